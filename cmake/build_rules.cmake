@@ -9,6 +9,8 @@ ELSEIF (CPP_LANGUAGE_VERSION STREQUAL "14")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++14")
 ELSEIF (CPP_LANGUAGE_VERSION STREQUAL "17")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++17")
+ELSEIF (CPP_LANGUAGE_VERSION STREQUAL "20")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++20")
 ELSEIF (CPP_LANGUAGE_VERSION STREQUAL "98")
 set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++98")
 ELSE (CPP_LANGUAGE_VERSION STREQUAL "0x")
@@ -17,9 +19,9 @@ set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11")
 endif (HAVE_CXX11)
 ENDIF (CPP_LANGUAGE_VERSION STREQUAL "0x")
 
-IF( CMAKE_CXX_FLAGS MATCHES "[-]std=c[+][+](11|14|17)" )
+IF( CMAKE_CXX_FLAGS MATCHES "[-]std=c[+][+](11|14|17|20)" )
 set( STRUS_CXX_STD_11 TRUE )
-ENDIF( CMAKE_CXX_FLAGS MATCHES "[-]std=c[+][+](11|14|17)" )
+ENDIF( CMAKE_CXX_FLAGS MATCHES "[-]std=c[+][+](11|14|17|20)" )
 
 IF (C_LANGUAGE_VERSION STREQUAL "99")
 set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -std=c99")
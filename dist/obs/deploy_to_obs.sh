@@ -0,0 +1,71 @@
+#!/bin/sh
+
+PACKAGE_NAME=strusbase
+PACKAGE_VERSION=0.17.0
+OSC_HOME=$HOME/home:PatrickFrey/$PACKAGE_NAME
+
+TMPDIR=/tmp
+
+if test "x$1" = "xtest"; then
+	rm -f ${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz
+	rm -rf $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}
+	cmake .
+	mkdir -p $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}
+	cp -R * $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}
+	OLDDIR=$PWD
+	cd $TMPDIR
+	( cd ${PACKAGE_NAME}-${PACKAGE_VERSION} && make clean distclean )
+	tar zcf $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz ${PACKAGE_NAME}-${PACKAGE_VERSION}
+	cd $OLDDIR
+	mv -f $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz .
+	rm -rf $TMPDIR/${PACKAGE_NAME}-${PACKAGE_VERSION}
+else
+	make dist-gz
+fi
+
+# git commit count since last tagging is used for a build number of
+# the package to make individual builds distinguishable
+
+GIT_COMMIT_COUNT=`git describe --long --tags | cut -f 2 -d -`
+
+# Redhat/SuSE
+
+cp ${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.tar.gz
+cp dist/redhat/$PACKAGE_NAME.spec $OSC_HOME/$PACKAGE_NAME.spec
+sed -i "s/Version:.*/Version: %{main_version}.${GIT_COMMIT_COUNT}/" $OSC_HOME/$PACKAGE_NAME.spec
+
+# Debian/Ubuntu
+
+cp ${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.orig.tar.gz
+
+SIZE=`stat -c '%s' $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.orig.tar.gz`
+CHKSUM=`md5sum $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.orig.tar.gz | cut -f 1 -d' '`
+
+cp dist/obs/$PACKAGE_NAME.dsc $OSC_HOME/$PACKAGE_NAME.dsc
+echo " $CHKSUM $SIZE ${PACKAGE_NAME}_${PACKAGE_VERSION}.orig.tar.gz" >> $OSC_HOME/$PACKAGE_NAME.dsc
+
+TMPDIR=/tmp
+rm -f $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz
+rm -rf $TMPDIR/debian
+cp -r dist/debian $TMPDIR/.
+sed -i "s/${PACKAGE_NAME} (\([0-9.]*\)-\([0-9]*\))/${PACKAGE_NAME} (\1-$GIT_COMMIT_COUNT)/" $TMPDIR/debian/changelog
+OLDDIR=$PWD
+cd $TMPDIR
+tar zcf $TMPDIR/${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz debian
+cd $OLDDIR
+rm -rf $TMPDIR/debian
+mv -f $TMPDIR/${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz $OSC_HOME/.
+DEBIAN_SIZE=`stat -c '%s' $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz`
+DEBIAN_CHKSUM=`md5sum  $OSC_HOME/${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz | cut -f 1 -d' '`
+echo " $DEBIAN_CHKSUM $DEBIAN_SIZE ${PACKAGE_NAME}_${PACKAGE_VERSION}.debian.tar.gz" >> $OSC_HOME/$PACKAGE_NAME.dsc
+
+# Archlinux
+
+cp ${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz $OSC_HOME/${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz
+
+CHKSUM=`md5sum $OSC_HOME/${PACKAGE_NAME}-${PACKAGE_VERSION}.tar.gz  | cut -f 1 -d' '`
+
+cat dist/archlinux/PKGBUILD > $OSC_HOME/PKGBUILD
+echo "md5sums=('$CHKSUM')" >> $OSC_HOME/PKGBUILD
+
+sed -i "s/^pkgver=.*/pkgver=\${_mainpkgver}.r${GIT_COMMIT_COUNT}/" $OSC_HOME/PKGBUILD
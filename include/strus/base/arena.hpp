@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Arena allocator for objects that are all freed together, with an allocator adaptor for STL containers
+/// \file arena.hpp
+#ifndef _STRUS_BASE_ARENA_HPP_INCLUDED
+#define _STRUS_BASE_ARENA_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <cstddef>
+#include <new>
+#include <limits>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+#if __cplusplus >= 201103L
+#define STRUS_ALIGNOF(TYPE) alignof(TYPE)
+#else
+#define STRUS_ALIGNOF(TYPE) __alignof__(TYPE)
+#endif
+
+namespace strus
+{
+
+/// \brief Allocator of memory in chunks, where single allocations are not freed, but everything allocated after a mark is freed at once
+/// \note Chunks released by rewind or clear are kept for reuse, so an arena used for one request after the other does not call malloc anymore after a while
+/// \note Not thread safe, use one arena per thread (see Arena::local())
+/// \note Allocation errors are reported with std::bad_alloc
+class Arena
+{
+public:
+	enum {
+		DefaultChunkSize=16384,		///< default size of a chunk
+		DefaultAlignment=16,		///< default alignment of a block allocated, sufficient for all fundamental types
+		MaxNofFreeChunks=64		///< maximum number of chunks kept for reuse
+	};
+
+	/// \brief Constructor
+	/// \param[in] chunkSize_ size of the chunks allocated in bytes, bigger allocations get a chunk of their own and the allocation continues in the current chunk
+	explicit Arena( std::size_t chunkSize_=DefaultChunkSize)
+		:m_chunkSize(chunkSize_ < 256 ? 256 : chunkSize_),m_cur(0),m_pos(1),m_end(0),m_free(0),m_nofFree(0),m_nofChunks(0){}
+	/// \brief Destructor, frees all memory
+	~Arena();
+
+	/// \brief Allocate a block of memory
+	/// \param[in] size size of the block in bytes
+	/// \param[in] alignment alignment of the block, a power of 2
+	/// \return pointer to the block
+	void* alloc( std::size_t size, std::size_t alignment=DefaultAlignment)
+	{
+		uintptr_t pos = (m_pos + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+		if (pos <= m_end && size <= m_end - pos)
+		{
+			m_pos = pos + size;
+			return (void*)pos;
+		}
+		return allocChunk( size, alignment);
+	}
+
+	/// \brief Allocate an array of objects, the objects are not constructed
+	/// \param[in] nofElements number of elements of the array
+	/// \return pointer to the array
+	template <class Object>
+	Object* allocArray( std::size_t nofElements)
+	{
+		if (nofElements > std::numeric_limits<std::size_t>::max() / sizeof(Object)) throw std::bad_alloc();
+		return (Object*)alloc( nofElements * sizeof(Object), STRUS_ALIGNOF(Object));
+	}
+
+	/// \brief Allocate a 0-terminated copy of a string
+	/// \param[in] str pointer to the string
+	/// \param[in] size size of the string in bytes
+	/// \return the copy
+	const char* allocStringCopy( const char* str, std::size_t size);
+
+	/// \brief Position in an arena to rewind to
+	struct Mark
+	{
+		void* chunk;		///< last chunk allocated
+		uintptr_t pos;		///< address of the free memory in the chunk allocations are taken from
+		uintptr_t end;		///< end address of the chunk allocations are taken from
+
+		Mark( void* chunk_, uintptr_t pos_, uintptr_t end_)
+			:chunk(chunk_),pos(pos_),end(end_){}
+		Mark( const Mark& o)
+			:chunk(o.chunk),pos(o.pos),end(o.end){}
+	};
+
+	/// \brief Get the current position to rewind to later
+	/// \return the mark
+	Mark mark() const
+	{
+		return Mark( m_cur, m_pos, m_end);
+	}
+
+	/// \brief Free everything allocated after a mark was taken
+	/// \param[in] mark_ mark returned by mark()
+	void rewind( const Mark& mark_);
+
+	/// \brief Free everything allocated
+	void clear()
+	{
+		rewind( Mark( 0, 1, 0));
+	}
+
+	/// \brief Rewinds the arena to the position at construction of the scope when leaving the scope
+	class Scope
+	{
+	public:
+		explicit Scope( Arena& arena_)
+			:m_arena(arena_),m_mark(arena_.mark()){}
+		~Scope()
+		{
+			m_arena.rewind( m_mark);
+		}
+
+	private:
+		Scope( const Scope&);			///> non copyable
+		void operator=( const Scope&);		///> non copyable
+
+	private:
+		Arena& m_arena;
+		Mark m_mark;
+	};
+
+	/// \brief Get the number of chunks in use
+	std::size_t nofChunks() const
+	{
+		return m_nofChunks;
+	}
+
+	/// \brief Get the arena of the current thread
+	/// \note The arena is freed when the thread terminates
+	static Arena& local();
+
+private:
+	void* allocChunk( std::size_t size, std::size_t alignment);
+
+	struct Chunk;
+	static char* chunkData( Chunk* chunk);
+	void releaseChunk( Chunk* chunk);
+
+private:
+	Arena( const Arena&){}			///> non copyable
+	void operator=( const Arena&){}		///> non copyable
+
+private:
+	std::size_t m_chunkSize;
+	Chunk* m_cur;				///< last chunk allocated, linked with the chunks allocated before
+	uintptr_t m_pos;			///< address of the free memory in the chunk allocations are taken from (1 without chunk, so that every allocation takes the slow path)
+	uintptr_t m_end;			///< end address of the chunk allocations are taken from (0 without chunk), not the last chunk if that one holds an oversized block
+	Chunk* m_free;				///< list of chunks of the default size for reuse
+	std::size_t m_nofFree;
+	std::size_t m_nofChunks;
+};
+
+
+/// \brief Allocator for STL containers allocating from an arena
+/// \note Deallocate does nothing, the memory is freed with the arena (rewind or clear)
+/// \note Example: std::vector<int,strus::ArenaAllocator<int> > vec( strus::ArenaAllocator<int>( arena));
+template <typename Element>
+class ArenaAllocator
+{
+public:
+	typedef Element value_type;
+	typedef Element* pointer;
+	typedef const Element* const_pointer;
+	typedef Element& reference;
+	typedef const Element& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <typename Other>
+	struct rebind
+	{
+		typedef ArenaAllocator<Other> other;
+	};
+
+	explicit ArenaAllocator( Arena& arena_)
+		:m_arena(&arena_){}
+	ArenaAllocator( const ArenaAllocator& o)
+		:m_arena(o.m_arena){}
+	template <typename Other>
+	ArenaAllocator( const ArenaAllocator<Other>& o)
+		:m_arena(o.arena()){}
+
+	pointer allocate( size_type nofElements, const void* = 0)
+	{
+		return m_arena->allocArray<Element>( nofElements);
+	}
+	void deallocate( pointer, size_type)
+	{}
+
+	size_type max_size() const
+	{
+		return std::numeric_limits<size_type>::max() / sizeof(Element);
+	}
+
+	void construct( pointer ptr, const_reference value)
+	{
+		new ((void*)ptr) Element( value);
+	}
+	void destroy( pointer ptr)
+	{
+		ptr->~Element();
+	}
+#if __cplusplus >= 201103L
+	template <typename Other, typename... Args>
+	void construct( Other* ptr, Args&&... args)
+	{
+		new ((void*)ptr) Other( std::forward<Args>(args)...);
+	}
+	template <typename Other>
+	void destroy( Other* ptr)
+	{
+		ptr->~Other();
+	}
+#endif
+	pointer address( reference value) const
+	{
+		return &value;
+	}
+	const_pointer address( const_reference value) const
+	{
+		return &value;
+	}
+
+	Arena* arena() const
+	{
+		return m_arena;
+	}
+
+	template <typename Other>
+	bool operator==( const ArenaAllocator<Other>& o) const
+	{
+		return m_arena == o.arena();
+	}
+	template <typename Other>
+	bool operator!=( const ArenaAllocator<Other>& o) const
+	{
+		return m_arena != o.arena();
+	}
+
+private:
+	Arena* m_arena;
+};
+
+}//namespace
+#endif
+
@@ -38,6 +38,8 @@ class atomic
 	:public std::atomic<X>
 {
 public:
+	atomic()
+		:std::atomic<X>(X()){}
 	atomic( X value)
 		:std::atomic<X>(value){}
 	atomic( const atomic& o)
@@ -58,6 +60,8 @@ class atomic
 	:public boost::atomic<X>
 {
 public:
+	atomic()
+		:boost::atomic<X>(X()){}
 	atomic( X value)
 		:boost::atomic<X>(value){}
 	atomic( const atomic& o)
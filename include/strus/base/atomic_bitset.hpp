@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Bitsets with atomic operations for marking positions from several threads without locking
+/// \file atomic_bitset.hpp
+#ifndef _STRUS_ATOMIC_BITSET_HPP_INCLUDED
+#define _STRUS_ATOMIC_BITSET_HPP_INCLUDED
+#include "strus/base/atomic.hpp"
+#include "strus/base/bitset.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/stdint.h"
+#include <vector>
+#include <limits>
+#include <new>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Operations on an array of atomic 64 bit words shared by atomic_bitset and atomic_dynamic_bitset
+/// \note Every operation is atomic for one word only, operations on more than one word (reset, join, count, next) are not atomic as a whole
+struct atomic_bitset_words
+{
+	typedef strus::atomic<uint64_t> Word;
+
+	/// \brief Set a bit
+	/// \return the value of the bit before the operation
+	/// \note The word is read before the read-modify-write operation, so that marking a bit already set does not acquire the cache line exclusively
+	static bool test_and_set( Word* ar, std::size_t pos)
+	{
+		uint64_t mask = (uint64_t)1 << (pos % 64);
+		Word& word = ar[ pos / 64];
+		if (word.load() & mask) return true;
+		return (word.fetch_or( mask) & mask) != 0;
+	}
+	/// \brief Clear a bit
+	/// \return the value of the bit before the operation
+	static bool test_and_reset( Word* ar, std::size_t pos)
+	{
+		uint64_t mask = (uint64_t)1 << (pos % 64);
+		Word& word = ar[ pos / 64];
+		if (!(word.load() & mask)) return false;
+		return (word.fetch_and( ~mask) & mask) != 0;
+	}
+	static bool test( const Word* ar, std::size_t pos)
+	{
+		return (ar[ pos / 64].load() & ((uint64_t)1 << (pos % 64))) != 0;
+	}
+	static void reset( Word* ar, std::size_t nofWords)
+	{
+		std::size_t wi = 0;
+		for (; wi < nofWords; ++wi) ar[ wi].store( 0);
+	}
+	/// \brief Add the bits of an array of words, skipping words without new bits
+	/// \return true if the operation changed the contents of the set
+	static bool join( Word* ar, const uint64_t* src, std::size_t nofWords)
+	{
+		bool rt = false;
+		std::size_t wi = 0;
+		for (; wi < nofWords; ++wi)
+		{
+			if (src[ wi] & ~ar[ wi].load())
+			{
+				rt |= ((ar[ wi].fetch_or( src[ wi]) & src[ wi]) != src[ wi]);
+			}
+		}
+		return rt;
+	}
+	static std::size_t count( const Word* ar, std::size_t nofWords)
+	{
+		std::size_t rt = 0;
+		std::size_t wi = 0;
+		for (; wi < nofWords; ++wi) rt += BitOperations::bitCount( (uint64_t)ar[ wi].load());
+		return rt;
+	}
+	/// \brief Get the next bit set with position strictly higher than the position passed as argument
+	/// \note Every word is loaded once, a bit set or cleared concurrently is seen if the operation happened before the load of its word
+	static int next( const Word* ar, std::size_t nofWords, int pos)
+	{
+		++pos;
+		if (pos < 0) return -1;
+		std::size_t wi = (unsigned int)pos / 64;
+		if (wi >= nofWords) return -1;
+		uint64_t start = ar[ wi].load() & ~((((uint64_t)1) << (pos % 64)) - 1);
+		if (start)
+		{
+			return wi * 64 + BitOperations::bitScanForward( start) - 1;
+		}
+		for (++wi; wi < nofWords; ++wi)
+		{
+			uint64_t word = ar[ wi].load();
+			if (word)
+			{
+				return wi * 64 + BitOperations::bitScanForward( word) - 1;
+			}
+		}
+		return -1;
+	}
+	static std::vector<int> elements( const Word* ar, std::size_t nofWords)
+	{
+		std::vector<int> rt;
+		int pi = next( ar, nofWords, -1);
+		for (; pi >= 0; pi = next( ar, nofWords, pi))
+		{
+			rt.push_back( pi);
+		}
+		return rt;
+	}
+};
+
+/// \brief Bitset with a dimension defined by the template argument, where bits can be set and cleared concurrently by several threads without locking
+/// \note Same interface as bitset for the operations that can be implemented with atomic operations on one word (fetch_or/fetch_and)
+template <int SIZE>
+class atomic_bitset
+{
+public:
+	/// \brief Constructor, the words are zero initialized by their default constructor
+	atomic_bitset(){}
+
+	/// \brief Set or clear a bit on a defined position
+	/// \return true, if the content of the set has changed with the operation
+	bool set( int pos, bool value)
+	{
+		if ((unsigned int)pos >= SIZE) return false;
+		return value
+			? !atomic_bitset_words::test_and_set( m_ar, pos)
+			: atomic_bitset_words::test_and_reset( m_ar, pos);
+	}
+	/// \brief Set a bit on a defined position
+	/// \return the value of the bit before the operation, false for a position out of range
+	/// \note Exactly one of several threads setting the same bit concurrently gets false, useful for deduplication
+	bool test_and_set( int pos)
+	{
+		if ((unsigned int)pos >= SIZE) return false;
+		return atomic_bitset_words::test_and_set( m_ar, pos);
+	}
+	/// \brief Clear a bit on a defined position
+	/// \return the value of the bit before the operation
+	bool test_and_reset( int pos)
+	{
+		if ((unsigned int)pos >= SIZE) return false;
+		return atomic_bitset_words::test_and_reset( m_ar, pos);
+	}
+	/// \brief Test a bit on a defined position
+	bool test( int pos) const
+	{
+		if ((unsigned int)pos >= SIZE) return false;
+		return atomic_bitset_words::test( m_ar, pos);
+	}
+	/// \brief Zero all bits of the set
+	void reset()
+	{
+		atomic_bitset_words::reset( m_ar, ArSize);
+	}
+
+	/// \brief Add the elements of an equally dimensioned set
+	/// \return true if operation changed the contents of the set
+	bool join( const bitset<SIZE>& o)
+	{
+		return atomic_bitset_words::join( m_ar, o.data(), ArSize);
+	}
+
+	/// \brief Get the next bit set with position strictly higher than the position passed as argument
+	/// \return the position of the bit or -1 if there is none
+	/// \note May be called concurrently to set, bits changed concurrently are seen if they were changed before their word is visited
+	int next( int pos) const
+	{
+		return atomic_bitset_words::next( m_ar, ArSize, pos);
+	}
+	/// \brief Get the first bit set
+	/// \return the position of the bit or -1 if the set is empty
+	int first() const
+	{
+		return next( -1);
+	}
+	/// \brief Get the positions of the bits set in ascending order
+	std::vector<int> elements() const
+	{
+		return atomic_bitset_words::elements( m_ar, ArSize);
+	}
+	/// \brief Get the number of set bits in the set
+	std::size_t size() const
+	{
+		return atomic_bitset_words::count( m_ar, ArSize);
+	}
+	/// \brief Test if the set is empty (contains no bits set)
+	bool empty() const
+	{
+		return first() < 0;
+	}
+
+private:
+	atomic_bitset( const atomic_bitset&);		///> non copyable
+	void operator=( const atomic_bitset&);		///> non copyable
+
+private:
+	enum {ArSize=(SIZE+63)/64};
+	atomic_bitset_words::Word m_ar[ ArSize];
+};
+
+/// \brief Bitset with a dimension defined by the constructor, where bits can be set and cleared concurrently by several threads without locking
+/// \note Same interface as dynamic_bitset for the operations that can be implemented with atomic operations on one word (fetch_or/fetch_and)
+/// \note The words are allocated in the constructor, unlike dynamic_bitset the structure is never changed by setting a bit
+class atomic_dynamic_bitset
+{
+public:
+	/// \brief Constructor
+	/// \param[in] size_ dimension of the set, the positions allowed are 0 to size_-1
+	explicit atomic_dynamic_bitset( std::size_t size_)
+		:m_size(size_),m_nofWords((size_+63)/64),m_ar(0)
+	{
+		if (size_ > (std::size_t)std::numeric_limits<int32_t>::max()) throw std::bad_alloc();
+		m_ar = new atomic_bitset_words::Word[ m_nofWords];
+	}
+	~atomic_dynamic_bitset()
+	{
+		delete [] m_ar;
+	}
+
+	/// \brief Set or clear a bit on a defined position
+	/// \return true, if the content of the set has changed with the operation
+	bool set( std::size_t n, bool val = true)
+	{
+		if (n >= m_size) return false;
+		return val
+			? !atomic_bitset_words::test_and_set( m_ar, n)
+			: atomic_bitset_words::test_and_reset( m_ar, n);
+	}
+	/// \brief Set a bit on a defined position
+	/// \return the value of the bit before the operation, false for a position out of range
+	/// \note Exactly one of several threads setting the same bit concurrently gets false, useful for deduplication
+	bool test_and_set( std::size_t n)
+	{
+		if (n >= m_size) return false;
+		return atomic_bitset_words::test_and_set( m_ar, n);
+	}
+	/// \brief Clear a bit on a defined position
+	/// \return the value of the bit before the operation
+	bool test_and_reset( std::size_t n)
+	{
+		if (n >= m_size) return false;
+		return atomic_bitset_words::test_and_reset( m_ar, n);
+	}
+	/// \brief Test a bit on a defined position
+	bool test( std::size_t n) const
+	{
+		if (n >= m_size) return false;
+		return atomic_bitset_words::test( m_ar, n);
+	}
+	/// \brief Zero all bits of the set
+	void reset()
+	{
+		atomic_bitset_words::reset( m_ar, m_nofWords);
+	}
+
+	/// \brief Get the dimension of the set
+	std::size_t size() const
+	{
+		return m_size;
+	}
+	/// \brief Get the number of bits set
+	std::size_t count() const
+	{
+		return atomic_bitset_words::count( m_ar, m_nofWords);
+	}
+
+	/// \brief Get the next bit set with position strictly higher than the position passed as argument
+	/// \return the position of the bit or -1 if there is none
+	/// \note May be called concurrently to set, bits changed concurrently are seen if they were changed before their word is visited
+	int next( int pos) const
+	{
+		return atomic_bitset_words::next( m_ar, m_nofWords, pos);
+	}
+	/// \brief Get the first bit set
+	/// \return the position of the bit or -1 if the set is empty
+	int first() const
+	{
+		return next( -1);
+	}
+	/// \brief Get the positions of the bits set in ascending order
+	std::vector<int> elements() const
+	{
+		return atomic_bitset_words::elements( m_ar, m_nofWords);
+	}
+
+private:
+	atomic_dynamic_bitset( const atomic_dynamic_bitset&);		///> non copyable
+	void operator=( const atomic_dynamic_bitset&);			///> non copyable
+
+private:
+	std::size_t m_size;			///< dimension of the set
+	std::size_t m_nofWords;			///< number of words allocated
+	atomic_bitset_words::Word* m_ar;	///< words with the bits of the set
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Bulk operations on arrays of 64 bit words of bitsets with SIMD implementations selected at runtime
+/// \file bitSetKernels.hpp
+#ifndef _STRUS_BASE_BITSET_KERNELS_HPP_INCLUDED
+#define _STRUS_BASE_BITSET_KERNELS_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Bulk operations on arrays of 64 bit words used by bitset, dynamic_bitset and compressed_bitset
+/// \note The implementation is selected at program start from the instruction sets supported by the CPU (AVX-512, AVX2 or scalar code as fallback)
+/// \note The arrays of operands must not overlap partially, they may be identical
+struct BitSetKernels
+{
+	/// \brief Instruction set of an implementation
+	enum Isa {IsaScalar,IsaAVX2,IsaAVX512};
+
+	/// \brief Get the instruction set of the implementation in use
+	static Isa isa();
+	/// \brief Test if the implementation with an instruction set is available on this machine
+	static bool supported( Isa isa_);
+	/// \brief Select the implementation with an instruction set, for tests and benchmarks
+	/// \note Not thread safe, must not be called while bitset operations are executed
+	/// \return true on success, false if the instruction set is not supported by this machine or this build
+	static bool select( Isa isa_);
+	/// \brief Get the name of an instruction set
+	static const char* isaName( Isa isa_);
+
+	/// \brief Union dst |= src
+	/// \return true if dst has changed
+	static bool join( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+	/// \brief Union dst |= src
+	/// \return the number of bits changed in dst
+	static std::size_t join_count( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+	/// \brief Intersection dst &= src
+	/// \return true if dst has changed
+	static bool intersect( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+	/// \brief Difference dst &= ~src
+	/// \return true if dst has changed
+	static bool subtract( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+	/// \brief Symmetric difference dst ^= src
+	/// \return true if dst has changed
+	static bool toggle( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+	/// \brief Get the number of bits set
+	static std::size_t count( const uint64_t* ar, std::size_t nofWords);
+	/// \brief Get the index of the first word that differs in two arrays
+	/// \return the index of the word or nofWords if the arrays are equal
+	static std::size_t mismatch( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords);
+};
+
+}//namespace
+#endif
+
@@ -10,6 +10,7 @@
 #ifndef _STRUS_BITSET_HPP_INCLUDED
 #define _STRUS_BITSET_HPP_INCLUDED
 #include "strus/base/bitOperations.hpp"
+#include "strus/base/bitSetKernels.hpp"
 #include "strus/base/stdint.h"
 #include <vector>
 
@@ -269,6 +270,7 @@ public:
 	/// \return true if operation changed the contents of the set
 	bool join( const bitset<SIZE>& o)
 	{
+		if (ArSize >= KernelMinArSize) return BitSetKernels::join( m_ar, o.m_ar, ArSize);
 		bool rt = false;
 		for (int ai=0; ai<ArSize; ++ai)
 		{
@@ -283,6 +285,7 @@ public:
 	/// \return return the number of changes
 	int join_count( const bitset<SIZE>& o)
 	{
+		if (ArSize >= KernelMinArSize) return BitSetKernels::join_count( m_ar, o.m_ar, ArSize);
 		int rt = 0;
 		for (int ai=0; ai<ArSize; ++ai)
 		{
@@ -293,10 +296,55 @@ public:
 		return rt;
 	}
 
+	/// \brief Remove the elements not in an equally dimensioned set (intersection)
+	/// \return true if operation changed the contents of the set
+	bool intersect( const bitset<SIZE>& o)
+	{
+		if (ArSize >= KernelMinArSize) return BitSetKernels::intersect( m_ar, o.m_ar, ArSize);
+		bool rt = false;
+		for (int ai=0; ai<ArSize; ++ai)
+		{
+			uint64_t ee = m_ar[ai] & o.m_ar[ai];
+			rt |= (ee != m_ar[ai]);
+			m_ar[ai] = ee;
+		}
+		return rt;
+	}
+
+	/// \brief Remove the elements of an equally dimensioned set (difference)
+	/// \return true if operation changed the contents of the set
+	bool subtract( const bitset<SIZE>& o)
+	{
+		if (ArSize >= KernelMinArSize) return BitSetKernels::subtract( m_ar, o.m_ar, ArSize);
+		bool rt = false;
+		for (int ai=0; ai<ArSize; ++ai)
+		{
+			uint64_t ee = m_ar[ai] & ~o.m_ar[ai];
+			rt |= (ee != m_ar[ai]);
+			m_ar[ai] = ee;
+		}
+		return rt;
+	}
+
+	/// \brief Toggle the bits of the elements of an equally dimensioned set (symmetric difference)
+	/// \return true if operation changed the contents of the set
+	bool toggle( const bitset<SIZE>& o)
+	{
+		if (ArSize >= KernelMinArSize) return BitSetKernels::toggle( m_ar, o.m_ar, ArSize);
+		bool rt = false;
+		for (int ai=0; ai<ArSize; ++ai)
+		{
+			rt |= (o.m_ar[ai] != 0);
+			m_ar[ai] ^= o.m_ar[ai];
+		}
+		return rt;
+	}
+
 	/// \brief Get the number of set bits in the set
 	/// \return the number of non-zero bits
 	std::size_t size() const
 	{
+		if (ArSize >= KernelMinArSizeCount) return BitSetKernels::count( m_ar, ArSize);
 		std::size_t rt = 0;
 		for (int ai=0; ai<ArSize; ++ai)
 		{
@@ -305,6 +353,12 @@ public:
 		return rt;
 	}
 
+	/// \brief Get the array of 64 bit words representing the set, the lowest bit of the first word is the element with position 0
+	const uint64_t* data() const
+	{
+		return m_ar;
+	}
+
 	/// \brief Comparison (lesser) of two sets
 	/// \return true if yes, false if no
 	bool operator < (const bitset& o) const
@@ -324,7 +378,11 @@ public:
 	}
 
 private:
-	enum {ArSize=(SIZE+63)/64};
+	enum {
+		ArSize=(SIZE+63)/64,
+		KernelMinArSize=4,		///< minimum number of words for calling BitSetKernels for set operations, for smaller sets the inline loop is faster
+		KernelMinArSizeCount=2		///< minimum number of words for calling BitSetKernels for counting
+	};
 	uint64_t m_ar[ ArSize];
 };
 
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Compressed bitset (roaring bitmap) with array, bitmap and run containers
+/// \file compressed_bitset.hpp
+#ifndef _STRUS_COMPRESSED_BITSET_HPP_INCLUDED
+#define _STRUS_COMPRESSED_BITSET_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Bitset with a dimension defined by the constructor, compressed for sparse sets and sets with long runs of consecutive positions
+/// \note Same interface as dynamic_bitset, for big dimensions where dynamic_bitset wastes memory
+/// \note The positions are partitioned by their upper 16 bits into chunks of 65536 positions. Every non empty chunk is represented by a container,
+///	that is either a sorted array of up to 4096 positions, a bitmap of 65536 bits or a sorted list of runs of consecutive positions.
+/// \note Set operations and the cardinality are evaluated container by container, chunks that are empty in one of the operands are skipped or copied
+/// \remark Implements the scheme of RoaringBitmap (see https://github.com/RoaringBitmap/CRoaring/blob/master/include/roaring/roaring.h)
+class compressed_bitset
+{
+public:
+	/// \brief Constructor
+	/// \param[in] size_ dimension of the set, the positions allowed are 0 to size_-1
+	explicit compressed_bitset( std::size_t size_);
+	compressed_bitset( const compressed_bitset& o)
+		:m_size(o.m_size),m_keys(o.m_keys),m_containers(o.m_containers){}
+	compressed_bitset& operator=( const compressed_bitset& o)
+		{m_size = o.m_size; m_keys = o.m_keys; m_containers = o.m_containers; return *this;}
+#if __cplusplus >= 201103L
+	compressed_bitset( compressed_bitset&& o)
+		:m_size(o.m_size),m_keys(std::move(o.m_keys)),m_containers(std::move(o.m_containers)){}
+	compressed_bitset& operator=( compressed_bitset&& o)
+		{m_size = o.m_size; m_keys = std::move(o.m_keys); m_containers = std::move(o.m_containers); return *this;}
+#endif
+
+	/// \brief Set or clear a bit on a defined position
+	/// \return true, if the content of the set has changed with the operation
+	bool set( std::size_t n, bool val = true);
+	/// \brief Test a bit on a defined position
+	bool test( std::size_t n) const;
+	/// \brief Zero all bits of the set
+	void reset();
+
+	/// \brief Get the dimension of the set
+	std::size_t size() const
+	{
+		return m_size;
+	}
+	/// \brief Get the number of bits set
+	std::size_t count() const;
+	/// \brief Test if the set is empty (contains no bits set)
+	bool empty() const
+	{
+		return m_keys.empty();
+	}
+
+	/// \brief Get the next bit set with position strictly higher than the position passed as argument
+	/// \return the position of the bit or -1 if there is none
+	int next( int pos) const;
+	/// \brief Get the first bit set
+	/// \return the position of the bit or -1 if the set is empty
+	int first() const
+	{
+		return next( -1);
+	}
+	/// \brief Get the positions of the bits set in ascending order
+	std::vector<int> elements() const;
+
+	/// \brief Union with a set of the same dimension
+	compressed_bitset& operator |= ( const compressed_bitset& o);
+	/// \brief Intersection with a set of the same dimension
+	compressed_bitset& operator &= ( const compressed_bitset& o);
+	/// \brief Symmetric difference with a set of the same dimension
+	compressed_bitset& operator ^= ( const compressed_bitset& o);
+	/// \brief Difference (and not) with a set of the same dimension
+	compressed_bitset& operator -= ( const compressed_bitset& o);
+
+	/// \brief Get the cardinality of the intersection with another set without building it
+	std::size_t count_and( const compressed_bitset& o) const;
+
+	/// \brief Test if two sets have the same elements
+	bool operator == ( const compressed_bitset& o) const;
+	bool operator != ( const compressed_bitset& o) const
+	{
+		return !operator==( o);
+	}
+
+	/// \brief Convert every container to the representation needing the least memory (including run containers) and release memory not used
+	/// \note Containers are compressed as runs by set operations, but not by set, so this method should be called after building a set with set
+	void optimize();
+
+	/// \brief Get the number of bytes allocated for the set
+	std::size_t allocated() const;
+
+public:
+	/// \brief Container of the positions of a chunk (lower 16 bits), for internal use only
+	struct Container
+	{
+		enum Type {ArrayType,BitmapType,RunType};
+
+		unsigned char type;		///< representation of the positions
+		unsigned int card;		///< number of positions in the container
+		std::vector<uint16_t> values;	///< sorted positions (ArrayType) or pairs of first and last positions of runs (RunType)
+		std::vector<uint64_t> words;	///< 1024 words with a bit for each position (BitmapType)
+
+		Container()
+			:type(ArrayType),card(0),values(),words(){}
+
+		void swap( Container& o)
+		{
+			std::swap( type, o.type);
+			std::swap( card, o.card);
+			values.swap( o.values);
+			words.swap( o.words);
+		}
+	};
+
+private:
+	/// \brief Get the index of the container of a chunk or of the first container with a higher chunk key if it does not exist
+	std::size_t findContainer( uint16_t key) const;
+
+private:
+	std::size_t m_size;			///< dimension of the set
+	std::vector<uint16_t> m_keys;		///< ascending upper 16 bits of the positions of the non empty chunks
+	std::vector<Container> m_containers;	///< containers of the non empty chunks, parallel to m_keys
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Map of strings to indices shared between threads, with lock free lookups and inserts distributed on independent shards
+///\file concurrentSymbolTable.hpp
+#ifndef _STRUS_BASE_CONCURRENT_SYMBOL_TABLE_HPP_INCLUDED
+#define _STRUS_BASE_CONCURRENT_SYMBOL_TABLE_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+#include <new>
+
+namespace strus
+{
+/// \brief Forward declaration
+class ErrorBufferInterface;
+
+///\brief Map of strings to indices not freed till end of table life time, that can be accessed by many threads concurrently
+///\note The handles are the same as for SymbolTable: dense, starting with 1 and never reused
+///\note Lookups (get,key) do not lock, inserts (getOrCreate) lock only the shard the key is assigned to
+class ConcurrentSymbolTable
+{
+public:
+	///\brief Constructor
+	///\param[in] errorhnd_ error buffer interface for reporting errors
+	///\param[in] nofShards_ number of independent shards for writers (rounded up to a power of 2), 0 for a default derived from the number of cores
+	explicit ConcurrentSymbolTable( ErrorBufferInterface* errorhnd_, int nofShards_=0)
+		:m_data(0)
+	{
+		if (!init( errorhnd_, nofShards_)) throw std::bad_alloc();
+	}
+	///\brief Destructor
+	~ConcurrentSymbolTable();
+
+	///\brief Get handle ( >= 1) associated with key, create one if not defined
+	///\param[in] key string
+	///\return the handle for the key or 0 on a memory allocation error
+	uint32_t getOrCreate( const std::string& key);
+	///\brief Get handle ( >= 1) associated with key, create one if not defined
+	///\param[in] key key string poiner
+	///\param[in] keysize size of key in bytes
+	///\return the handle for the key or 0 on a memory allocation error
+	uint32_t getOrCreate( const char* key, std::size_t keysize);
+	///\brief Get handle ( >= 1) associated with key, create one if not defined
+	///\param[in] key key string poiner
+	///\param[in] keysize size of key in bytes
+	///\param[out] isNew true if the symbol was created with this call
+	///\return the handle for the key or 0 on a memory allocation error
+	///\remark Replaces SymbolTable::isNew() that has no meaning with concurrent callers
+	uint32_t getOrCreate( const char* key, std::size_t keysize, bool& isNew);
+
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key string
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const std::string& key) const;
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key key string poiner
+	///\param[in] keysize size of key in bytes
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const char* key, std::size_t keysize) const;
+
+	///\brief Inverse lookup, get key of handle
+	///\param[in] id key handle
+	///\return the key string or NULL if not defined
+	const char* key( const uint32_t& id) const;
+
+	///\brief Get number of elements defined
+	///\note The result may include handles of symbols that are just being created by another thread
+	///\return the number of elements defined
+	std::size_t size() const;
+
+	///\brief Evaluate if the symbol table is empty, without any definitions
+	///\return true if yes
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	///\brief Free all keys allocated
+	///\remark Not thread safe, no other thread may access the table during this call
+	void clear();
+
+private:
+#if __cplusplus >= 201103L
+	ConcurrentSymbolTable( const ConcurrentSymbolTable&) = delete;
+	void operator=( const ConcurrentSymbolTable&) = delete;
+#else
+	ConcurrentSymbolTable( const ConcurrentSymbolTable&){}	///> non copyable
+	void operator=( const ConcurrentSymbolTable&){}		///> non copyable
+#endif
+	bool init( ErrorBufferInterface* errorhnd_, int nofShards_);
+
+private:
+	struct Data;
+	Data* m_data;
+};
+
+}//namespace
+#endif
+
@@ -23,6 +23,25 @@ public:
 	static uint32_t calc( const char* blk);
 };
 
+/// \brief Class with some functions to calculate a CRC32C value (Castagnoli polynomial) of a buffer (memory area)
+/// \note Uses the SSE4.2 crc32 instruction if the CPU supports it (evaluated at runtime), a table driven implementation otherwise
+class Crc32c
+{
+public:
+	static uint32_t calc( const char* blk, std::size_t blksize);
+	static uint32_t calc( const char* blk);
+
+	/// \brief Evaluate if the CPU instruction is used for the calculation
+	/// \return true if yes
+	static bool hardwareSupported();
+
+	/// \brief Select the implementation with the CPU instruction or the table driven implementation, for tests and benchmarks
+	/// \note Not thread safe, must not be called while CRC32C values are calculated
+	/// \param[in] hardware true for the implementation with the CPU instruction, false for the table driven implementation
+	/// \return true on success, false if the CPU instruction is not supported by this machine or this build
+	static bool selectHardware( bool hardware);
+};
+
 }}
 #endif
 
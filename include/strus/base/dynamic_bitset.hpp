@@ -10,6 +10,8 @@
 #define _STRUS_DYNAMIC_BITSET_HPP_INCLUDED
 #include "strus/base/bitset.hpp"
 #include <utility>
+#include <iterator>
+#include <cstddef>
 
 /// PF:HACK: Bad solution, need probing of dynamic_bitset as C++ feature as for regex
 #if defined __GNUC__
@@ -27,51 +29,105 @@
 #endif // __clang__
 #endif // __cplusplus
 
+namespace strus {
+
+/// \brief Iterator on the positions of the bits set in a dynamic_bitset
+template <class BitSet>
+class dynamic_bitset_const_iterator
+{
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef int value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const int* pointer;
+	typedef const int& reference;
+
+	dynamic_bitset_const_iterator()
+		:m_set(0),m_pos(-1){}
+	dynamic_bitset_const_iterator( const BitSet* set_, int pos_)
+		:m_set(set_),m_pos(pos_){}
+
+	const int& operator*() const
+	{
+		return m_pos;
+	}
+	dynamic_bitset_const_iterator& operator++()
+	{
+		m_pos = m_set->next( m_pos);
+		return *this;
+	}
+	dynamic_bitset_const_iterator operator++(int)
+	{
+		dynamic_bitset_const_iterator rt( *this);
+		m_pos = m_set->next( m_pos);
+		return rt;
+	}
+	bool operator==( const dynamic_bitset_const_iterator& o) const
+	{
+		return m_pos == o.m_pos;
+	}
+	bool operator!=( const dynamic_bitset_const_iterator& o) const
+	{
+		return m_pos != o.m_pos;
+	}
+
+private:
+	const BitSet* m_set;
+	int m_pos;
+};
+
+}//namespace
+
 #ifdef STRUS_USE_STD_DYNAMIC_BITSET
 #include <vector>
 #include <algorithm>
 #include "strus/base/stdint.h"
+#include "strus/base/bitSetKernels.hpp"
+#include "strus/base/static_assert.hpp"
 #include <limits>
 namespace strus {
 
 /// \brief Bitset with a dimension defined by the constructor
-/// \remark Possible alternative: Library RoaringBitmap (see https://github.com/RoaringBitmap/CRoaring/blob/master/include/roaring/roaring.h)
+/// \note Blocks of 256 bits are allocated on the first bit set in them, set operations, count and iteration skip blocks not allocated
+/// \remark Possible alternative: Library RoaringBitmap (see https://github.com/RoaringBitmap/CRoaring/blob/master/include/roaring/roaring.h), see compressed_bitset
 class dynamic_bitset
 {
 public:
+	typedef dynamic_bitset_const_iterator<dynamic_bitset> const_iterator;
+
 	explicit dynamic_bitset( std::size_t size_)
-		:m_indices( (size_+(ElementDim-1)) / ElementDim, -1),m_elements()
+		:m_size(size_),m_indices( (size_+(ElementDim-1)) / ElementDim, -1),m_elements(),m_blocks()
 	{
 		if (size_ > (std::size_t)std::numeric_limits<int32_t>::max()) throw std::bad_alloc();
 	}
 	dynamic_bitset( const dynamic_bitset& o)
-		:m_indices(o.m_indices),m_elements(o.m_elements){}
+		:m_size(o.m_size),m_indices(o.m_indices),m_elements(o.m_elements),m_blocks(o.m_blocks){}
 	dynamic_bitset& operator=( const dynamic_bitset& o)
-		{m_indices = o.m_indices; m_elements = o.m_elements; return *this;}
+		{m_size = o.m_size; m_indices = o.m_indices; m_elements = o.m_elements; m_blocks = o.m_blocks; return *this;}
 #if __cplusplus >= 201103L
 	dynamic_bitset( dynamic_bitset&& o)
-		:m_indices(std::move(o.m_indices)),m_elements(std::move(o.m_elements)){}
+		:m_size(o.m_size),m_indices(std::move(o.m_indices)),m_elements(std::move(o.m_elements)),m_blocks(std::move(o.m_blocks)){}
 	dynamic_bitset& operator=( dynamic_bitset&& o)
-		{m_indices=std::move(o.m_indices); m_elements=std::move(o.m_elements); return *this;}
+		{m_size = o.m_size; m_indices=std::move(o.m_indices); m_elements=std::move(o.m_elements); m_blocks=std::move(o.m_blocks); return *this;}
 #endif
 	bool set( std::size_t n, bool val = true)
 	{
+		if (n >= m_size) return false;
 		int hi = n / ElementDim;
 		int li = n % ElementDim;
-		if (hi >= (int)m_indices.size()) return false;
 		int idx = m_indices[ hi];
 		if (idx == -1)
 		{
-			idx = m_indices[ hi] = m_elements.size();
-			m_elements.push_back( bitset<ElementDim>());
+			if (!val) return false;
+			idx = allocBlock( hi);
 		}
 		return m_elements[ idx].set( li, val);
 	}
 	bool test( std::size_t n) const
 	{
+		if (n >= m_size) return false;
 		int hi = n / ElementDim;
 		int li = n % ElementDim;
-		if (hi >= (int)m_indices.size()) return false;
 		int idx = m_indices[ hi];
 		if (idx == -1) return false;
 		return m_elements.at(idx).test( li);
@@ -79,13 +135,186 @@ public:
 	void reset()
 	{
 		m_elements.clear();
+		m_blocks.clear();
 		std::fill( m_indices.begin(), m_indices.end(), -1);
 	}
 
+	/// \brief Get the dimension of the set
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+	/// \brief Get the number of bits set
+	/// \note The blocks allocated are contiguous in memory and counted with one call of BitSetKernels::count
+	std::size_t count() const
+	{
+		STRUS_STATIC_ASSERT( sizeof(bitset<ElementDim>) == ElementDim / 8);
+		if (m_elements.empty()) return 0;
+		return BitSetKernels::count( m_elements[0].data(), m_elements.size() * (ElementDim / 64));
+	}
+
+	/// \brief Get the next bit set with position strictly higher than the position passed as argument
+	/// \return the position of the bit or -1 if there is none
+	/// \note Blocks not allocated are skipped with a scan of the block index (4 bytes per 256 positions)
+	int next( int pos) const
+	{
+		++pos;
+		if (pos < 0 || (std::size_t)pos >= m_size) return -1;
+		int hi = pos / ElementDim;
+		int li = pos % ElementDim;
+		int idx = m_indices[ hi];
+		if (idx != -1)
+		{
+			int rt = m_elements[ idx].next( li - 1);
+			if (rt >= 0) return hi * ElementDim + rt;
+		}
+		for (++hi; hi < (int)m_indices.size(); ++hi)
+		{
+			idx = m_indices[ hi];
+			if (idx != -1)
+			{
+				int rt = m_elements[ idx].first();
+				if (rt >= 0) return hi * ElementDim + rt;
+			}
+		}
+		return -1;
+	}
+
+	/// \brief Get the first bit set
+	/// \return the position of the bit or -1 if the set is empty
+	int first() const
+	{
+		return next( -1);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator( this, first());
+	}
+	const_iterator end() const
+	{
+		return const_iterator( this, -1);
+	}
+
+	/// \brief Union with a set of the same dimension, iterating on the blocks allocated in the operand
+	dynamic_bitset& operator |= ( const dynamic_bitset& o)
+	{
+		std::size_t ei = 0, ee = o.m_elements.size();
+		for (; ei != ee; ++ei)
+		{
+			int hi = o.m_blocks[ ei];
+			if (hi >= (int)m_indices.size()) continue;
+			int idx = m_indices[ hi];
+			if (idx == -1)
+			{
+				if (o.m_elements[ ei].empty()) continue;
+				idx = allocBlock( hi);
+			}
+			m_elements[ idx].join( o.m_elements[ ei]);
+		}
+		return *this;
+	}
+
+	/// \brief Intersection with a set of the same dimension, iterating on the blocks allocated in this set
+	dynamic_bitset& operator &= ( const dynamic_bitset& o)
+	{
+		std::size_t ei = 0;
+		while (ei < m_elements.size())
+		{
+			int hi = m_blocks[ ei];
+			int oidx = hi < (int)o.m_indices.size() ? o.m_indices[ hi] : -1;
+			if (oidx != -1)
+			{
+				m_elements[ ei].intersect( o.m_elements[ oidx]);
+			}
+			if (oidx == -1 || m_elements[ ei].empty())
+			{
+				freeBlock( ei);
+			}
+			else
+			{
+				++ei;
+			}
+		}
+		return *this;
+	}
+
+	/// \brief Symmetric difference with a set of the same dimension, iterating on the blocks allocated in the operand
+	dynamic_bitset& operator ^= ( const dynamic_bitset& o)
+	{
+		if (&o == this)
+		{
+			reset();
+			return *this;
+		}
+		std::size_t ei = 0, ee = o.m_elements.size();
+		for (; ei != ee; ++ei)
+		{
+			int hi = o.m_blocks[ ei];
+			if (hi >= (int)m_indices.size() || o.m_elements[ ei].empty()) continue;
+			int idx = m_indices[ hi];
+			if (idx == -1) idx = allocBlock( hi);
+			m_elements[ idx].toggle( o.m_elements[ ei]);
+			if (m_elements[ idx].empty()) freeBlock( idx);
+		}
+		return *this;
+	}
+
+	/// \brief Difference (and not) with a set of the same dimension, iterating on the blocks allocated in this set
+	dynamic_bitset& operator -= ( const dynamic_bitset& o)
+	{
+		std::size_t ei = 0;
+		while (ei < m_elements.size())
+		{
+			int hi = m_blocks[ ei];
+			int oidx = hi < (int)o.m_indices.size() ? o.m_indices[ hi] : -1;
+			if (oidx != -1 && m_elements[ ei].subtract( o.m_elements[ oidx]) && m_elements[ ei].empty())
+			{
+				freeBlock( ei);
+			}
+			else
+			{
+				++ei;
+			}
+		}
+		return *this;
+	}
+
 private:
 	enum {ElementDim=256};
-	std::vector<int32_t> m_indices;
-	std::vector<bitset<ElementDim> > m_elements;
+	typedef std::vector<bitset<ElementDim> > ElementArray;
+
+	/// \brief Allocate the block with index hi
+	/// \return the index of the block element
+	int allocBlock( int hi)
+	{
+		int idx = m_elements.size();
+		m_elements.push_back( bitset<ElementDim>());
+		m_blocks.push_back( hi);
+		return m_indices[ hi] = idx;
+	}
+
+	/// \brief Free the block element with index idx, the last element is moved to its place
+	void freeBlock( std::size_t idx)
+	{
+		std::size_t last = m_elements.size()-1;
+		m_indices[ m_blocks[ idx]] = -1;
+		if (idx != last)
+		{
+			m_elements[ idx] = m_elements[ last];
+			m_blocks[ idx] = m_blocks[ last];
+			m_indices[ m_blocks[ idx]] = idx;
+		}
+		m_elements.pop_back();
+		m_blocks.pop_back();
+	}
+
+private:
+	std::size_t m_size;				///< dimension of the set
+	std::vector<int32_t> m_indices;			///< index of the element of each block or -1 if not allocated
+	ElementArray m_elements;			///< blocks allocated
+	std::vector<int32_t> m_blocks;			///< index of the block of each element, parallel to m_elements
 };
 }//namespace
 
@@ -98,10 +327,30 @@ class dynamic_bitset
 	:public boost::dynamic_bitset<>
 {
 public:
+	typedef dynamic_bitset_const_iterator<dynamic_bitset> const_iterator;
+
 	dynamic_bitset( std::size_t size_)
 		:boost::dynamic_bitset<>( size_){}
 	dynamic_bitset( const dynamic_bitset& o)
 		:boost::dynamic_bitset<>( o){}
+
+	int next( int pos) const
+	{
+		std::size_t rt = pos < 0 ? find_first() : find_next( pos);
+		return rt == npos ? -1 : (int)rt;
+	}
+	int first() const
+	{
+		return next( -1);
+	}
+	const_iterator begin() const
+	{
+		return const_iterator( this, first());
+	}
+	const_iterator end() const
+	{
+		return const_iterator( this, -1);
+	}
 };
 
 }//namespace
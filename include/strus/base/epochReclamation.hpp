@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Epoch based reclamation of memory shared with lock free readers
+/// \file epochReclamation.hpp
+#ifndef _STRUS_BASE_EPOCH_RECLAMATION_HPP_INCLUDED
+#define _STRUS_BASE_EPOCH_RECLAMATION_HPP_INCLUDED
+#include "strus/base/atomic.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/platform.hpp"
+#include "strus/base/stdint.h"
+#include <vector>
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Epoch based reclamation of memory shared with lock free readers
+/// \note Readers pin the current epoch for the time they access shared data, writers retire objects they unlinked instead of deleting them.
+///	Retired objects are freed in batches as soon as no reader is pinned to an epoch they could have been seen in.
+/// \note Readers increment a counter of the current epoch (there are 3 epochs alive at once) in a slot selected by the thread,
+///	they do not write to memory shared with all readers. Threads sharing a slot are handled correctly, the number of slots only limits contention.
+/// \remark An object retired in epoch E is freed when the global epoch is E+2. The epoch is advanced if no reader is pinned to the previous epoch.
+class EpochReclamation
+{
+public:
+	/// \brief Function to free a retired object
+	typedef void (*Deleter)( void* ptr);
+
+	enum {
+		NofSlots=64,			///< number of slots of counters of pinned readers, a power of 2
+		DefaultBatchSize=32		///< default number of retired objects triggering an attempt to free them
+	};
+
+	/// \brief Constructor
+	/// \param[in] batchSize_ number of objects retired since the last attempt that trigger an attempt to free retired objects
+	explicit EpochReclamation( std::size_t batchSize_=DefaultBatchSize)
+		:m_epoch(0),m_mutex(),m_retired(),m_batchSize(batchSize_ ? batchSize_ : 1),m_lastCollectSize(0){}
+
+	/// \brief Destructor, frees all objects retired
+	/// \note No reader must be pinned anymore
+	~EpochReclamation();
+
+	/// \brief Pin of a reader, returned by pin
+	typedef strus::atomic<int>* PinRef;
+
+	/// \brief Pin the current epoch, objects retired from now on are not freed till unpin is called
+	/// \return the reference needed for unpin
+	PinRef pin() const
+	{
+		Slot& slot = m_slots[ threadSlot() & (NofSlots-1)];
+		for (;;)
+		{
+			uint64_t epoch = m_epoch.load();
+			strus::atomic<int>& counter = slot.counter[ epoch % 3];
+			counter.fetch_add( 1);
+			if (m_epoch.load() == epoch) return &counter;
+			//... epoch advanced meanwhile, the reader might not be seen by the writer that advanced it
+			counter.fetch_sub( 1);
+		}
+	}
+
+	/// \brief Release a pin of a reader
+	/// \param[in] pinref pin returned by pin
+	static void unpin( PinRef pinref)
+	{
+		pinref->fetch_sub( 1);
+	}
+
+	/// \brief Pin the epoch of an existing pin once more
+	/// \param[in] pinref pin returned by pin
+	/// \return the reference needed for unpin
+	static PinRef repin( PinRef pinref)
+	{
+		pinref->fetch_add( 1);
+		return pinref;
+	}
+
+	/// \brief Scoped pin of the current epoch
+	class Guard
+	{
+	public:
+		explicit Guard( const EpochReclamation& domain)
+			:m_pinref(domain.pin()){}
+		~Guard()
+		{
+			EpochReclamation::unpin( m_pinref);
+		}
+
+	private:
+		Guard( const Guard&){}			///> non copyable
+		void operator=( const Guard&){}		///> non copyable
+
+	private:
+		PinRef m_pinref;
+	};
+
+	/// \brief Retire an object not reachable anymore for readers starting from now, free it when no reader can access it anymore
+	/// \param[in] ptr pointer to the object
+	/// \param[in] deleter function to free the object
+	/// \note Throws std::bad_alloc, the object is freed immediately in this case (after waiting for the readers)
+	void retire( void* ptr, Deleter deleter);
+
+	/// \brief Retire an object allocated with new, see retire( void*, Deleter)
+	template <class Object>
+	void retire( Object* ptr)
+	{
+		retire( ptr, &deleteObject<Object>);
+	}
+
+	/// \brief Try to advance the epoch and free the objects that no reader can access anymore
+	void collect();
+
+	/// \brief Get the number of retired objects not freed yet
+	std::size_t nofRetired() const;
+
+	/// \brief Get the current epoch
+	uint64_t epoch() const
+	{
+		return m_epoch.load();
+	}
+
+private:
+	template <class Object>
+	static void deleteObject( void* ptr)
+	{
+		delete (Object*)ptr;
+	}
+
+	/// \brief Get the index of the slot of the current thread
+	static unsigned int threadSlot();
+
+	/// \brief Advance the epoch if no reader is pinned to the previous epoch anymore
+	bool tryAdvance();
+
+	/// \brief Free retired objects not accessible by readers anymore, must be called with the mutex locked
+	void freeRetired();
+
+	struct Slot
+	{
+		strus::atomic<int> counter[3];		///< number of readers pinned to epoch modulo 3
+		char pad[ platform::CacheLineSize];	///< avoid false sharing of the counters of different slots
+	};
+
+	struct Retired
+	{
+		void* ptr;
+		Deleter deleter;
+		uint64_t epoch;
+
+		Retired( void* ptr_, Deleter deleter_, uint64_t epoch_)
+			:ptr(ptr_),deleter(deleter_),epoch(epoch_){}
+		Retired( const Retired& o)
+			:ptr(o.ptr),deleter(o.deleter),epoch(o.epoch){}
+	};
+
+private:
+	EpochReclamation( const EpochReclamation&){}		///> non copyable
+	void operator=( const EpochReclamation&){}		///> non copyable
+
+private:
+	strus::atomic<uint64_t> m_epoch;
+	mutable Slot m_slots[ NofSlots];
+	mutable strus::mutex m_mutex;
+	std::vector<Retired> m_retired;
+	std::size_t m_batchSize;
+	std::size_t m_lastCollectSize;
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Immutable symbol table with a minimal perfect hash function built from a symbol table
+///\file frozenSymbolTable.hpp
+#ifndef _STRUS_BASE_FROZEN_SYMBOL_TABLE_HPP_INCLUDED
+#define _STRUS_BASE_FROZEN_SYMBOL_TABLE_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace strus
+{
+/// \brief Forward declaration
+class ErrorBufferInterface;
+/// \brief Forward declaration
+class SymbolTable;
+
+///\brief Read only copy of a symbol table with the same handles, for tables that do not change anymore after they have been built
+///\note Lookups use a minimal perfect hash function (CHD, compress hash and displace) and need at most one key comparison
+///\note The memory used besides the 0-terminated keys stored in one contiguous block is about 9 bytes per key:
+///	8 bits per key for the hash function (one 32 bit displacement per bucket of 4 keys on average), 32 bits per key for the handle of a slot
+///	and 32 bits per key for the start of the key of a handle.
+///\remark Not the few bits per key of a minimal perfect hash function alone: the handles of the symbol table copied are kept,
+///	so the table has to map slots of the hash function to handles and handles to keys. This permutation needs at least log2(n) bits per key
+///	in each direction, 32 bit arrays are used for fast access. Use a plain minimal perfect hash function where arbitrary handles are acceptable.
+class FrozenSymbolTable
+{
+public:
+	///\brief Constructor
+	///\param[in] errorhnd_ error buffer interface for reporting errors
+	explicit FrozenSymbolTable( ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_nofSymbols(0),m_displacements(),m_slots(),m_offsets(),m_strings(){}
+
+	///\brief Build the table from the contents of a symbol table
+	///\param[in] symtab symbol table to copy, handles are the same as in symtab
+	///\return true on success, false on error (reported to the error buffer)
+	bool build( const SymbolTable& symtab);
+
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key string
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const std::string& key) const;
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key key string poiner
+	///\param[in] keysize size of key in bytes
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const char* key, std::size_t keysize) const;
+
+	///\brief Inverse lookup, get key of handle
+	///\param[in] id key handle
+	///\return the key string or NULL if not defined
+	const char* key( const uint32_t& id) const;
+
+	///\brief Get the size of the key of a handle in bytes
+	///\param[in] id key handle
+	///\return the size of the key or 0 if not defined
+	std::size_t keySize( const uint32_t& id) const;
+
+	///\brief Get number of elements defined
+	///\return the number of elements defined
+	std::size_t size() const
+	{
+		return m_nofSymbols;
+	}
+
+	///\brief Evaluate if the symbol table is empty, without any definitions
+	///\return true if yes
+	bool empty() const
+	{
+		return m_nofSymbols == 0;
+	}
+
+	///\brief Get the number of bytes allocated for the table
+	///\return the memory usage in bytes
+	std::size_t memoryUsage() const;
+
+	///\brief Free all contents
+	void clear();
+
+	///\brief Swap contents
+	void swap( FrozenSymbolTable& o);
+
+private:
+#if __cplusplus >= 201103L
+	FrozenSymbolTable( const FrozenSymbolTable&) = delete;
+	void operator=( const FrozenSymbolTable&) = delete;
+#else
+	FrozenSymbolTable( const FrozenSymbolTable&){}		///> non copyable
+	void operator=( const FrozenSymbolTable&){}		///> non copyable
+#endif
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	uint32_t m_nofSymbols;
+	std::vector<uint32_t> m_displacements;	///< per bucket seed of the slot hash or slot index ored with DirectSlotFlag for buckets with one key
+	std::vector<uint32_t> m_slots;		///< handle of the key in a slot
+	std::vector<uint32_t> m_offsets;	///< start of the key of a handle - 1 in m_strings, m_offsets[ m_nofSymbols] is the end of the last key
+	std::string m_strings;			///< all keys 0-terminated ordered by handle
+};
+
+}//namespace
+#endif
+
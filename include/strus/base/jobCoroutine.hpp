@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Coroutine tasks executed by a JobQueueWorker, suspended while waiting for file handle events, timers or other jobs
+/// \file jobCoroutine.hpp
+/// \note Only available if the compiler supports C++20 coroutines (build with CPP_LANGUAGE_VERSION=20), STRUS_HAVE_COROUTINES is defined then
+#ifndef _STRUS_BASE_JOB_COROUTINE_HPP_INCLUDED
+#define _STRUS_BASE_JOB_COROUTINE_HPP_INCLUDED
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/jobFuture.hpp"
+#include "strus/base/filehandle.hpp"
+
+#if defined __cpp_impl_coroutine && __cpp_impl_coroutine >= 201902L
+#define STRUS_HAVE_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <stdexcept>
+#include <new>
+
+namespace strus
+{
+
+/// \brief Part of the promise of a task independent of the result type
+class JobTaskPromiseBase
+{
+public:
+	JobTaskPromiseBase()
+		:m_worker(0){}
+	virtual ~JobTaskPromiseBase(){}
+
+	/// \brief Get the worker executing the task
+	JobQueueWorker* worker() const
+	{
+		return m_worker;
+	}
+	void setWorker( JobQueueWorker* worker_)
+	{
+		m_worker = worker_;
+	}
+
+	/// \brief Set the error of the task
+	virtual void fail( const std::string& error)=0;
+
+private:
+	JobQueueWorker* m_worker;
+};
+
+/// \brief Helpers for suspending and resuming tasks
+class JobTaskResumer
+{
+public:
+	/// \brief Schedule the resumption of a suspended task as job of its worker
+	/// \return true on success, false if the job could not be pushed
+	static bool schedule( std::coroutine_handle<> handle, JobTaskPromiseBase& promise)
+	{
+		return promise.worker()->pushJob( &JobTaskResumer::resume, handle.address(), &JobTaskResumer::destroy);
+	}
+
+	/// \brief Schedule the resumption of a suspended task, destroy it with an error if this is not possible
+	static void resumeOrFail( std::coroutine_handle<> handle, JobTaskPromiseBase& promise)
+	{
+		if (!schedule( handle, promise))
+		{
+			promise.fail( "failed to push job resuming task");
+			handle.destroy();
+		}
+	}
+
+private:
+	static void resume( void* context)
+	{
+		std::coroutine_handle<>::from_address( context).resume();
+	}
+	static void destroy( void* context)
+	{
+		//... job dropped, the promise sets its error in the destructor if the task did not complete
+		std::coroutine_handle<>::from_address( context).destroy();
+	}
+};
+
+/// \brief Coroutine executed as sequence of jobs by a JobQueueWorker, with the result delivered as JobFuture
+/// \tparam Result type of the result (default constructible and copyable as for JobFuture, use e.g. bool for tasks without result)
+/// \note A task is started with spawn or by awaiting it in another task. Suspended tasks do not block any thread.
+/// \note The awaitables readable, writable, sleep_for, a JobFuture or another JobTask suspend the task, it is resumed by a job pushed to its worker
+/// \note Tasks that cannot be resumed anymore (the job resuming them is dropped by stop or they wait for a timer or a file handle when the worker is destroyed) are destroyed and their future fails
+template <typename Result>
+class JobTask
+{
+public:
+	class promise_type
+		:public JobTaskPromiseBase
+	{
+	public:
+		promise_type()
+			:JobTaskPromiseBase(),m_state( new JobFutureState<Result>()){}
+		virtual ~promise_type()
+		{
+			//... no effect if the task completed
+			m_state->setError( "task destroyed without completion");
+		}
+
+		JobTask get_return_object()
+		{
+			return JobTask( std::coroutine_handle<promise_type>::from_promise( *this));
+		}
+		std::suspend_always initial_suspend() noexcept
+		{
+			return std::suspend_always();
+		}
+		std::suspend_never final_suspend() noexcept
+		{
+			return std::suspend_never();
+		}
+		void return_value( const Result& value)
+		{
+			m_state->setValue( value);
+		}
+		void unhandled_exception()
+		{
+			try
+			{
+				throw;
+			}
+			catch (const std::bad_alloc&)
+			{
+				m_state->setError( "out of memory");
+			}
+			catch (const std::exception& err)
+			{
+				m_state->setError( err.what());
+			}
+			catch (...)
+			{
+				m_state->setError( "unknown exception");
+			}
+		}
+		virtual void fail( const std::string& error)
+		{
+			m_state->setError( error);
+		}
+		const typename JobFuture<Result>::StateRef& state() const
+		{
+			return m_state;
+		}
+
+	private:
+		typename JobFuture<Result>::StateRef m_state;
+	};
+
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	JobTask( JobTask&& o) noexcept
+		:m_handle(o.m_handle)
+	{
+		o.m_handle = nullptr;
+	}
+	~JobTask()
+	{
+		if (m_handle) m_handle.destroy();
+	}
+
+	/// \brief Start the task as job of a worker
+	/// \param[in] worker the worker executing the task
+	/// \return the future of the result, invalid if the task has been started already
+	JobFuture<Result> spawn( JobQueueWorker& worker)
+	{
+		if (!m_handle) return JobFuture<Result>();
+		Handle handle = m_handle;
+		m_handle = nullptr;
+		handle.promise().setWorker( &worker);
+		JobFuture<Result> rt( handle.promise().state());
+		JobTaskResumer::resumeOrFail( handle, handle.promise());
+		return rt;
+	}
+
+	/// \brief Awaiter of a task started by the task awaiting it, on the worker of the task awaiting it
+	class Awaiter;
+	Awaiter operator co_await() &&;
+
+private:
+	explicit JobTask( Handle handle_)
+		:m_handle(handle_){}
+	JobTask( const JobTask&) = delete;
+	JobTask& operator=( const JobTask&) = delete;
+
+private:
+	Handle m_handle;
+};
+
+/// \brief Awaiter of the result of a job (a JobFuture), the awaiting task is resumed when the result is available
+/// \note co_await of a failed future throws std::runtime_error with its error
+template <typename Result>
+class JobFutureAwaiter
+{
+public:
+	explicit JobFutureAwaiter( const JobFuture<Result>& future_)
+		:m_future(future_){}
+
+	bool await_ready() const
+	{
+		return m_future.ready();
+	}
+	template <class Promise>
+	void await_suspend( std::coroutine_handle<Promise> handle)
+	{
+		//... the task might be resumed and destroy this awaiter before addContinuation returns, so the state is held by a local
+		typename JobFuture<Result>::StateRef state = m_future.state();
+		state->addContinuation( new ResumeContinuation( handle, handle.promise()));
+	}
+	Result await_resume() const
+	{
+		return m_future.get();
+	}
+
+private:
+	class ResumeContinuation
+		:public JobFutureContinuation
+	{
+	public:
+		ResumeContinuation( std::coroutine_handle<> handle_, JobTaskPromiseBase& promise_)
+			:m_handle(handle_),m_promise(&promise_){}
+		virtual void resolve()
+		{
+			JobTaskResumer::resumeOrFail( m_handle, *m_promise);
+		}
+	private:
+		std::coroutine_handle<> m_handle;
+		JobTaskPromiseBase* m_promise;
+	};
+
+private:
+	JobFuture<Result> m_future;
+};
+
+/// \brief Await the result of a job in a JobTask
+template <typename Result>
+JobFutureAwaiter<Result> operator co_await( const JobFuture<Result>& future)
+{
+	return JobFutureAwaiter<Result>( future);
+}
+
+template <typename Result>
+class JobTask<Result>::Awaiter
+{
+public:
+	explicit Awaiter( JobTask&& task_)
+		:m_task(std::move(task_)),m_future(){}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+	template <class Promise>
+	bool await_suspend( std::coroutine_handle<Promise> handle)
+	{
+		m_future = m_task.spawn( *handle.promise().worker());
+		typename JobFuture<Result>::StateRef state = m_future.state();
+		if (!state.get()) throw std::runtime_error( "awaited task started already");
+		JobFutureAwaiter<Result> awaiter( m_future);
+		if (awaiter.await_ready()) return false;
+		awaiter.await_suspend( handle);
+		return true;
+	}
+	Result await_resume() const
+	{
+		return m_future.get();
+	}
+
+private:
+	JobTask m_task;
+	JobFuture<Result> m_future;
+};
+
+template <typename Result>
+typename JobTask<Result>::Awaiter JobTask<Result>::operator co_await() &&
+{
+	return Awaiter( std::move(*this));
+}
+
+/// \brief Awaiter of an event on a file handle, the awaiting task is resumed when the file handle is ready
+/// \note Requires a worker in the select mode (constructor parameter useFdSelect set to true), otherwise the awaiting task is destroyed
+/// \note Only one task can wait for an event type on a file handle at the same time
+class JobFdEventAwaiter
+{
+public:
+	JobFdEventAwaiter( const FileHandle& fh_, JobQueueWorker::FdType type_)
+		:m_fh(fh_),m_type(type_){}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+	template <class Promise>
+	void await_suspend( std::coroutine_handle<Promise> handle)
+	{
+		JobQueueWorker* worker = handle.promise().worker();
+		Listener* listener = new Listener( handle, handle.promise(), m_fh, m_type);
+		if (!worker->pushListener( &Listener::ready, listener, &Listener::dispose, m_fh, m_type))
+		{
+			delete listener;
+			throw std::runtime_error( "failed to push listener");
+		}
+	}
+	void await_resume() const {}
+
+private:
+	/// \brief Listener resuming the task with the first event, deleted when the listener is removed
+	class Listener
+	{
+	public:
+		Listener( std::coroutine_handle<> handle_, JobTaskPromiseBase& promise_, const FileHandle& fh_, int type_)
+			:m_handle(handle_),m_promise(&promise_),m_fh(fh_),m_type(type_),m_fired(false){}
+
+		static void ready( void* context)
+		{
+			Listener* listener = (Listener*)context;
+			//... the listener might be called again before its removal is processed
+			if (listener->m_fired) return;
+			listener->m_fired = true;
+			JobQueueWorker* worker = listener->m_promise->worker();
+			(void)worker->pushListener( 0, 0, 0, listener->m_fh, listener->m_type);
+			JobTaskResumer::resumeOrFail( listener->m_handle, *listener->m_promise);
+		}
+
+		static void dispose( void* context)
+		{
+			Listener* listener = (Listener*)context;
+			if (!listener->m_fired) listener->m_handle.destroy();
+			delete listener;
+		}
+
+	private:
+		std::coroutine_handle<> m_handle;
+		JobTaskPromiseBase* m_promise;
+		FileHandle m_fh;
+		int m_type;
+		bool m_fired;
+	};
+
+private:
+	FileHandle m_fh;
+	JobQueueWorker::FdType m_type;
+};
+
+/// \brief Suspend the task until a file handle is ready for reading
+inline JobFdEventAwaiter readable( const FileHandle& fh)
+{
+	return JobFdEventAwaiter( fh, JobQueueWorker::FdRead);
+}
+
+/// \brief Suspend the task until a file handle is ready for writing
+inline JobFdEventAwaiter writable( const FileHandle& fh)
+{
+	return JobFdEventAwaiter( fh, JobQueueWorker::FdWrite);
+}
+
+/// \brief Awaiter of a timeout, the awaiting task is resumed when a timer of its worker expires
+class JobSleepAwaiter
+{
+public:
+	explicit JobSleepAwaiter( int milliseconds_)
+		:m_milliseconds(milliseconds_){}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+	template <class Promise>
+	void await_suspend( std::coroutine_handle<Promise> handle)
+	{
+		JobQueueWorker* worker = handle.promise().worker();
+		Timer* timer = new Timer( handle, handle.promise());
+		if (!worker->scheduleTimer( m_milliseconds, &Timer::expired, timer, &Timer::dispose))
+		{
+			delete timer;
+			throw std::runtime_error( "failed to schedule timer");
+		}
+	}
+	void await_resume() const {}
+
+private:
+	class Timer
+	{
+	public:
+		Timer( std::coroutine_handle<> handle_, JobTaskPromiseBase& promise_)
+			:m_handle(handle_),m_promise(&promise_){}
+
+		static void expired( void* context)
+		{
+			Timer* timer = (Timer*)context;
+			JobTaskResumer::resumeOrFail( timer->m_handle, *timer->m_promise);
+			delete timer;
+		}
+
+		static void dispose( void* context)
+		{
+			Timer* timer = (Timer*)context;
+			timer->m_handle.destroy();
+			delete timer;
+		}
+
+	private:
+		std::coroutine_handle<> m_handle;
+		JobTaskPromiseBase* m_promise;
+	};
+
+private:
+	int m_milliseconds;
+};
+
+/// \brief Suspend the task for a number of milliseconds
+inline JobSleepAwaiter sleep_for( int milliseconds)
+{
+	return JobSleepAwaiter( milliseconds);
+}
+
+}//namespace
+#endif //__cpp_impl_coroutine
+#endif
+
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Futures for the results of jobs executed by a JobQueueWorker, with continuations and joins
+/// \file jobFuture.hpp
+#ifndef _STRUS_BASE_JOB_FUTURE_HPP_INCLUDED
+#define _STRUS_BASE_JOB_FUTURE_HPP_INCLUDED
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/thread.hpp"
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <new>
+
+namespace strus
+{
+
+/// \brief Action triggered when the result of a job is available
+class JobFutureContinuation
+{
+public:
+	virtual ~JobFutureContinuation(){}
+	/// \brief Called once when the result is available, by the thread that set the result
+	virtual void resolve()=0;
+};
+
+/// \brief Shared state of a future, set by the job and read by the owners of futures
+/// \tparam Result type of the result, default constructible and copyable
+template <typename Result>
+class JobFutureState
+{
+public:
+	JobFutureState()
+		:m_mutex(),m_cv(),m_ready(false),m_failed(false),m_value(),m_error(),m_continuations(){}
+	~JobFutureState()
+	{
+		std::vector<JobFutureContinuation*>::const_iterator ci = m_continuations.begin(), ce = m_continuations.end();
+		for (; ci != ce; ++ci) delete *ci;
+	}
+
+	/// \brief Set the result, only the first result or error set is taken
+	void setValue( const Result& value_)
+	{
+		std::vector<JobFutureContinuation*> continuations;
+		{
+			strus::unique_lock lock( m_mutex);
+			if (m_ready) return;
+			m_value = value_;
+			m_ready = true;
+			continuations.swap( m_continuations);
+			m_cv.notify_all();
+		}
+		resolve( continuations);
+	}
+
+	/// \brief Set the error, only the first result or error set is taken
+	void setError( const std::string& error_)
+	{
+		std::vector<JobFutureContinuation*> continuations;
+		{
+			strus::unique_lock lock( m_mutex);
+			if (m_ready) return;
+			try
+			{
+				m_error = error_;
+			}
+			catch (const std::bad_alloc&)
+			{
+				//... keep the error empty, failed() is what counts
+			}
+			m_failed = true;
+			m_ready = true;
+			continuations.swap( m_continuations);
+			m_cv.notify_all();
+		}
+		resolve( continuations);
+	}
+
+	/// \brief Add an action triggered when the result is available, called immediately if the result is available already
+	/// \param[in] continuation action, ownership passed
+	void addContinuation( JobFutureContinuation* continuation)
+	{
+		{
+			strus::unique_lock lock( m_mutex);
+			if (!m_ready)
+			{
+				try
+				{
+					m_continuations.push_back( continuation);
+				}
+				catch (...)
+				{
+					delete continuation;
+					throw;
+				}
+				return;
+			}
+		}
+		continuation->resolve();
+		delete continuation;
+	}
+
+	/// \brief Wait till the result is available
+	void wait() const
+	{
+		strus::unique_lock lock( m_mutex);
+		while (!m_ready) m_cv.wait( lock);
+	}
+
+	/// \brief Test if the result is available
+	bool ready() const
+	{
+		strus::unique_lock lock( m_mutex);
+		return m_ready;
+	}
+
+	/// \brief Test if the job failed, only valid if the result is available
+	bool failed() const
+	{
+		return m_failed;
+	}
+
+	/// \brief Get the result, only valid if the result is available
+	const Result& value() const
+	{
+		return m_value;
+	}
+
+	/// \brief Get the error, only valid if the result is available
+	const std::string& error() const
+	{
+		return m_error;
+	}
+
+private:
+	static void resolve( const std::vector<JobFutureContinuation*>& continuations)
+	{
+		std::vector<JobFutureContinuation*>::const_iterator ci = continuations.begin(), ce = continuations.end();
+		for (; ci != ce; ++ci)
+		{
+			(*ci)->resolve();
+			delete *ci;
+		}
+	}
+
+private:
+	JobFutureState( const JobFutureState&){}		///> non copyable
+	void operator=( const JobFutureState&){}		///> non copyable
+
+private:
+	mutable strus::mutex m_mutex;
+	mutable strus::condition_variable m_cv;
+	bool m_ready;
+	bool m_failed;
+	Result m_value;
+	std::string m_error;
+	std::vector<JobFutureContinuation*> m_continuations;
+};
+
+/// \brief Job calling a function object and setting its result in a future state
+template <typename Result, class Function>
+class JobFutureTask
+{
+public:
+	typedef strus::shared_ptr<JobFutureState<Result> > StateRef;
+
+	JobFutureTask( const StateRef& state_, const Function& func_)
+		:m_state(state_),m_func(func_){}
+
+	/// \brief Push the task as job
+	/// \note The state gets an error if the job cannot be pushed
+	static void push( JobQueueWorker& worker, const StateRef& state, const Function& func)
+	{
+		JobFutureTask* task = 0;
+		try
+		{
+			task = new JobFutureTask( state, func);
+		}
+		catch (const std::bad_alloc&)
+		{
+			state->setError( "out of memory");
+			return;
+		}
+		if (!worker.pushJob( &JobFutureTask::run, task, &JobFutureTask::drop))
+		{
+			delete task;
+			state->setError( "failed to push job");
+		}
+	}
+
+private:
+	static void run( void* context)
+	{
+		JobFutureTask* task = (JobFutureTask*)context;
+		try
+		{
+			task->m_state->setValue( task->m_func());
+		}
+		catch (const std::bad_alloc&)
+		{
+			task->m_state->setError( "out of memory");
+		}
+		catch (const std::exception& err)
+		{
+			task->m_state->setError( err.what());
+		}
+		catch (...)
+		{
+			task->m_state->setError( "unknown exception");
+		}
+		delete task;
+	}
+
+	static void drop( void* context)
+	{
+		JobFutureTask* task = (JobFutureTask*)context;
+		task->m_state->setError( "job dropped without execution");
+		delete task;
+	}
+
+private:
+	StateRef m_state;
+	Function m_func;
+};
+
+/// \brief Future for the result of a job executed by a JobQueueWorker
+/// \tparam Result type of the result, default constructible and copyable
+/// \note Copies of a future refer to the same result
+template <typename Result>
+class JobFuture
+{
+public:
+	typedef strus::shared_ptr<JobFutureState<Result> > StateRef;
+
+	/// \brief Default constructor of an invalid future
+	JobFuture()
+		:m_state(){}
+	/// \brief Constructor
+	explicit JobFuture( const StateRef& state_)
+		:m_state(state_){}
+	/// \brief Copy constructor
+	JobFuture( const JobFuture& o)
+		:m_state(o.m_state){}
+	JobFuture& operator=( const JobFuture& o)
+	{
+		m_state = o.m_state;
+		return *this;
+	}
+
+	/// \brief Test if the future refers to a job
+	bool valid() const
+	{
+		return !!m_state.get();
+	}
+
+	/// \brief Wait till the result is available
+	void wait() const
+	{
+		m_state->wait();
+	}
+
+	/// \brief Test if the result is available without waiting
+	bool ready() const
+	{
+		return m_state->ready();
+	}
+
+	/// \brief Wait for the result and test if the job failed
+	bool failed() const
+	{
+		m_state->wait();
+		return m_state->failed();
+	}
+
+	/// \brief Wait for the result and get the error message of a job failed
+	const std::string& error() const
+	{
+		m_state->wait();
+		return m_state->error();
+	}
+
+	/// \brief Wait for the result and get it
+	/// \note Throws std::runtime_error with the error message if the job failed
+	const Result& get() const
+	{
+		m_state->wait();
+		if (m_state->failed()) throw std::runtime_error( m_state->error());
+		return m_state->value();
+	}
+
+	/// \brief Get the shared state
+	const StateRef& state() const
+	{
+		return m_state;
+	}
+
+	/// \brief Execute a function with the result as job when the result is available
+	/// \tparam NextResult type of the result of the function
+	/// \tparam Function function object with NextResult operator()( const Result&) const
+	/// \param[in] worker worker to push the job to
+	/// \param[in] func the function
+	/// \return the future of the result of the function, failing with the error of this job if this job failed
+	/// \note No thread is blocked while waiting for the result
+	template <typename NextResult, class Function>
+	JobFuture<NextResult> then( JobQueueWorker& worker, const Function& func) const
+	{
+		typename JobFuture<NextResult>::StateRef next( new JobFutureState<NextResult>());
+		m_state->addContinuation( new ThenContinuation<NextResult,Function>( worker, m_state, next, func));
+		return JobFuture<NextResult>( next);
+	}
+
+private:
+	/// \brief Function object binding an argument to a function object
+	template <typename NextResult, class Function>
+	class BoundFunction
+	{
+	public:
+		BoundFunction( const Function& func_, const Result& arg_)
+			:m_func(func_),m_arg(arg_){}
+		NextResult operator()() const
+		{
+			return m_func( m_arg);
+		}
+	private:
+		Function m_func;
+		Result m_arg;
+	};
+
+	template <typename NextResult, class Function>
+	class ThenContinuation
+		:public JobFutureContinuation
+	{
+	public:
+		typedef typename JobFuture<NextResult>::StateRef NextStateRef;
+
+		ThenContinuation( JobQueueWorker& worker_, const StateRef& source_, const NextStateRef& target_, const Function& func_)
+			:m_worker(&worker_),m_source(source_),m_target(target_),m_func(func_){}
+
+		virtual void resolve()
+		{
+			if (m_source->failed())
+			{
+				m_target->setError( m_source->error());
+			}
+			else
+			{
+				try
+				{
+					JobFutureTask<NextResult,BoundFunction<NextResult,Function> >::push( *m_worker, m_target, BoundFunction<NextResult,Function>( m_func, m_source->value()));
+				}
+				catch (const std::bad_alloc&)
+				{
+					m_target->setError( "out of memory");
+				}
+			}
+		}
+
+	private:
+		JobQueueWorker* m_worker;
+		StateRef m_source;
+		NextStateRef m_target;
+		Function m_func;
+	};
+
+private:
+	StateRef m_state;
+};
+
+/// \brief Submit a function as job to a worker
+/// \tparam Result type of the result of the function, default constructible and copyable
+/// \tparam Function function object with Result operator()() const
+/// \param[in] worker worker to push the job to
+/// \param[in] func the function
+/// \return the future of the result, failing with the message of an exception thrown by the function or if the job could not be pushed or was dropped
+template <typename Result, class Function>
+JobFuture<Result> submitJob( JobQueueWorker& worker, const Function& func)
+{
+	typename JobFuture<Result>::StateRef state( new JobFutureState<Result>());
+	JobFutureTask<Result,Function>::push( worker, state, func);
+	return JobFuture<Result>( state);
+}
+
+/// \brief Join of the results of several futures
+template <typename Result>
+class JobFutureJoin
+{
+public:
+	typedef strus::shared_ptr<JobFutureState<std::vector<Result> > > StateRef;
+	typedef strus::shared_ptr<JobFutureState<Result> > SourceStateRef;
+
+	JobFutureJoin( const StateRef& target_, std::size_t size_)
+		:m_mutex(),m_target(target_),m_values( size_),m_nofPending(size_),m_failed(false),m_error(){}
+
+	/// \brief Set the result of the future with index idx
+	void set( std::size_t idx, const SourceStateRef& source)
+	{
+		bool complete;
+		{
+			strus::unique_lock lock( m_mutex);
+			if (source->failed())
+			{
+				if (!m_failed) m_error = source->error();
+				m_failed = true;
+			}
+			else
+			{
+				m_values[ idx] = source->value();
+			}
+			complete = (--m_nofPending == 0);
+		}
+		if (complete)
+		{
+			if (m_failed)
+			{
+				m_target->setError( m_error);
+			}
+			else
+			{
+				m_target->setValue( m_values);
+			}
+		}
+	}
+
+	class Continuation
+		:public JobFutureContinuation
+	{
+	public:
+		Continuation( const strus::shared_ptr<JobFutureJoin>& join_, std::size_t idx_, const SourceStateRef& source_)
+			:m_join(join_),m_idx(idx_),m_source(source_){}
+
+		virtual void resolve()
+		{
+			m_join->set( m_idx, m_source);
+		}
+
+	private:
+		strus::shared_ptr<JobFutureJoin> m_join;
+		std::size_t m_idx;
+		SourceStateRef m_source;
+	};
+
+private:
+	strus::mutex m_mutex;
+	StateRef m_target;
+	std::vector<Result> m_values;
+	std::size_t m_nofPending;
+	bool m_failed;
+	std::string m_error;
+};
+
+/// \brief Get a future for the results of all futures passed
+/// \param[in] futures futures to join
+/// \return the future of the results in the order of the futures passed, failing with the first error of a future failed
+/// \note The results are collected by the threads setting them, no thread is blocked while waiting
+/// \note Throws std::bad_alloc
+template <typename Result>
+JobFuture<std::vector<Result> > whenAll( const std::vector<JobFuture<Result> >& futures)
+{
+	typedef JobFutureJoin<Result> Join;
+	typename Join::StateRef target( new JobFutureState<std::vector<Result> >());
+	if (futures.empty())
+	{
+		target->setValue( std::vector<Result>());
+		return JobFuture<std::vector<Result> >( target);
+	}
+	strus::shared_ptr<Join> join( new Join( target, futures.size()));
+	typename std::vector<JobFuture<Result> >::const_iterator fi = futures.begin(), fe = futures.end();
+	for (std::size_t fidx=0; fi != fe; ++fi,++fidx)
+	{
+		fi->state()->addContinuation( new typename Join::Continuation( join, fidx, fi->state()));
+	}
+	return JobFuture<std::vector<Result> >( target);
+}
+
+}//namespace
+#endif
+
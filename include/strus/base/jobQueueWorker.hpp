@@ -9,8 +9,10 @@
 #ifndef _STRUS_JOB_QUEUE_WORKER_HPP_INCLUDED
 #define _STRUS_JOB_QUEUE_WORKER_HPP_INCLUDED
 #include "strus/base/filehandle.hpp"
+#include "strus/base/stdint.h"
 #include <stdexcept>
 #include <new>
+#include <cstddef>
 
 namespace strus {
 
@@ -30,7 +32,18 @@ public:
 	/// \remark Regularity of timer events is not guaranteed, bookkeeping about real time is up to client
 	JobQueueWorker( int secondsPeriod_, bool useFdSelect)
 	{
-		if (!init(secondsPeriod_,useFdSelect)) throw std::bad_alloc();
+		if (!init(secondsPeriod_,useFdSelect,-1)) throw std::bad_alloc();
+	}
+	/// \brief Constructor of a worker executing the jobs with a pool of threads
+	/// \param[in] secondsPeriod_ Period of timer ticker events in seconds
+	/// \param[in] useFdSelect true, wait on file descriptor events (select), false wait on condition variables
+	/// \param[in] nofWorkers_ number of threads executing jobs, 0 for the number of cores of the system
+	/// \note Every thread of the pool has its own job queue. Jobs pushed by a job are queued in the queue of the thread executing it,
+	///	jobs pushed from outside are distributed round robin. Threads without jobs steal jobs from the queues of the other threads.
+	/// \note Tickers and listeners are still served by one thread of their own
+	JobQueueWorker( int secondsPeriod_, bool useFdSelect, int nofWorkers_)
+	{
+		if (!init(secondsPeriod_,useFdSelect,nofWorkers_ < 0 ? 0 : nofWorkers_)) throw std::bad_alloc();
 	}
 	/// \brief Destructor
 	~JobQueueWorker()
@@ -44,12 +57,86 @@ public:
 	/// \brief Stop thread without finishing idle jobs in the queue
 	void stop();
 
-	/// \brief Push a new job to be executed
+	/// \brief Priority classes of jobs
+	/// \note Jobs of a class are only executed if no jobs of a higher class are queued, jobs of the same class in FIFO order
+	///	(in the pool mode a thread executes the jobs pushed by its own jobs first)
+	enum JobPriority {
+		PriorityHigh,		///< latency critical jobs (e.g. cache refreshes)
+		PriorityNormal,		///< default priority
+		PriorityLow,		///< bulk work (e.g. compactions) overtaken by all other jobs
+		NofJobPriorities	///< number of priority classes
+	};
+
+	/// \brief Push a new job to be executed with normal priority
 	/// \param[in] proc procedure of the job to be executed
 	/// \param[in] context context data of the job to be executed
 	/// \param[in] deleter destructor function of the context
 	/// \return true on success, false on error
-	bool pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter);
+	bool pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter)
+	{
+		return pushJob( proc, context, deleter, PriorityNormal);
+	}
+
+	/// \brief Push a new job to be executed with a priority
+	/// \param[in] proc procedure of the job to be executed
+	/// \param[in] context context data of the job to be executed
+	/// \param[in] deleter destructor function of the context
+	/// \param[in] priority priority class of the job
+	/// \return true on success, false on error
+	bool pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter, JobPriority priority);
+
+	/// \brief Behaviour of pushJob if the job queue is full
+	enum OverflowPolicy {
+		OverflowBlock,		///< wait until there is space in the queue (jobs pushed by the threads executing jobs of the worker are accepted without waiting to avoid deadlocks)
+		OverflowReject,		///< do not queue the job, pushJob returns false and the context stays with the caller
+		OverflowDropOldest	///< remove the job of the lowest priority class queued waiting for the longest time and call its deleter to make space
+	};
+
+	/// \brief Limit the number of jobs queued
+	/// \param[in] capacity maximum number of jobs queued, 0 for no limit (default)
+	/// \param[in] policy what to do if a job is pushed to a full queue
+	/// \note Listeners are not counted and never rejected
+	/// \return true on success, false if called when the worker is running
+	bool setQueueCapacity( std::size_t capacity, OverflowPolicy policy);
+
+	/// \brief Snapshot of the metrics of the jobs of a priority class
+	struct PriorityStatistics
+	{
+		std::size_t depth;		///< number of jobs of the class queued now
+		uint64_t nofEnqueued;		///< number of jobs of the class accepted
+		uint64_t nofDequeued;		///< number of jobs of the class taken from the queue for execution
+		double avgWaitTime;		///< average time in milliseconds a job of the class waited in the queue in the last measuring interval
+		double maxWaitTime;		///< longest time in milliseconds a job of the class waited in the queue since start
+
+		PriorityStatistics()
+			:depth(0),nofEnqueued(0),nofDequeued(0),avgWaitTime(0.0),maxWaitTime(0.0){}
+	};
+
+	/// \brief Snapshot of the metrics of the job queue
+	struct QueueStatistics
+	{
+		std::size_t capacity;		///< maximum number of jobs queued, 0 for no limit
+		std::size_t depth;		///< number of jobs queued now
+		std::size_t maxDepth;		///< highest number of jobs queued since start
+		uint64_t nofEnqueued;		///< number of jobs accepted
+		uint64_t nofDequeued;		///< number of jobs taken from the queue for execution
+		uint64_t nofRejected;		///< number of jobs rejected because the queue was full (OverflowReject)
+		uint64_t nofDropped;		///< number of jobs removed from the queue without execution (OverflowDropOldest)
+		uint64_t nofBlocked;		///< number of pushes that had to wait for space in the queue (OverflowBlock)
+		double enqueueRate;		///< jobs accepted per second in the last measuring interval
+		double avgWaitTime;		///< average time in milliseconds a job waited in the queue in the last measuring interval
+		double maxWaitTime;		///< longest time in milliseconds a job waited in the queue since start
+		PriorityStatistics priority[ NofJobPriorities];	///< metrics of the jobs of each priority class
+
+		QueueStatistics()
+			:capacity(0),depth(0),maxDepth(0),nofEnqueued(0),nofDequeued(0),nofRejected(0),nofDropped(0),nofBlocked(0)
+			,enqueueRate(0.0),avgWaitTime(0.0),maxWaitTime(0.0){}
+	};
+
+	/// \brief Get the metrics of the job queue
+	/// \note The rates and averages are measured over the interval since the last call at least one second ago (or since start),
+	///	so a monitor calling this function periodically gets the values of its period
+	QueueStatistics queueStatistics() const;
 
 	/// \brief Push a ticker procedure called periodically
 	/// \param[in] proc procedure of the ticker to be executed
@@ -57,7 +144,26 @@ public:
 	/// \return true on success, false on error
 	bool pushTicker( JobHandlerProc proc, void* context);
 
+	/// \brief Handle of a timer, 0 is an invalid handle
+	typedef uint64_t TimerId;
+
+	/// \brief Schedule a procedure to be called once after a timeout by the thread serving tickers and listeners
+	/// \param[in] milliseconds timeout in milliseconds
+	/// \param[in] proc procedure called when the timer expires
+	/// \param[in] context context data of the procedure
+	/// \param[in] deleter destructor function of the context, called if the timer is cancelled or if it did not expire before the worker is destroyed
+	/// \note As for jobs the procedure is responsible for the context when the timer expires, the deleter is not called then
+	/// \note Timers are kept in a hierarchical timer wheel, scheduling and cancelling is O(1)
+	/// \return the handle of the timer for cancelTimer or 0 on error
+	TimerId scheduleTimer( int milliseconds, JobHandlerProc proc, void* context, JobDeleterProc deleter);
+
+	/// \brief Cancel a timer
+	/// \param[in] id handle of the timer returned by scheduleTimer
+	/// \return true if the timer has been cancelled and its deleter called, false if it expired or was cancelled already
+	bool cancelTimer( TimerId id);
+
 	/// \brief Types of events to listen in the select mode (with constructor parameter useFdSelect set to true)
+	/// \note The select mode uses epoll where available (Linux) without limits of the number of file descriptors and listeners, select with a limit of FD_SETSIZE file descriptors and 255 listeners otherwise
 	enum FdType {FdRead=1,FdWrite=2,FdExcept=4};
 
 	/// \brief Push a listener for a filehandle event 
@@ -71,9 +177,14 @@ public:
 	/// \return true on success, false on error
 	bool pushListener( JobHandlerProc proc, void* context, JobDeleterProc deleter, const FileHandle& fh, int fdTypeMask);
 
+	/// \brief Get the number of threads executing jobs
+	/// \return the number of threads of the pool or 1 if constructed without pool
+	int nofWorkers() const;
+
 private:
 	void wait();
-	bool init( int secondsPeriod_, bool useFdSelect);
+	/// \param[in] nofWorkers_ number of threads of the pool, 0 for the number of cores, -1 for no pool (jobs are executed by the thread serving tickers and listeners)
+	bool init( int secondsPeriod_, bool useFdSelect, int nofWorkers_);
 	void clear();
 
 private:
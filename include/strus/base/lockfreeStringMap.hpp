@@ -5,69 +5,70 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
-/// \brief Implementation of a hash table for shared read/write trying to avoid locking for parallel read accesses and single write access
+/// \brief Implementation of a hash table for shared read/write without locking for parallel read accesses and with parallel write access to different blocks
 /// \file lockfreeStringMap.hpp
 #ifndef _STRUS_BASE_LOCKFREE_STRING_MAP_HPP_INCLUDED
 #define _STRUS_BASE_LOCKFREE_STRING_MAP_HPP_INCLUDED
 #include "strus/base/atomic.hpp"
 #include "strus/base/thread.hpp"
-#include "strus/base/shared_ptr.hpp"
-#include "strus/base/crc32.hpp"
+#include "strus/base/platform.hpp"
+#include "strus/base/epochReclamation.hpp"
+#include "strus/base/stringHash.hpp"
 #include "strus/base/stdint.h"
 #include <limits>
 #include <map>
+#include <vector>
 #include <string>
 #include <cstring>
-
-#undef STRUS_USE_STD_MAKE_SHARED
-#if __cplusplus >= 201103L
-#if defined __clang__
-#define STRUS_USE_STD_MAKE_SHARED
-#elif defined __GNUC__
-#if STRUS_GCC_VERSION >= 40900
-#define STRUS_USE_STD_MAKE_SHARED
-#endif // STRUS_GCC_VERSION
-#endif // __clang__
-#endif // __cplusplus
-
-#ifdef STRUS_USE_STD_MAKE_SHARED
-#include <memory>
-#else
-#include <boost/make_shared.hpp> 
-#endif
-
+#include <cstdlib>
+#include <new>
 
 namespace strus
 {
 
 /// \brief Lockfree map of string to a scalar or atomically assignable value
-/// \note This map is only lock free for readers but does locking for the mutual exclusion of writers
-/// \note ValueType must be atomically assignable; there is just one writer at once but values are assigned by the assignment operator
+/// \note This map is lock free for readers, writers lock only the block a key belongs to
+/// \note Readers pin an epoch (see epochReclamation.hpp) instead of holding references on the data they read, replaced tables are freed in batches
+/// \note ValueType must be atomically assignable; values are updated in place by the writer holding the block lock while readers may read them
 /// \note For atomic data types see https://www.gnu.org/software/libc/manual/html_node/Atomic-Types.html
-template <typename ValueType>
+/// \note HashPolicy is a class with a static method 'uint64_t calc( const char* key, std::size_t keylen)', see stringHash.hpp
+template <typename ValueType, class HashPolicy=StringHash>
 class LockfreeStringMap
 {
 public:
 	explicit LockfreeStringMap( std::size_t nofBlocks=128)
-		:m_hashMask(1),m_nofHashBits(0),m_blocks()
+		:m_hashMask(1),m_nofHashBits(0),m_blocks(0),m_reclamation()
 	{
 		if (nofBlocks <= 1) nofBlocks = 1;
 		if (nofBlocks >= (std::size_t)(1<<31)) throw std::bad_alloc();
 		while (m_hashMask < (uint32_t)nofBlocks) {++m_nofHashBits; m_hashMask <<= 1;}
-		for (std::size_t ii=0; ii<m_hashMask; ++ii) m_blocks.push_back( BlockKeyMapRef());
+		m_blocks = new Block[ m_hashMask];
 		m_hashMask--;
 	}
+	~LockfreeStringMap()
+	{
+		delete [] m_blocks;
+	}
 
 	bool get( const char* key, ValueType& value) const
 	{
-		std::size_t blockidx = hashString( key) & m_hashMask;
+		return get( key, std::strlen( key), value);
+	}
+
+	/// \brief Get the value of a key that is not 0-terminated
+	/// \param[in] key pointer to the key
+	/// \param[in] keylen size of the key in bytes
+	/// \param[out] value the value of the key if found
+	/// \return true if the key was found, false else
+	bool get( const char* key, std::size_t keylen, ValueType& value) const
+	{
+		uint64_t hash = HashPolicy::calc( key, keylen);
 
-		BlockKeyMapRef ownership = m_blocks[ blockidx];
-		if (!ownership.get()) return false;
-		const ValueType* valref = ownership->find( key);
-		if (valref)
+		EpochReclamation::Guard guard( m_reclamation);
+		const Slot* slot = m_blocks[ hash & m_hashMask].find( (uint32_t)(hash >> m_nofHashBits), key, keylen);
+		if (slot)
 		{
-			value = *valref;
+			value = slot->value;
 			return true;
 		}
 		else
@@ -76,6 +77,55 @@ public:
 		}
 	}
 
+	/// \brief Get the values of a list of keys
+	/// \note The keys are processed in batches: all keys of a batch are hashed first, then the memory they are accessing is prefetched, then they are resolved.
+	///	Hides the memory latency of resolving many keys, e.g. all terms of a query.
+	/// \param[in] nofKeys number of keys
+	/// \param[in] keys array of pointers to the keys
+	/// \param[in] keylens array of the sizes of the keys in bytes
+	/// \param[out] values array where to write the values of the keys found to (values of keys not found are left untouched)
+	/// \param[out] found array where to write for each key if it was found
+	/// \return the number of keys found
+	std::size_t getMany( std::size_t nofKeys, const char* const* keys, const std::size_t* keylens, ValueType* values, bool* found) const
+	{
+		enum {BatchSize=16};
+		std::size_t rt = 0;
+		uint64_t hashes[ BatchSize];
+		const Block* blocks[ BatchSize];
+
+		EpochReclamation::Guard guard( m_reclamation);
+		for (std::size_t bi=0; bi < nofKeys; bi += BatchSize)
+		{
+			std::size_t be = (nofKeys - bi > (std::size_t)BatchSize) ? (bi + BatchSize) : nofKeys;
+			std::size_t ki;
+			for (ki=bi; ki < be; ++ki)
+			{
+				hashes[ ki-bi] = HashPolicy::calc( keys[ ki], keylens[ ki]);
+				blocks[ ki-bi] = &m_blocks[ hashes[ ki-bi] & m_hashMask];
+				prefetch( blocks[ ki-bi]);
+			}
+			for (ki=bi; ki < be; ++ki)
+			{
+				blocks[ ki-bi]->prefetch( (uint32_t)(hashes[ ki-bi] >> m_nofHashBits));
+			}
+			for (ki=bi; ki < be; ++ki)
+			{
+				const Slot* slot = blocks[ ki-bi]->find( (uint32_t)(hashes[ ki-bi] >> m_nofHashBits), keys[ ki], keylens[ ki]);
+				if (slot)
+				{
+					values[ ki] = slot->value;
+					found[ ki] = true;
+					++rt;
+				}
+				else
+				{
+					found[ ki] = false;
+				}
+			}
+		}
+		return rt;
+	}
+
 	class Assignment
 	{
 	public:
@@ -89,202 +139,384 @@ public:
 	template <class Updater>
 	void set( const char* key, const ValueType& value, const Updater& updater = Updater())
 	{
-		std::size_t blockidx = hashString( key) & m_hashMask;
+		std::size_t keylen = std::strlen( key);
+		uint64_t hash = HashPolicy::calc( key, keylen);
+		Block& block = m_blocks[ hash & m_hashMask];
 
-		strus::unique_lock lock( m_writerMutex); //... only one writer
-		if (!m_blocks[ blockidx].get())
-		{
-			m_blocks[ blockidx] = BlockKeyMap::newBlock( key, value);
-		}
-		else
-		{
-			BlockKeyMapRef newblock = m_blocks[ blockidx]->setValueAndGetUpdatedBlock( key, value, updater);
-			if (newblock.get()) m_blocks[ blockidx] = newblock;
-		}
+		strus::unique_lock lock( block.mutex); //... only one writer per block
+		block.set( (uint32_t)(hash >> m_nofHashBits), key, keylen, value, updater, m_reclamation);
 	}
 
 	template <class Updater, class KeyValuePairList>
 	void set( const KeyValuePairList& assignmentList, Updater updater = Assignment())
 	{
-		typedef typename KeyValuePairList::value_type KeyValuePair;
-		typedef std::vector<KeyValuePair> KeyValuePairVector;
-		typedef std::map<std::size_t,KeyValuePairVector> BlockMap;
+		typedef std::pair<uint64_t,std::string> HashKeyPair;
+		typedef std::pair<HashKeyPair,ValueType> KeyAssignment;
+		typedef std::vector<KeyAssignment> AssignmentVector;
+		typedef std::map<std::size_t,AssignmentVector> BlockMap;
 
 		BlockMap blockmap;
 
 		typename KeyValuePairList::const_iterator ai = assignmentList.begin(), ae = assignmentList.end();
 		for (; ai != ae; ++ai)
 		{
-			std::size_t blockidx = hashString( ai->first) & m_hashMask;
-			blockmap[ blockidx].push_back( *ai);
+			std::string key = ai->first;
+			uint64_t hash = hashString( key);
+			blockmap[ hash & m_hashMask].push_back( KeyAssignment( HashKeyPair( hash, key), ai->second));
 		}
 
 		typename BlockMap::const_iterator bi = blockmap.begin(), be = blockmap.end();
 		for (; bi != be; ++bi)
 		{
-			strus::unique_lock lock( m_writerMutex); //... only one writer
+			Block& block = m_blocks[ bi->first];
+			strus::unique_lock lock( block.mutex); //... only one writer per block
 
-			BlockKeyMapRef newblock = BlockKeyMap::mergeBlock( m_blocks[ bi->first].get(), bi->second, updater);
-			if (newblock.get()) m_blocks[ bi->first] = newblock;
+			typename AssignmentVector::const_iterator vi = bi->second.begin(), ve = bi->second.end();
+			for (; vi != ve; ++vi)
+			{
+				const std::string& key = vi->first.second;
+				block.set( (uint32_t)(vi->first.first >> m_nofHashBits), key.c_str(), key.size(), vi->second, updater, m_reclamation);
+			}
 		}
 	}
 
 private:
-	struct BlockKeyMap;
-#ifdef STRUS_USE_STD_MAKE_SHARED
-	typedef std::shared_ptr<BlockKeyMap> BlockKeyMapRef;
-	static BlockKeyMapRef createBlockKeyMapRef() {return std::make_shared<BlockKeyMap>();}
-#else
-	typedef boost::shared_ptr<BlockKeyMap> BlockKeyMapRef;
-	static BlockKeyMapRef createBlockKeyMapRef() {return boost::make_shared<BlockKeyMap>();}
-#endif
-
-	struct BlockKeyMap
+	/// \brief Allocator for the keys of one block, keys are not freed till the end of the map life time
+	/// \note A record is the key size (uint32_t) followed by the key and a terminating 0, the key pointer points to the key
+	class KeyAllocator
 	{
-		struct KeyLess
+	public:
+		enum {ChunkSize=4096};
+
+		KeyAllocator()
+			:m_chunks(),m_pos(ChunkSize){}
+		~KeyAllocator()
 		{
-			bool operator()( char const *a, char const *b) const
+			std::vector<char*>::const_iterator ci = m_chunks.begin(), ce = m_chunks.end();
+			for (; ci != ce; ++ci) std::free( *ci);
+		}
+
+		const char* alloc( const char* key, std::size_t keylen)
+		{
+			if (keylen >= (std::size_t)std::numeric_limits<uint32_t>::max()) throw std::bad_alloc();
+			std::size_t recsize = sizeof(uint32_t) + keylen + 1;
+			char* rec;
+			if (recsize > ChunkSize / 4)
 			{
-				return std::strcmp( a, b) < 0;
+				//... big keys get their own chunk, inserted before the current chunk
+				rec = (char*)std::malloc( recsize);
+				if (!rec) throw std::bad_alloc();
+				m_chunks.insert( m_chunks.end() - (m_chunks.empty() ? 0:1), rec);
 			}
-		};
+			else
+			{
+				if (m_pos + recsize > ChunkSize)
+				{
+					char* chunk = (char*)std::malloc( ChunkSize);
+					if (!chunk) throw std::bad_alloc();
+					try
+					{
+						m_chunks.push_back( chunk);
+					}
+					catch (const std::bad_alloc&)
+					{
+						std::free( chunk);
+						throw;
+					}
+					m_pos = 0;
+				}
+				rec = m_chunks.back() + m_pos;
+				m_pos += recsize;
+			}
+			uint32_t keylen32 = keylen;
+			std::memcpy( rec, &keylen32, sizeof(keylen32));
+			std::memcpy( rec + sizeof(uint32_t), key, keylen);
+			rec[ sizeof(uint32_t) + keylen] = 0;
+			return rec + sizeof(uint32_t);
+		}
 
-		typedef std::map<const char*,ValueType,KeyLess> Map;
-		Map map;
-		std::string strar;
+		static std::size_t keylen( const char* keyptr)
+		{
+			uint32_t rt;
+			std::memcpy( &rt, keyptr - sizeof(uint32_t), sizeof(rt));
+			return rt;
+		}
 
-		BlockKeyMap() :map(),strar(){}
+	private:
+		KeyAllocator( const KeyAllocator&){}		///> non copyable
+		void operator=( const KeyAllocator&){}		///> non copyable
 
-		static BlockKeyMapRef newBlock( const char* key, ValueType value)
+	private:
+		std::vector<char*> m_chunks;
+		std::size_t m_pos;
+	};
+
+	/// \brief Element of the hash table of a block, published to readers by storing the key pointer after hash and value have been written
+	struct Slot
+	{
+		strus::atomic<const char*> key;
+		uint32_t hash;
+		ValueType value;
+
+		Slot() :key(0),hash(0),value(){}
+	};
+
+	/// \brief Open addressing hash table with linear probing of a block
+	class Table
+	{
+	public:
+		explicit Table( std::size_t size_)
+			:m_mask(size_-1),m_ar(new Slot[ size_]){}
+		~Table()
+		{
+			delete [] m_ar;
+		}
+
+		std::size_t size() const
 		{
-			BlockKeyMapRef copy = createBlockKeyMapRef();
-			copy->strar = key;
-			copy->map.insert( typename Map::value_type( copy->strar.c_str(), value));
-			return copy;
+			return m_mask+1;
 		}
 
-		template <class Updater, class KeyValuePairList>
-		static BlockKeyMapRef mergeBlock( BlockKeyMap* ths, const KeyValuePairList& assignmentList, Updater updater)
+		/// \brief Find the slot of a key
+		/// \note Lock free, the table is never full
+		const Slot* find( uint32_t hash, const char* key, std::size_t keylen) const
 		{
-			BlockKeyMapRef copy = createBlockKeyMapRef();
-			typename KeyValuePairList::const_iterator ai = assignmentList.begin(), ae = assignmentList.end();
-			std::vector<ValueType> values;
-			for (; ai != ae; ++ai)
+			for (std::size_t pos = hash & m_mask;; pos = (pos + 1) & m_mask)
 			{
-				typename Map::iterator mi;
-				std::string key = ai->first;
-				if (ths && ths->map.end() != (mi = ths->map.find( key.c_str())))
+				const Slot& slot = m_ar[ pos];
+				const char* slotkey = slot.key.load();
+				if (!slotkey) return 0;
+				if (slot.hash == hash && KeyAllocator::keylen( slotkey) == keylen && std::memcmp( slotkey, key, keylen) == 0)
 				{
-					// ... key already defined, update value in table
-					updater( mi->second, ai->second);
-				}
-				else
-				{
-					// ... key unknown, create new key and add value to parallel array values
-					values.push_back( ai->second);
-					if (!copy->strar.empty()) copy->strar.push_back( '\0');
-					copy->strar.append( key);
+					return &slot;
 				}
 			}
-			if (values.empty())
-			{
-				return BlockKeyMapRef();
-			}
-			if (ths)
+		}
+
+		Slot* find( uint32_t hash, const char* key, std::size_t keylen)
+		{
+			return const_cast<Slot*>( const_cast<const Table*>(this)->find( hash, key, keylen));
+		}
+
+		/// \brief Prefetch the first slot visited by a lookup
+		void prefetch( uint32_t hash) const
+		{
+			LockfreeStringMap::prefetch( m_ar + (hash & m_mask));
+		}
+
+		/// \brief Insert a new key, only called by the owner of the block lock
+		void insert( uint32_t hash, const char* keyptr, const ValueType& value)
+		{
+			for (std::size_t pos = hash & m_mask;; pos = (pos + 1) & m_mask)
 			{
-				typename Map::const_iterator oi = ths->map.begin(), oe = ths->map.end();
-				for (; oi != oe; ++oi)
+				Slot& slot = m_ar[ pos];
+				if (!slot.key.load())
 				{
-					// ... add all old keys to new keys and add value to parallel array values
-					values.push_back( oi->second);
-					if (!copy->strar.empty()) copy->strar.push_back( '\0');
-					copy->strar.append( oi->first);
+					slot.hash = hash;
+					slot.value = value;
+					slot.key.store( keyptr);
+					return;
 				}
 			}
-			// Insert all key/values into new map
-			typename std::vector<ValueType>::const_iterator vi = values.begin(), ve = values.end();
-			char const* ki = copy->strar.c_str();
-			for (; vi != ve; ++vi,ki=std::strchr( ki, '\0')+1)
+		}
+
+		const Slot& slot( std::size_t idx) const
+		{
+			return m_ar[ idx];
+		}
+
+	private:
+		Table( const Table&){}			///> non copyable
+		void operator=( const Table&){}		///> non copyable
+
+	private:
+		std::size_t m_mask;
+		Slot* m_ar;
+	};
+
+	/// \brief Independent part of the map with its own lock for writers
+	/// \note A table that is full is replaced by a table of double size, the elements of the old table are moved incrementally
+	///	with every following insert into the block. Readers look into the new table first and then into the old table till it has been migrated.
+	/// \note The old table is not changed anymore after it has been replaced, it stays readable for readers that loaded it till they have left (epoch reclamation)
+	struct Block
+	{
+		enum {
+			InitSize=8,		///< initial size of the table
+			MigrationStep=16	///< number of slots of the old table migrated with every insert, the migration ends before the new table is half full
+		};
+
+		Block()
+			:mutex(),table(0),oldTable(0),migratePos(0),keys(),nofElements(0){}
+		~Block()
+		{
+			delete table.load();
+			delete oldTable.load();
+		}
+
+		/// \brief Find the slot of a key
+		/// \note Lock free, the caller must have pinned the epoch
+		/// \note Both tables are loaded before any of them is searched. The old table is set before the new table is published
+		///	and reset after the migration into the new table is complete. So a key missing in the new table at the time of the
+		///	search is still in the old table loaded. The retry covers the tables being replaced in between.
+		const Slot* find( uint32_t hash, const char* key, std::size_t keylen) const
+		{
+			for (;;)
 			{
-				copy->map.insert( typename Map::value_type( ki, *vi));
+				const Table* tab = table.load();
+				if (!tab) return 0;
+				const Table* oldtab = oldTable.load();
+				const Slot* rt = tab->find( hash, key, keylen);
+				if (!rt && oldtab) rt = oldtab->find( hash, key, keylen);
+				if (rt || table.load() == tab) return rt;
 			}
-			return copy;
 		}
 
+		/// \brief Prefetch the first slot of the current table visited by a lookup
+		/// \note Lock free, the caller must have pinned the epoch
+		void prefetch( uint32_t hash) const
+		{
+			const Table* tab = table.load();
+			if (tab) tab->prefetch( hash);
+		}
+
+		/// \brief Insert a key or update its value, only called by the owner of the block lock
 		template <class Updater>
-		BlockKeyMapRef setValueAndGetUpdatedBlock( const char* key, ValueType value, Updater updater)
+		void set( uint32_t hash, const char* key, std::size_t keylen, const ValueType& value, const Updater& updater, EpochReclamation& reclamation)
 		{
-			typename Map::iterator mi = map.find( key);
-			if (mi == map.end())
+			Table* tab = table.load();
+			if (tab)
 			{
-				BlockKeyMapRef copy = createBlockKeyMapRef();
-				std::size_t keylen = std::strlen( key);
-
-				copy->strar.reserve( keylen + 1 + strar.size());
-				copy->strar.append( strar);
-				copy->strar.push_back( '\0');
-				copy->strar.append( key);
-				const char* new_key = copy->strar.c_str() + copy->strar.size() - keylen;
-				copy->map.insert( typename Map::value_type( new_key, value));
-				typename Map::const_iterator oi = map.begin(), oe = map.end();
-				for (; oi != oe; ++oi)
+				Slot* slot = tab->find( hash, key, keylen);
+				if (slot)
+				{
+					updater( slot->value, value);
+					return;
+				}
+				Table* oldtab = oldTable.load();
+				const Slot* oldslot = oldtab ? oldtab->find( hash, key, keylen) : 0;
+				if (oldslot)
 				{
-					const char* o_key = copy->strar.c_str() + (oi->first - strar.c_str());
-					copy->map.insert( typename Map::value_type( o_key, oi->second));
+					//... key not migrated yet, migrate it with the updated value
+					ValueType newvalue = oldslot->value;
+					updater( newvalue, value);
+					tab->insert( hash, oldslot->key.load(), newvalue);
+					migrate( MigrationStep, reclamation);
+					return;
 				}
-				return copy;
 			}
-			else
+			if (!tab || (nofElements+1) * 2 > tab->size())
 			{
-				updater( mi->second, value);
-				return BlockKeyMapRef();
+				tab = grow( tab, reclamation);
 			}
+			tab->insert( hash, keys.alloc( key, keylen), value);
+			++nofElements;
+			migrate( MigrationStep, reclamation);
 		}
 
-		const ValueType* find( const char* key) const
+		Table* grow( Table* tab, EpochReclamation& reclamation)
 		{
-			typename Map::const_iterator mi = map.find(key);
-			return (mi == map.end()) ? NULL : &mi->second;
+			if (oldTable.load()) migrate( std::numeric_limits<std::size_t>::max(), reclamation);
+			Table* newtab = new Table( tab ? (tab->size() * 2) : (std::size_t)InitSize);
+			if (tab)
+			{
+				oldTable.store( tab);
+				migratePos = 0;
+			}
+			table.store( newtab);
+			return newtab;
 		}
 
-		typedef typename Map::const_iterator const_iterator;
-		const_iterator begin() const	{return map.begin();}
-		const_iterator end() const	{return map.end();}
+		/// \brief Move the elements of a number of slots of the old table to the new table
+		void migrate( std::size_t nofSlots, EpochReclamation& reclamation)
+		{
+			Table* oldtab = oldTable.load();
+			if (!oldtab) return;
+			Table* tab = table.load();
+			std::size_t end = (nofSlots >= oldtab->size() - migratePos) ? oldtab->size() : (migratePos + nofSlots);
+			for (; migratePos < end; ++migratePos)
+			{
+				const Slot& slot = oldtab->slot( migratePos);
+				const char* keyptr = slot.key.load();
+				if (keyptr && !tab->find( slot.hash, keyptr, KeyAllocator::keylen( keyptr)))
+				{
+					tab->insert( slot.hash, keyptr, slot.value);
+				}
+			}
+			if (migratePos == oldtab->size())
+			{
+				oldTable.store( 0);
+				//... readers could still be using the old table, it is freed when they have left
+				reclamation.retire( oldtab);
+			}
+		}
+
+		strus::mutex mutex;
+		strus::atomic<Table*> table;
+		strus::atomic<Table*> oldTable;		///< table replaced by table and not completely migrated yet or NULL
+		std::size_t migratePos;			///< next slot of oldTable to migrate
+		KeyAllocator keys;
+		std::size_t nofElements;
+		char pad[ platform::CacheLineSize];	///< avoid false sharing of the block header by writers of different blocks
 	};
 
 private:
-	static uint32_t hashString( const char* key)
+	static void prefetch( const void* ptr)
+	{
+#if defined __GNUC__
+		__builtin_prefetch( ptr);
+#else
+		(void)ptr;
+#endif
+	}
+	static uint64_t hashString( const char* key)
 	{
-		return utils::Crc32::calc( key);
+		return HashPolicy::calc( key, std::strlen( key));
 	}
-	static uint32_t hashString( const std::string& key)
+	static uint64_t hashString( const std::string& key)
 	{
-		return utils::Crc32::calc( key.c_str(), key.size());
+		return HashPolicy::calc( key.c_str(), key.size());
 	}
 
-	typedef std::vector<BlockKeyMapRef> BlockKeyMapRefArray;
-
 public:
 	class const_iterator
 	{
 	public:
 		const_iterator( const const_iterator& o)
-			:m_cur(o.m_cur),m_itr(o.m_itr),m_end(o.m_end),m_elemitr(o.m_elemitr){}
-		const_iterator( typename BlockKeyMapRefArray::const_iterator itr_, typename BlockKeyMapRefArray::const_iterator end_)
-			:m_itr(itr_),m_end(end_)
+			:m_pinref(EpochReclamation::repin(o.m_pinref)),m_blocks(o.m_blocks),m_blockidx(o.m_blockidx),m_nofBlocks(o.m_nofBlocks),m_table(o.m_table),m_newTable(o.m_newTable),m_oldTable(o.m_oldTable),m_slotidx(o.m_slotidx),m_elem(o.m_elem){}
+		const_iterator( const EpochReclamation& reclamation, const Block* blocks_, std::size_t blockidx_, std::size_t nofBlocks_)
+			:m_pinref(reclamation.pin()),m_blocks(blocks_),m_blockidx(blockidx_),m_nofBlocks(nofBlocks_),m_table(0),m_newTable(0),m_oldTable(0),m_slotidx(0),m_elem(0,ValueType())
 		{
 			skip();
 		}
+		~const_iterator()
+		{
+			EpochReclamation::unpin( m_pinref);
+		}
+		const_iterator& operator=( const const_iterator& o)
+		{
+			EpochReclamation::PinRef pinref = EpochReclamation::repin( o.m_pinref);
+			EpochReclamation::unpin( m_pinref);
+			m_pinref = pinref;
+			m_blocks = o.m_blocks;
+			m_blockidx = o.m_blockidx;
+			m_nofBlocks = o.m_nofBlocks;
+			m_table = o.m_table;
+			m_newTable = o.m_newTable;
+			m_oldTable = o.m_oldTable;
+			m_slotidx = o.m_slotidx;
+			m_elem = o.m_elem;
+			return *this;
+		}
 
-		typedef std::pair<const char* const,ValueType> value_type;
+		typedef std::pair<const char*,ValueType> value_type;
 
 		const value_type& operator* () const
 		{
-			return *m_elemitr;
+			return m_elem;
 		}
 		const value_type* operator-> () const
 		{
-			return &*m_elemitr;
+			return &m_elem;
 		}
 		const_iterator& operator++() {next(); return *this;}
 		const_iterator operator++(int) {const_iterator rt=*this; next(); return rt;}
@@ -293,79 +525,103 @@ public:
 		bool operator != (const const_iterator& o) const	{return !isequal(o);}
 
 	private:
+		/// \brief Move to the next occupied slot starting from the current position
+		/// \note Visits the slots of the old table of a block first, that does not change anymore, with the value of the new table if the key has been migrated.
+		///	Then visits the slots of the new table with keys not in the old table. Visiting the new table first would miss keys migrated
+		///	to a slot already passed.
 		void skip()
 		{
-			for (;;)
+			for (; m_blockidx < m_nofBlocks; ++m_blockidx,m_table=0)
 			{
-				m_cur = BlockKeyMapRef();
-				for (; m_itr != m_end; ++m_itr)
+				if (!m_table)
 				{
-					m_cur = *m_itr;
-					if (m_cur.get()) break;
+					//... the new table is loaded before the old table like in Block::find
+					m_newTable = m_blocks[ m_blockidx].table.load();
+					if (!m_newTable) continue;
+					m_oldTable = m_blocks[ m_blockidx].oldTable.load();
+					//... the old table loaded is the new table loaded if the block has grown again in between, its keys are all in the new table then
+					if (m_oldTable == m_newTable) m_oldTable = 0;
+					m_table = m_oldTable ? m_oldTable : m_newTable;
+					m_slotidx = 0;
 				}
-				if (m_cur.get())
+				for (;;)
 				{
-					m_elemitr = m_cur->begin();
-					if (m_elemitr == m_cur->end()) continue;
+					for (; m_slotidx < m_table->size(); ++m_slotidx)
+					{
+						const Slot& slot = m_table->slot( m_slotidx);
+						const char* keyptr = slot.key.load();
+						if (!keyptr) continue;
+						if (m_table == m_oldTable)
+						{
+							const Slot* migrated = m_newTable->find( slot.hash, keyptr, KeyAllocator::keylen( keyptr));
+							m_elem.first = keyptr;
+							m_elem.second = migrated ? migrated->value : slot.value;
+							return;
+						}
+						else if (!m_oldTable || !m_oldTable->find( slot.hash, keyptr, KeyAllocator::keylen( keyptr)))
+						{
+							m_elem.first = keyptr;
+							m_elem.second = slot.value;
+							return;
+						}
+					}
+					if (m_table != m_oldTable) break;
+					m_table = m_newTable;
+					m_slotidx = 0;
 				}
-				break;
 			}
+			m_table = 0;
+			m_slotidx = 0;
+			m_elem.first = 0;
 		}
 
 		void next()
 		{
-			if (m_cur.get() && m_elemitr != m_cur->end())
-			{
-				++m_elemitr;
-				if (m_elemitr == m_cur->end())
-				{
-					++m_itr;
-					skip();
-				}
-			}
-			else
+			if (m_table)
 			{
-				++m_itr;
+				++m_slotidx;
 				skip();
 			}
 		}
 
-		int isequal( const const_iterator& o) const
-		{
-			return isequal( *this, o);
-		}
-
-		static bool isequal( const const_iterator& aa, const const_iterator& bb)
+		bool isequal( const const_iterator& o) const
 		{
-			if (!aa.m_cur.get()) return !bb.m_cur.get();
-			if (!bb.m_cur.get()) return false;
-			return (aa.m_itr == bb.m_itr && aa.m_elemitr == bb.m_elemitr);
+			if (!m_table) return !o.m_table;
+			return m_table == o.m_table && m_slotidx == o.m_slotidx;
 		}
 
 	private:
-		BlockKeyMapRef m_cur;
-		typename BlockKeyMapRefArray::const_iterator m_itr;
-		typename BlockKeyMapRefArray::const_iterator m_end;
-		typename BlockKeyMap::Map::const_iterator m_elemitr;
+		EpochReclamation::PinRef m_pinref;	///< iterators keep tables alive, so they should not live long while writers are active
+		const Block* m_blocks;
+		std::size_t m_blockidx;
+		std::size_t m_nofBlocks;
+		const Table* m_table;
+		const Table* m_newTable;
+		const Table* m_oldTable;
+		std::size_t m_slotidx;
+		value_type m_elem;
 	};
 
 	const_iterator begin() const
 	{
-		return const_iterator( m_blocks.begin(), m_blocks.end());
+		return const_iterator( m_reclamation, m_blocks, 0, m_hashMask+1);
 	}
 	const_iterator end() const
 	{
-		return const_iterator( m_blocks.end(), m_blocks.end());
+		return const_iterator( m_reclamation, m_blocks, m_hashMask+1, m_hashMask+1);
 	}
 
 private:
-	strus::mutex m_writerMutex;
+	LockfreeStringMap( const LockfreeStringMap&){}		///> non copyable
+	void operator=( const LockfreeStringMap&){}		///> non copyable
+
+private:
 	uint32_t m_hashMask;
 	int m_nofHashBits;
-	BlockKeyMapRefArray m_blocks;
+	Block* m_blocks;
+	EpochReclamation m_reclamation;
 };
 
 }//namespace
 #endif
 
-
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Read only symbol table working directly on a snapshot file mapped into memory
+///\file mappedSymbolTable.hpp
+#ifndef _STRUS_BASE_MAPPED_SYMBOL_TABLE_HPP_INCLUDED
+#define _STRUS_BASE_MAPPED_SYMBOL_TABLE_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <string>
+#include <cstddef>
+
+namespace strus
+{
+/// \brief Forward declaration
+class ErrorBufferInterface;
+
+///\brief Read only symbol table working directly on the pages of a file written with SymbolTable::save
+///\note The pages are shared between processes mapping the same file
+///\note Loading reads only the header and the bounds of the sections, so that it does not depend on the size of the file and pages are mapped lazily on access.
+///	The offsets and handles read by get and key are checked on access, so that a corrupt file never causes reads outside the mapping.
+class MappedSymbolTable
+{
+public:
+	///\brief Constructor
+	///\param[in] errorhnd_ error buffer interface for reporting errors
+	explicit MappedSymbolTable( ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_base(0),m_mapsize(0),m_nofSymbols(0),m_hashMask(0),m_offsets(0),m_slots(0),m_strings(0),m_stringsSize(0){}
+	///\brief Destructor
+	~MappedSymbolTable();
+
+	///\brief Map a file written with SymbolTable::save into memory
+	///\param[in] filename path of the file
+	///\return true on success, false on error (reported to the error buffer)
+	bool load( const std::string& filename);
+
+	///\brief Unmap the file loaded
+	void close();
+
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key string
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const std::string& key) const;
+	///\brief Get handle associated with key or 0 if not defined
+	///\param[in] key key string poiner
+	///\param[in] keysize size of key in bytes
+	///\return the handle for the key or 0 if not defined
+	uint32_t get( const char* key, std::size_t keysize) const;
+
+	///\brief Inverse lookup, get key of handle
+	///\param[in] id key handle
+	///\return the key string or NULL if not defined
+	const char* key( const uint32_t& id) const;
+
+	///\brief Get number of elements defined
+	///\return the number of elements defined
+	std::size_t size() const
+	{
+		return m_nofSymbols;
+	}
+
+	///\brief Evaluate if the symbol table is empty, without any definitions
+	///\return true if yes
+	bool empty() const
+	{
+		return m_nofSymbols == 0;
+	}
+
+private:
+#if __cplusplus >= 201103L
+	MappedSymbolTable( const MappedSymbolTable&) = delete;
+	void operator=( const MappedSymbolTable&) = delete;
+#else
+	MappedSymbolTable( const MappedSymbolTable&){}		///> non copyable
+	void operator=( const MappedSymbolTable&){}		///> non copyable
+#endif
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	void* m_base;
+	std::size_t m_mapsize;
+	uint32_t m_nofSymbols;
+	uint32_t m_hashMask;
+	const uint64_t* m_offsets;
+	const void* m_slots;
+	const char* m_strings;
+	uint64_t m_stringsSize;
+};
+
+}//namespace
+#endif
+
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Data parallel algorithms (parallel_for, parallel_reduce, parallel_sort) executed on a thread pool shared by the process
+/// \file parallel.hpp
+#ifndef _STRUS_BASE_PARALLEL_HPP_INCLUDED
+#define _STRUS_BASE_PARALLEL_HPP_INCLUDED
+#include "strus/base/thread.hpp"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+
+namespace strus
+{
+namespace parallel
+{
+
+/// \brief Function executed for chunks of a range in parallel
+class RangeBody
+{
+public:
+	virtual ~RangeBody(){}
+	/// \brief Process the chunk [start,end[
+	virtual void run( std::size_t start, std::size_t end)=0;
+};
+
+/// \brief Get the number of threads executing parallel algorithms including the caller
+int concurrency();
+
+/// \brief Define the number of threads executing parallel algorithms including the caller, before the first parallel algorithm is called
+/// \param[in] nofThreads number of threads, 0 for the number of cores
+/// \return true on success, false if the shared thread pool is already created
+bool setConcurrency( int nofThreads);
+
+/// \brief Process a range in chunks in parallel, the calling thread takes part, so nested calls do not block the pool
+/// \param[in] start start of the range
+/// \param[in] end end of the range (first element not part of it)
+/// \param[in] minGrain minimum size of a chunk
+/// \param[in] body function to call for each chunk
+/// \note The chunk size is adaptive (guided): every chunk claimed is a fraction of the rest of the range not claimed yet, but not smaller than minGrain
+/// \note Throws std::runtime_error with the message of the first exception thrown by the body, chunks not started yet are skipped then
+/// \note Throws std::bad_alloc
+void runRange( std::size_t start, std::size_t end, std::size_t minGrain, RangeBody& body);
+
+template <class Body>
+class RangeBodyAdapter
+	:public RangeBody
+{
+public:
+	explicit RangeBodyAdapter( const Body& body_)
+		:m_body(body_){}
+	virtual void run( std::size_t start, std::size_t end)
+	{
+		m_body( start, end);
+	}
+private:
+	const Body& m_body;
+};
+
+template <typename Value, class Body>
+class ReduceBodyAdapter
+	:public RangeBody
+{
+public:
+	ReduceBodyAdapter( const Body& body_, const Value& identity_)
+		:m_body(body_),m_identity(identity_),m_mutex(),m_results(){}
+	virtual void run( std::size_t start, std::size_t end)
+	{
+		Value value = m_body( start, end, m_identity);
+		strus::unique_lock lock( m_mutex);
+		m_results.push_back( std::pair<std::size_t,Value>( start, value));
+	}
+	/// \brief Get the results of the chunks in ascending order of their position
+	std::vector<std::pair<std::size_t,Value> >& results()
+	{
+		std::sort( m_results.begin(), m_results.end(), CompareStart());
+		return m_results;
+	}
+
+private:
+	struct CompareStart
+	{
+		bool operator()( const std::pair<std::size_t,Value>& aa, const std::pair<std::size_t,Value>& bb) const
+		{
+			return aa.first < bb.first;
+		}
+	};
+
+private:
+	const Body& m_body;
+	const Value& m_identity;
+	strus::mutex m_mutex;
+	std::vector<std::pair<std::size_t,Value> > m_results;
+};
+
+template <class Iterator, class Compare>
+class SortPartsBody
+{
+public:
+	SortPartsBody( Iterator begin_, const std::vector<std::size_t>& bounds_, const Compare& cmp_)
+		:m_begin(begin_),m_bounds(bounds_),m_cmp(cmp_){}
+	void operator()( std::size_t start, std::size_t end) const
+	{
+		for (std::size_t pi=start; pi < end; ++pi)
+		{
+			std::sort( m_begin + m_bounds[ pi], m_begin + m_bounds[ pi+1], m_cmp);
+		}
+	}
+private:
+	Iterator m_begin;
+	const std::vector<std::size_t>& m_bounds;
+	const Compare& m_cmp;
+};
+
+template <class Iterator, class Compare>
+class MergePartsBody
+{
+public:
+	MergePartsBody( Iterator begin_, const std::vector<std::size_t>& bounds_, std::size_t width_, const Compare& cmp_)
+		:m_begin(begin_),m_bounds(bounds_),m_width(width_),m_cmp(cmp_){}
+	void operator()( std::size_t start, std::size_t end) const
+	{
+		std::size_t nofParts = m_bounds.size()-1;
+		for (std::size_t mi=start; mi < end; ++mi)
+		{
+			std::size_t first = mi * 2 * m_width;
+			std::size_t middle = std::min( first + m_width, nofParts);
+			std::size_t last = std::min( first + 2 * m_width, nofParts);
+			std::inplace_merge( m_begin + m_bounds[ first], m_begin + m_bounds[ middle], m_begin + m_bounds[ last], m_cmp);
+		}
+	}
+private:
+	Iterator m_begin;
+	const std::vector<std::size_t>& m_bounds;
+	std::size_t m_width;
+	const Compare& m_cmp;
+};
+
+}//namespace parallel
+
+
+/// \brief Call a function for the chunks of a range in parallel on the shared thread pool
+/// \param[in] start start of the range
+/// \param[in] end end of the range (first element not part of it)
+/// \param[in] body function object with void operator()( std::size_t chunkStart, std::size_t chunkEnd) const, called concurrently
+/// \param[in] minGrain minimum size of a chunk, should be big enough to make the overhead of a chunk (an atomic operation) negligible
+/// \note Throws std::runtime_error with the message of the first exception thrown by the body, std::bad_alloc
+template <class Body>
+void parallel_for( std::size_t start, std::size_t end, const Body& body, std::size_t minGrain=1)
+{
+	parallel::RangeBodyAdapter<Body> adapter( body);
+	parallel::runRange( start, end, minGrain, adapter);
+}
+
+/// \brief Reduce a range in parallel on the shared thread pool
+/// \param[in] start start of the range
+/// \param[in] end end of the range (first element not part of it)
+/// \param[in] identity neutral element of join
+/// \param[in] body function object with Value operator()( std::size_t chunkStart, std::size_t chunkEnd, const Value& init) const, reducing a chunk starting with init, called concurrently
+/// \param[in] join function object with Value operator()( const Value& left, const Value& right) const, associative, called with the results of adjacent chunks in the order of the range
+/// \param[in] minGrain minimum size of a chunk
+/// \return the result of the reduction
+/// \note Throws std::runtime_error with the message of the first exception thrown by the body, std::bad_alloc
+template <typename Value, class Body, class Join>
+Value parallel_reduce( std::size_t start, std::size_t end, const Value& identity, const Body& body, const Join& join, std::size_t minGrain=1)
+{
+	parallel::ReduceBodyAdapter<Value,Body> adapter( body, identity);
+	parallel::runRange( start, end, minGrain, adapter);
+	Value rt = identity;
+	typename std::vector<std::pair<std::size_t,Value> >::const_iterator ri = adapter.results().begin(), re = adapter.results().end();
+	for (; ri != re; ++ri)
+	{
+		rt = join( rt, ri->second);
+	}
+	return rt;
+}
+
+/// \brief Sort a random access range in parallel on the shared thread pool (merge sort of parts sorted with std::sort)
+/// \param[in] begin start of the range
+/// \param[in] end end of the range
+/// \param[in] cmp less comparison
+/// \param[in] minGrain minimum size of a part sorted by one thread
+/// \note Not stable, the merges of the last rounds have less parallelism than there are threads
+/// \note Throws std::runtime_error with the message of the first exception thrown by a comparison, std::bad_alloc
+template <class Iterator, class Compare>
+void parallel_sort( Iterator begin, Iterator end, const Compare& cmp, std::size_t minGrain=4096)
+{
+	std::size_t size = end - begin;
+	std::size_t nofParts = 1;
+	std::size_t maxNofParts = parallel::concurrency();
+	if (minGrain == 0) minGrain = 1;
+	while (nofParts < maxNofParts && size / (nofParts * 2) >= minGrain) nofParts *= 2;
+	if (nofParts == 1)
+	{
+		std::sort( begin, end, cmp);
+		return;
+	}
+	std::vector<std::size_t> bounds;
+	bounds.reserve( nofParts + 1);
+	for (std::size_t pi=0; pi <= nofParts; ++pi)
+	{
+		bounds.push_back( size / nofParts * pi + std::min( pi, size % nofParts));
+	}
+	parallel_for( 0, nofParts, parallel::SortPartsBody<Iterator,Compare>( begin, bounds, cmp), 1);
+	for (std::size_t width=1; width < nofParts; width *= 2)
+	{
+		parallel_for( 0, nofParts / (2 * width), parallel::MergePartsBody<Iterator,Compare>( begin, bounds, width, cmp), 1);
+	}
+}
+
+/// \brief Sort a random access range ascending in parallel on the shared thread pool
+/// \see parallel_sort( Iterator, Iterator, const Compare&, std::size_t)
+template <class Iterator>
+void parallel_sort( Iterator begin, Iterator end)
+{
+	parallel_sort( begin, end, std::less<typename std::iterator_traits<Iterator>::value_type>());
+}
+
+}//namespace
+#endif
+
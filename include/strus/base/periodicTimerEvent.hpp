@@ -14,11 +14,26 @@
 namespace strus {
 
 /// \brief Periodic timer event
+/// \note All timer events of the process are served by one thread of a shared timer service, running while at least one timer event is started
+/// \remark The tick method should return quickly, because it delays the ticks of all other timer events
 class PeriodicTimerEvent
 {
 public:
+	/// \brief Unit of the period of a timer event
+	enum PeriodUnit {Seconds,Milliseconds};
+
+	/// \brief Constructor
+	/// \param[in] secondsPeriod_ period of the ticks in seconds
 	explicit PeriodicTimerEvent( int secondsPeriod_)
-		:m_secondsPeriod(secondsPeriod_)
+		:m_data(0),m_millisecondsPeriod(secondsPeriod_ * 1000)
+	{
+		if (!init()) throw std::bad_alloc();
+	}
+	/// \brief Constructor
+	/// \param[in] period_ period of the ticks
+	/// \param[in] unit_ unit of period_
+	PeriodicTimerEvent( int period_, PeriodUnit unit_)
+		:m_data(0),m_millisecondsPeriod(unit_ == Seconds ? period_ * 1000 : period_)
 	{
 		if (!init()) throw std::bad_alloc();
 	}
@@ -27,21 +42,30 @@ public:
 		clear();
 	}
 
+	/// \brief Start calling tick periodically, restarts the timer event if already started
+	/// \return true on success, false on error
 	bool start();
+	/// \brief Stop calling tick, waits for a tick in progress unless called by the tick itself
 	void stop();
 
 	/// \brief Event called
+	/// \note The ticks are scheduled relative to the start, so they do not drift. Periods missed because of ticks taking too long are skipped
+	/// \note Exceptions thrown are ignored
+	/// \remark Derived classes have to call stop in their destructor, so that tick is not called on an object partially destroyed
 	virtual void tick(){}
 
 private:
-	void wait();
 	bool init();
 	void clear();
 
+private:
+	PeriodicTimerEvent( const PeriodicTimerEvent&){}	///> non copyable
+	void operator=( const PeriodicTimerEvent&){}		///> non copyable
+
 private:
 	struct Data;
 	Data* m_data;
-	int m_secondsPeriod;
+	int m_millisecondsPeriod;
 };
 
 } // namespace
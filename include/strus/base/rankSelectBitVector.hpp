@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Read only bit vector with constant time rank and select queries
+/// \file rankSelectBitVector.hpp
+#ifndef _STRUS_BASE_RANK_SELECT_BIT_VECTOR_HPP_INCLUDED
+#define _STRUS_BASE_RANK_SELECT_BIT_VECTOR_HPP_INCLUDED
+#include "strus/base/bitset.hpp"
+#include "strus/base/stdint.h"
+#include <vector>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Forward declaration
+class dynamic_bitset;
+/// \brief Forward declaration
+class compressed_bitset;
+
+/// \brief Read only bit vector answering the number of bits set before a position (rank) and the position of the k-th bit set (select)
+/// \note The bits are partitioned into blocks of 2048 bits. For every block a 64 bit word holds the number of bits set before the block (32 bits)
+///	and the number of bits set in its first three sub blocks of 512 bits (10 bits each). rank counts at most 7 words of a sub block.
+/// \note select locates the block with a sample of the block index stored for every 8192th bit set and a binary search on the block counts between two samples
+/// \note The space needed for the index is about 3.1% of the bit vector for the blocks and at most 0.4% for the select samples
+/// \remark Implements the scheme 'poppy' described in "Space-Efficient, High-Performance Rank & Select Structures on Uncompressed Bit Sequences" (Zhou, Andersen, Kaminsky)
+class RankSelectBitVector
+{
+public:
+	/// \brief Default constructor, creates an empty bit vector
+	RankSelectBitVector()
+		:m_size(0),m_count(0),m_words(),m_blocks(),m_samples(){}
+	/// \brief Constructor from an array of 64 bit words, the lowest bit of the first word is the position 0
+	/// \param[in] words array of (size_+63)/64 words, bits of the last word beyond the dimension are ignored
+	/// \param[in] size_ dimension of the bit vector
+	RankSelectBitVector( const uint64_t* words, std::size_t size_);
+	/// \brief Constructor from a bitset
+	template <int SIZE>
+	explicit RankSelectBitVector( const bitset<SIZE>& set)
+		:m_size(0),m_count(0),m_words(),m_blocks(),m_samples()
+	{
+		init( set.data(), SIZE);
+	}
+	/// \brief Constructor from a dynamic bitset
+	explicit RankSelectBitVector( const dynamic_bitset& set);
+	/// \brief Constructor from a compressed bitset
+	explicit RankSelectBitVector( const compressed_bitset& set);
+
+	RankSelectBitVector( const RankSelectBitVector& o)
+		:m_size(o.m_size),m_count(o.m_count),m_words(o.m_words),m_blocks(o.m_blocks),m_samples(o.m_samples){}
+	RankSelectBitVector& operator=( const RankSelectBitVector& o)
+		{m_size = o.m_size; m_count = o.m_count; m_words = o.m_words; m_blocks = o.m_blocks; m_samples = o.m_samples; return *this;}
+#if __cplusplus >= 201103L
+	RankSelectBitVector( RankSelectBitVector&& o)
+		:m_size(o.m_size),m_count(o.m_count),m_words(std::move(o.m_words)),m_blocks(std::move(o.m_blocks)),m_samples(std::move(o.m_samples)){}
+	RankSelectBitVector& operator=( RankSelectBitVector&& o)
+		{m_size = o.m_size; m_count = o.m_count; m_words = std::move(o.m_words); m_blocks = std::move(o.m_blocks); m_samples = std::move(o.m_samples); return *this;}
+#endif
+
+	/// \brief Get the dimension of the bit vector
+	std::size_t size() const
+	{
+		return m_size;
+	}
+	/// \brief Get the number of bits set
+	std::size_t count() const
+	{
+		return m_count;
+	}
+
+	/// \brief Test a bit on a defined position
+	bool test( std::size_t pos) const
+	{
+		if (pos >= m_size) return false;
+		return (m_words[ pos / 64] & ((uint64_t)1 << (pos % 64))) != 0;
+	}
+
+	/// \brief Get the number of bits set with a position strictly lower than the position passed as argument
+	/// \param[in] pos position, values bigger than the dimension are treated as the dimension
+	/// \return the number of bits set in [0,pos)
+	std::size_t rank( std::size_t pos) const;
+
+	/// \brief Get the position of the bit set with a defined rank
+	/// \param[in] idx rank of the bit starting with 0, so that select( rank( pos)) == pos for any bit set on pos
+	/// \return the position of the bit or -1 if idx is not lower than count()
+	int select( std::size_t idx) const;
+
+	/// \brief Get the number of bytes allocated for the bit vector and its index
+	std::size_t allocated() const;
+
+private:
+	void init( const uint64_t* words, std::size_t size_);
+	void buildIndex();
+
+private:
+	std::size_t m_size;			///< dimension of the bit vector
+	std::size_t m_count;			///< number of bits set
+	std::vector<uint64_t> m_words;		///< bits, padded with zero words to a multiple of the block size
+	std::vector<uint64_t> m_blocks;		///< index entry of every block with the number of bits set before the block and the counts of its sub blocks
+	std::vector<uint32_t> m_samples;	///< index of the block containing the bit set with rank i*8192 for every i
+};
+
+}//namespace
+#endif
+
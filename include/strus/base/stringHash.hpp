@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Hash functions for strings used as hash policies of hash tables
+/// \note A hash policy is a class with a static method 'uint64_t calc( const char* key, std::size_t keylen)'
+/// \file stringHash.hpp
+#ifndef _STRUS_BASE_STRING_HASH_HPP_INCLUDED
+#define _STRUS_BASE_STRING_HASH_HPP_INCLUDED
+#include "strus/base/crc32.hpp"
+#include "strus/base/stdint.h"
+#include <cstring>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Fast non cryptographic 64 bit hash of a string, default hash policy of strus hash tables
+/// \note Follows wyhash (https://github.com/wangyi-fudan/wyhash, public domain) by Wang Yi, processing 16 bytes per step with 64x64->128 bit multiplications
+/// \remark Not stable between versions of strus, do not use it for persistent data
+struct StringHash
+{
+	static uint64_t calc( const char* key, std::size_t keylen)
+	{
+		const uint64_t s0 = 0xa0761d6478bd642f;
+		const uint64_t s1 = 0xe7037ed1a0b428db;
+		const uint64_t s2 = 0x8ebc6af09c88c6e3;
+		const uint64_t s3 = 0x589965cc75374cc3;
+
+		const unsigned char* pp = (const unsigned char*)key;
+		uint64_t seed = mix( s0, s1);
+		uint64_t aa, bb;
+		if (keylen <= 16)
+		{
+			if (keylen >= 4)
+			{
+				std::size_t ofs = (keylen >> 3) << 2;
+				aa = (read4( pp) << 32) | read4( pp + ofs);
+				bb = (read4( pp + keylen - 4) << 32) | read4( pp + keylen - 4 - ofs);
+			}
+			else if (keylen > 0)
+			{
+				aa = ((uint64_t)pp[0] << 16) | ((uint64_t)pp[ keylen >> 1] << 8) | pp[ keylen - 1];
+				bb = 0;
+			}
+			else
+			{
+				aa = bb = 0;
+			}
+		}
+		else
+		{
+			std::size_t ii = keylen;
+			if (ii > 48)
+			{
+				uint64_t see1 = seed, see2 = seed;
+				do
+				{
+					seed = mix( read8( pp) ^ s1, read8( pp + 8) ^ seed);
+					see1 = mix( read8( pp + 16) ^ s2, read8( pp + 24) ^ see1);
+					see2 = mix( read8( pp + 32) ^ s3, read8( pp + 40) ^ see2);
+					pp += 48;
+					ii -= 48;
+				}
+				while (ii > 48);
+				seed ^= see1 ^ see2;
+			}
+			while (ii > 16)
+			{
+				seed = mix( read8( pp) ^ s1, read8( pp + 8) ^ seed);
+				ii -= 16;
+				pp += 16;
+			}
+			aa = read8( pp + ii - 16);
+			bb = read8( pp + ii - 8);
+		}
+		aa ^= s1;
+		bb ^= seed;
+		mum( aa, bb);
+		return mix( aa ^ s0 ^ keylen, bb ^ s1);
+	}
+
+	static uint64_t calc( const char* key)
+	{
+		return calc( key, std::strlen( key));
+	}
+
+private:
+	static uint64_t read8( const unsigned char* pp)
+	{
+		uint64_t rt;
+		std::memcpy( &rt, pp, sizeof(rt));
+		return rt;
+	}
+	static uint64_t read4( const unsigned char* pp)
+	{
+		uint32_t rt;
+		std::memcpy( &rt, pp, sizeof(rt));
+		return rt;
+	}
+	/// \brief Multiply two 64 bit numbers and return the low and the high part of the result in the arguments
+	static void mum( uint64_t& aa, uint64_t& bb)
+	{
+#if defined __SIZEOF_INT128__
+		__uint128_t rr = (__uint128_t)aa * bb;
+		aa = (uint64_t)rr;
+		bb = (uint64_t)(rr >> 64);
+#else
+		uint64_t ha = aa >> 32, hb = bb >> 32, la = (uint32_t)aa, lb = (uint32_t)bb;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t tt = rl + (rm0 << 32);
+		uint64_t carry = tt < rl;
+		uint64_t lo = tt + (rm1 << 32);
+		carry += lo < tt;
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+		aa = lo;
+		bb = hi;
+#endif
+	}
+	static uint64_t mix( uint64_t aa, uint64_t bb)
+	{
+		mum( aa, bb);
+		return aa ^ bb;
+	}
+};
+
+/// \brief Hash policy with CRC32C, calculated with the CPU instruction if available
+/// \note The result is the same with and without hardware support, so it can be used for persistent data
+struct Crc32cStringHash
+{
+	static uint64_t calc( const char* key, std::size_t keylen)
+	{
+		return utils::Crc32c::calc( key, keylen);
+	}
+	static uint64_t calc( const char* key)
+	{
+		return utils::Crc32c::calc( key);
+	}
+};
+
+/// \brief Hash policy with CRC32 calculated byte by byte, the hash function used before hash policies were introduced
+struct Crc32StringHash
+{
+	static uint64_t calc( const char* key, std::size_t keylen)
+	{
+		return utils::Crc32::calc( key, keylen);
+	}
+	static uint64_t calc( const char* key)
+	{
+		return utils::Crc32::calc( key);
+	}
+};
+
+}//namespace
+#endif
+
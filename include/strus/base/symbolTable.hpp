@@ -8,7 +8,7 @@
 ///\brief Map of strings to indices not freed till end of table life time.
 #ifndef _STRUS_BASE_SYMBOL_TABLE_HPP_INCLUDED
 #define _STRUS_BASE_SYMBOL_TABLE_HPP_INCLUDED
-#include "strus/base/crc32.hpp"
+#include "strus/base/stringHash.hpp"
 #include <list>
 #include <vector>
 #include <string>
@@ -167,9 +167,9 @@ public:
 	};
 	struct HashFunc
 	{
-		int operator()( const Key& key)const
+		std::size_t operator()( const Key& key)const
 		{
-			return utils::Crc32::calc( key.str, key.len);
+			return (std::size_t)StringHash::calc( key.str, key.len);
 		}
 	};
 
@@ -201,6 +201,11 @@ public:
 	///\param[in] id key handle
 	///\return the key string
 	const char* key( const uint32_t& id) const;
+	///\brief Get the size of the key of a handle in bytes
+	///\note Keys may contain null bytes, so the size can not be evaluated with strlen
+	///\param[in] id key handle
+	///\return the size of the key or 0 if not defined
+	std::size_t keySize( const uint32_t& id) const;
 
 	///\brief Get number of elements defined
 	///\return the number of elements defined
@@ -249,6 +254,12 @@ public:
 	///\brief Swap contents
 	void swap( SymbolTable& o);
 
+	///\brief Write a snapshot of the table with keys, handles and hash index to a file
+	///\note The file can be loaded with MappedSymbolTable (strus/base/mappedSymbolTable.hpp) without rebuilding the table
+	///\param[in] filename path of the file to write
+	///\return true on success, false on error (reported to the error buffer)
+	bool save( const std::string& filename) const;
+
 private:
 #if __cplusplus >= 201103L
 	SymbolTable( const SymbolTable&) = delete;
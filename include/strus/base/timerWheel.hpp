@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Hierarchical timer wheel for many independent timeouts
+/// \file timerWheel.hpp
+#ifndef _STRUS_BASE_TIMER_WHEEL_HPP_INCLUDED
+#define _STRUS_BASE_TIMER_WHEEL_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Hierarchical timer wheel with NofLevels levels of SlotsPerLevel slots, the time unit (tick) is up to the client (e.g. milliseconds)
+/// \note Scheduling and cancelling a timer is O(1). Advancing the clock cascades the timers of the slot entered at each level to the level below,
+///	so every timer is moved at most NofLevels-1 times. Timers further in the future than the range of the wheel are kept in the highest level and revisited.
+/// \note Not thread safe, the clients synchronize the access (see JobQueueWorker)
+class TimerWheel
+{
+public:
+	typedef void (*TimerProc)( void* context);
+	typedef void (*TimerDeleter)( void* context);
+
+	/// \brief Handle of a timer scheduled, 0 is an invalid handle
+	/// \note Handles of timers expired or cancelled are not reused during the next 2^32 timers scheduled with the same slot
+	typedef uint64_t TimerId;
+
+	enum {
+		LevelBits=8,			///< number of bits of the time addressed by a level
+		SlotsPerLevel=1<<LevelBits,	///< number of slots of a level
+		NofLevels=4			///< number of levels, timers up to 2^(LevelBits*NofLevels) ticks are placed without revisiting
+	};
+
+	/// \brief Timer returned when expired or cancelled
+	struct Timer
+	{
+		uint64_t expiry;
+		TimerProc proc;
+		void* context;
+		TimerDeleter deleter;
+
+		Timer()
+			:expiry(0),proc(0),context(0),deleter(0){}
+		Timer( uint64_t expiry_, TimerProc proc_, void* context_, TimerDeleter deleter_)
+			:expiry(expiry_),proc(proc_),context(context_),deleter(deleter_){}
+		Timer( const Timer& o)
+			:expiry(o.expiry),proc(o.proc),context(o.context),deleter(o.deleter){}
+	};
+
+	/// \brief Constructor
+	/// \param[in] now_ initial time in ticks
+	explicit TimerWheel( uint64_t now_=0);
+
+	/// \brief Schedule a timer
+	/// \param[in] expiry time in ticks when the timer expires, timers with an expiry time not in the future expire with the next tick
+	/// \param[in] proc procedure called when the timer expires
+	/// \param[in] context context of the procedure
+	/// \param[in] deleter destructor function of the context called if the timer is cancelled
+	/// \return the handle of the timer
+	/// \note Throws std::bad_alloc
+	TimerId schedule( uint64_t expiry, TimerProc proc, void* context, TimerDeleter deleter);
+
+	/// \brief Cancel a timer
+	/// \param[in] id handle of the timer returned by schedule
+	/// \param[out] timer the timer removed, for calling its deleter
+	/// \return true on success, false if the timer does not exist anymore (expired or cancelled)
+	bool cancel( TimerId id, Timer& timer);
+
+	/// \brief Advance the clock and collect the timers expired
+	/// \param[in] now_ current time in ticks, nothing is done if not later than the current time of the wheel
+	/// \param[out] expired where to append the timers expired in the order of their expiry time slots
+	/// \note Throws std::bad_alloc
+	void advance( uint64_t now_, std::vector<Timer>& expired);
+
+	/// \brief Remove all timers
+	/// \param[out] removed where to append the timers removed, for calling their deleters
+	/// \note Throws std::bad_alloc
+	void clear( std::vector<Timer>& removed);
+
+	/// \brief Get the time when the clock has to be advanced next time
+	/// \return the expiry time of the next timer if it is within one round of the lowest level, else the next time timers of a higher level are cascaded, or the maximum value of uint64_t if there are no timers
+	uint64_t nextEventTime() const;
+
+	/// \brief Get the current time of the wheel in ticks
+	uint64_t now() const
+	{
+		return m_now;
+	}
+
+	/// \brief Get the number of timers scheduled
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	enum {NoSlot=0xffffFFFFU};
+
+	struct Node
+	{
+		uint64_t expiry;
+		TimerProc proc;
+		void* context;
+		TimerDeleter deleter;
+		uint32_t prev;		///< index of the previous node in the slot list + 1, 0 for the first
+		uint32_t next;		///< index of the next node in the slot list or the free list + 1, 0 for the last
+		uint32_t slot;		///< index of the slot the node is linked in or NoSlot if free
+		uint32_t generation;	///< incremented with every use of the node for detecting handles of expired timers
+
+		Node()
+			:expiry(0),proc(0),context(0),deleter(0),prev(0),next(0),slot(NoSlot),generation(0){}
+	};
+
+	void link( uint32_t nodeidx);
+	void unlink( uint32_t nodeidx);
+	void freeNode( uint32_t nodeidx);
+	void cascade( int level);
+	void tick( std::vector<Timer>& expired);
+
+private:
+	TimerWheel( const TimerWheel&){}		///> non copyable
+	void operator=( const TimerWheel&){}		///> non copyable
+
+private:
+	uint64_t m_now;
+	std::size_t m_size;
+	std::size_t m_levelSize[ NofLevels];		///< number of timers in each level
+	uint32_t m_slots[ NofLevels * SlotsPerLevel];	///< index of the first node of each slot + 1, 0 if empty
+	std::vector<Node> m_nodes;
+	uint32_t m_freelist;				///< index of the first free node + 1, 0 if empty
+};
+
+}//namespace
+#endif
+
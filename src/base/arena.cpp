@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Arena allocator for objects that are all freed together
+#include "strus/base/arena.hpp"
+#include "strus/base/dll_tags.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#if __cplusplus < 201103L
+#include <boost/thread/tss.hpp>
+#endif
+
+using namespace strus;
+
+struct Arena::Chunk
+{
+	Chunk* prev;		///< chunk allocated before this chunk
+	std::size_t size;	///< size of the data of the chunk in bytes
+};
+
+enum {ChunkHeaderSize=(sizeof(void*) + sizeof(std::size_t) + Arena::DefaultAlignment - 1) & ~(Arena::DefaultAlignment - 1)};
+
+DLL_PUBLIC char* Arena::chunkData( Chunk* chunk)
+{
+	return (char*)chunk + ChunkHeaderSize;
+}
+
+DLL_PUBLIC Arena::~Arena()
+{
+	clear();
+	while (m_free)
+	{
+		Chunk* chunk = m_free;
+		m_free = chunk->prev;
+		std::free( chunk);
+	}
+}
+
+DLL_PUBLIC void* Arena::allocChunk( std::size_t size, std::size_t alignment)
+{
+	if (!alignment || (alignment & (alignment - 1)) != 0) throw std::bad_alloc();
+	if (size > std::numeric_limits<std::size_t>::max() - alignment - ChunkHeaderSize) throw std::bad_alloc();
+	std::size_t datasize = size + (alignment > (std::size_t)DefaultAlignment ? alignment : 0);
+	Chunk* chunk;
+	if (datasize > m_chunkSize)
+	{
+		//... an oversized block gets a chunk of its own, the rest of the current chunk is still used for the following allocations
+		chunk = (Chunk*)std::malloc( ChunkHeaderSize + datasize);
+		if (!chunk) throw std::bad_alloc();
+		chunk->size = datasize;
+		chunk->prev = m_cur;
+		m_cur = chunk;
+		++m_nofChunks;
+		uintptr_t data = (uintptr_t)chunkData( chunk);
+		return (void*)((data + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+	}
+	if (m_free)
+	{
+		chunk = m_free;
+		m_free = chunk->prev;
+		--m_nofFree;
+	}
+	else
+	{
+		chunk = (Chunk*)std::malloc( ChunkHeaderSize + m_chunkSize);
+		if (!chunk) throw std::bad_alloc();
+		chunk->size = m_chunkSize;
+	}
+	chunk->prev = m_cur;
+	m_cur = chunk;
+	++m_nofChunks;
+	m_pos = (uintptr_t)chunkData( chunk);
+	m_end = m_pos + chunk->size;
+
+	uintptr_t pos = (m_pos + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+	m_pos = pos + size;
+	return (void*)pos;
+}
+
+DLL_PUBLIC void Arena::releaseChunk( Chunk* chunk)
+{
+	if (chunk->size == m_chunkSize && m_nofFree < (std::size_t)MaxNofFreeChunks)
+	{
+		chunk->prev = m_free;
+		m_free = chunk;
+		++m_nofFree;
+	}
+	else
+	{
+		std::free( chunk);
+	}
+}
+
+DLL_PUBLIC void Arena::rewind( const Mark& mark_)
+{
+	while (m_cur != mark_.chunk)
+	{
+		if (!m_cur) throw std::logic_error( "rewind to a mark of another arena or of a chunk already released");
+		Chunk* chunk = m_cur;
+		m_cur = chunk->prev;
+		releaseChunk( chunk);
+		--m_nofChunks;
+	}
+	//... the chunk allocations were taken from when the mark was taken is older than the mark and still allocated
+	m_pos = mark_.pos;
+	m_end = mark_.end;
+}
+
+DLL_PUBLIC const char* Arena::allocStringCopy( const char* str, std::size_t size)
+{
+	char* rt = (char*)alloc( size+1, 1);
+	std::memcpy( rt, str, size);
+	rt[ size] = 0;
+	return rt;
+}
+
+DLL_PUBLIC Arena& Arena::local()
+{
+#if __cplusplus >= 201103L
+	static thread_local Arena rt;
+	return rt;
+#else
+	static boost::thread_specific_ptr<Arena> g_arena;
+	if (!g_arena.get()) g_arena.reset( new Arena());
+	return *g_arena;
+#endif
+}
+
@@ -0,0 +1,507 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Bulk operations on arrays of 64 bit words of bitsets with SIMD implementations selected at runtime
+#include "strus/base/bitSetKernels.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/dll_tags.hpp"
+
+#undef STRUS_BITSET_KERNELS_X86
+#if defined __x86_64__ && defined __GNUC__
+#if defined __clang__ || (__GNUC__ * 100 + __GNUC_MINOR__ >= 409)
+//... target attributes allowing intrinsics of instruction sets not enabled for the whole build
+#define STRUS_BITSET_KERNELS_X86
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace strus;
+
+namespace {
+
+typedef bool (*ModifyProc)( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+typedef std::size_t (*ModifyCountProc)( uint64_t* dst, const uint64_t* src, std::size_t nofWords);
+typedef std::size_t (*CountProc)( const uint64_t* ar, std::size_t nofWords);
+typedef std::size_t (*MismatchProc)( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords);
+
+/// \brief Implementation of the kernels for an instruction set
+struct KernelTable
+{
+	BitSetKernels::Isa isa;
+	ModifyProc join;
+	ModifyCountProc join_count;
+	ModifyProc intersect;
+	ModifyProc subtract;
+	ModifyProc toggle;
+	CountProc count;
+	MismatchProc mismatch;
+};
+
+// --------------------------------------
+// Scalar implementation
+// --------------------------------------
+
+struct ScalarKernels
+{
+	static bool join( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		uint64_t diff = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi)
+		{
+			uint64_t ee = dst[wi] | src[wi];
+			diff |= ee ^ dst[wi];
+			dst[wi] = ee;
+		}
+		return diff != 0;
+	}
+	static std::size_t join_count( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		std::size_t rt = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi)
+		{
+			uint64_t ee = dst[wi] | src[wi];
+			rt += BitOperations::bitCount( (uint64_t)(ee ^ dst[wi]));
+			dst[wi] = ee;
+		}
+		return rt;
+	}
+	static bool intersect( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		uint64_t diff = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi)
+		{
+			uint64_t ee = dst[wi] & src[wi];
+			diff |= ee ^ dst[wi];
+			dst[wi] = ee;
+		}
+		return diff != 0;
+	}
+	static bool subtract( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		uint64_t diff = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi)
+		{
+			uint64_t ee = dst[wi] & ~src[wi];
+			diff |= ee ^ dst[wi];
+			dst[wi] = ee;
+		}
+		return diff != 0;
+	}
+	static bool toggle( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		uint64_t diff = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi)
+		{
+			diff |= src[wi];
+			dst[wi] ^= src[wi];
+		}
+		return diff != 0;
+	}
+	static std::size_t count( const uint64_t* ar, std::size_t nofWords)
+	{
+		std::size_t rt = 0;
+		for (std::size_t wi=0; wi<nofWords; ++wi) rt += BitOperations::bitCount( ar[wi]);
+		return rt;
+	}
+	static std::size_t mismatch( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords)
+	{
+		std::size_t wi = 0;
+		for (; wi<nofWords && aa[wi] == bb[wi]; ++wi){}
+		return wi;
+	}
+};
+
+static const KernelTable g_scalarKernels = {
+	BitSetKernels::IsaScalar,
+	&ScalarKernels::join, &ScalarKernels::join_count, &ScalarKernels::intersect, &ScalarKernels::subtract, &ScalarKernels::toggle,
+	&ScalarKernels::count, &ScalarKernels::mismatch
+};
+
+#ifdef STRUS_BITSET_KERNELS_X86
+// --------------------------------------
+// AVX2 implementation
+// --------------------------------------
+#define STRUS_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+
+/// \brief Population count of the 64 bit lanes of a vector (lookup of nibbles with shuffle, W. Mula)
+STRUS_TARGET_AVX2 static inline __m256i popcount256( __m256i vv)
+{
+	const __m256i lookup = _mm256_setr_epi8( 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+	const __m256i lowMask = _mm256_set1_epi8( 0x0f);
+	__m256i lo = _mm256_and_si256( vv, lowMask);
+	__m256i hi = _mm256_and_si256( _mm256_srli_epi16( vv, 4), lowMask);
+	__m256i cnt = _mm256_add_epi8( _mm256_shuffle_epi8( lookup, lo), _mm256_shuffle_epi8( lookup, hi));
+	return _mm256_sad_epu8( cnt, _mm256_setzero_si256());
+}
+
+STRUS_TARGET_AVX2 static inline std::size_t sumLanes256( __m256i vv)
+{
+	__m128i sum = _mm_add_epi64( _mm256_castsi256_si128( vv), _mm256_extracti128_si256( vv, 1));
+	return (std::size_t)(_mm_cvtsi128_si64( sum) + _mm_extract_epi64( sum, 1));
+}
+
+struct AVX2Kernels
+{
+	enum {Lanes=4};
+
+	template <class Op>
+	STRUS_TARGET_AVX2 static inline bool modify( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		__m256i diff = _mm256_setzero_si256();
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			__m256i aa = _mm256_loadu_si256( (const __m256i*)(dst + wi));
+			__m256i bb = _mm256_loadu_si256( (const __m256i*)(src + wi));
+			__m256i ee = Op::apply( aa, bb);
+			diff = _mm256_or_si256( diff, _mm256_xor_si256( ee, aa));
+			_mm256_storeu_si256( (__m256i*)(dst + wi), ee);
+		}
+		uint64_t taildiff = 0;
+		for (; wi < nofWords; ++wi)
+		{
+			uint64_t ee = Op::apply( dst[wi], src[wi]);
+			taildiff |= ee ^ dst[wi];
+			dst[wi] = ee;
+		}
+		return taildiff != 0 || !_mm256_testz_si256( diff, diff);
+	}
+
+	struct OrOp
+	{
+		STRUS_TARGET_AVX2 static inline __m256i apply( __m256i aa, __m256i bb) {return _mm256_or_si256( aa, bb);}
+		static inline uint64_t apply( uint64_t aa, uint64_t bb) {return aa | bb;}
+	};
+	struct AndOp
+	{
+		STRUS_TARGET_AVX2 static inline __m256i apply( __m256i aa, __m256i bb) {return _mm256_and_si256( aa, bb);}
+		static inline uint64_t apply( uint64_t aa, uint64_t bb) {return aa & bb;}
+	};
+	struct AndNotOp
+	{
+		STRUS_TARGET_AVX2 static inline __m256i apply( __m256i aa, __m256i bb) {return _mm256_andnot_si256( bb, aa);}
+		static inline uint64_t apply( uint64_t aa, uint64_t bb) {return aa & ~bb;}
+	};
+	struct XorOp
+	{
+		STRUS_TARGET_AVX2 static inline __m256i apply( __m256i aa, __m256i bb) {return _mm256_xor_si256( aa, bb);}
+		static inline uint64_t apply( uint64_t aa, uint64_t bb) {return aa ^ bb;}
+	};
+
+	STRUS_TARGET_AVX2 static bool join( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		return modify<OrOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX2 static std::size_t join_count( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		__m256i cnt = _mm256_setzero_si256();
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			__m256i aa = _mm256_loadu_si256( (const __m256i*)(dst + wi));
+			__m256i bb = _mm256_loadu_si256( (const __m256i*)(src + wi));
+			__m256i ee = _mm256_or_si256( aa, bb);
+			cnt = _mm256_add_epi64( cnt, popcount256( _mm256_xor_si256( ee, aa)));
+			_mm256_storeu_si256( (__m256i*)(dst + wi), ee);
+		}
+		std::size_t rt = sumLanes256( cnt);
+		for (; wi < nofWords; ++wi)
+		{
+			uint64_t ee = dst[wi] | src[wi];
+			rt += _mm_popcnt_u64( ee ^ dst[wi]);
+			dst[wi] = ee;
+		}
+		return rt;
+	}
+	STRUS_TARGET_AVX2 static bool intersect( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		return modify<AndOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX2 static bool subtract( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		return modify<AndNotOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX2 static bool toggle( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		return modify<XorOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX2 static std::size_t count( const uint64_t* ar, std::size_t nofWords)
+	{
+		__m256i cnt = _mm256_setzero_si256();
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			cnt = _mm256_add_epi64( cnt, popcount256( _mm256_loadu_si256( (const __m256i*)(ar + wi))));
+		}
+		std::size_t rt = sumLanes256( cnt);
+		for (; wi < nofWords; ++wi) rt += _mm_popcnt_u64( ar[wi]);
+		return rt;
+	}
+	STRUS_TARGET_AVX2 static std::size_t mismatch( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords)
+	{
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			__m256i eq = _mm256_cmpeq_epi64( _mm256_loadu_si256( (const __m256i*)(aa + wi)), _mm256_loadu_si256( (const __m256i*)(bb + wi)));
+			unsigned int mask = _mm256_movemask_pd( _mm256_castsi256_pd( eq));
+			if (mask != 0xF) return wi + __builtin_ctz( ~mask);
+		}
+		for (; wi < nofWords && aa[wi] == bb[wi]; ++wi){}
+		return wi;
+	}
+};
+
+static const KernelTable g_avx2Kernels = {
+	BitSetKernels::IsaAVX2,
+	&AVX2Kernels::join, &AVX2Kernels::join_count, &AVX2Kernels::intersect, &AVX2Kernels::subtract, &AVX2Kernels::toggle,
+	&AVX2Kernels::count, &AVX2Kernels::mismatch
+};
+
+// --------------------------------------
+// AVX-512 implementation
+// --------------------------------------
+#define STRUS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,popcnt")))
+
+/// \brief Population count of the 64 bit lanes of a vector (lookup of nibbles with shuffle, AVX512BW)
+STRUS_TARGET_AVX512 static inline __m512i popcount512( __m512i vv)
+{
+	const __m512i lookup = _mm512_broadcast_i32x4( _mm_setr_epi8( 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4));
+	const __m512i lowMask = _mm512_set1_epi8( 0x0f);
+	__m512i lo = _mm512_and_si512( vv, lowMask);
+	__m512i hi = _mm512_and_si512( _mm512_srli_epi16( vv, 4), lowMask);
+	__m512i cnt = _mm512_add_epi8( _mm512_shuffle_epi8( lookup, lo), _mm512_shuffle_epi8( lookup, hi));
+	return _mm512_sad_epu8( cnt, _mm512_setzero_si512());
+}
+
+/// \note Arrays shorter than a vector are processed by the AVX2 implementation, masked loads and stores do not pay off for them
+struct AVX512Kernels
+{
+	enum {Lanes=8};
+
+	/// \brief Mask of the lanes of the rest of an array shorter than a vector
+	static inline __mmask8 tailMask( std::size_t rest)
+	{
+		return (__mmask8)((1U << rest) - 1);
+	}
+
+	template <class Op>
+	STRUS_TARGET_AVX512 static inline bool modify( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		__m512i diff = _mm512_setzero_si512();
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			__m512i aa = _mm512_loadu_si512( (const void*)(dst + wi));
+			__m512i bb = _mm512_loadu_si512( (const void*)(src + wi));
+			__m512i ee = Op::apply( aa, bb);
+			diff = _mm512_or_si512( diff, _mm512_xor_si512( ee, aa));
+			_mm512_storeu_si512( (void*)(dst + wi), ee);
+		}
+		if (wi < nofWords)
+		{
+			__mmask8 mask = tailMask( nofWords - wi);
+			__m512i aa = _mm512_maskz_loadu_epi64( mask, (const void*)(dst + wi));
+			__m512i bb = _mm512_maskz_loadu_epi64( mask, (const void*)(src + wi));
+			__m512i ee = Op::apply( aa, bb);
+			diff = _mm512_or_si512( diff, _mm512_xor_si512( ee, aa));
+			_mm512_mask_storeu_epi64( (void*)(dst + wi), mask, ee);
+		}
+		return _mm512_test_epi64_mask( diff, diff) != 0;
+	}
+
+	struct OrOp
+	{
+		STRUS_TARGET_AVX512 static inline __m512i apply( __m512i aa, __m512i bb) {return _mm512_or_si512( aa, bb);}
+	};
+	struct AndOp
+	{
+		STRUS_TARGET_AVX512 static inline __m512i apply( __m512i aa, __m512i bb) {return _mm512_and_si512( aa, bb);}
+	};
+	struct AndNotOp
+	{
+		STRUS_TARGET_AVX512 static inline __m512i apply( __m512i aa, __m512i bb) {return _mm512_andnot_si512( bb, aa);}
+	};
+	struct XorOp
+	{
+		STRUS_TARGET_AVX512 static inline __m512i apply( __m512i aa, __m512i bb) {return _mm512_xor_si512( aa, bb);}
+	};
+
+	STRUS_TARGET_AVX512 static bool join( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::join( dst, src, nofWords);
+		return modify<OrOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX512 static std::size_t join_count( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::join_count( dst, src, nofWords);
+		__m512i cnt = _mm512_setzero_si512();
+		std::size_t wi = 0;
+		for (; wi < nofWords; wi += Lanes)
+		{
+			__mmask8 mask = (wi + Lanes <= nofWords) ? (__mmask8)0xFF : tailMask( nofWords - wi);
+			__m512i aa = _mm512_maskz_loadu_epi64( mask, (const void*)(dst + wi));
+			__m512i bb = _mm512_maskz_loadu_epi64( mask, (const void*)(src + wi));
+			__m512i ee = _mm512_or_si512( aa, bb);
+			cnt = _mm512_add_epi64( cnt, popcount512( _mm512_xor_si512( ee, aa)));
+			_mm512_mask_storeu_epi64( (void*)(dst + wi), mask, ee);
+		}
+		return (std::size_t)_mm512_reduce_add_epi64( cnt);
+	}
+	STRUS_TARGET_AVX512 static bool intersect( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::intersect( dst, src, nofWords);
+		return modify<AndOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX512 static bool subtract( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::subtract( dst, src, nofWords);
+		return modify<AndNotOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX512 static bool toggle( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::toggle( dst, src, nofWords);
+		return modify<XorOp>( dst, src, nofWords);
+	}
+	STRUS_TARGET_AVX512 static std::size_t count( const uint64_t* ar, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::count( ar, nofWords);
+		__m512i cnt = _mm512_setzero_si512();
+		std::size_t wi = 0;
+		for (; wi + Lanes <= nofWords; wi += Lanes)
+		{
+			cnt = _mm512_add_epi64( cnt, popcount512( _mm512_loadu_si512( (const void*)(ar + wi))));
+		}
+		if (wi < nofWords)
+		{
+			cnt = _mm512_add_epi64( cnt, popcount512( _mm512_maskz_loadu_epi64( tailMask( nofWords - wi), (const void*)(ar + wi))));
+		}
+		return (std::size_t)_mm512_reduce_add_epi64( cnt);
+	}
+	STRUS_TARGET_AVX512 static std::size_t mismatch( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords)
+	{
+		if (nofWords < Lanes) return AVX2Kernels::mismatch( aa, bb, nofWords);
+		std::size_t wi = 0;
+		for (; wi < nofWords; wi += Lanes)
+		{
+			__mmask8 mask = (wi + Lanes <= nofWords) ? (__mmask8)0xFF : tailMask( nofWords - wi);
+			__mmask8 neq = _mm512_mask_cmpneq_epi64_mask( mask, _mm512_maskz_loadu_epi64( mask, (const void*)(aa + wi)), _mm512_maskz_loadu_epi64( mask, (const void*)(bb + wi)));
+			if (neq) return wi + __builtin_ctz( neq);
+		}
+		return nofWords;
+	}
+};
+
+static const KernelTable g_avx512Kernels = {
+	BitSetKernels::IsaAVX512,
+	&AVX512Kernels::join, &AVX512Kernels::join_count, &AVX512Kernels::intersect, &AVX512Kernels::subtract, &AVX512Kernels::toggle,
+	&AVX512Kernels::count, &AVX512Kernels::mismatch
+};
+#endif //STRUS_BITSET_KERNELS_X86
+
+static const KernelTable* kernelTable( BitSetKernels::Isa isa)
+{
+	switch (isa)
+	{
+		case BitSetKernels::IsaScalar:
+			return &g_scalarKernels;
+		case BitSetKernels::IsaAVX2:
+#ifdef STRUS_BITSET_KERNELS_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports( "avx2") && __builtin_cpu_supports( "popcnt")) return &g_avx2Kernels;
+#endif
+			return 0;
+		case BitSetKernels::IsaAVX512:
+#ifdef STRUS_BITSET_KERNELS_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports( "avx512f") && __builtin_cpu_supports( "avx512bw") && __builtin_cpu_supports( "popcnt")) return &g_avx512Kernels;
+#endif
+			return 0;
+	}
+	return 0;
+}
+
+static const KernelTable* bestKernelTable()
+{
+	const KernelTable* rt = kernelTable( BitSetKernels::IsaAVX512);
+	if (!rt) rt = kernelTable( BitSetKernels::IsaAVX2);
+	if (!rt) rt = &g_scalarKernels;
+	return rt;
+}
+
+//... the scalar implementation is used for operations in static initializers executed before the selection
+static const KernelTable* g_kernels = &g_scalarKernels;
+
+struct KernelTableSelection
+{
+	KernelTableSelection()
+	{
+		g_kernels = bestKernelTable();
+	}
+};
+static KernelTableSelection g_kernelTableSelection;
+
+}//anonymous namespace
+
+DLL_PUBLIC BitSetKernels::Isa BitSetKernels::isa()
+{
+	return g_kernels->isa;
+}
+
+DLL_PUBLIC bool BitSetKernels::supported( Isa isa_)
+{
+	return kernelTable( isa_) != 0;
+}
+
+DLL_PUBLIC bool BitSetKernels::select( Isa isa_)
+{
+	const KernelTable* table = kernelTable( isa_);
+	if (!table) return false;
+	g_kernels = table;
+	return true;
+}
+
+DLL_PUBLIC const char* BitSetKernels::isaName( Isa isa_)
+{
+	static const char* ar[] = {"scalar","AVX2","AVX-512"};
+	return ar[ isa_];
+}
+
+DLL_PUBLIC bool BitSetKernels::join( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+{
+	return g_kernels->join( dst, src, nofWords);
+}
+
+DLL_PUBLIC std::size_t BitSetKernels::join_count( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+{
+	return g_kernels->join_count( dst, src, nofWords);
+}
+
+DLL_PUBLIC bool BitSetKernels::intersect( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+{
+	return g_kernels->intersect( dst, src, nofWords);
+}
+
+DLL_PUBLIC bool BitSetKernels::subtract( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+{
+	return g_kernels->subtract( dst, src, nofWords);
+}
+
+DLL_PUBLIC bool BitSetKernels::toggle( uint64_t* dst, const uint64_t* src, std::size_t nofWords)
+{
+	return g_kernels->toggle( dst, src, nofWords);
+}
+
+DLL_PUBLIC std::size_t BitSetKernels::count( const uint64_t* ar, std::size_t nofWords)
+{
+	return g_kernels->count( ar, nofWords);
+}
+
+DLL_PUBLIC std::size_t BitSetKernels::mismatch( const uint64_t* aa, const uint64_t* bb, std::size_t nofWords)
+{
+	return g_kernels->mismatch( aa, bb, nofWords);
+}
+
@@ -0,0 +1,1005 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Compressed bitset (roaring bitmap) with array, bitmap and run containers
+#include "strus/base/compressed_bitset.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/bitSetKernels.hpp"
+#include "strus/base/dll_tags.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <limits>
+#include <new>
+
+using namespace strus;
+
+typedef compressed_bitset::Container Container;
+
+enum {
+	ChunkBits=16,
+	ChunkMask=0xFFFF,
+	ArrayMaxSize=4096,	///< maximum number of positions in an array container, an array container is never bigger than a bitmap container
+	BitmapWords=1024	///< number of 64 bit words of a bitmap container
+};
+
+// --------------------------------------
+// Bitmap helpers
+// --------------------------------------
+
+/// \brief Mask of the bits of the word with index wi in the range [first,last]
+static inline uint64_t rangeMask( unsigned int wi, unsigned int first, unsigned int last)
+{
+	unsigned int base = wi * 64;
+	unsigned int lo = first > base ? first - base : 0;
+	unsigned int hi = last < base + 63 ? last - base : 63;
+	uint64_t himask = (hi == 63) ? ~(uint64_t)0 : (((uint64_t)1 << (hi+1)) - 1);
+	return himask & ~(((uint64_t)1 << lo) - 1);
+}
+
+static void bitmapSetRange( std::vector<uint64_t>& words, unsigned int first, unsigned int last)
+{
+	unsigned int we = last / 64;
+	for (unsigned int wi = first / 64; wi <= we; ++wi) words[ wi] |= rangeMask( wi, first, last);
+}
+
+static void bitmapClearRange( std::vector<uint64_t>& words, unsigned int first, unsigned int last)
+{
+	unsigned int we = last / 64;
+	for (unsigned int wi = first / 64; wi <= we; ++wi) words[ wi] &= ~rangeMask( wi, first, last);
+}
+
+static void bitmapFlipRange( std::vector<uint64_t>& words, unsigned int first, unsigned int last)
+{
+	unsigned int we = last / 64;
+	for (unsigned int wi = first / 64; wi <= we; ++wi) words[ wi] ^= rangeMask( wi, first, last);
+}
+
+static void bitmapCopyRange( std::vector<uint64_t>& words, const std::vector<uint64_t>& src, unsigned int first, unsigned int last)
+{
+	unsigned int we = last / 64;
+	for (unsigned int wi = first / 64; wi <= we; ++wi) words[ wi] |= src[ wi] & rangeMask( wi, first, last);
+}
+
+static unsigned int bitmapCountRange( const std::vector<uint64_t>& words, unsigned int first, unsigned int last)
+{
+	unsigned int rt = 0;
+	unsigned int we = last / 64;
+	for (unsigned int wi = first / 64; wi <= we; ++wi) rt += BitOperations::bitCount( (uint64_t)(words[ wi] & rangeMask( wi, first, last)));
+	return rt;
+}
+
+static unsigned int bitmapCount( const std::vector<uint64_t>& words)
+{
+	return BitSetKernels::count( words.data(), BitmapWords);
+}
+
+static inline bool bitmapTest( const std::vector<uint64_t>& words, unsigned int pos)
+{
+	return (words[ pos / 64] & ((uint64_t)1 << (pos % 64))) != 0;
+}
+
+/// \brief Get the first position not smaller than pos with a bit equal to value
+/// \return the position found or BitmapWords*64 if there is none
+static unsigned int bitmapNext( const std::vector<uint64_t>& words, unsigned int pos, bool value)
+{
+	unsigned int wi = pos / 64;
+	if (wi >= BitmapWords) return BitmapWords * 64;
+	uint64_t ww = value ? words[ wi] : ~words[ wi];
+	ww &= ~(((uint64_t)1 << (pos % 64)) - 1);
+	for (;;)
+	{
+		if (ww) return wi * 64 + BitOperations::bitScanForward( ww) - 1;
+		if (++wi == BitmapWords) return BitmapWords * 64;
+		ww = value ? words[ wi] : ~words[ wi];
+	}
+}
+
+/// \brief Count the number of runs of consecutive bits set
+static unsigned int bitmapNofRuns( const std::vector<uint64_t>& words)
+{
+	unsigned int rt = 0;
+	uint64_t carry = 0;
+	for (unsigned int wi = 0; wi < BitmapWords; ++wi)
+	{
+		uint64_t ww = words[ wi];
+		//... count the bits set with the bit before not set
+		rt += BitOperations::bitCount( (uint64_t)(ww & ~((ww << 1) | carry)));
+		carry = ww >> 63;
+	}
+	return rt;
+}
+
+// --------------------------------------
+// Container operations
+// --------------------------------------
+
+static inline unsigned int runFirst( const Container& cnt, std::size_t ri)
+{
+	return cnt.values[ ri*2];
+}
+
+static inline unsigned int runLast( const Container& cnt, std::size_t ri)
+{
+	return cnt.values[ ri*2+1];
+}
+
+static inline std::size_t nofRuns( const Container& cnt)
+{
+	return cnt.values.size() / 2;
+}
+
+/// \brief Get the index of the last run starting not after pos
+/// \return the index or -1 if there is none
+static int findRun( const Container& cnt, unsigned int pos)
+{
+	std::size_t lo = 0;
+	std::size_t hi = nofRuns( cnt);
+	while (lo < hi)
+	{
+		std::size_t mid = (lo + hi) / 2;
+		if (runFirst( cnt, mid) <= pos)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return (int)lo - 1;
+}
+
+static void appendRun( Container& cnt, unsigned int first, unsigned int last)
+{
+	cnt.values.push_back( first);
+	cnt.values.push_back( last);
+	cnt.card += last - first + 1;
+}
+
+static bool containerTest( const Container& cnt, unsigned int pos)
+{
+	switch ((Container::Type)cnt.type)
+	{
+		case Container::ArrayType:
+			return std::binary_search( cnt.values.begin(), cnt.values.end(), (uint16_t)pos);
+		case Container::BitmapType:
+			return bitmapTest( cnt.words, pos);
+		case Container::RunType:
+		{
+			int ri = findRun( cnt, pos);
+			return ri >= 0 && pos <= runLast( cnt, ri);
+		}
+	}
+	return false;
+}
+
+/// \brief Get the first position in the container not smaller than pos
+/// \return the position or -1 if there is none
+static int containerNext( const Container& cnt, unsigned int pos)
+{
+	switch ((Container::Type)cnt.type)
+	{
+		case Container::ArrayType:
+		{
+			std::vector<uint16_t>::const_iterator vi = std::lower_bound( cnt.values.begin(), cnt.values.end(), (uint16_t)pos);
+			return vi == cnt.values.end() ? -1 : (int)*vi;
+		}
+		case Container::BitmapType:
+		{
+			unsigned int rt = bitmapNext( cnt.words, pos, true);
+			return rt == BitmapWords * 64 ? -1 : (int)rt;
+		}
+		case Container::RunType:
+		{
+			int ri = findRun( cnt, pos);
+			if (ri >= 0 && pos <= runLast( cnt, ri)) return pos;
+			return (std::size_t)(ri + 1) < nofRuns( cnt) ? (int)runFirst( cnt, ri + 1) : -1;
+		}
+	}
+	return -1;
+}
+
+/// \brief Fill a bitmap with the positions of a container
+static void fillBitmap( std::vector<uint64_t>& words, const Container& cnt)
+{
+	if (cnt.type == Container::BitmapType)
+	{
+		words = cnt.words;
+		return;
+	}
+	words.assign( BitmapWords, 0);
+	if (cnt.type == Container::ArrayType)
+	{
+		std::vector<uint16_t>::const_iterator vi = cnt.values.begin(), ve = cnt.values.end();
+		for (; vi != ve; ++vi) words[ *vi / 64] |= (uint64_t)1 << (*vi % 64);
+	}
+	else
+	{
+		std::size_t ri = 0, re = nofRuns( cnt);
+		for (; ri != re; ++ri) bitmapSetRange( words, runFirst( cnt, ri), runLast( cnt, ri));
+	}
+}
+
+static void convertToArray( Container& cnt)
+{
+	std::vector<uint16_t> values;
+	values.reserve( cnt.card);
+	if (cnt.type == Container::BitmapType)
+	{
+		for (unsigned int wi = 0; wi < BitmapWords; ++wi)
+		{
+			uint64_t ww = cnt.words[ wi];
+			while (ww)
+			{
+				values.push_back( wi * 64 + BitOperations::bitScanForward( ww) - 1);
+				ww &= ww - 1;
+			}
+		}
+	}
+	else if (cnt.type == Container::RunType)
+	{
+		std::size_t ri = 0, re = nofRuns( cnt);
+		for (; ri != re; ++ri)
+		{
+			unsigned int last = runLast( cnt, ri);
+			for (unsigned int pos = runFirst( cnt, ri); pos <= last; ++pos) values.push_back( pos);
+		}
+	}
+	else
+	{
+		return;
+	}
+	cnt.values.swap( values);
+	std::vector<uint64_t>().swap( cnt.words);
+	cnt.type = Container::ArrayType;
+}
+
+static void convertToBitmap( Container& cnt)
+{
+	if (cnt.type == Container::BitmapType) return;
+	std::vector<uint64_t> words;
+	fillBitmap( words, cnt);
+	cnt.words.swap( words);
+	std::vector<uint16_t>().swap( cnt.values);
+	cnt.type = Container::BitmapType;
+}
+
+static void convertToRuns( Container& cnt)
+{
+	std::vector<uint16_t> runs;
+	if (cnt.type == Container::ArrayType)
+	{
+		std::vector<uint16_t>::const_iterator vi = cnt.values.begin(), ve = cnt.values.end();
+		while (vi != ve)
+		{
+			unsigned int first = *vi;
+			unsigned int last = first;
+			for (++vi; vi != ve && *vi == last + 1; ++vi) ++last;
+			runs.push_back( first);
+			runs.push_back( last);
+		}
+	}
+	else if (cnt.type == Container::BitmapType)
+	{
+		unsigned int pos = bitmapNext( cnt.words, 0, true);
+		while (pos < BitmapWords * 64)
+		{
+			unsigned int end = bitmapNext( cnt.words, pos, false);
+			runs.push_back( pos);
+			runs.push_back( end - 1);
+			pos = bitmapNext( cnt.words, end, true);
+		}
+	}
+	else
+	{
+		return;
+	}
+	cnt.values.swap( runs);
+	std::vector<uint64_t>().swap( cnt.words);
+	cnt.type = Container::RunType;
+}
+
+static std::size_t countRuns( const Container& cnt)
+{
+	switch ((Container::Type)cnt.type)
+	{
+		case Container::ArrayType:
+		{
+			std::size_t rt = 0;
+			std::vector<uint16_t>::const_iterator vi = cnt.values.begin(), ve = cnt.values.end();
+			unsigned int prev = 0;
+			for (std::size_t idx = 0; vi != ve; ++vi,++idx)
+			{
+				if (idx == 0 || *vi != prev + 1) ++rt;
+				prev = *vi;
+			}
+			return rt;
+		}
+		case Container::BitmapType:
+			return bitmapNofRuns( cnt.words);
+		case Container::RunType:
+			return nofRuns( cnt);
+	}
+	return 0;
+}
+
+/// \brief Convert a container to the representation needing the least memory
+static void normalize( Container& cnt)
+{
+	if (cnt.card == 0) return;
+	std::size_t runSize = countRuns( cnt) * 2 * sizeof(uint16_t);
+	std::size_t arraySize = cnt.card <= ArrayMaxSize ? cnt.card * sizeof(uint16_t) : std::numeric_limits<std::size_t>::max();
+	std::size_t bitmapSize = BitmapWords * sizeof(uint64_t);
+	if (runSize < arraySize && runSize < bitmapSize)
+	{
+		if (cnt.type == Container::BitmapType || cnt.type == Container::ArrayType) convertToRuns( cnt);
+	}
+	else if (arraySize <= bitmapSize)
+	{
+		convertToArray( cnt);
+	}
+	else
+	{
+		convertToBitmap( cnt);
+	}
+}
+
+static bool containerSetRun( Container& cnt, unsigned int pos, bool val)
+{
+	int ri = findRun( cnt, pos);
+	bool inRun = ri >= 0 && pos <= runLast( cnt, ri);
+	if (val)
+	{
+		if (inRun) return false;
+		bool joinPrev = ri >= 0 && runLast( cnt, ri) + 1 == pos;
+		bool joinNext = (std::size_t)(ri + 1) < nofRuns( cnt) && runFirst( cnt, ri + 1) == pos + 1;
+		if (joinPrev && joinNext)
+		{
+			cnt.values[ ri*2+1] = cnt.values[ (ri+1)*2+1];
+			cnt.values.erase( cnt.values.begin() + (ri+1)*2, cnt.values.begin() + (ri+2)*2);
+		}
+		else if (joinPrev)
+		{
+			cnt.values[ ri*2+1] = pos;
+		}
+		else if (joinNext)
+		{
+			cnt.values[ (ri+1)*2] = pos;
+		}
+		else
+		{
+			uint16_t run[2] = {(uint16_t)pos,(uint16_t)pos};
+			cnt.values.insert( cnt.values.begin() + (ri+1)*2, run, run+2);
+		}
+		++cnt.card;
+	}
+	else
+	{
+		if (!inRun) return false;
+		unsigned int first = runFirst( cnt, ri);
+		unsigned int last = runLast( cnt, ri);
+		if (first == last)
+		{
+			cnt.values.erase( cnt.values.begin() + ri*2, cnt.values.begin() + (ri+1)*2);
+		}
+		else if (pos == first)
+		{
+			cnt.values[ ri*2] = pos + 1;
+		}
+		else if (pos == last)
+		{
+			cnt.values[ ri*2+1] = pos - 1;
+		}
+		else
+		{
+			//... split the run
+			uint16_t run[2] = {(uint16_t)(pos + 1),(uint16_t)last};
+			cnt.values[ ri*2+1] = pos - 1;
+			cnt.values.insert( cnt.values.begin() + (ri+1)*2, run, run+2);
+		}
+		--cnt.card;
+	}
+	std::size_t runSize = cnt.values.size() * sizeof(uint16_t);
+	if (runSize > BitmapWords * sizeof(uint64_t) || (cnt.card <= ArrayMaxSize && runSize > cnt.card * sizeof(uint16_t)))
+	{
+		normalize( cnt);
+	}
+	return true;
+}
+
+static bool containerSet( Container& cnt, unsigned int pos, bool val)
+{
+	switch ((Container::Type)cnt.type)
+	{
+		case Container::ArrayType:
+		{
+			std::vector<uint16_t>::iterator vi = std::lower_bound( cnt.values.begin(), cnt.values.end(), (uint16_t)pos);
+			bool found = vi != cnt.values.end() && *vi == pos;
+			if (found == val) return false;
+			if (val)
+			{
+				cnt.values.insert( vi, (uint16_t)pos);
+				if (++cnt.card > ArrayMaxSize) convertToBitmap( cnt);
+			}
+			else
+			{
+				cnt.values.erase( vi);
+				--cnt.card;
+			}
+			return true;
+		}
+		case Container::BitmapType:
+		{
+			uint64_t& word = cnt.words[ pos / 64];
+			uint64_t mask = (uint64_t)1 << (pos % 64);
+			if (((word & mask) != 0) == val) return false;
+			word ^= mask;
+			if (val)
+			{
+				++cnt.card;
+			}
+			else if (--cnt.card <= ArrayMaxSize)
+			{
+				convertToArray( cnt);
+			}
+			return true;
+		}
+		case Container::RunType:
+			return containerSetRun( cnt, pos, val);
+	}
+	return false;
+}
+
+/// \brief Get the number of positions in the intersection of two containers
+static unsigned int containerCountAnd( const Container& aa, const Container& bb)
+{
+	if (aa.type == Container::ArrayType || bb.type == Container::ArrayType)
+	{
+		const Container& arr = aa.type == Container::ArrayType ? aa : bb;
+		const Container& oth = aa.type == Container::ArrayType ? bb : aa;
+		unsigned int rt = 0;
+		if (oth.type == Container::ArrayType)
+		{
+			std::vector<uint16_t>::const_iterator ai = arr.values.begin(), ae = arr.values.end();
+			std::vector<uint16_t>::const_iterator bi = oth.values.begin(), be = oth.values.end();
+			while (ai != ae && bi != be)
+			{
+				if (*ai < *bi) ++ai;
+				else if (*bi < *ai) ++bi;
+				else {++rt; ++ai; ++bi;}
+			}
+		}
+		else
+		{
+			std::vector<uint16_t>::const_iterator ai = arr.values.begin(), ae = arr.values.end();
+			for (; ai != ae; ++ai) rt += containerTest( oth, *ai) ? 1 : 0;
+		}
+		return rt;
+	}
+	else if (aa.type == Container::RunType && bb.type == Container::RunType)
+	{
+		unsigned int rt = 0;
+		std::size_t ai = 0, ae = nofRuns( aa), bi = 0, be = nofRuns( bb);
+		while (ai != ae && bi != be)
+		{
+			unsigned int first = std::max( runFirst( aa, ai), runFirst( bb, bi));
+			unsigned int last = std::min( runLast( aa, ai), runLast( bb, bi));
+			if (first <= last) rt += last - first + 1;
+			if (runLast( aa, ai) < runLast( bb, bi)) ++ai; else ++bi;
+		}
+		return rt;
+	}
+	else if (aa.type == Container::BitmapType && bb.type == Container::BitmapType)
+	{
+		unsigned int rt = 0;
+		for (unsigned int wi = 0; wi < BitmapWords; ++wi) rt += BitOperations::bitCount( (uint64_t)(aa.words[ wi] & bb.words[ wi]));
+		return rt;
+	}
+	else
+	{
+		const Container& run = aa.type == Container::RunType ? aa : bb;
+		const Container& bmp = aa.type == Container::RunType ? bb : aa;
+		unsigned int rt = 0;
+		std::size_t ri = 0, re = nofRuns( run);
+		for (; ri != re; ++ri) rt += bitmapCountRange( bmp.words, runFirst( run, ri), runLast( run, ri));
+		return rt;
+	}
+}
+
+static void containerAnd( Container& res, const Container& aa, const Container& bb)
+{
+	if (aa.type == Container::ArrayType || bb.type == Container::ArrayType)
+	{
+		const Container& arr = aa.type == Container::ArrayType ? aa : bb;
+		const Container& oth = aa.type == Container::ArrayType ? bb : aa;
+		if (oth.type == Container::ArrayType)
+		{
+			std::set_intersection( arr.values.begin(), arr.values.end(), oth.values.begin(), oth.values.end(), std::back_inserter( res.values));
+		}
+		else
+		{
+			std::vector<uint16_t>::const_iterator ai = arr.values.begin(), ae = arr.values.end();
+			for (; ai != ae; ++ai) if (containerTest( oth, *ai)) res.values.push_back( *ai);
+		}
+		res.type = Container::ArrayType;
+		res.card = res.values.size();
+	}
+	else if (aa.type == Container::RunType && bb.type == Container::RunType)
+	{
+		res.type = Container::RunType;
+		std::size_t ai = 0, ae = nofRuns( aa), bi = 0, be = nofRuns( bb);
+		while (ai != ae && bi != be)
+		{
+			unsigned int first = std::max( runFirst( aa, ai), runFirst( bb, bi));
+			unsigned int last = std::min( runLast( aa, ai), runLast( bb, bi));
+			if (first <= last) appendRun( res, first, last);
+			if (runLast( aa, ai) < runLast( bb, bi)) ++ai; else ++bi;
+		}
+	}
+	else
+	{
+		res.type = Container::BitmapType;
+		if (aa.type == Container::BitmapType && bb.type == Container::BitmapType)
+		{
+			res.words = aa.words;
+			BitSetKernels::intersect( res.words.data(), bb.words.data(), BitmapWords);
+		}
+		else
+		{
+			const Container& run = aa.type == Container::RunType ? aa : bb;
+			const Container& bmp = aa.type == Container::RunType ? bb : aa;
+			res.words.assign( BitmapWords, 0);
+			std::size_t ri = 0, re = nofRuns( run);
+			for (; ri != re; ++ri) bitmapCopyRange( res.words, bmp.words, runFirst( run, ri), runLast( run, ri));
+		}
+		res.card = bitmapCount( res.words);
+	}
+	normalize( res);
+}
+
+static void containerOr( Container& res, const Container& aa, const Container& bb)
+{
+	if (aa.type == Container::ArrayType && bb.type == Container::ArrayType)
+	{
+		std::set_union( aa.values.begin(), aa.values.end(), bb.values.begin(), bb.values.end(), std::back_inserter( res.values));
+		res.type = Container::ArrayType;
+		res.card = res.values.size();
+	}
+	else if (aa.type == Container::RunType && bb.type == Container::RunType)
+	{
+		res.type = Container::RunType;
+		std::size_t ai = 0, ae = nofRuns( aa), bi = 0, be = nofRuns( bb);
+		bool hasRun = false;
+		unsigned int first = 0;
+		unsigned int last = 0;
+		while (ai != ae || bi != be)
+		{
+			//... take the run starting first, merge it with the current one if they overlap or are adjacent
+			//... the side is chosen by position and not by address, because both operands may be the same container
+			bool fromA = (bi == be || (ai != ae && runFirst( aa, ai) <= runFirst( bb, bi)));
+			const Container& src = fromA ? aa : bb;
+			std::size_t& si = fromA ? ai : bi;
+			unsigned int rf = runFirst( src, si);
+			unsigned int rl = runLast( src, si);
+			++si;
+			if (hasRun && rf <= last + 1)
+			{
+				if (rl > last) last = rl;
+			}
+			else
+			{
+				if (hasRun) appendRun( res, first, last);
+				first = rf;
+				last = rl;
+				hasRun = true;
+			}
+		}
+		if (hasRun) appendRun( res, first, last);
+	}
+	else
+	{
+		const Container& base = bb.type == Container::BitmapType ? bb : aa;
+		const Container& oth = bb.type == Container::BitmapType ? aa : bb;
+		res.type = Container::BitmapType;
+		fillBitmap( res.words, base);
+		if (oth.type == Container::ArrayType)
+		{
+			std::vector<uint16_t>::const_iterator vi = oth.values.begin(), ve = oth.values.end();
+			for (; vi != ve; ++vi) res.words[ *vi / 64] |= (uint64_t)1 << (*vi % 64);
+		}
+		else if (oth.type == Container::BitmapType)
+		{
+			BitSetKernels::join( res.words.data(), oth.words.data(), BitmapWords);
+		}
+		else
+		{
+			std::size_t ri = 0, re = nofRuns( oth);
+			for (; ri != re; ++ri) bitmapSetRange( res.words, runFirst( oth, ri), runLast( oth, ri));
+		}
+		res.card = bitmapCount( res.words);
+	}
+	normalize( res);
+}
+
+static void containerXor( Container& res, const Container& aa, const Container& bb)
+{
+	if (aa.type == Container::ArrayType && bb.type == Container::ArrayType)
+	{
+		std::set_symmetric_difference( aa.values.begin(), aa.values.end(), bb.values.begin(), bb.values.end(), std::back_inserter( res.values));
+		res.type = Container::ArrayType;
+		res.card = res.values.size();
+	}
+	else
+	{
+		const Container& base = bb.type == Container::BitmapType ? bb : aa;
+		const Container& oth = bb.type == Container::BitmapType ? aa : bb;
+		res.type = Container::BitmapType;
+		fillBitmap( res.words, base);
+		if (oth.type == Container::ArrayType)
+		{
+			std::vector<uint16_t>::const_iterator vi = oth.values.begin(), ve = oth.values.end();
+			for (; vi != ve; ++vi) res.words[ *vi / 64] ^= (uint64_t)1 << (*vi % 64);
+		}
+		else if (oth.type == Container::BitmapType)
+		{
+			BitSetKernels::toggle( res.words.data(), oth.words.data(), BitmapWords);
+		}
+		else
+		{
+			std::size_t ri = 0, re = nofRuns( oth);
+			for (; ri != re; ++ri) bitmapFlipRange( res.words, runFirst( oth, ri), runLast( oth, ri));
+		}
+		res.card = bitmapCount( res.words);
+	}
+	normalize( res);
+}
+
+static void containerAndNot( Container& res, const Container& aa, const Container& bb)
+{
+	if (aa.type == Container::ArrayType)
+	{
+		if (bb.type == Container::ArrayType)
+		{
+			std::set_difference( aa.values.begin(), aa.values.end(), bb.values.begin(), bb.values.end(), std::back_inserter( res.values));
+		}
+		else
+		{
+			std::vector<uint16_t>::const_iterator ai = aa.values.begin(), ae = aa.values.end();
+			for (; ai != ae; ++ai) if (!containerTest( bb, *ai)) res.values.push_back( *ai);
+		}
+		res.type = Container::ArrayType;
+		res.card = res.values.size();
+	}
+	else
+	{
+		res.type = Container::BitmapType;
+		fillBitmap( res.words, aa);
+		if (bb.type == Container::ArrayType)
+		{
+			std::vector<uint16_t>::const_iterator vi = bb.values.begin(), ve = bb.values.end();
+			for (; vi != ve; ++vi) res.words[ *vi / 64] &= ~((uint64_t)1 << (*vi % 64));
+		}
+		else if (bb.type == Container::BitmapType)
+		{
+			BitSetKernels::subtract( res.words.data(), bb.words.data(), BitmapWords);
+		}
+		else
+		{
+			std::size_t ri = 0, re = nofRuns( bb);
+			for (; ri != re; ++ri) bitmapClearRange( res.words, runFirst( bb, ri), runLast( bb, ri));
+		}
+		res.card = bitmapCount( res.words);
+	}
+	normalize( res);
+}
+
+/// \brief Append a container to a container list, taking its contents
+static void appendContainer( std::vector<uint16_t>& keys, std::vector<Container>& containers, uint16_t key, Container& cnt)
+{
+	containers.push_back( Container());
+	containers.back().swap( cnt);
+	keys.push_back( key);
+}
+
+/// \brief Check that a set operand does not have elements out of the dimension of the set it is combined with
+static void checkOperandDimension( std::size_t size, std::size_t operandSize)
+{
+	if (operandSize > size) throw std::runtime_error( "dimension of bitset operand bigger than the dimension of the result");
+}
+
+// --------------------------------------
+// Compressed bitset
+// --------------------------------------
+
+DLL_PUBLIC compressed_bitset::compressed_bitset( std::size_t size_)
+	:m_size(size_),m_keys(),m_containers()
+{
+	if (size_ > (std::size_t)std::numeric_limits<int32_t>::max()) throw std::bad_alloc();
+}
+
+std::size_t compressed_bitset::findContainer( uint16_t key) const
+{
+	return std::lower_bound( m_keys.begin(), m_keys.end(), key) - m_keys.begin();
+}
+
+DLL_PUBLIC bool compressed_bitset::set( std::size_t n, bool val)
+{
+	if (n >= m_size) return false;
+	uint16_t key = n >> ChunkBits;
+	unsigned int pos = n & ChunkMask;
+	std::size_t ci = findContainer( key);
+	if (ci == m_keys.size() || m_keys[ ci] != key)
+	{
+		if (!val) return false;
+		Container cnt;
+		cnt.values.push_back( pos);
+		cnt.card = 1;
+		m_containers.insert( m_containers.begin() + ci, Container())->swap( cnt);
+		m_keys.insert( m_keys.begin() + ci, key);
+		return true;
+	}
+	bool rt = containerSet( m_containers[ ci], pos, val);
+	if (m_containers[ ci].card == 0)
+	{
+		m_containers.erase( m_containers.begin() + ci);
+		m_keys.erase( m_keys.begin() + ci);
+	}
+	return rt;
+}
+
+DLL_PUBLIC bool compressed_bitset::test( std::size_t n) const
+{
+	if (n >= m_size) return false;
+	uint16_t key = n >> ChunkBits;
+	std::size_t ci = findContainer( key);
+	if (ci == m_keys.size() || m_keys[ ci] != key) return false;
+	return containerTest( m_containers[ ci], n & ChunkMask);
+}
+
+DLL_PUBLIC void compressed_bitset::reset()
+{
+	m_keys.clear();
+	m_containers.clear();
+}
+
+DLL_PUBLIC std::size_t compressed_bitset::count() const
+{
+	std::size_t rt = 0;
+	std::vector<Container>::const_iterator ci = m_containers.begin(), ce = m_containers.end();
+	for (; ci != ce; ++ci) rt += ci->card;
+	return rt;
+}
+
+DLL_PUBLIC int compressed_bitset::next( int pos) const
+{
+	++pos;
+	if (pos < 0 || (std::size_t)pos >= m_size) return -1;
+	uint16_t key = (unsigned int)pos >> ChunkBits;
+	std::size_t ci = findContainer( key);
+	if (ci == m_keys.size()) return -1;
+	if (m_keys[ ci] == key)
+	{
+		int rt = containerNext( m_containers[ ci], pos & ChunkMask);
+		if (rt >= 0) return ((int)key << ChunkBits) + rt;
+		if (++ci == m_keys.size()) return -1;
+	}
+	//... containers are never empty
+	return ((int)m_keys[ ci] << ChunkBits) + containerNext( m_containers[ ci], 0);
+}
+
+DLL_PUBLIC std::vector<int> compressed_bitset::elements() const
+{
+	std::vector<int> rt;
+	rt.reserve( count());
+	for (int pi = first(); pi >= 0; pi = next( pi)) rt.push_back( pi);
+	return rt;
+}
+
+DLL_PUBLIC compressed_bitset& compressed_bitset::operator |= ( const compressed_bitset& o)
+{
+	checkOperandDimension( m_size, o.m_size);
+	std::vector<uint16_t> keys;
+	std::vector<Container> containers;
+	keys.reserve( m_keys.size() + o.m_keys.size());
+	containers.reserve( m_keys.size() + o.m_keys.size());
+	std::size_t ai = 0, ae = m_keys.size(), bi = 0, be = o.m_keys.size();
+	while (ai != ae || bi != be)
+	{
+		if (bi == be || (ai != ae && m_keys[ ai] < o.m_keys[ bi]))
+		{
+			appendContainer( keys, containers, m_keys[ ai], m_containers[ ai]);
+			++ai;
+		}
+		else if (ai == ae || o.m_keys[ bi] < m_keys[ ai])
+		{
+			Container cnt( o.m_containers[ bi]);
+			appendContainer( keys, containers, o.m_keys[ bi], cnt);
+			++bi;
+		}
+		else
+		{
+			Container cnt;
+			containerOr( cnt, m_containers[ ai], o.m_containers[ bi]);
+			appendContainer( keys, containers, m_keys[ ai], cnt);
+			++ai;
+			++bi;
+		}
+	}
+	m_keys.swap( keys);
+	m_containers.swap( containers);
+	return *this;
+}
+
+DLL_PUBLIC compressed_bitset& compressed_bitset::operator &= ( const compressed_bitset& o)
+{
+	std::size_t wi = 0, ai = 0, ae = m_keys.size(), bi = 0, be = o.m_keys.size();
+	while (ai != ae && bi != be)
+	{
+		if (m_keys[ ai] < o.m_keys[ bi])
+		{
+			++ai;
+		}
+		else if (o.m_keys[ bi] < m_keys[ ai])
+		{
+			++bi;
+		}
+		else
+		{
+			Container cnt;
+			containerAnd( cnt, m_containers[ ai], o.m_containers[ bi]);
+			if (cnt.card)
+			{
+				m_containers[ wi].swap( cnt);
+				m_keys[ wi] = m_keys[ ai];
+				++wi;
+			}
+			++ai;
+			++bi;
+		}
+	}
+	m_keys.resize( wi);
+	m_containers.resize( wi);
+	return *this;
+}
+
+DLL_PUBLIC compressed_bitset& compressed_bitset::operator ^= ( const compressed_bitset& o)
+{
+	checkOperandDimension( m_size, o.m_size);
+	std::vector<uint16_t> keys;
+	std::vector<Container> containers;
+	keys.reserve( m_keys.size() + o.m_keys.size());
+	containers.reserve( m_keys.size() + o.m_keys.size());
+	std::size_t ai = 0, ae = m_keys.size(), bi = 0, be = o.m_keys.size();
+	while (ai != ae || bi != be)
+	{
+		if (bi == be || (ai != ae && m_keys[ ai] < o.m_keys[ bi]))
+		{
+			appendContainer( keys, containers, m_keys[ ai], m_containers[ ai]);
+			++ai;
+		}
+		else if (ai == ae || o.m_keys[ bi] < m_keys[ ai])
+		{
+			Container cnt( o.m_containers[ bi]);
+			appendContainer( keys, containers, o.m_keys[ bi], cnt);
+			++bi;
+		}
+		else
+		{
+			Container cnt;
+			containerXor( cnt, m_containers[ ai], o.m_containers[ bi]);
+			if (cnt.card) appendContainer( keys, containers, m_keys[ ai], cnt);
+			++ai;
+			++bi;
+		}
+	}
+	m_keys.swap( keys);
+	m_containers.swap( containers);
+	return *this;
+}
+
+DLL_PUBLIC compressed_bitset& compressed_bitset::operator -= ( const compressed_bitset& o)
+{
+	std::size_t wi = 0, ai = 0, ae = m_keys.size(), bi = 0, be = o.m_keys.size();
+	for (; ai != ae; ++ai)
+	{
+		while (bi != be && o.m_keys[ bi] < m_keys[ ai]) ++bi;
+		if (bi != be && o.m_keys[ bi] == m_keys[ ai])
+		{
+			Container cnt;
+			containerAndNot( cnt, m_containers[ ai], o.m_containers[ bi]);
+			if (cnt.card)
+			{
+				m_containers[ wi].swap( cnt);
+				m_keys[ wi] = m_keys[ ai];
+				++wi;
+			}
+		}
+		else
+		{
+			if (wi != ai)
+			{
+				m_containers[ wi].swap( m_containers[ ai]);
+				m_keys[ wi] = m_keys[ ai];
+			}
+			++wi;
+		}
+	}
+	m_keys.resize( wi);
+	m_containers.resize( wi);
+	return *this;
+}
+
+DLL_PUBLIC std::size_t compressed_bitset::count_and( const compressed_bitset& o) const
+{
+	std::size_t rt = 0;
+	std::size_t ai = 0, ae = m_keys.size(), bi = 0, be = o.m_keys.size();
+	while (ai != ae && bi != be)
+	{
+		if (m_keys[ ai] < o.m_keys[ bi])
+		{
+			++ai;
+		}
+		else if (o.m_keys[ bi] < m_keys[ ai])
+		{
+			++bi;
+		}
+		else
+		{
+			rt += containerCountAnd( m_containers[ ai], o.m_containers[ bi]);
+			++ai;
+			++bi;
+		}
+	}
+	return rt;
+}
+
+DLL_PUBLIC bool compressed_bitset::operator == ( const compressed_bitset& o) const
+{
+	if (m_keys != o.m_keys) return false;
+	std::vector<Container>::const_iterator ai = m_containers.begin(), ae = m_containers.end();
+	std::vector<Container>::const_iterator bi = o.m_containers.begin();
+	for (; ai != ae; ++ai,++bi)
+	{
+		//... the same positions can be represented differently, depending on how the containers were built
+		if (ai->card != bi->card) return false;
+		if (ai->type == bi->type && ai->type != Container::BitmapType)
+		{
+			if (ai->values != bi->values) return false;
+		}
+		else if (containerCountAnd( *ai, *bi) != ai->card)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+DLL_PUBLIC void compressed_bitset::optimize()
+{
+	std::vector<Container>::iterator ci = m_containers.begin(), ce = m_containers.end();
+	for (; ci != ce; ++ci)
+	{
+		normalize( *ci);
+		std::vector<uint16_t>( ci->values).swap( ci->values);
+		std::vector<uint64_t>( ci->words).swap( ci->words);
+	}
+	std::vector<uint16_t>( m_keys).swap( m_keys);
+	std::vector<Container>( m_containers).swap( m_containers);
+}
+
+DLL_PUBLIC std::size_t compressed_bitset::allocated() const
+{
+	std::size_t rt = m_keys.capacity() * sizeof(uint16_t) + m_containers.capacity() * sizeof(Container);
+	std::vector<Container>::const_iterator ci = m_containers.begin(), ce = m_containers.end();
+	for (; ci != ce; ++ci)
+	{
+		rt += ci->values.capacity() * sizeof(uint16_t) + ci->words.capacity() * sizeof(uint64_t);
+	}
+	return rt;
+}
+
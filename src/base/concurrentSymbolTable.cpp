@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Map of strings to indices shared between threads, with lock free lookups and inserts distributed on independent shards
+#include "strus/base/concurrentSymbolTable.hpp"
+#include "strus/base/dll_tags.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/platform.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/stringHash.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "private/internationalization.hpp"
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace strus;
+
+namespace {
+
+/// \brief Allocator for the key records of one shard, records are not freed till the end of the table life time
+/// \note A record is the key size (uint32_t) followed by the key and a terminating 0, the key pointer points to the key
+class KeyRecordAllocator
+{
+public:
+	enum {ChunkSize=4096};
+
+	KeyRecordAllocator()
+		:m_chunks(),m_pos(ChunkSize){}
+	~KeyRecordAllocator()
+	{
+		clear();
+	}
+
+	const char* alloc( const char* key, uint32_t keylen)
+	{
+		std::size_t recsize = sizeof(uint32_t) + keylen + 1;
+		char* rec;
+		if (recsize > ChunkSize / 4)
+		{
+			//... big keys get their own chunk, inserted before the current chunk
+			rec = (char*)std::malloc( recsize);
+			if (!rec) throw std::bad_alloc();
+			m_chunks.insert( m_chunks.end() - (m_chunks.empty() ? 0:1), rec);
+		}
+		else
+		{
+			if (m_pos + recsize > ChunkSize)
+			{
+				char* chunk = (char*)std::malloc( ChunkSize);
+				if (!chunk) throw std::bad_alloc();
+				m_chunks.push_back( chunk);
+				m_pos = 0;
+			}
+			rec = m_chunks.back() + m_pos;
+			m_pos += recsize;
+		}
+		std::memcpy( rec, &keylen, sizeof(keylen));
+		std::memcpy( rec + sizeof(uint32_t), key, keylen);
+		rec[ sizeof(uint32_t) + keylen] = 0;
+		return rec + sizeof(uint32_t);
+	}
+
+	static uint32_t keylen( const char* keyptr)
+	{
+		uint32_t rt;
+		std::memcpy( &rt, keyptr - sizeof(uint32_t), sizeof(rt));
+		return rt;
+	}
+
+	void clear()
+	{
+		std::vector<char*>::const_iterator ci = m_chunks.begin(), ce = m_chunks.end();
+		for (; ci != ce; ++ci) std::free( *ci);
+		m_chunks.clear();
+		m_pos = ChunkSize;
+	}
+
+private:
+	std::vector<char*> m_chunks;
+	std::size_t m_pos;
+};
+
+/// \brief Array of key pointers indexed by handle
+/// \note Organized as segments of doubling size that are never moved, so that readers do not need to lock
+class InvTable
+{
+public:
+	enum {FirstSegmentBits=10, NofSegments=32-FirstSegmentBits};
+	typedef strus::atomic<const char*> Element;
+
+	InvTable()
+	{
+		for (int si=0; si<NofSegments; ++si) m_segments[ si].store( 0);
+	}
+	~InvTable()
+	{
+		clear();
+	}
+
+	const char* get( uint32_t id) const
+	{
+		int segidx;
+		std::size_t ofs;
+		if (!address( id, segidx, ofs)) return 0;
+		Element* seg = m_segments[ segidx].load();
+		return seg ? seg[ ofs].load() : 0;
+	}
+
+	void set( uint32_t id, const char* keyptr)
+	{
+		int segidx;
+		std::size_t ofs;
+		if (!address( id, segidx, ofs)) throw std::bad_alloc();
+		Element* seg = m_segments[ segidx].load();
+		if (!seg)
+		{
+			Element* newseg = new Element[ (std::size_t)1 << (segidx + FirstSegmentBits)];
+			if (m_segments[ segidx].compare_exchange_strong( seg, newseg))
+			{
+				seg = newseg;
+			}
+			else
+			{
+				//... other thread was faster, seg contains its segment now
+				delete [] newseg;
+			}
+		}
+		seg[ ofs].store( keyptr);
+	}
+
+	void clear()
+	{
+		for (int si=0; si<NofSegments; ++si)
+		{
+			Element* seg = m_segments[ si].load();
+			if (seg) delete [] seg;
+			m_segments[ si].store( 0);
+		}
+	}
+
+private:
+	static bool address( uint32_t id, int& segidx, std::size_t& ofs)
+	{
+		if (!id || id > (uint32_t)std::numeric_limits<int32_t>::max()) return false;
+		uint32_t vv = (id-1) + ((uint32_t)1 << FirstSegmentBits);
+		int bi = BitOperations::bitScanReverse( vv) - 1;
+		segidx = bi - FirstSegmentBits;
+		ofs = vv - ((uint32_t)1 << bi);
+		return true;
+	}
+
+private:
+	strus::atomic<Element*> m_segments[ NofSegments];
+};
+
+/// \brief Open addressing hash table of one shard mapping a hash value to handles
+class SlotTable
+{
+public:
+	struct Slot
+	{
+		strus::atomic<uint32_t> hash;
+		strus::atomic<uint32_t> id;
+	};
+
+	explicit SlotTable( std::size_t size_)
+		:m_mask(size_-1),m_ar(new Slot[ size_]){}
+	~SlotTable()
+	{
+		delete [] m_ar;
+	}
+
+	std::size_t size() const
+	{
+		return m_mask+1;
+	}
+
+	/// \brief Find the handle of a key
+	/// \note Lock free, a slot is published by writing the handle after the hash and the key have been written
+	uint32_t find( const InvTable& inv, uint32_t hash, uint32_t pos, const char* key, std::size_t keylen) const
+	{
+		for (pos &= m_mask;; pos = (pos + 1) & m_mask)
+		{
+			const Slot& slot = m_ar[ pos];
+			uint32_t id = slot.id.load();
+			if (!id) return 0;
+			if (slot.hash.load() == hash)
+			{
+				const char* keyptr = inv.get( id);
+				if (KeyRecordAllocator::keylen( keyptr) == keylen && std::memcmp( keyptr, key, keylen) == 0)
+				{
+					return id;
+				}
+			}
+		}
+	}
+
+	/// \brief Insert a new handle, only called by the owner of the shard mutex
+	void insert( uint32_t hash, uint32_t pos, uint32_t id)
+	{
+		for (pos &= m_mask;; pos = (pos + 1) & m_mask)
+		{
+			Slot& slot = m_ar[ pos];
+			if (!slot.id.load())
+			{
+				slot.hash.store( hash);
+				slot.id.store( id);
+				return;
+			}
+		}
+	}
+
+	/// \brief Copy all elements into a table of a different size
+	void rehash( SlotTable& dest, int nofShardBits) const
+	{
+		for (std::size_t si=0; si<=m_mask; ++si)
+		{
+			uint32_t id = m_ar[ si].id.load();
+			if (id)
+			{
+				uint32_t hash = m_ar[ si].hash.load();
+				dest.insert( hash, hash >> nofShardBits, id);
+			}
+		}
+	}
+
+private:
+	std::size_t m_mask;
+	Slot* m_ar;
+};
+
+/// \brief Independent part of the table with its own lock for writers
+struct Shard
+{
+	enum {InitSize=16};
+
+	Shard()
+		:table(new SlotTable( InitSize)),retired(),keys(),nofElements(0){}
+	~Shard()
+	{
+		clear();
+		delete table.load();
+	}
+
+	void clear()
+	{
+		std::vector<SlotTable*>::const_iterator ri = retired.begin(), re = retired.end();
+		for (; ri != re; ++ri) delete *ri;
+		retired.clear();
+		keys.clear();
+		nofElements = 0;
+	}
+
+	strus::mutex mutex;
+	strus::atomic<SlotTable*> table;
+	std::vector<SlotTable*> retired;	///< tables replaced, freed at the end of the table life time or on clear, because readers could still be using them
+	KeyRecordAllocator keys;
+	std::size_t nofElements;
+	char pad[ platform::CacheLineSize];	///< avoid false sharing of the shard header by writers of different shards
+};
+
+}//anonymous namespace
+
+struct ConcurrentSymbolTable::Data
+{
+	Data( ErrorBufferInterface* errorhnd_, int nofShards_)
+		:errorhnd(errorhnd_),nofShardBits(0),shardMask(0),shards(0),inv(),counter(0)
+	{
+		if (nofShards_ <= 0) nofShards_ = platform::cores() * 4;
+		if (nofShards_ <= 0) nofShards_ = 1;
+		if (nofShards_ > MaxNofShards) nofShards_ = MaxNofShards;
+		while ((1 << nofShardBits) < nofShards_) ++nofShardBits;
+		shardMask = (1 << nofShardBits) - 1;
+		shards = new Shard[ shardMask+1];
+	}
+	~Data()
+	{
+		delete [] shards;
+	}
+
+	enum {MaxNofShards=1024};
+
+	static uint32_t hash( const char* key, std::size_t keylen)
+	{
+		return (uint32_t)StringHash::calc( key, keylen);
+	}
+
+	ErrorBufferInterface* errorhnd;
+	int nofShardBits;
+	uint32_t shardMask;
+	Shard* shards;
+	InvTable inv;
+	AtomicCounter<uint32_t> counter;
+};
+
+DLL_PUBLIC bool ConcurrentSymbolTable::init( ErrorBufferInterface* errorhnd_, int nofShards_)
+{
+	try
+	{
+		m_data = new Data( errorhnd_, nofShards_);
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+DLL_PUBLIC ConcurrentSymbolTable::~ConcurrentSymbolTable()
+{
+	delete m_data;
+}
+
+DLL_PUBLIC uint32_t ConcurrentSymbolTable::getOrCreate( const std::string& key_)
+{
+	bool isNew;
+	return getOrCreate( key_.c_str(), key_.size(), isNew);
+}
+
+DLL_PUBLIC uint32_t ConcurrentSymbolTable::getOrCreate( const char* keystr, std::size_t keylen)
+{
+	bool isNew;
+	return getOrCreate( keystr, keylen, isNew);
+}
+
+DLL_PUBLIC uint32_t ConcurrentSymbolTable::getOrCreate( const char* keystr, std::size_t keylen, bool& isNew)
+{
+	isNew = false;
+	try
+	{
+		uint32_t hash = Data::hash( keystr, keylen);
+		uint32_t pos = hash >> m_data->nofShardBits;
+		Shard& shard = m_data->shards[ hash & m_data->shardMask];
+
+		uint32_t rt = shard.table.load()->find( m_data->inv, hash, pos, keystr, keylen);
+		if (rt) return rt;
+
+		strus::scoped_lock lock( shard.mutex);
+		SlotTable* tab = shard.table.load();
+		rt = tab->find( m_data->inv, hash, pos, keystr, keylen);
+		if (rt) return rt;
+
+		if (keylen >= (std::size_t)std::numeric_limits<int32_t>::max()
+		||  m_data->counter.value() >= (uint32_t)std::numeric_limits<int32_t>::max()-1)
+		{
+			throw std::bad_alloc();
+		}
+		if ((shard.nofElements + 1) * 2 > tab->size())
+		{
+			SlotTable* newtab = new SlotTable( tab->size() * 2);
+			tab->rehash( *newtab, m_data->nofShardBits);
+			shard.retired.push_back( tab);
+			shard.table.store( newtab);
+			tab = newtab;
+		}
+		const char* keystr_copy = shard.keys.alloc( keystr, keylen);
+		rt = m_data->counter.allocIncrement() + 1;
+		m_data->inv.set( rt, keystr_copy);
+		tab->insert( hash, pos, rt);
+		++shard.nofElements;
+		isNew = true;
+		return rt;
+	}
+	catch (const std::bad_alloc&)
+	{
+		if (m_data->errorhnd) m_data->errorhnd->report( ErrorCodeOutOfMem, _TXT("out of memory"));
+		return 0;
+	}
+	catch (const std::exception& err)
+	{
+		if (m_data->errorhnd) m_data->errorhnd->report( ErrorCodeRuntimeError, "%s", err.what());
+		return 0;
+	}
+}
+
+DLL_PUBLIC uint32_t ConcurrentSymbolTable::get( const std::string& key_) const
+{
+	return get( key_.c_str(), key_.size());
+}
+
+DLL_PUBLIC uint32_t ConcurrentSymbolTable::get( const char* keystr, std::size_t keylen) const
+{
+	uint32_t hash = Data::hash( keystr, keylen);
+	const Shard& shard = m_data->shards[ hash & m_data->shardMask];
+	return shard.table.load()->find( m_data->inv, hash, hash >> m_data->nofShardBits, keystr, keylen);
+}
+
+DLL_PUBLIC const char* ConcurrentSymbolTable::key( const uint32_t& id) const
+{
+	return m_data->inv.get( id);
+}
+
+DLL_PUBLIC std::size_t ConcurrentSymbolTable::size() const
+{
+	return m_data->counter.value();
+}
+
+DLL_PUBLIC void ConcurrentSymbolTable::clear()
+{
+	try
+	{
+		for (uint32_t si=0; si<=m_data->shardMask; ++si)
+		{
+			Shard& shard = m_data->shards[ si];
+			SlotTable* newtab = new SlotTable( Shard::InitSize);
+			shard.clear();
+			delete shard.table.load();
+			shard.table.store( newtab);
+		}
+		m_data->inv.clear();
+		m_data->counter.set( 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		if (m_data->errorhnd) m_data->errorhnd->report( ErrorCodeOutOfMem, _TXT("out of memory"));
+	}
+}
+
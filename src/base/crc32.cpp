@@ -8,10 +8,16 @@
 #include "strus/base/crc32.hpp"
 #include "strus/base/dll_tags.hpp"
 #include <stdlib.h>
+#include <string.h>
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define STRUS_CRC32C_HARDWARE
+#include <nmmintrin.h>
+#endif
 
 using namespace strus;
 using namespace strus::utils;
 
+template <uint32_t Polynomial>
 class Crc32Table
 {
 public:
@@ -19,7 +25,6 @@ public:
 	{
 		for (unsigned int ii = 0; ii <= 0xFF; ii++)
 		{
-			enum {Polynomial=0xEDB88320U};
 			uint32_t crc = ii;
 			for (unsigned int jj = 0; jj < 8; jj++)
 			{
@@ -37,7 +42,8 @@ private:
 	uint32_t m_ar[ 0x100];
 };
 
-static const Crc32Table g_crc32Lookup;
+static const Crc32Table<0xEDB88320U> g_crc32Lookup;
+static const Crc32Table<0x82F63B78U> g_crc32cLookup;
 
 ///\note CRC32 Standard implementation from blog post http://create.stephan-brumme.com/crc32/#sarwate, Thanks
 static uint32_t crc32_standardImplementation_1byte( const void* data, size_t length, uint32_t previousCrc32)
@@ -71,3 +77,102 @@ DLL_PUBLIC uint32_t Crc32::calc( const char* blk)
 	return crc32_standardImplementation_1byte( blk, 0);
 }
 
+static uint32_t crc32c_softwareImplementation( const char* data, size_t length)
+{
+	uint32_t crc = ~(uint32_t)0;
+	unsigned char const* current = (unsigned char const*) data;
+	while (length--)
+	{
+		crc = (crc >> 8) ^ g_crc32cLookup[(crc & 0xFF) ^ *current++];
+	}
+	return ~crc;
+}
+
+#ifdef STRUS_CRC32C_HARDWARE
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hardwareImplementation( const char* data, size_t length)
+{
+	unsigned char const* current = (unsigned char const*) data;
+#if defined __x86_64__
+	uint64_t crc = ~(uint32_t)0;
+	for (; length >= 8; length -= 8, current += 8)
+	{
+		uint64_t chunk;
+		memcpy( &chunk, current, sizeof(chunk));
+		crc = _mm_crc32_u64( crc, chunk);
+	}
+	uint32_t crc32 = (uint32_t)crc;
+#else
+	uint32_t crc32 = ~(uint32_t)0;
+	for (; length >= 4; length -= 4, current += 4)
+	{
+		uint32_t chunk;
+		memcpy( &chunk, current, sizeof(chunk));
+		crc32 = _mm_crc32_u32( crc32, chunk);
+	}
+#endif
+	while (length--)
+	{
+		crc32 = _mm_crc32_u8( crc32, *current++);
+	}
+	return ~crc32;
+}
+#endif
+
+typedef uint32_t (*Crc32cImplementation)( const char* data, size_t length);
+
+static Crc32cImplementation getCrc32cImplementation()
+{
+#ifdef STRUS_CRC32C_HARDWARE
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports( "sse4.2")) return &crc32c_hardwareImplementation;
+#endif
+	return &crc32c_softwareImplementation;
+}
+
+//... the table driven implementation is used for calculations in static initializers executed before the selection
+static Crc32cImplementation g_crc32cImplementation = &crc32c_softwareImplementation;
+
+namespace {
+struct Crc32cImplementationSelection
+{
+	Crc32cImplementationSelection()
+	{
+		g_crc32cImplementation = getCrc32cImplementation();
+	}
+};
+}//anonymous namespace
+static Crc32cImplementationSelection g_crc32cImplementationSelection;
+
+static Crc32cImplementation crc32cImplementation()
+{
+	return g_crc32cImplementation;
+}
+
+DLL_PUBLIC uint32_t Crc32c::calc( const char* blk, std::size_t blksize)
+{
+	return crc32cImplementation()( blk, blksize);
+}
+
+DLL_PUBLIC uint32_t Crc32c::calc( const char* blk)
+{
+	return crc32cImplementation()( blk, strlen( blk));
+}
+
+DLL_PUBLIC bool Crc32c::hardwareSupported()
+{
+	return crc32cImplementation() != &crc32c_softwareImplementation;
+}
+
+DLL_PUBLIC bool Crc32c::selectHardware( bool hardware)
+{
+	if (!hardware)
+	{
+		g_crc32cImplementation = &crc32c_softwareImplementation;
+		return true;
+	}
+	Crc32cImplementation impl = getCrc32cImplementation();
+	if (impl == &crc32c_softwareImplementation) return false;
+	g_crc32cImplementation = impl;
+	return true;
+}
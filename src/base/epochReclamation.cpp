@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Epoch based reclamation of memory shared with lock free readers
+#include "strus/base/epochReclamation.hpp"
+#include "strus/base/dll_tags.hpp"
+#include "strus/base/sleep.hpp"
+#if __cplusplus < 201103L
+#include <boost/functional/hash.hpp>
+#endif
+
+using namespace strus;
+
+DLL_PUBLIC EpochReclamation::~EpochReclamation()
+{
+	std::vector<Retired>::const_iterator ri = m_retired.begin(), re = m_retired.end();
+	for (; ri != re; ++ri) ri->deleter( ri->ptr);
+}
+
+#if __cplusplus >= 201103L
+static strus::AtomicCounter<unsigned int> g_threadSlotCounter;
+#endif
+
+DLL_PUBLIC unsigned int EpochReclamation::threadSlot()
+{
+#if __cplusplus >= 201103L
+	//... threads get their slots assigned round robin
+	static thread_local unsigned int rt = g_threadSlotCounter.allocIncrement();
+	return rt;
+#else
+	return boost::hash<strus::ThreadId::Type>()( strus::ThreadId::get());
+#endif
+}
+
+DLL_PUBLIC bool EpochReclamation::tryAdvance()
+{
+	uint64_t epoch = m_epoch.load();
+	unsigned int prev = (epoch + 2) % 3;
+	for (int si=0; si<NofSlots; ++si)
+	{
+		if (m_slots[ si].counter[ prev].load() != 0) return false;
+	}
+	return m_epoch.compare_exchange_strong( epoch, epoch+1);
+}
+
+DLL_PUBLIC void EpochReclamation::freeRetired()
+{
+	if (tryAdvance()) tryAdvance();
+	uint64_t epoch = m_epoch.load();
+
+	std::vector<Retired>::iterator ri = m_retired.begin(), re = m_retired.end(), rn = m_retired.begin();
+	for (; ri != re; ++ri)
+	{
+		if (ri->epoch + 2 <= epoch)
+		{
+			ri->deleter( ri->ptr);
+		}
+		else
+		{
+			*rn++ = *ri;
+		}
+	}
+	m_retired.resize( rn - m_retired.begin(), Retired( 0, 0, 0));
+	m_lastCollectSize = m_retired.size();
+}
+
+DLL_PUBLIC void EpochReclamation::retire( void* ptr, Deleter deleter)
+{
+	strus::unique_lock lock( m_mutex);
+	try
+	{
+		m_retired.push_back( Retired( ptr, deleter, m_epoch.load()));
+	}
+	catch (const std::bad_alloc&)
+	{
+		//... wait till all readers that could see the object have left
+		uint64_t epoch = m_epoch.load() + 2;
+		while (m_epoch.load() < epoch)
+		{
+			if (!tryAdvance()) strus::usleep( 100);
+		}
+		deleter( ptr);
+		throw;
+	}
+	if (m_retired.size() >= m_lastCollectSize + m_batchSize)
+	{
+		freeRetired();
+	}
+}
+
+DLL_PUBLIC void EpochReclamation::collect()
+{
+	strus::unique_lock lock( m_mutex);
+	freeRetired();
+}
+
+DLL_PUBLIC std::size_t EpochReclamation::nofRetired() const
+{
+	strus::unique_lock lock( m_mutex);
+	return m_retired.size();
+}
+
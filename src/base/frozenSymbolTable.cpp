@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Immutable symbol table with a minimal perfect hash function built from a symbol table
+///\note The hash function follows "Hash, displace, and compress" by Belazzougui, Botelho and Dietzfelbinger (CHD):
+///	the keys are distributed into buckets with an average size of KeysPerBucket, the buckets are processed in descending order of their size.
+///	For each bucket a seed is searched that maps all its keys to free slots. Buckets with one key are stored directly with the index of a free slot.
+#include "strus/base/frozenSymbolTable.hpp"
+#include "strus/base/symbolTable.hpp"
+#include "strus/base/stringHash.hpp"
+#include "strus/base/dll_tags.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "private/internationalization.hpp"
+#include <cstring>
+#include <limits>
+#include <utility>
+
+using namespace strus;
+
+enum {
+	KeysPerBucket=4,		///< average number of keys in a bucket
+	DirectSlotFlag=0x80000000U,	///< flag marking a displacement as slot index of the only key in a bucket
+	MaxSeed=1<<24			///< maximum number of seeds tried for a bucket before giving up
+};
+
+static inline uint64_t keyHash( const char* key, std::size_t keylen)
+{
+	return StringHash::calc( key, keylen);
+}
+
+static inline uint32_t bucketIndex( uint64_t hash, uint32_t nofBuckets)
+{
+	return (uint32_t)(((hash & 0xffffFFFFU) * nofBuckets) >> 32);
+}
+
+static inline uint32_t slotIndex( uint64_t hash, uint32_t seed, uint32_t nofSlots)
+{
+	uint64_t xx = hash ^ ((uint64_t)seed * 0x9E3779B97F4A7C15);
+	xx ^= xx >> 33;
+	xx *= 0xff51afd7ed558ccd;
+	xx ^= xx >> 33;
+	return (uint32_t)(((xx >> 32) * nofSlots) >> 32);
+}
+
+DLL_PUBLIC bool FrozenSymbolTable::build( const SymbolTable& symtab)
+{
+	try
+	{
+		clear();
+		if (symtab.size() >= (std::size_t)DirectSlotFlag)
+		{
+			if (m_errorhnd) m_errorhnd->report( ErrorCodeMaxNofItemsExceeded, _TXT("too many symbols to build a frozen symbol table"));
+			return false;
+		}
+		uint32_t nofSymbols = symtab.size();
+		if (!nofSymbols) return true;
+		uint32_t nofBuckets = nofSymbols / KeysPerBucket + 1;
+
+		// [1] Copy the keys and calculate their hash values:
+		std::vector<uint32_t> offsets;
+		std::string strings;
+		std::vector<uint64_t> hashes;
+		offsets.reserve( nofSymbols + 1);
+		hashes.reserve( nofSymbols);
+		for (uint32_t id=1; id <= nofSymbols; ++id)
+		{
+			const char* keystr = symtab.key( id);
+			std::size_t keylen = symtab.keySize( id);
+			if (strings.size() + keylen + 1 > (std::size_t)std::numeric_limits<uint32_t>::max())
+			{
+				if (m_errorhnd) m_errorhnd->report( ErrorCodeMaxLimitReached, _TXT("keys too big to build a frozen symbol table"));
+				return false;
+			}
+			offsets.push_back( strings.size());
+			strings.append( keystr, keylen);
+			strings.push_back( '\0');
+			hashes.push_back( keyHash( keystr, keylen));
+		}
+		offsets.push_back( strings.size());
+
+		// [2] Distribute the keys into buckets (counting sort, keys of bucket bi are bucketKeys[ bucketStart[bi] .. bucketStart[bi+1]-1]):
+		std::vector<uint32_t> bucketStart( nofBuckets + 1, 0);
+		std::vector<uint32_t> bucketKeys( nofSymbols);
+		for (uint32_t ki=0; ki < nofSymbols; ++ki)
+		{
+			++bucketStart[ bucketIndex( hashes[ ki], nofBuckets) + 1];
+		}
+		uint32_t maxBucketSize = 0;
+		for (uint32_t bi=0; bi < nofBuckets; ++bi)
+		{
+			if (bucketStart[ bi+1] > maxBucketSize) maxBucketSize = bucketStart[ bi+1];
+			bucketStart[ bi+1] += bucketStart[ bi];
+		}
+		{
+			std::vector<uint32_t> fill( bucketStart.begin(), bucketStart.end()-1);
+			for (uint32_t ki=0; ki < nofSymbols; ++ki)
+			{
+				bucketKeys[ fill[ bucketIndex( hashes[ ki], nofBuckets)]++] = ki;
+			}
+		}
+		// [3] Order the buckets by descending size (counting sort):
+		std::vector<uint32_t> sizeStart( maxBucketSize + 2, 0);
+		std::vector<uint32_t> bucketOrder( nofBuckets);
+		for (uint32_t bi=0; bi < nofBuckets; ++bi)
+		{
+			++sizeStart[ maxBucketSize - (bucketStart[ bi+1] - bucketStart[ bi]) + 1];
+		}
+		for (uint32_t si=0; si <= maxBucketSize; ++si)
+		{
+			sizeStart[ si+1] += sizeStart[ si];
+		}
+		for (uint32_t bi=0; bi < nofBuckets; ++bi)
+		{
+			bucketOrder[ sizeStart[ maxBucketSize - (bucketStart[ bi+1] - bucketStart[ bi])]++] = bi;
+		}
+
+		// [4] Find the displacements of the buckets:
+		std::vector<uint32_t> displacements( nofBuckets, 0);
+		std::vector<uint32_t> slots( nofSymbols, 0);
+		std::vector<uint32_t> bucketSlots( maxBucketSize);
+		uint32_t freeSlotIdx = 0;
+		std::vector<uint32_t>::const_iterator oi = bucketOrder.begin(), oe = bucketOrder.end();
+		for (; oi != oe; ++oi)
+		{
+			uint32_t const* bkeys = &bucketKeys[0] + bucketStart[ *oi];
+			uint32_t bsize = bucketStart[ *oi+1] - bucketStart[ *oi];
+			if (bsize == 0)
+			{
+				break;
+			}
+			else if (bsize == 1)
+			{
+				while (slots[ freeSlotIdx]) ++freeSlotIdx;
+				slots[ freeSlotIdx] = bkeys[0] + 1;
+				displacements[ *oi] = freeSlotIdx | DirectSlotFlag;
+				continue;
+			}
+			uint32_t seed = 0;
+			for (; seed < (uint32_t)MaxSeed; ++seed)
+			{
+				uint32_t bi = 0;
+				for (; bi < bsize; ++bi)
+				{
+					uint32_t slotidx = slotIndex( hashes[ bkeys[ bi]], seed, nofSymbols);
+					if (slots[ slotidx]) break;
+					slots[ slotidx] = bkeys[ bi] + 1;
+					bucketSlots[ bi] = slotidx;
+				}
+				if (bi == bsize) break;
+				while (bi > 0) slots[ bucketSlots[ --bi]] = 0;
+			}
+			if (seed == (uint32_t)MaxSeed)
+			{
+				if (m_errorhnd) m_errorhnd->report( ErrorCodeRuntimeError, _TXT("failed to build perfect hash function for frozen symbol table (keys with equal hash values)"));
+				return false;
+			}
+			displacements[ *oi] = seed;
+		}
+
+		// [5] Assign the result:
+		m_nofSymbols = nofSymbols;
+		m_displacements.swap( displacements);
+		m_slots.swap( slots);
+		m_offsets.swap( offsets);
+		m_strings.swap( strings);
+		return true;
+	}
+	catch (const std::bad_alloc&)
+	{
+		clear();
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeOutOfMem, _TXT("out of memory"));
+		return false;
+	}
+}
+
+DLL_PUBLIC uint32_t FrozenSymbolTable::get( const std::string& key_) const
+{
+	return get( key_.c_str(), key_.size());
+}
+
+DLL_PUBLIC uint32_t FrozenSymbolTable::get( const char* keystr, std::size_t keylen) const
+{
+	if (!m_nofSymbols) return 0;
+	uint64_t hash = keyHash( keystr, keylen);
+	uint32_t disp = m_displacements[ bucketIndex( hash, m_displacements.size())];
+	uint32_t slotidx = (disp & DirectSlotFlag) ? (disp & ~(uint32_t)DirectSlotFlag) : slotIndex( hash, disp, m_nofSymbols);
+	uint32_t id = m_slots[ slotidx];
+	uint32_t start = m_offsets[ id-1];
+	if (m_offsets[ id] - start == keylen + 1 && 0==std::memcmp( m_strings.c_str() + start, keystr, keylen))
+	{
+		return id;
+	}
+	return 0;
+}
+
+DLL_PUBLIC const char* FrozenSymbolTable::key( const uint32_t& id) const
+{
+	if (!id || id > m_nofSymbols) return 0;
+	return m_strings.c_str() + m_offsets[ id-1];
+}
+
+DLL_PUBLIC std::size_t FrozenSymbolTable::keySize( const uint32_t& id) const
+{
+	if (!id || id > m_nofSymbols) return 0;
+	return m_offsets[ id] - m_offsets[ id-1] - 1;
+}
+
+DLL_PUBLIC std::size_t FrozenSymbolTable::memoryUsage() const
+{
+	return (m_displacements.size() + m_slots.size() + m_offsets.size()) * sizeof(uint32_t) + m_strings.size();
+}
+
+DLL_PUBLIC void FrozenSymbolTable::clear()
+{
+	m_nofSymbols = 0;
+	std::vector<uint32_t>().swap( m_displacements);
+	std::vector<uint32_t>().swap( m_slots);
+	std::vector<uint32_t>().swap( m_offsets);
+	std::string().swap( m_strings);
+}
+
+DLL_PUBLIC void FrozenSymbolTable::swap( FrozenSymbolTable& o)
+{
+	std::swap( m_errorhnd, o.m_errorhnd);
+	std::swap( m_nofSymbols, o.m_nofSymbols);
+	m_displacements.swap( o.m_displacements);
+	m_slots.swap( o.m_slots);
+	m_offsets.swap( o.m_offsets);
+	m_strings.swap( o.m_strings);
+}
+
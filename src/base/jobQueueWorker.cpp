@@ -11,10 +11,24 @@
 #include "strus/base/atomic.hpp"
 #include "strus/base/bitset.hpp"
 #include "strus/base/thread.hpp"
-#include <queue>
+#include "strus/base/platform.hpp"
+#include "strus/base/timerWheel.hpp"
+#include <deque>
 #include <ctime>
+#include <map>
+#include <limits>
+#include <vector>
+#include <cerrno>
 #include <unistd.h>
 #include <fcntl.h>
+#if __cplusplus < 201103L
+#include <boost/thread/tss.hpp>
+#endif
+#if defined __linux__
+#define STRUS_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 #undef USE_CPP_CHRONO
 #if __cplusplus >= 201103L
@@ -39,6 +53,31 @@ namespace pte = boost;
 
 using namespace strus;
 
+enum {JobBatchSize=64};	///< maximum number of jobs executed by the event thread before looking for termination
+
+/// \brief Marks of the current thread as consumer of a worker
+struct ThreadMarker
+{
+	const void* pool;		///< pool the current thread is a worker of, for queueing jobs pushed by jobs in the queue of the thread executing them
+	int workerIdx;			///< index of the current thread in its pool
+	const void* eventThread;	///< worker data of the event thread the current thread is, for not blocking it when pushing to a full queue
+
+	ThreadMarker()
+		:pool(0),workerIdx(-1),eventThread(0){}
+};
+
+static ThreadMarker& currentThreadMarker()
+{
+#if __cplusplus >= 201103L
+	static thread_local ThreadMarker rt;
+	return rt;
+#else
+	static boost::thread_specific_ptr<ThreadMarker> g_marker;
+	if (!g_marker.get()) g_marker.reset( new ThreadMarker());
+	return *g_marker;
+#endif
+}
+
 struct JobQueueWorker::Data
 {
 	struct FdSet
@@ -48,12 +87,12 @@ struct JobQueueWorker::Data
 		fd_set excep;
 		struct timeval timeout;
 
-		FdSet( int timeout_secs)
+		FdSet()
 		{
 			FD_ZERO( &read);
 			FD_ZERO( &write);
 			FD_ZERO( &excep);
-			timeout.tv_sec = timeout_secs;
+			timeout.tv_sec = 0;
 			timeout.tv_usec = 0;
 		}
 		FdSet( const FdSet& o)
@@ -84,7 +123,25 @@ struct JobQueueWorker::Data
 			{proc=o.proc; deleter=o.deleter; context=o.context; refcnt=o.refcnt; return *this;}
 	};
 
+	/// \brief Interface of the implementation of waiting for file descriptor events of listeners
+	struct FdEventHandler
+	{
+		virtual ~FdEventHandler(){}
+		/// \brief Wake up the thread waiting for events
+		virtual bool notify()=0;
+		/// \brief Define a listener for events on a file descriptor
+		virtual bool defineListener( JobHandlerProc proc, JobDeleterProc deleter, void* context, int fh, int fdTypeMask)=0;
+		/// \brief Delete the listeners for events on a file descriptor
+		virtual bool deleteListener( int fh, int fdTypeMask)=0;
+		/// \brief Wait for events and call the listeners of the file descriptors ready
+		/// \param[in] timeout_ms maximum time to wait in milliseconds
+		/// \return true if woken up by notify or by a file descriptor event, false on timeout or error
+		virtual bool wait( int timeout_ms)=0;
+	};
+
+	/// \brief Waiting for file descriptor events with select, portable but limited to FD_SETSIZE file descriptors and MaxNofJobs listeners
 	struct SelectFdData
+		:public FdEventHandler
 	{
 		FdSet fdset;
 		int nofd;
@@ -97,8 +154,8 @@ struct JobQueueWorker::Data
 		SelectJobStruct jobs[MaxNofJobs];
 		int nofJobs;
 
-		SelectFdData( int timeout_secs)
-			:fdset( timeout_secs),nofJobs(0)
+		SelectFdData()
+			:fdset(),nofJobs(0)
 		{
 			pipfd[0] = 0;
 			pipfd[1] = 0;
@@ -124,13 +181,13 @@ struct JobQueueWorker::Data
 			close( pipfd[1]);
 			throw std::bad_alloc();
 		}
-		~SelectFdData()
+		virtual ~SelectFdData()
 		{
 			close( pipfd[0]);
 			close( pipfd[1]);
 		}
 
-		bool notify()
+		virtual bool notify()
 		{
 			int sz;
 			do {
@@ -195,9 +252,9 @@ struct JobQueueWorker::Data
 			}
 		}
 
-		bool defineListener( JobHandlerProc proc, JobDeleterProc deleter, void* context, int fh, int fdTypeMask)
+		virtual bool defineListener( JobHandlerProc proc, JobDeleterProc deleter, void* context, int fh, int fdTypeMask)
 		{
-			if (fh >= FD_SETSIZE) return false;
+			if (fh < 0 || fh >= FD_SETSIZE) return false;
 
 			// [1] Find free job handle:
 			unsigned char jobhnd = allocJobHandle( proc, deleter, context);
@@ -224,9 +281,9 @@ struct JobQueueWorker::Data
 			}
 		}
 
-		bool deleteListener( int fh, int fdTypeMask)
+		virtual bool deleteListener( int fh, int fdTypeMask)
 		{
-			if (fh >= FD_SETSIZE) return false;
+			if (fh < 0 || fh >= FD_SETSIZE) return false;
 
 			if (!fdTypeMask)
 			{
@@ -258,13 +315,15 @@ struct JobQueueWorker::Data
 			return true;
 		}
 
-		bool wait()
+		virtual bool wait( int timeout_ms)
 		{
 			bool gotSignal = false;
 			bitset<MaxNofJobs> hndset;
 
 			int ready;
 			FdSet fs = fdset;
+			fs.timeout.tv_sec = timeout_ms / 1000;
+			fs.timeout.tv_usec = (timeout_ms % 1000) * 1000;
 			while ((ready = ::select( nofd, &fs.read, &fs.write, &fs.excep, &fs.timeout)) == -1 && errno == EINTR)
 			{
 				continue;
@@ -289,11 +348,307 @@ struct JobQueueWorker::Data
 			gotSignal |= (hnd >= 0);
 			for (; hnd >= 0; hnd = hndset.next( hnd))
 			{
-				jobs[ hnd].proc( jobs[ hnd].context);
+				jobs[ hnd-1].proc( jobs[ hnd-1].context);
+			}
+			return gotSignal;
+		}
+	};
+
+#ifdef STRUS_USE_EPOLL
+	/// \brief Waiting for file descriptor events with epoll (level triggered), without limits of the number of file descriptors or listeners
+	/// \note Listener calls are dispatched only for the file descriptors ready, the thread is woken up with an eventfd
+	struct EpollFdData
+		:public FdEventHandler
+	{
+		enum {MaxNofEvents=256};
+		enum {TypeRead=0,TypeWrite=1,TypeExcept=2,NofTypes=3};
+
+		struct FdEntry
+		{
+			int jobhnd[ NofTypes];	///< job handle (index + 1) of the listener for each type of event, 0 if not defined
+			bool registered;	///< true, if the file descriptor is registered in epoll
+
+			FdEntry() :registered(false)
+			{
+				jobhnd[ TypeRead] = 0;
+				jobhnd[ TypeWrite] = 0;
+				jobhnd[ TypeExcept] = 0;
+			}
+		};
+
+		struct JobKey
+		{
+			JobHandlerProc proc;
+			JobDeleterProc deleter;
+			void* context;
+
+			JobKey( JobHandlerProc proc_, JobDeleterProc deleter_, void* context_)
+				:proc(proc_),deleter(deleter_),context(context_){}
+			JobKey( const JobKey& o)
+				:proc(o.proc),deleter(o.deleter),context(o.context){}
+
+			bool operator < ( const JobKey& o) const
+			{
+				if (proc != o.proc) return (void*)proc < (void*)o.proc;
+				if (context != o.context) return context < o.context;
+				return (void*)deleter < (void*)o.deleter;
+			}
+		};
+
+		EpollFdData()
+			:epfd(-1),evfd(-1),stamp(0)
+		{
+			epfd = ::epoll_create1( EPOLL_CLOEXEC);
+			if (epfd == -1) throw std::bad_alloc();
+			evfd = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (evfd == -1) goto ERROR;
+			{
+				struct epoll_event ev;
+				std::memset( &ev, 0, sizeof(ev));
+				ev.events = EPOLLIN;
+				ev.data.fd = evfd;
+				if (::epoll_ctl( epfd, EPOLL_CTL_ADD, evfd, &ev) == -1) goto ERROR;
+			}
+			return;
+		ERROR:
+			if (evfd != -1) ::close( evfd);
+			::close( epfd);
+			throw std::bad_alloc();
+		}
+		virtual ~EpollFdData()
+		{
+			::close( evfd);
+			::close( epfd);
+		}
+
+		virtual bool notify()
+		{
+			uint64_t one = 1;
+			return ::write( evfd, &one, sizeof(one)) == (ssize_t)sizeof(one) || errno == EAGAIN;
+		}
+
+		int allocJobHandle( JobHandlerProc proc, JobDeleterProc deleter, void* context)
+		{
+			JobKey key( proc, deleter, context);
+			std::map<JobKey,int>::const_iterator mi = jobIndex.find( key);
+			if (mi != jobIndex.end()) return mi->second;
+			int jobhnd;
+			if (freeJobs.empty())
+			{
+				jobs.push_back( SelectJobStruct( proc, deleter, context));
+				jobStamps.push_back( 0);
+				jobhnd = jobs.size();
+			}
+			else
+			{
+				jobhnd = freeJobs.back();
+				freeJobs.pop_back();
+				jobs[ jobhnd-1] = SelectJobStruct( proc, deleter, context);
+				jobStamps[ jobhnd-1] = 0;
+			}
+			jobs[ jobhnd-1].refcnt = 0;
+			try
+			{
+				jobIndex[ key] = jobhnd;
+			}
+			catch (...)
+			{
+				jobs[ jobhnd-1] = SelectJobStruct();
+				freeJobs.push_back( jobhnd);
+				throw;
+			}
+			return jobhnd;
+		}
+
+		void releaseJobHandle( int jobhnd)
+		{
+			SelectJobStruct& job = jobs[ jobhnd-1];
+			if (--job.refcnt == 0)
+			{
+				jobIndex.erase( JobKey( job.proc, job.deleter, job.context));
+				if (job.deleter && job.context)
+				{
+					job.deleter( job.context);
+				}
+				job = SelectJobStruct();
+				freeJobs.push_back( jobhnd);
+			}
+		}
+
+		static uint32_t epollEvents( const FdEntry& entry)
+		{
+			return (entry.jobhnd[ TypeRead] ? EPOLLIN : 0)
+				| (entry.jobhnd[ TypeWrite] ? EPOLLOUT : 0)
+				| (entry.jobhnd[ TypeExcept] ? EPOLLPRI : 0);
+		}
+
+		bool updateRegistration( int fh, FdEntry& entry)
+		{
+			struct epoll_event ev;
+			std::memset( &ev, 0, sizeof(ev));
+			ev.events = epollEvents( entry);
+			ev.data.fd = fh;
+			if (!ev.events)
+			{
+				if (entry.registered)
+				{
+					//... errors are ignored, the file descriptor might have been closed already
+					(void)::epoll_ctl( epfd, EPOLL_CTL_DEL, fh, &ev);
+					entry.registered = false;
+				}
+				return true;
+			}
+			if (::epoll_ctl( epfd, entry.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fh, &ev) == -1)
+			{
+				return false;
+			}
+			entry.registered = true;
+			return true;
+		}
+
+		void clrJob( FdEntry& entry, int type)
+		{
+			if (entry.jobhnd[ type])
+			{
+				releaseJobHandle( entry.jobhnd[ type]);
+				entry.jobhnd[ type] = 0;
+			}
+		}
+
+		virtual bool defineListener( JobHandlerProc proc, JobDeleterProc deleter, void* context, int fh, int fdTypeMask)
+		{
+			if (fh < 0 || fh == evfd) return false;
+			try
+			{
+				if ((std::size_t)fh >= fdmap.size()) fdmap.resize( fh+1);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return false;
+			}
+			FdEntry& entry = fdmap[ fh];
+			FdEntry prev = entry;
+
+			// [1] Find or allocate job handle:
+			int jobhnd;
+			try
+			{
+				jobhnd = allocJobHandle( proc, deleter, context);
+			}
+			catch (const std::bad_alloc&)
+			{
+				return false;
+			}
+			// [2] Initialize listener:
+			++jobs[ jobhnd-1].refcnt; //... hold the job while replacing listeners
+			int types[ NofTypes] = {FdRead,FdWrite,FdExcept};
+			for (int ti=0; ti < NofTypes; ++ti)
+			{
+				if ((fdTypeMask & types[ ti]) == types[ ti] && entry.jobhnd[ ti] != jobhnd)
+				{
+					++jobs[ jobhnd-1].refcnt;
+					if (entry.jobhnd[ ti]) releaseJobHandle( entry.jobhnd[ ti]);
+					entry.jobhnd[ ti] = jobhnd;
+				}
+			}
+			// [3] Register the file descriptor:
+			bool rt = updateRegistration( fh, entry);
+			if (!rt)
+			{
+				for (int ti=0; ti < NofTypes; ++ti)
+				{
+					if (entry.jobhnd[ ti] != prev.jobhnd[ ti]) clrJob( entry, ti);
+				}
+			}
+			releaseJobHandle( jobhnd);
+			return rt;
+		}
+
+		virtual bool deleteListener( int fh, int fdTypeMask)
+		{
+			if (fh < 0) return false;
+			if ((std::size_t)fh >= fdmap.size()) return true;
+			FdEntry& entry = fdmap[ fh];
+			if (!fdTypeMask || (fdTypeMask & FdRead) == FdRead) clrJob( entry, TypeRead);
+			if (!fdTypeMask || (fdTypeMask & FdWrite) == FdWrite) clrJob( entry, TypeWrite);
+			if (!fdTypeMask || (fdTypeMask & FdExcept) == FdExcept) clrJob( entry, TypeExcept);
+			return updateRegistration( fh, entry);
+		}
+
+		void addReady( int jobhnd)
+		{
+			if (jobhnd && jobStamps[ jobhnd-1] != stamp)
+			{
+				//... each listener is called only once per wakeup
+				jobStamps[ jobhnd-1] = stamp;
+				ready.push_back( jobhnd);
+			}
+		}
+
+		virtual bool wait( int timeout_ms)
+		{
+			bool gotSignal = false;
+			int nofEvents;
+			while ((nofEvents = ::epoll_wait( epfd, events, MaxNofEvents, timeout_ms)) == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			if (nofEvents == -1) return false;
+			++stamp;
+			ready.clear();
+			for (int ei=0; ei < nofEvents; ++ei)
+			{
+				int fh = events[ ei].data.fd;
+				uint32_t evmask = events[ ei].events;
+				if (fh == evfd)
+				{
+					uint64_t cnt;
+					while (::read( evfd, &cnt, sizeof(cnt)) == -1 && errno == EINTR){}
+					gotSignal = true;
+					continue;
+				}
+				if ((std::size_t)fh >= fdmap.size()) continue;
+				const FdEntry& entry = fdmap[ fh];
+				if (evmask & (EPOLLIN | EPOLLHUP | EPOLLERR)) addReady( entry.jobhnd[ TypeRead]);
+				if (evmask & (EPOLLOUT | EPOLLERR)) addReady( entry.jobhnd[ TypeWrite]);
+				if (evmask & EPOLLPRI) addReady( entry.jobhnd[ TypeExcept]);
+			}
+			gotSignal |= !ready.empty();
+			std::vector<int>::const_iterator ri = ready.begin(), re = ready.end();
+			for (; ri != re; ++ri)
+			{
+				jobs[ *ri-1].proc( jobs[ *ri-1].context);
 			}
 			return gotSignal;
 		}
+
+		int epfd;
+		int evfd;
+		unsigned int stamp;			///< counter of wakeups for calling listeners only once per wakeup
+		std::vector<FdEntry> fdmap;		///< listeners indexed by file descriptor
+		std::vector<SelectJobStruct> jobs;	///< listeners indexed by job handle - 1
+		std::vector<unsigned int> jobStamps;	///< wakeup a listener was called last, indexed by job handle - 1
+		std::vector<int> freeJobs;		///< job handles free for reuse
+		std::map<JobKey,int> jobIndex;		///< map of listeners to job handles
+		std::vector<int> ready;			///< job handles of listeners to call in the current wakeup
+		struct epoll_event events[ MaxNofEvents];
 	};
+#endif
+
+	static FdEventHandler* createFdEventHandler()
+	{
+#ifdef STRUS_USE_EPOLL
+		try
+		{
+			return new EpollFdData();
+		}
+		catch (const std::bad_alloc&)
+		{
+			//... fallback to select
+		}
+#endif
+		return new SelectFdData();
+	}
 
 	struct Ticker
 	{
@@ -307,14 +662,14 @@ struct JobQueueWorker::Data
 
 	struct Job
 	{
-		Job() :proc(0),deleter(0),context(0),fh(0),fdTypeMask(0){}
-		Job( JobHandlerProc proc_, void* context_, JobDeleterProc deleter_) :proc(proc_),deleter(deleter_),context(context_),fh(0),fdTypeMask(0){}
-		Job( JobHandlerProc proc_, void* context_, JobDeleterProc deleter_, int fh_, int fdTypeMask_) :proc(proc_),deleter(deleter_),context(context_),fh(fh_),fdTypeMask(fdTypeMask_){}
-		Job( const Job& o) :proc(o.proc),deleter(o.deleter),context(o.context),fh(o.fh),fdTypeMask(o.fdTypeMask){}
+		Job() :proc(0),deleter(0),context(0),fh(0),fdTypeMask(0),listener(false),priority(PriorityNormal),enqueueTime(0){}
+		Job( JobHandlerProc proc_, void* context_, JobDeleterProc deleter_, JobPriority priority_) :proc(proc_),deleter(deleter_),context(context_),fh(0),fdTypeMask(0),listener(false),priority(priority_),enqueueTime(0){}
+		Job( JobHandlerProc proc_, void* context_, JobDeleterProc deleter_, int fh_, int fdTypeMask_) :proc(proc_),deleter(deleter_),context(context_),fh(fh_),fdTypeMask(fdTypeMask_),listener(true),priority(PriorityHigh),enqueueTime(0){}
+		Job( const Job& o) :proc(o.proc),deleter(o.deleter),context(o.context),fh(o.fh),fdTypeMask(o.fdTypeMask),listener(o.listener),priority(o.priority),enqueueTime(o.enqueueTime){}
 
 		bool isListener()
 		{
-			return !!fdTypeMask;
+			return listener;
 		}
 
 		JobHandlerProc proc;
@@ -322,46 +677,820 @@ struct JobQueueWorker::Data
 		void* context;
 		FileHandle fh;
 		int fdTypeMask;
+		bool listener;		///< true for a job defining or deleting a listener (fdTypeMask 0 deletes all listeners of fh)
+		JobPriority priority;	///< priority class, listener definitions are queued with the highest priority
+		uint64_t enqueueTime;	///< time of the push in microseconds (steady clock), for the statistics of the wait time
+	};
+
+	/// \brief Job linked in a queue
+	struct JobNode
+		:public Job
+	{
+		explicit JobNode( const Job& job_) :Job(job_),next(0){}
+		JobNode() :Job(),next(0){}
+
+		strus::atomic<JobNode*> next;
+	};
+
+	/// \brief Intrusive lock free queue of jobs with many producers and one consumer (after Dmitry Vyukov)
+	/// \note A push costs one atomic exchange and one store, the consumer does not write to memory shared with producers except when it runs empty
+	struct JobQueue
+	{
+		JobQueue() :head(&stub),tail(&stub),stub(){}
+		~JobQueue()
+		{
+			JobNode* node;
+			while (0!=(node = pop())) delete node;
+		}
+
+		/// \brief Push a job, called by any thread
+		void push( JobNode* node)
+		{
+			node->next.store( 0);
+			JobNode* prev = head.exchange( node);
+			//... the queue is not linked between exchange and store, the consumer sees the node after the store
+			prev->next.store( node);
+		}
+
+		/// \brief Pop the next job, called by the consumer only
+		/// \return the job or NULL if the queue is empty or a push is in progress
+		JobNode* pop()
+		{
+			JobNode* tl = tail;
+			JobNode* next = tl->next.load();
+			if (tl == &stub)
+			{
+				if (!next) return 0;
+				tail = next;
+				tl = next;
+				next = next->next.load();
+			}
+			if (next)
+			{
+				tail = next;
+				return tl;
+			}
+			if (tl != head.load()) return 0;
+			push( &stub);
+			next = tl->next.load();
+			if (next)
+			{
+				tail = next;
+				return tl;
+			}
+			return 0;
+		}
+
+		/// \brief Test if the queue is empty, called by the consumer only
+		/// \note A push in progress is seen as not empty
+		bool empty() const
+		{
+			return tail == &stub && head.load() == &stub;
+		}
+
+	private:
+		strus::atomic<JobNode*> head;
+		char pad[ platform::CacheLineSize];	///< avoid false sharing between producers and the consumer
+		JobNode* tail;
+		JobNode stub;
+	};
+
+	/// \brief Admission control and metrics of the jobs queued, shared by the event thread queue and the pool
+	/// \note Counts only jobs, listener definitions are not limited
+	struct QueueMetrics
+	{
+		/// \brief Counters of the jobs of a priority class
+		struct PriorityCounters
+		{
+			strus::atomic<uint64_t> nofEnqueued;
+			strus::atomic<uint64_t> nofDequeued;
+			strus::atomic<uint64_t> nofRemoved;	///< number of jobs removed without execution (dropped or deleted on stop)
+			strus::atomic<uint64_t> totalWaitTime;	///< sum of the wait times of the jobs dequeued in microseconds
+			strus::atomic<uint64_t> maxWaitTime;	///< longest wait time of a job in microseconds
+			uint64_t sampleDequeued;		///< number of jobs dequeued at the start of the current measuring interval
+			uint64_t sampleWaitTime;		///< total wait time at the start of the current measuring interval
+			double avgWaitTime;			///< result of the last measuring interval
+
+			PriorityCounters()
+				:nofEnqueued(0),nofDequeued(0),nofRemoved(0),totalWaitTime(0),maxWaitTime(0)
+				,sampleDequeued(0),sampleWaitTime(0),avgWaitTime(0.0){}
+		};
+
+		QueueMetrics()
+			:capacity(0),policy(OverflowReject)
+			,depth(0),maxDepth(0),nofRejected(0),nofDropped(0),nofBlocked(0)
+			,nofWaiting(0),space_cv(),space_mutex(),closed(false)
+			,sample_mutex(),sampled(false),sampleTime(clockMicroseconds()),sampleEnqueued(0)
+			,enqueueRate(0.0),avgWaitTime(0.0){}
+
+		static uint64_t clockMicroseconds()
+		{
+			return pte::chrono::duration_cast<pte::chrono::microseconds>( pte::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		/// \brief Try to reserve space for a job
+		/// \return true if the job can be queued
+		bool tryAdmit( JobPriority priority)
+		{
+			if (!capacity)
+			{
+				admitted( priority, depth.fetch_add( 1) + 1);
+				return true;
+			}
+			std::size_t dp = depth.load();
+			while (dp < capacity)
+			{
+				if (depth.compare_exchange_weak( dp, dp + 1))
+				{
+					admitted( priority, dp + 1);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/// \brief Reserve space for a job even if the queue is full
+		void forceAdmit( JobPriority priority)
+		{
+			admitted( priority, depth.fetch_add( 1) + 1);
+		}
+
+		/// \brief Wait until there is space for a job and reserve it
+		/// \return false if the queue has been closed in the meantime
+		bool waitAdmit( JobPriority priority)
+		{
+			nofBlocked.fetch_add( 1);
+			strus::unique_lock lock( space_mutex);
+			//... announce waiting before testing, a consumer either sees the waiter or the waiter sees the space freed
+			nofWaiting.fetch_add( 1);
+			while (!tryAdmit( priority))
+			{
+				if (closed.test())
+				{
+					nofWaiting.fetch_sub( 1);
+					return false;
+				}
+				space_cv.wait( lock);
+			}
+			nofWaiting.fetch_sub( 1);
+			return true;
+		}
+
+		/// \brief Release the space of a job taken from the queue for execution
+		void dequeued( const Job& job)
+		{
+			PriorityCounters& cnt = classes[ job.priority];
+			uint64_t waitTime = clockMicroseconds() - job.enqueueTime;
+			cnt.totalWaitTime.fetch_add( waitTime);
+			uint64_t mx = cnt.maxWaitTime.load();
+			while (waitTime > mx && !cnt.maxWaitTime.compare_exchange_weak( mx, waitTime)){}
+			cnt.nofDequeued.fetch_add( 1);
+			release();
+		}
+
+		/// \brief Release the space of a job removed from the queue without execution
+		void removed( const Job& job, bool dropped)
+		{
+			if (dropped) nofDropped.fetch_add( 1);
+			classes[ job.priority].nofRemoved.fetch_add( 1);
+			release();
+		}
+
+		void reject()
+		{
+			nofRejected.fetch_add( 1);
+		}
+
+		/// \brief Wake up all producers waiting for space, called on stop
+		void close()
+		{
+			closed.set( true);
+			strus::unique_lock lock( space_mutex);
+			space_cv.notify_all();
+		}
+
+		void open()
+		{
+			closed.set( false);
+		}
+
+		QueueStatistics statistics()
+		{
+			QueueStatistics rt;
+			rt.capacity = capacity;
+			rt.depth = depth.load();
+			rt.maxDepth = maxDepth.load();
+			rt.nofRejected = nofRejected.load();
+			rt.nofDropped = nofDropped.load();
+			rt.nofBlocked = nofBlocked.load();
+			uint64_t waitTime[ NofJobPriorities];
+			uint64_t totalWaitTime = 0;
+			uint64_t maxWaitTime = 0;
+			for (int pi=0; pi < NofJobPriorities; ++pi)
+			{
+				PriorityStatistics& st = rt.priority[ pi];
+				st.nofDequeued = classes[ pi].nofDequeued.load();
+				//... load the counters in reverse order of their updates, so that the depth calculated is not negative
+				uint64_t nofRemoved = classes[ pi].nofRemoved.load();
+				st.nofEnqueued = classes[ pi].nofEnqueued.load();
+				st.depth = st.nofEnqueued - st.nofDequeued - nofRemoved;
+				uint64_t mx = classes[ pi].maxWaitTime.load();
+				st.maxWaitTime = mx / 1000.0;
+				waitTime[ pi] = classes[ pi].totalWaitTime.load();
+
+				rt.nofEnqueued += st.nofEnqueued;
+				rt.nofDequeued += st.nofDequeued;
+				totalWaitTime += waitTime[ pi];
+				if (mx > maxWaitTime) maxWaitTime = mx;
+			}
+			rt.maxWaitTime = maxWaitTime / 1000.0;
+			uint64_t now = clockMicroseconds();
+
+			strus::unique_lock lock( sample_mutex);
+			//... the values of the last complete interval are reported, the values of the current one before the first interval is complete
+			if (now > sampleTime && (now >= sampleTime + 1000000 || !sampled))
+			{
+				bool completed = now >= sampleTime + 1000000;
+				enqueueRate = (double)(rt.nofEnqueued - sampleEnqueued) * 1000000.0 / (double)(now - sampleTime);
+				uint64_t nofDequeuedInterval = 0;
+				uint64_t waitTimeInterval = 0;
+				for (int pi=0; pi < NofJobPriorities; ++pi)
+				{
+					PriorityCounters& cnt = classes[ pi];
+					uint64_t nofDequeuedClass = rt.priority[ pi].nofDequeued - cnt.sampleDequeued;
+					uint64_t waitTimeClass = waitTime[ pi] - cnt.sampleWaitTime;
+					cnt.avgWaitTime = nofDequeuedClass ? (double)waitTimeClass / (nofDequeuedClass * 1000.0) : 0.0;
+					nofDequeuedInterval += nofDequeuedClass;
+					waitTimeInterval += waitTimeClass;
+					if (completed)
+					{
+						cnt.sampleDequeued = rt.priority[ pi].nofDequeued;
+						cnt.sampleWaitTime = waitTime[ pi];
+					}
+				}
+				avgWaitTime = nofDequeuedInterval ? (double)waitTimeInterval / (nofDequeuedInterval * 1000.0) : 0.0;
+				if (completed)
+				{
+					sampled = true;
+					sampleTime = now;
+					sampleEnqueued = rt.nofEnqueued;
+				}
+			}
+			rt.enqueueRate = enqueueRate;
+			rt.avgWaitTime = avgWaitTime;
+			for (int pi=0; pi < NofJobPriorities; ++pi)
+			{
+				rt.priority[ pi].avgWaitTime = classes[ pi].avgWaitTime;
+			}
+			return rt;
+		}
+
+	private:
+		void admitted( JobPriority priority, std::size_t dp)
+		{
+			classes[ priority].nofEnqueued.fetch_add( 1);
+			std::size_t mx = maxDepth.load();
+			while (dp > mx && !maxDepth.compare_exchange_weak( mx, dp)){}
+		}
+
+		void release()
+		{
+			depth.fetch_sub( 1);
+			if (nofWaiting.load() > 0)
+			{
+				strus::unique_lock lock( space_mutex);
+				space_cv.notify_one();
+			}
+		}
+
+	public:
+		std::size_t capacity;			///< maximum number of jobs queued, 0 for no limit, only changed when the worker is stopped
+		OverflowPolicy policy;
+
+	private:
+		strus::atomic<std::size_t> depth;
+		strus::atomic<std::size_t> maxDepth;
+		strus::atomic<uint64_t> nofRejected;
+		strus::atomic<uint64_t> nofDropped;
+		strus::atomic<uint64_t> nofBlocked;
+		PriorityCounters classes[ NofJobPriorities];
+		strus::atomic<int> nofWaiting;		///< number of producers waiting for space
+		strus::condition_variable space_cv;
+		strus::mutex space_mutex;
+		AtomicFlag closed;
+		strus::mutex sample_mutex;		///< protects the members of the measuring interval below and in classes
+		bool sampled;				///< true if a measuring interval has been completed
+		uint64_t sampleTime;			///< start of the current measuring interval in microseconds
+		uint64_t sampleEnqueued;
+		double enqueueRate;			///< result of the last measuring interval
+		double avgWaitTime;			///< result of the last measuring interval
 	};
 
-	explicit Data( int secondsPeriod_, bool useFdSelect)
+	/// \brief Pool of threads with a job queue for each thread, idle threads steal jobs from the queues of the others
+	struct WorkerPool
+	{
+		struct Worker
+		{
+			strus::mutex mutex;
+			std::deque<Job> deque[ NofJobPriorities];	///< jobs queued for each priority class
+			strus::thread* thread;
+			char pad[ platform::CacheLineSize];	///< avoid false sharing of the mutexes of different workers
+
+			Worker() :mutex(),thread(0){}
+		};
+
+		WorkerPool( int nofWorkers_, int secondsPeriod_, QueueMetrics* metrics_)
+			:workers(0),nofWorkers(nofWorkers_ > 0 ? nofWorkers_ : 1)
+			,secondsPeriod(secondsPeriod_ > 0 ? secondsPeriod_ : 1)
+			,idle_cv(),idle_mutex(),nofQueued(0),nofIdle(0),nextWorker(0),terminate(false),metrics(metrics_)
+		{
+			for (int pi=0; pi < NofJobPriorities; ++pi) nofQueuedPriority[ pi].store( 0);
+			workers = new Worker[ nofWorkers];
+		}
+		~WorkerPool()
+		{
+			stop();
+			delete [] workers;
+		}
+
+		int currentWorkerIndex() const
+		{
+			const ThreadMarker& marker = currentThreadMarker();
+			return marker.pool == this ? marker.workerIdx : -1;
+		}
+
+		void push( const Job& job)
+		{
+			int widx = currentWorkerIndex();
+			if (widx < 0) widx = nextWorker.allocIncrement() % (unsigned int)nofWorkers;
+			{
+				strus::unique_lock lock( workers[ widx].mutex);
+				workers[ widx].deque[ job.priority].push_back( job);
+			}
+			nofQueuedPriority[ job.priority].fetch_add( 1);
+			// ... counters with sequential consistency: either the pusher sees an idle thread or the idle thread sees the job
+			nofQueued.fetch_add( 1);
+			if (nofIdle.load() > 0)
+			{
+				strus::unique_lock lock( idle_mutex);
+				idle_cv.notify_one();
+			}
+		}
+
+		bool popOwn( int widx, int priority, Job& job)
+		{
+			strus::unique_lock lock( workers[ widx].mutex);
+			std::deque<Job>& deque = workers[ widx].deque[ priority];
+			if (deque.empty()) return false;
+			job = deque.back();
+			deque.pop_back();
+			return true;
+		}
+
+		/// \brief Remove the job of the lowest priority class queued waiting for the longest time, the oldest job at the front of one of the queues
+		/// \return true if a job has been removed
+		bool dropOldest()
+		{
+			int pi = NofJobPriorities-1;
+			for (; pi >= 0 && nofQueuedPriority[ pi].load() == 0; --pi){}
+			if (pi < 0) return false;
+
+			int oldest = -1;
+			uint64_t oldestTime = std::numeric_limits<uint64_t>::max();
+			for (int wi=0; wi < nofWorkers; ++wi)
+			{
+				strus::unique_lock lock( workers[ wi].mutex);
+				const std::deque<Job>& deque = workers[ wi].deque[ pi];
+				if (!deque.empty() && deque.front().enqueueTime < oldestTime)
+				{
+					oldest = wi;
+					oldestTime = deque.front().enqueueTime;
+				}
+			}
+			if (oldest < 0) return false;
+			Job job;
+			{
+				strus::unique_lock lock( workers[ oldest].mutex);
+				//... the front might have been taken in the meantime, the next one is about as old
+				std::deque<Job>& deque = workers[ oldest].deque[ pi];
+				if (deque.empty()) return false;
+				job = deque.front();
+				deque.pop_front();
+			}
+			nofQueuedPriority[ pi].fetch_sub( 1);
+			nofQueued.fetch_sub( 1);
+			metrics->removed( job, true);
+			if (job.deleter) job.deleter( job.context);
+			return true;
+		}
+
+		bool steal( int widx, int priority, Job& job)
+		{
+			for (int ii=1; ii < nofWorkers; ++ii)
+			{
+				Worker& victim = workers[ (widx + ii) % nofWorkers];
+				strus::unique_lock lock( victim.mutex);
+				std::deque<Job>& deque = victim.deque[ priority];
+				if (deque.empty()) continue;
+				job = deque.front();
+				deque.pop_front();
+				return true;
+			}
+			return false;
+		}
+
+		/// \brief Take the next job to execute, jobs of a higher priority class first, even if they have to be stolen
+		bool take( int widx, Job& job)
+		{
+			for (int pi=0; pi < NofJobPriorities; ++pi)
+			{
+				if (nofQueuedPriority[ pi].load() == 0) continue;
+				if (popOwn( widx, pi, job) || steal( widx, pi, job))
+				{
+					nofQueuedPriority[ pi].fetch_sub( 1);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void run( int widx)
+		{
+			ThreadMarker& marker = currentThreadMarker();
+			marker.pool = this;
+			marker.workerIdx = widx;
+			Job job;
+			while (!terminate.test())
+			{
+				if (take( widx, job))
+				{
+					nofQueued.fetch_sub( 1);
+					metrics->dequeued( job);
+					job.proc( job.context);
+					continue;
+				}
+				strus::unique_lock lock( idle_mutex);
+				nofIdle.fetch_add( 1);
+				if (nofQueued.load() == 0 && !terminate.test())
+				{
+					idle_cv.wait_for( lock, pte::chrono::seconds( secondsPeriod));
+				}
+				nofIdle.fetch_sub( 1);
+			}
+			marker.pool = 0;
+			marker.workerIdx = -1;
+		}
+
+		bool start()
+		{
+			terminate.set( false);
+			try
+			{
+				for (int wi=0; wi < nofWorkers; ++wi)
+				{
+					workers[ wi].thread = new strus::thread( &WorkerPool::run, this, wi);
+				}
+				return true;
+			}
+			catch (...)
+			{
+				stop();
+				return false;
+			}
+		}
+
+		void stop()
+		{
+			terminate.set( true);
+			{
+				strus::unique_lock lock( idle_mutex);
+				idle_cv.notify_all();
+			}
+			for (int wi=0; wi < nofWorkers; ++wi)
+			{
+				if (workers[ wi].thread)
+				{
+					workers[ wi].thread->join();
+					delete workers[ wi].thread;
+					workers[ wi].thread = 0;
+				}
+			}
+			for (int wi=0; wi < nofWorkers; ++wi)
+			{
+				for (int pi=0; pi < NofJobPriorities; ++pi)
+				{
+					std::deque<Job>& deque = workers[ wi].deque[ pi];
+					std::deque<Job>::const_iterator ji = deque.begin(), je = deque.end();
+					for (; ji != je; ++ji)
+					{
+						metrics->removed( *ji, false);
+						if (ji->deleter) ji->deleter( ji->context);
+					}
+					nofQueuedPriority[ pi].fetch_sub( (int)deque.size());
+					nofQueued.fetch_sub( (int)deque.size());
+					deque.clear();
+				}
+			}
+		}
+
+		Worker* workers;
+		int nofWorkers;
+		int secondsPeriod;
+		strus::condition_variable idle_cv;
+		strus::mutex idle_mutex;
+		strus::atomic<int> nofQueued;		///< number of jobs in all queues
+		strus::atomic<int> nofQueuedPriority[ NofJobPriorities];	///< number of jobs of each priority class in all queues, for skipping empty classes
+		strus::atomic<int> nofIdle;		///< number of threads about to wait for jobs
+		AtomicCounter<unsigned int> nextWorker;
+		AtomicFlag terminate;
+		QueueMetrics* metrics;			///< admission control and metrics of the worker owning the pool
+
+	private:
+		WorkerPool( const WorkerPool&){}		///> non copyable
+		void operator=( const WorkerPool&){}		///> non copyable
+	};
+
+	explicit Data( int secondsPeriod_, bool useFdSelect, int nofWorkers_)
 		:thread(0)
 		,secondsPeriod(secondsPeriod_)
 		,requestCount(0)
 		,numberOfRequestsBeforeTick(secondsPeriod_*NumberOfRequestsBeforeTick)
 		,terminate(false)
-		,selectFdData( useFdSelect ? new SelectFdData( secondsPeriod_) : 0)
-	{}
+		,parked(false)
+		,fdEventHandler(0)
+		,pool(0)
+		,metrics()
+		,pop_mutex()
+		,retainedHead(0)
+		,retainedTail(0)
+		,startTime(pte::chrono::steady_clock::now())
+		,lastActive(0)
+		,timers(0)
+		,plannedWakeup(std::numeric_limits<uint64_t>::max())
+		,expiredTimers()
+	{
+		try
+		{
+			if (useFdSelect) fdEventHandler = createFdEventHandler();
+			if (nofWorkers_ >= 0) pool = new WorkerPool( nofWorkers_ ? nofWorkers_ : platform::cores(), secondsPeriod_, &metrics);
+		}
+		catch (...)
+		{
+			if (fdEventHandler) delete fdEventHandler;
+			throw;
+		}
+	}
 	~Data()
 	{
-		if (selectFdData) delete selectFdData;
+		if (pool) delete pool;
+		if (fdEventHandler) delete fdEventHandler;
+		clearTimers();
+		while (retainedHead)
+		{
+			JobNode* node = retainedHead;
+			retainedHead = node->next.load();
+			delete node;
+		}
+	}
+
+	/// \brief Get the time in milliseconds since the start of the worker
+	uint64_t timeNow() const
+	{
+		return pte::chrono::duration_cast<pte::chrono::milliseconds>( pte::chrono::steady_clock::now() - startTime).count();
+	}
+
+	TimerId scheduleTimer( int milliseconds, JobHandlerProc proc, void* context, JobDeleterProc deleter)
+	{
+		try
+		{
+			uint64_t expiry = timeNow() + (milliseconds > 0 ? milliseconds : 0);
+			TimerId rt;
+			bool wakeup;
+			{
+				strus::unique_lock lock( tm_mutex);
+				rt = timers.schedule( expiry, proc, context, deleter);
+				wakeup = expiry < plannedWakeup;
+			}
+			//... the event thread has to recalculate its timeout if the timer expires before it wakes up
+			if (wakeup) notifyParked();
+			return rt;
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+
+	bool cancelTimer( TimerId id)
+	{
+		TimerWheel::Timer timer;
+		{
+			strus::unique_lock lock( tm_mutex);
+			if (!timers.cancel( id, timer)) return false;
+		}
+		if (timer.deleter && timer.context) timer.deleter( timer.context);
+		return true;
+	}
+
+	/// \brief Call the procedures of the timers expired, called by the event thread
+	void runTimers()
+	{
+		expiredTimers.clear();
+		try
+		{
+			strus::unique_lock lock( tm_mutex);
+			timers.advance( timeNow(), expiredTimers);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//... the timers collected so far are called, the others with the next wakeup
+		}
+		std::vector<TimerWheel::Timer>::const_iterator ti = expiredTimers.begin(), te = expiredTimers.end();
+		for (; ti != te; ++ti)
+		{
+			ti->proc( ti->context);
+		}
+	}
+
+	void clearTimers()
+	{
+		std::vector<TimerWheel::Timer> removed;
+		{
+			strus::unique_lock lock( tm_mutex);
+			timers.clear( removed);
+		}
+		std::vector<TimerWheel::Timer>::const_iterator ti = removed.begin(), te = removed.end();
+		for (; ti != te; ++ti)
+		{
+			if (ti->deleter && ti->context) ti->deleter( ti->context);
+		}
+	}
+
+	/// \brief Calculate the timeout of the next wait of the event thread
+	/// \return the timeout in milliseconds
+	int waitTimeout()
+	{
+		uint64_t now = timeNow();
+		uint64_t wakeup = lastActive + (uint64_t)secondsPeriod * 1000;
+		strus::unique_lock lock( tm_mutex);
+		uint64_t next = timers.nextEventTime();
+		if (next < wakeup) wakeup = next;
+		plannedWakeup = wakeup;
+		return wakeup > now ? (int)(wakeup - now) : 0;
+	}
+
+	/// \brief Mark the event thread as active, the tickers are called after a period without activity
+	void setActive()
+	{
+		lastActive = timeNow();
+	}
+
+	/// \brief Test if a period has passed without activity and mark the event thread as active if yes
+	bool idlePeriodPassed()
+	{
+		uint64_t now = timeNow();
+		if (now >= lastActive + (uint64_t)secondsPeriod * 1000)
+		{
+			lastActive = now;
+			return true;
+		}
+		return false;
 	}
 
 	bool notify()
 	{
-		if (selectFdData)
+		if (fdEventHandler)
 		{
-			return selectFdData->notify();
+			return fdEventHandler->notify();
 		}
 		else
 		{
+			strus::unique_lock lock( cv_mutex);
 			cv.notify_all();
 			return true;
 		}
 	}
 
-	bool pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter)
+	/// \brief Wake up the consumer after a push if it is parked, only the first push after parking issues a wakeup
+	void notifyParked()
+	{
+		if (parked.exchange( false)) (void)notify();
+	}
+
+	bool pushNode( const Job& job)
+	{
+		queue[ job.priority].push( new JobNode( job));
+		notifyParked();
+		return true;
+	}
+
+	bool setQueueCapacity( std::size_t capacity, OverflowPolicy policy)
+	{
+		if (!stopped()) return false;
+		metrics.capacity = capacity;
+		metrics.policy = policy;
+		return true;
+	}
+
+	QueueStatistics queueStatistics()
+	{
+		return metrics.statistics();
+	}
+
+	/// \brief Test if the current thread executes jobs of this worker
+	bool isConsumerThread() const
+	{
+		const ThreadMarker& marker = currentThreadMarker();
+		return marker.eventThread == this || (pool && marker.pool == pool);
+	}
+
+	/// \brief Link a listener node taken from the queue by a producer into the list the consumer processes first, called with pop_mutex locked
+	void retain( JobNode* node)
+	{
+		node->next.store( 0);
+		if (retainedTail)
+		{
+			retainedTail->next.store( node);
+		}
+		else
+		{
+			retainedHead = node;
+		}
+		retainedTail = node;
+	}
+
+	/// \brief Remove the job of the lowest priority class queued waiting for the longest time without executing it
+	/// \return true if a job has been removed
+	bool dropOldest()
+	{
+		if (pool) return pool->dropOldest();
+		JobNode* node = 0;
+		{
+			strus::unique_lock lock( pop_mutex);
+			for (int pi=NofJobPriorities-1; !node && pi >= 0; --pi)
+			{
+				//... listener definitions are not dropped, they keep their order before the jobs still queued
+				while (0!=(node = queue[ pi].pop()) && node->isListener()) retain( node);
+			}
+		}
+		if (!node) return false;
+		metrics.removed( *node, true);
+		if (node->deleter) node->deleter( node->context);
+		delete node;
+		return true;
+	}
+
+	/// \brief Reserve space for a job in the queue according to the overflow policy
+	/// \return true if the job can be queued
+	bool admitJob( JobPriority priority)
 	{
+		if (metrics.tryAdmit( priority)) return true;
+		switch (metrics.policy)
+		{
+			case OverflowBlock:
+				//... a thread executing jobs of this worker would wait for itself
+				if (isConsumerThread())
+				{
+					metrics.forceAdmit( priority);
+					return true;
+				}
+				return metrics.waitAdmit( priority);
+			case OverflowReject:
+				metrics.reject();
+				return false;
+			case OverflowDropOldest:
+				do
+				{
+					if (!dropOldest())
+					{
+						//... nothing to drop, the jobs queued are just being taken or pushed by others
+						metrics.forceAdmit( priority);
+						return true;
+					}
+				} while (!metrics.tryAdmit( priority));
+				return true;
+		}
+		return false;
+	}
+
+	bool pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter, JobPriority priority)
+	{
+		if ((unsigned int)priority >= (unsigned int)NofJobPriorities) return false;
+		if (!admitJob( priority)) return false;
+		Job job( proc, context, deleter, priority);
 		try
 		{
-			intent.increment();
-			strus::unique_lock lock( qe_mutex);
-			queue.push( Job( proc, context, deleter));
-			(void)notify();
-			return true;
+			job.enqueueTime = QueueMetrics::clockMicroseconds();
+			if (pool)
+			{
+				pool->push( job);
+				return true;
+			}
+			return pushNode( job);
 		}
 		catch (...)
 		{
+			metrics.removed( job, false);
 			return false;
 		}
 	}
@@ -384,11 +1513,7 @@ struct JobQueueWorker::Data
 	{
 		try
 		{
-			intent.increment();
-			strus::unique_lock lock( qe_mutex);
-			queue.push( Job( proc, context, deleter, fh, fdTypeMask));
-			(void)notify();
-			return true;
+			return pushNode( Job( proc, context, deleter, fh, fdTypeMask));
 		}
 		catch (...)
 		{
@@ -406,21 +1531,21 @@ struct JobQueueWorker::Data
 		}
 	}
 
-	bool fetch( Job& job)
+	/// \brief Execute the jobs in the queue
+	/// \param[in] maxNofJobs maximum number of jobs to execute
+	/// \return the number of jobs executed
+	int execJobs( int maxNofJobs)
 	{
-		try
-		{
-			strus::unique_lock lock( qe_mutex);
-			if (queue.empty()) return false;
-			job = queue.front();
-			queue.pop();
-			intent.decrement();
-			return true;
-		}
-		catch (...)
+		int nofJobs = 0;
+		for (; nofJobs < maxNofJobs; ++nofJobs)
 		{
-			return false;
+			JobNode* node = popNode();
+			if (!node) break;
+			if (!node->isListener()) metrics.dequeued( *node);
+			(void)execJob( *node);
+			delete node;
 		}
+		return nofJobs;
 	}
 
 	bool forcedTick()
@@ -446,10 +1571,21 @@ struct JobQueueWorker::Data
 	{
 		if (thread) return false;
 		terminate.set( false);
+		metrics.open();
 		thread = thread_;
 		return true;
 	}
 
+	bool startPool()
+	{
+		return pool ? pool->start() : true;
+	}
+
+	int nofWorkers() const
+	{
+		return pool ? pool->nofWorkers : 1;
+	}
+
 	bool stopped()
 	{
 		return thread == NULL;
@@ -457,36 +1593,99 @@ struct JobQueueWorker::Data
 
 	void stop()
 	{
+		metrics.close();
+		if (pool) pool->stop();
 		if (thread)
 		{
-			intent.increment();
 			terminate.set( true);
 			(void)notify();
 			thread->join();
-			Job job;
-			while (fetch( job))
+			JobNode* node;
+			while (0!=(node = popNode()))
 			{
-				if (job.deleter) job.deleter( job.context);
+				if (!node->isListener()) metrics.removed( *node, false);
+				if (node->deleter) node->deleter( node->context);
+				delete node;
 			}
 			delete thread;
 			thread = 0;
 		}
 	}
 
+	/// \brief Pop the next job of the highest priority class queued
+	JobNode* popQueues()
+	{
+		for (int pi=0; pi < NofJobPriorities; ++pi)
+		{
+			JobNode* rt = queue[ pi].pop();
+			if (rt) return rt;
+		}
+		return 0;
+	}
+
+	bool queuesEmpty() const
+	{
+		for (int pi=0; pi < NofJobPriorities; ++pi)
+		{
+			if (!queue[ pi].empty()) return false;
+		}
+		return true;
+	}
+
+	/// \brief Pop the next job, called by the consumer only
+	/// \note With the policy OverflowDropOldest producers take jobs from the queue too, the access is serialized with a mutex then
+	JobNode* popNode()
+	{
+		if (metrics.policy != OverflowDropOldest) return popQueues();
+		strus::unique_lock lock( pop_mutex);
+		if (retainedHead)
+		{
+			JobNode* rt = retainedHead;
+			retainedHead = rt->next.load();
+			if (!retainedHead) retainedTail = 0;
+			return rt;
+		}
+		return popQueues();
+	}
+
+	bool queueEmpty()
+	{
+		if (metrics.policy != OverflowDropOldest) return queuesEmpty();
+		strus::unique_lock lock( pop_mutex);
+		return !retainedHead && queuesEmpty();
+	}
+
 	inline bool wait()
 	{
-		if (intent.value())
+		if (!queueEmpty())
 		{
 			return true;
 		}
-		else if (selectFdData)
+		else if (fdEventHandler)
 		{
-			return selectFdData->wait();
+			//... announce parking before looking at the queue again, a producer either sees the flag or the consumer sees the job
+			parked.store( true);
+			if (!queueEmpty() || terminated())
+			{
+				parked.store( false);
+				return true;
+			}
+			bool rt = fdEventHandler->wait( waitTimeout());
+			parked.store( false);
+			return rt;
 		}
 		else
 		{
 			strus::unique_lock lock( cv_mutex);
-			return cv.wait_for( lock, pte::chrono::seconds( secondsPeriod)) == (strus::cv_status)strus::cv_status_no_timeout;
+			parked.store( true);
+			if (!queueEmpty() || terminated())
+			{
+				parked.store( false);
+				return true;
+			}
+			bool rt = cv.wait_for( lock, pte::chrono::milliseconds( waitTimeout())) == (strus::cv_status)strus::cv_status_no_timeout;
+			parked.store( false);
+			return rt;
 		}
 	}
 
@@ -494,19 +1693,21 @@ struct JobQueueWorker::Data
 	{
 		if (job.isListener())
 		{
-			if (selectFdData)
+			if (fdEventHandler)
 			{
 				if (job.proc)
 				{
-					selectFdData->defineListener( job.proc, job.deleter, job.context, job.fh, job.fdTypeMask);
+					fdEventHandler->defineListener( job.proc, job.deleter, job.context, job.fh, job.fdTypeMask);
 				}
 				else
 				{
-					selectFdData->deleteListener( job.fh, job.fdTypeMask);
+					fdEventHandler->deleteListener( job.fh, job.fdTypeMask);
 				}
 			}
 			else
 			{
+				//... listeners are not served without select mode, the context is disposed
+				if (job.proc && job.deleter) job.deleter( job.context);
 				return false;
 			}
 		}
@@ -521,25 +1722,35 @@ struct JobQueueWorker::Data
 private:
 	strus::condition_variable cv;
 	strus::mutex cv_mutex;
-	strus::mutex qe_mutex;
 	strus::mutex tc_mutex;
 	strus::thread* thread;
-	std::queue<Job> queue;
+	JobQueue queue[ NofJobPriorities];	///< queue of jobs for each priority class, listener definitions are queued with the highest priority
 	std::vector<Ticker> tickers;
 	int secondsPeriod;
 	int requestCount;
 	int numberOfRequestsBeforeTick;
 	AtomicFlag terminate;
-	AtomicCounter<int> intent;
-	SelectFdData* selectFdData;
+	strus::atomic<bool> parked;		///< true if the consumer is about to wait or waiting for events
+	FdEventHandler* fdEventHandler;
+	WorkerPool* pool;
+	QueueMetrics metrics;
+	strus::mutex pop_mutex;			///< serializes taking jobs from the queue with the policy OverflowDropOldest
+	JobNode* retainedHead;			///< listener definitions taken from the queue by producers dropping jobs, protected by pop_mutex
+	JobNode* retainedTail;
+	pte::chrono::steady_clock::time_point startTime;
+	uint64_t lastActive;			///< time of the last event or tick of the event thread in milliseconds since start
+	strus::mutex tm_mutex;
+	TimerWheel timers;			///< timers with expiry time in milliseconds since start
+	uint64_t plannedWakeup;			///< time the event thread wakes up at the latest, protected by tm_mutex
+	std::vector<TimerWheel::Timer> expiredTimers;
 };
 
 
-DLL_PUBLIC bool JobQueueWorker::init( int secondsPeriod_, bool useFdSelect)
+DLL_PUBLIC bool JobQueueWorker::init( int secondsPeriod_, bool useFdSelect, int nofWorkers_)
 {
 	try
 	{
-		m_data = new Data( secondsPeriod_, useFdSelect);
+		m_data = new Data( secondsPeriod_, useFdSelect, nofWorkers_);
 		return true;
 	}
 	catch (...)
@@ -556,6 +1767,7 @@ DLL_PUBLIC void JobQueueWorker::clear()
 
 DLL_PUBLIC void JobQueueWorker::wait()
 {
+	currentThreadMarker().eventThread = m_data;
 	for (;;)
 	{
 		bool gotEvent = m_data->wait();
@@ -563,17 +1775,16 @@ DLL_PUBLIC void JobQueueWorker::wait()
 		{
 			return;
 		}
-		else if (gotEvent)
+		m_data->runTimers();
+		if (gotEvent)
 		{
-			JobQueueWorker::Data::Job job;
-			while (m_data->fetch( job))
-			{
-				(void)m_data->execJob( job);
-			}
+			m_data->setActive();
+			//... drain the queue in batches, producers do not wake the thread while it is running
+			while (m_data->execJobs( JobBatchSize) == JobBatchSize && !m_data->terminated()){}
 		}
-		else
+		else if (m_data->idlePeriodPassed())
 		{
-			//... timeout, do tick
+			//... timeout without activity for a period, do tick
 			m_data->tick();
 		}
 	}
@@ -584,7 +1795,13 @@ DLL_PUBLIC bool JobQueueWorker::start()
 	try
 	{
 		if (!m_data->stopped()) return false;
-		return m_data->start( new strus::thread( &JobQueueWorker::wait, this));
+		if (!m_data->start( new strus::thread( &JobQueueWorker::wait, this))) return false;
+		if (!m_data->startPool())
+		{
+			m_data->stop();
+			return false;
+		}
+		return true;
 	}
 	catch (...)
 	{
@@ -597,9 +1814,34 @@ DLL_PUBLIC void JobQueueWorker::stop()
 	m_data->stop();
 }
 
-DLL_PUBLIC bool JobQueueWorker::pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter)
+DLL_PUBLIC bool JobQueueWorker::pushJob( JobHandlerProc proc, void* context, JobDeleterProc deleter, JobPriority priority)
+{
+	return m_data->pushJob( proc, context, deleter, priority);
+}
+
+DLL_PUBLIC bool JobQueueWorker::setQueueCapacity( std::size_t capacity, OverflowPolicy policy)
+{
+	return m_data->setQueueCapacity( capacity, policy);
+}
+
+DLL_PUBLIC JobQueueWorker::QueueStatistics JobQueueWorker::queueStatistics() const
+{
+	return m_data->queueStatistics();
+}
+
+DLL_PUBLIC JobQueueWorker::TimerId JobQueueWorker::scheduleTimer( int milliseconds, JobHandlerProc proc, void* context, JobDeleterProc deleter)
+{
+	return m_data->scheduleTimer( milliseconds, proc, context, deleter);
+}
+
+DLL_PUBLIC bool JobQueueWorker::cancelTimer( TimerId id)
+{
+	return m_data->cancelTimer( id);
+}
+
+DLL_PUBLIC int JobQueueWorker::nofWorkers() const
 {
-	return m_data->pushJob( proc, context, deleter);
+	return m_data->nofWorkers();
 }
 
 DLL_PUBLIC bool JobQueueWorker::pushTicker( JobHandlerProc proc, void* context)
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Read only symbol table working directly on a snapshot file mapped into memory
+#include "strus/base/mappedSymbolTable.hpp"
+#include "strus/base/dll_tags.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "private/internationalization.hpp"
+#include "symbolTableFile.hpp"
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace strus;
+
+DLL_PUBLIC MappedSymbolTable::~MappedSymbolTable()
+{
+	close();
+}
+
+DLL_PUBLIC void MappedSymbolTable::close()
+{
+	if (m_base) ::munmap( m_base, m_mapsize);
+	m_base = 0;
+	m_mapsize = 0;
+	m_nofSymbols = 0;
+	m_hashMask = 0;
+	m_offsets = 0;
+	m_slots = 0;
+	m_strings = 0;
+	m_stringsSize = 0;
+}
+
+static bool checkHeader( const SymbolTableFile::Header& hdr, std::size_t filesize)
+{
+	typedef SymbolTableFile::Slot Slot;
+	if (0!=std::memcmp( hdr.magic, SymbolTableFile::magic(), sizeof(hdr.magic))) return false;
+	if (hdr.version != SymbolTableFile::Version) return false;
+	if (hdr.byteOrderMark != SymbolTableFile::ByteOrderMark) return false;
+	if (hdr.fileSize != filesize) return false;
+	if (!hdr.hashTableSize || (hdr.hashTableSize & (hdr.hashTableSize-1)) != 0) return false;
+	if (hdr.hashTableSize < (uint64_t)hdr.nofSymbols * 2) return false;
+	if (hdr.keyOffsetsPos != sizeof(SymbolTableFile::Header)) return false;
+	if (hdr.hashTablePos != hdr.keyOffsetsPos + ((uint64_t)hdr.nofSymbols + 1) * sizeof(uint64_t)) return false;
+	if (hdr.stringsPos != hdr.hashTablePos + (uint64_t)hdr.hashTableSize * sizeof(Slot)) return false;
+	if (hdr.stringsPos > hdr.fileSize) return false;
+	return true;
+}
+
+/// \brief Check the bounds of the key offset array and the string area
+/// \note Only the first and the last offset and the last byte of the strings are read, so that loading does not touch every page of the file.
+///	Offsets and handles in between are checked on access by get and key. The 0 at the end of the string area terminates any key returned.
+static bool checkBounds( const SymbolTableFile::Header& hdr, const char* base)
+{
+	const uint64_t* offsets = (const uint64_t*)(const void*)(base + hdr.keyOffsetsPos);
+	uint64_t stringsSize = hdr.fileSize - hdr.stringsPos;
+	if (offsets[ 0] != 0 || offsets[ hdr.nofSymbols] != stringsSize) return false;
+	if (stringsSize && base[ hdr.fileSize - 1] != '\0') return false;
+	return true;
+}
+
+DLL_PUBLIC bool MappedSymbolTable::load( const std::string& filename)
+{
+	close();
+	int fd = ::open( filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		int ec = errno;
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeIOError, _TXT("error opening symbol table file '%s': %s"), filename.c_str(), ::strerror(ec));
+		return false;
+	}
+	struct stat st;
+	if (::fstat( fd, &st) != 0)
+	{
+		int ec = errno;
+		::close( fd);
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeIOError, _TXT("error reading size of symbol table file '%s': %s"), filename.c_str(), ::strerror(ec));
+		return false;
+	}
+	std::size_t filesize = st.st_size;
+	if (filesize < sizeof(SymbolTableFile::Header))
+	{
+		::close( fd);
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeDataCorruption, _TXT("file '%s' is not a symbol table file"), filename.c_str());
+		return false;
+	}
+	void* base = ::mmap( 0, filesize, PROT_READ, MAP_SHARED, fd, 0);
+	int ec = errno;
+	::close( fd);
+	if (base == MAP_FAILED)
+	{
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeIOError, _TXT("error mapping symbol table file '%s' into memory: %s"), filename.c_str(), ::strerror(ec));
+		return false;
+	}
+	const SymbolTableFile::Header* hdr = (const SymbolTableFile::Header*)base;
+	if (!checkHeader( *hdr, filesize))
+	{
+		::munmap( base, filesize);
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeDataCorruption, _TXT("file '%s' is not a symbol table file or has an incompatible version or byte order"), filename.c_str());
+		return false;
+	}
+	m_base = base;
+	m_mapsize = filesize;
+	m_nofSymbols = hdr->nofSymbols;
+	m_hashMask = hdr->hashTableSize - 1;
+	m_offsets = (const uint64_t*)(const void*)((const char*)base + hdr->keyOffsetsPos);
+	m_slots = (const char*)base + hdr->hashTablePos;
+	m_strings = (const char*)base + hdr->stringsPos;
+	m_stringsSize = hdr->fileSize - hdr->stringsPos;
+	if (!checkBounds( *hdr, (const char*)base))
+	{
+		close();
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeDataCorruption, _TXT("symbol table file '%s' is corrupt"), filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+DLL_PUBLIC uint32_t MappedSymbolTable::get( const std::string& key_) const
+{
+	return get( key_.c_str(), key_.size());
+}
+
+DLL_PUBLIC uint32_t MappedSymbolTable::get( const char* keystr, std::size_t keylen) const
+{
+	if (!m_base) return 0;
+	const SymbolTableFile::Slot* slots = (const SymbolTableFile::Slot*)m_slots;
+	uint32_t hash = SymbolTableFile::hash( keystr, keylen);
+	uint32_t pos = hash & m_hashMask;
+	uint32_t cnt = 0;
+	for (; cnt <= m_hashMask; ++cnt,pos = (pos + 1) & m_hashMask)
+	{
+		const SymbolTableFile::Slot& slot = slots[ pos];
+		if (!slot.id) return 0;
+		if (slot.hash == hash && slot.id <= m_nofSymbols)
+		{
+			uint64_t start = m_offsets[ slot.id-1];
+			uint64_t end = m_offsets[ slot.id];
+			if (start < end && end <= m_stringsSize && end - start == keylen + 1 && 0==std::memcmp( m_strings + start, keystr, keylen))
+			{
+				return slot.id;
+			}
+		}
+	}
+	return 0; //... only reached with a corrupt file without empty slots
+}
+
+DLL_PUBLIC const char* MappedSymbolTable::key( const uint32_t& id) const
+{
+	if (!id || id > m_nofSymbols) return 0;
+	uint64_t start = m_offsets[ id-1];
+	if (start >= m_stringsSize) return 0;
+	return m_strings + start;
+}
+
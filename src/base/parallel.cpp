@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Data parallel algorithms executed on a thread pool shared by the process
+#include "strus/base/parallel.hpp"
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/platform.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/dll_tags.hpp"
+#include <stdexcept>
+#include <string>
+
+using namespace strus;
+
+namespace {
+
+/// \brief Worker with the thread pool shared by all parallel algorithms, created with the first call needing it
+struct SharedPool
+{
+	strus::mutex mutex;
+	JobQueueWorker* worker;
+	int concurrency;
+
+	SharedPool()
+		:mutex(),worker(0),concurrency(0){}
+	~SharedPool()
+	{
+		if (worker) delete worker;
+	}
+
+	int getConcurrency()
+	{
+		strus::unique_lock lock( mutex);
+		if (!concurrency)
+		{
+			concurrency = platform::cores();
+			if (concurrency <= 0) concurrency = 1;
+		}
+		return concurrency;
+	}
+
+	bool setConcurrency( int nofThreads)
+	{
+		strus::unique_lock lock( mutex);
+		if (worker) return false;
+		concurrency = nofThreads > 0 ? nofThreads : platform::cores();
+		if (concurrency <= 0) concurrency = 1;
+		return true;
+	}
+
+	JobQueueWorker* getWorker()
+	{
+		int nofHelpers = getConcurrency() - 1;
+		if (nofHelpers <= 0) return 0;
+		strus::unique_lock lock( mutex);
+		if (!worker)
+		{
+			JobQueueWorker* wk = new JobQueueWorker( 60, false, nofHelpers);
+			if (!wk->start())
+			{
+				delete wk;
+				return 0;
+			}
+			worker = wk;
+		}
+		return worker;
+	}
+};
+
+static SharedPool g_sharedPool;
+
+/// \brief State of a range processed in parallel, shared by the caller and the helper jobs
+/// \note Helper jobs started after the range is completely processed find nothing to do, the caller does not wait for them
+class RangeState
+{
+public:
+	RangeState( std::size_t start_, std::size_t end_, std::size_t minGrain_, int nofThreads_, parallel::RangeBody* body_)
+		:m_next(start_),m_end(end_),m_minGrain(minGrain_ ? minGrain_ : 1),m_nofThreads(nofThreads_)
+		,m_processed(0),m_total(end_ - start_),m_body(body_),m_mutex(),m_cv(),m_failed(false),m_error(){}
+
+	/// \brief Process chunks till there is nothing left
+	void work()
+	{
+		std::size_t chunkStart;
+		std::size_t chunkEnd;
+		while (claim( chunkStart, chunkEnd))
+		{
+			try
+			{
+				m_body->run( chunkStart, chunkEnd);
+			}
+			catch (const std::bad_alloc&)
+			{
+				setError( "out of memory");
+			}
+			catch (const std::exception& err)
+			{
+				setError( err.what());
+			}
+			catch (...)
+			{
+				setError( "unknown exception");
+			}
+			done( chunkEnd - chunkStart);
+		}
+	}
+
+	/// \brief Wait till all chunks are processed, called by the caller
+	void wait()
+	{
+		strus::unique_lock lock( m_mutex);
+		while (m_processed.load() < m_total) m_cv.wait( lock);
+	}
+
+	bool failed() const
+	{
+		return m_failed.test();
+	}
+
+	const std::string& error() const
+	{
+		return m_error;
+	}
+
+private:
+	bool claim( std::size_t& chunkStart, std::size_t& chunkEnd)
+	{
+		std::size_t pos = m_next.load();
+		for (;;)
+		{
+			if (pos >= m_end) return false;
+			//... guided scheduling: a fraction of the rest, but at least the minimum grain size
+			std::size_t chunkSize = (m_end - pos) / (2 * m_nofThreads);
+			if (chunkSize < m_minGrain) chunkSize = m_minGrain;
+			std::size_t end = (m_end - pos > chunkSize) ? pos + chunkSize : m_end;
+			if (m_next.compare_exchange_weak( pos, end))
+			{
+				chunkStart = pos;
+				chunkEnd = end;
+				return true;
+			}
+		}
+	}
+
+	void done( std::size_t size)
+	{
+		if (m_processed.fetch_add( size) + size == m_total)
+		{
+			strus::unique_lock lock( m_mutex);
+			m_cv.notify_all();
+		}
+	}
+
+	void setError( const char* msg)
+	{
+		{
+			strus::unique_lock lock( m_mutex);
+			if (m_failed.test()) return;
+			try
+			{
+				m_error = msg;
+			}
+			catch (const std::bad_alloc&)
+			{}
+			m_failed.set( true);
+		}
+		//... skip the chunks not claimed yet, they count as processed
+		std::size_t pos = m_next.exchange( m_end);
+		if (pos < m_end) done( m_end - pos);
+	}
+
+private:
+	strus::atomic<std::size_t> m_next;	///< start of the rest of the range not claimed yet
+	std::size_t m_end;
+	std::size_t m_minGrain;
+	std::size_t m_nofThreads;
+	strus::atomic<std::size_t> m_processed;	///< number of elements processed or skipped
+	std::size_t m_total;
+	parallel::RangeBody* m_body;		///< body, only valid while chunks are not processed completely
+	strus::mutex m_mutex;
+	strus::condition_variable m_cv;
+	AtomicFlag m_failed;
+	std::string m_error;
+};
+
+typedef strus::shared_ptr<RangeState> RangeStateRef;
+
+static void runHelper( void* context)
+{
+	RangeStateRef* state = (RangeStateRef*)context;
+	(*state)->work();
+	delete state;
+}
+
+static void deleteHelper( void* context)
+{
+	delete (RangeStateRef*)context;
+}
+
+}//anonymous namespace
+
+DLL_PUBLIC int parallel::concurrency()
+{
+	return g_sharedPool.getConcurrency();
+}
+
+DLL_PUBLIC bool parallel::setConcurrency( int nofThreads)
+{
+	return g_sharedPool.setConcurrency( nofThreads);
+}
+
+DLL_PUBLIC void parallel::runRange( std::size_t start, std::size_t end, std::size_t minGrain, RangeBody& body)
+{
+	if (start >= end) return;
+	if (minGrain == 0) minGrain = 1;
+	std::size_t size = end - start;
+	JobQueueWorker* worker = size > minGrain ? g_sharedPool.getWorker() : 0;
+	if (!worker)
+	{
+		body.run( start, end);
+		return;
+	}
+	int nofThreads = worker->nofWorkers() + 1;
+	RangeStateRef state( new RangeState( start, end, minGrain, nofThreads, &body));
+
+	// [1] Push helper jobs, not more than there are chunks of the minimum size besides the one of the caller:
+	std::size_t nofHelpers = size / minGrain - 1;
+	if (nofHelpers > (std::size_t)(nofThreads - 1)) nofHelpers = nofThreads - 1;
+	for (std::size_t hi=0; hi < nofHelpers; ++hi)
+	{
+		RangeStateRef* helperState = new RangeStateRef( state);
+		if (!worker->pushJob( &runHelper, helperState, &deleteHelper))
+		{
+			delete helperState;
+			break;
+		}
+	}
+	// [2] Take part and wait for the chunks processed by the helpers:
+	state->work();
+	state->wait();
+	if (state->failed()) throw std::runtime_error( state->error());
+}
+
@@ -8,6 +8,13 @@
 /// \brief Periodic timer event
 #include "strus/base/dll_tags.hpp"
 #include "strus/base/periodicTimerEvent.hpp"
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/stdint.h"
+#if __cplusplus < 201103L
+#include <boost/thread/tss.hpp>
+#endif
 
 /// PF:HACK: Bad solution, need probing of atomic as C++ feature as for regex
 #if defined __GNUC__
@@ -26,35 +33,205 @@
 #endif // __cplusplus
 
 #ifdef STRUS_USE_STL
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <chrono>
 namespace pte = std;
 #else
-#include <boost/thread.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 #include <boost/chrono.hpp>
 namespace pte = boost;
 #endif
 
 using namespace strus;
 
+/// \brief Flag that is true for the thread of the timer service, that must not destroy the worker it runs in
+static bool& timerServiceThreadFlag()
+{
+#if __cplusplus >= 201103L
+	static thread_local bool rt = false;
+	return rt;
+#else
+	static boost::thread_specific_ptr<bool> g_flag;
+	if (!g_flag.get()) g_flag.reset( new bool( false));
+	return *g_flag;
+#endif
+}
+
+namespace {
+
+/// \brief Worker with the thread serving the timers of all periodic timer events of the process
+/// \note Created with the first timer event started, destroyed when the last one is stopped
+/// \note Never destroyed itself, so that timer events that are static objects can be stopped in any order at exit
+class TimerService
+{
+public:
+	static TimerService& instance()
+	{
+		static TimerService* rt = new TimerService();
+		return *rt;
+	}
+
+	/// \brief Register a timer event started
+	/// \return the worker serving the timers or NULL on error
+	JobQueueWorker* attach()
+	{
+		strus::unique_lock lock( m_mutex);
+		if (!m_worker)
+		{
+			//... no tickers are used, the period of the worker is irrelevant
+			JobQueueWorker* worker = new (std::nothrow) JobQueueWorker( 60, false);
+			if (!worker) return 0;
+			if (!worker->start())
+			{
+				delete worker;
+				return 0;
+			}
+			m_worker = worker;
+		}
+		++m_refcnt;
+		return m_worker;
+	}
+
+	/// \brief Unregister a timer event stopped, destroys the worker if it was the last one
+	void detach()
+	{
+		JobQueueWorker* worker = 0;
+		{
+			strus::unique_lock lock( m_mutex);
+			if (--m_refcnt > 0 || isTimerServiceThread()) return;
+			worker = m_worker;
+			m_worker = 0;
+		}
+		delete worker;
+	}
+
+	static bool isTimerServiceThread()
+	{
+		return timerServiceThreadFlag();
+	}
+
+private:
+	TimerService()
+		:m_mutex(),m_worker(0),m_refcnt(0){}
+
+private:
+	strus::mutex m_mutex;
+	JobQueueWorker* m_worker;
+	int m_refcnt;
+};
+
+/// \brief State of a timer event shared with the timers scheduled for it
+/// \note A timer that expired but was not called yet when the event is stopped keeps the state alive, but does not call tick anymore
+struct TimerState
+{
+	typedef strus::shared_ptr<TimerState> Ref;
+
+	/// \brief Context of a timer scheduled
+	struct Context
+	{
+		Ref state;
+		uint64_t sequence;	///< sequence number of the timer, only the timer scheduled last is valid
+
+		Context( const Ref& state_, uint64_t sequence_)
+			:state(state_),sequence(sequence_){}
+	};
+
+	explicit TimerState( PeriodicTimerEvent* owner_)
+		:mutex(),cv(),owner(owner_),service(0),timerId(0),sequence(0),running(false),inTick(false),tickThread()
+		,millisecondsPeriod(1),startTime(),nofPeriods(0){}
+
+	static uint64_t timeNow()
+	{
+		return pte::chrono::duration_cast<pte::chrono::milliseconds>( pte::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// \brief Schedule the timer of the next period, called with the mutex locked
+	static bool scheduleNext( const Ref& state)
+	{
+		uint64_t now = timeNow();
+		uint64_t due = state->startTime + (state->nofPeriods + 1) * state->millisecondsPeriod;
+		if (due <= now)
+		{
+			//... periods missed are skipped
+			state->nofPeriods = (now - state->startTime) / state->millisecondsPeriod;
+			due = state->startTime + (state->nofPeriods + 1) * state->millisecondsPeriod;
+		}
+		++state->nofPeriods;
+		Context* context = new (std::nothrow) Context( state, ++state->sequence);
+		if (!context) return false;
+		state->timerId = state->service->scheduleTimer( (int)(due - now), &TimerState::expired, context, &TimerState::deleteContext);
+		if (!state->timerId)
+		{
+			delete context;
+			return false;
+		}
+		return true;
+	}
+
+	static void expired( void* context)
+	{
+		timerServiceThreadFlag() = true;
+		Ref state( ((Context*)context)->state);
+		uint64_t sequence = ((Context*)context)->sequence;
+		delete (Context*)context;
+		{
+			strus::unique_lock lock( state->mutex);
+			//... timers of a previous start that expired before they could be cancelled are ignored
+			if (!state->running || sequence != state->sequence) return;
+			state->inTick = true;
+			state->tickThread = strus::ThreadId::get();
+		}
+		try
+		{
+			state->owner->tick();
+		}
+		catch (...)
+		{
+			//... an exception must not terminate the thread serving all timer events
+		}
+		strus::unique_lock lock( state->mutex);
+		state->inTick = false;
+		//... no new timer if the event has been restarted by the tick
+		if (state->running && sequence == state->sequence && !scheduleNext( state))
+		{
+			//... out of memory, the timer event stops ticking
+			state->running = false;
+		}
+		state->cv.notify_all();
+	}
+
+	static void deleteContext( void* context)
+	{
+		delete (Context*)context;
+	}
+
+	strus::mutex mutex;
+	strus::condition_variable cv;		///< signaled at the end of a tick
+	PeriodicTimerEvent* owner;
+	JobQueueWorker* service;		///< worker of the timer service, defined while registered
+	JobQueueWorker::TimerId timerId;	///< timer scheduled for the next tick
+	uint64_t sequence;			///< sequence number of the timer scheduled for the next tick
+	bool running;				///< true while started, tick is not called anymore if false
+	bool inTick;				///< true while tick is called
+	strus::ThreadId::Type tickThread;	///< thread calling tick if inTick is true
+	uint64_t millisecondsPeriod;
+	uint64_t startTime;			///< time of the start in milliseconds
+	uint64_t nofPeriods;			///< number of periods from the start to the tick scheduled
+};
+
+}//anonymous namespace
+
 struct PeriodicTimerEvent::Data
 {
-	Data(){ thread = 0; }
+	explicit Data( PeriodicTimerEvent* owner)
+		:state( new TimerState( owner)){}
 
-	pte::condition_variable cv;
-	pte::mutex cv_mutex;
-	pte::thread* thread;
+	TimerState::Ref state;
 };
 
 DLL_PUBLIC bool PeriodicTimerEvent::init()
 {
 	try
 	{
-		m_data = new Data();
+		m_data = new Data( this);
 		return true;
 	}
 	catch (...)
@@ -69,49 +246,46 @@ DLL_PUBLIC void PeriodicTimerEvent::clear()
 	delete m_data;
 }
 
-DLL_PUBLIC void PeriodicTimerEvent::wait()
-{
-	for (;;)
-	{
-		pte::unique_lock<pte::mutex> lock( m_data->cv_mutex);
-		pte::cv_status status = m_data->cv.wait_for( lock, pte::chrono::seconds(m_secondsPeriod));
-		if (status == pte::cv_status::no_timeout)
-		{
-			//... signaled only by stop, so we terminate the thread
-			return;
-		}
-		else
-		{
-			//... timeout, do action
-			tick();
-		}
-	}
-}
-
 DLL_PUBLIC bool PeriodicTimerEvent::start()
 {
-	try
-	{
-		if (m_data->thread) stop();
-		m_data->thread = new pte::thread( &PeriodicTimerEvent::wait, this);
-		return true;
-	}
-	catch (...)
+	stop();
+	JobQueueWorker* service = TimerService::instance().attach();
+	if (!service) return false;
+
+	TimerState::Ref& state = m_data->state;
+	strus::unique_lock lock( state->mutex);
+	state->service = service;
+	state->millisecondsPeriod = m_millisecondsPeriod > 0 ? m_millisecondsPeriod : 1;
+	state->startTime = TimerState::timeNow();
+	state->nofPeriods = 0;
+	state->running = true;
+	if (!TimerState::scheduleNext( state))
 	{
+		state->running = false;
+		state->service = 0;
+		lock.unlock();
+		TimerService::instance().detach();
 		return false;
 	}
+	return true;
 }
 
 DLL_PUBLIC void PeriodicTimerEvent::stop()
 {
-	if (m_data->thread)
+	TimerState::Ref& state = m_data->state;
 	{
-		m_data->cv.notify_all();
-		m_data->thread->join();
-		delete m_data->thread;
-		m_data->thread = 0;
+		strus::unique_lock lock( state->mutex);
+		if (!state->service) return;
+		state->running = false;
+		(void)state->service->cancelTimer( state->timerId);
+		if (state->inTick && state->tickThread != strus::ThreadId::get())
+		{
+			//... wait for the tick in progress, unless stop is called by the tick itself
+			while (state->inTick) state->cv.wait( lock);
+		}
+		state->service = 0;
+		state->timerId = 0;
 	}
+	TimerService::instance().detach();
 }
 
-
-
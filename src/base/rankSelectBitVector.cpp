@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Read only bit vector with constant time rank and select queries
+#include "strus/base/rankSelectBitVector.hpp"
+#include "strus/base/dynamic_bitset.hpp"
+#include "strus/base/compressed_bitset.hpp"
+#include "strus/base/bitSetKernels.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/dll_tags.hpp"
+#include <limits>
+#include <algorithm>
+#include <new>
+
+using namespace strus;
+
+enum {
+	BlockBits=2048,			///< number of bits of a block with an index entry
+	BlockWords=BlockBits/64,	///< number of 64 bit words of a block
+	SubBlockBits=512,		///< number of bits of a sub block with a count in the index entry of its block
+	SubBlockWords=SubBlockBits/64,	///< number of 64 bit words of a sub block
+	NofSubBlocks=BlockBits/SubBlockBits,
+	SubBlockCountBits=10,		///< number of bits of a sub block count in the index entry
+	SelectSampleRate=8192		///< number of bits set between two samples for select
+};
+
+static inline std::size_t blockBase( uint64_t entry)
+{
+	return entry & 0xFFFFffffU;
+}
+
+static inline unsigned int subBlockCount( uint64_t entry, unsigned int sbi)
+{
+	return (entry >> (32 + sbi * SubBlockCountBits)) & ((1U << SubBlockCountBits) - 1);
+}
+
+/// \brief Get the position of the bit set with rank idx in a word
+/// \note Locates the byte with the counts of the bytes evaluated in parallel, then the bit in the byte
+static inline unsigned int selectInWord( uint64_t ww, unsigned int idx)
+{
+	uint64_t cnt = ww - ((ww >> 1) & 0x5555555555555555);
+	cnt = (cnt & 0x3333333333333333) + ((cnt >> 2) & 0x3333333333333333);
+	cnt = (cnt + (cnt >> 4)) & 0x0F0F0F0F0F0F0F0F;
+	unsigned int ofs = 0;
+	for (; ofs < 56; ofs += 8)
+	{
+		unsigned int bytecnt = (cnt >> ofs) & 0xFF;
+		if (idx < bytecnt) break;
+		idx -= bytecnt;
+	}
+	uint64_t bb = (ww >> ofs) & 0xFF;
+	for (; idx; --idx) bb &= bb - 1;
+	return ofs + BitOperations::bitScanForward( bb) - 1;
+}
+
+template <class BitSet>
+static void copyBits( std::vector<uint64_t>& words, const BitSet& set)
+{
+	int pos = set.first();
+	for (; pos >= 0; pos = set.next( pos))
+	{
+		words[ pos / 64] |= (uint64_t)1 << (pos % 64);
+	}
+}
+
+/// \brief Get the number of words allocated for a bit vector, padded to a multiple of the block size
+static std::size_t nofWordsAllocated( std::size_t size_)
+{
+	if (size_ > (std::size_t)std::numeric_limits<int32_t>::max()) throw std::bad_alloc();
+	return (size_ + BlockBits - 1) / BlockBits * BlockWords;
+}
+
+DLL_PUBLIC RankSelectBitVector::RankSelectBitVector( const uint64_t* words, std::size_t size_)
+	:m_size(0),m_count(0),m_words(),m_blocks(),m_samples()
+{
+	init( words, size_);
+}
+
+DLL_PUBLIC RankSelectBitVector::RankSelectBitVector( const dynamic_bitset& set)
+	:m_size(set.size()),m_count(0),m_words(),m_blocks(),m_samples()
+{
+	m_words.assign( nofWordsAllocated( m_size), 0);
+	copyBits( m_words, set);
+	buildIndex();
+}
+
+DLL_PUBLIC RankSelectBitVector::RankSelectBitVector( const compressed_bitset& set)
+	:m_size(set.size()),m_count(0),m_words(),m_blocks(),m_samples()
+{
+	m_words.assign( nofWordsAllocated( m_size), 0);
+	copyBits( m_words, set);
+	buildIndex();
+}
+
+DLL_PUBLIC void RankSelectBitVector::init( const uint64_t* words, std::size_t size_)
+{
+	m_words.assign( nofWordsAllocated( size_), 0);
+	m_size = size_;
+	std::size_t nofWords = (size_ + 63) / 64;
+	std::copy( words, words + nofWords, m_words.begin());
+	if (size_ % 64 != 0)
+	{
+		m_words[ nofWords-1] &= ((uint64_t)1 << (size_ % 64)) - 1;
+	}
+	buildIndex();
+}
+
+void RankSelectBitVector::buildIndex()
+{
+	std::size_t nofBlocks = m_words.size() / BlockWords;
+	m_blocks.clear();
+	m_blocks.reserve( nofBlocks);
+	m_samples.clear();
+
+	std::size_t total = 0;
+	std::size_t bi = 0;
+	for (; bi < nofBlocks; ++bi)
+	{
+		uint64_t entry = total;
+		std::size_t blockCount = 0;
+		unsigned int sbi = 0;
+		for (; sbi < NofSubBlocks; ++sbi)
+		{
+			std::size_t cnt = BitSetKernels::count( m_words.data() + bi * BlockWords + sbi * SubBlockWords, SubBlockWords);
+			if (sbi < NofSubBlocks-1)
+			{
+				entry |= (uint64_t)cnt << (32 + sbi * SubBlockCountBits);
+			}
+			blockCount += cnt;
+		}
+		m_blocks.push_back( entry);
+		//... sample the block for every bit set in it with a rank that is a multiple of the sample rate
+		while (m_samples.size() * SelectSampleRate < total + blockCount)
+		{
+			m_samples.push_back( bi);
+		}
+		total += blockCount;
+	}
+	m_count = total;
+}
+
+DLL_PUBLIC std::size_t RankSelectBitVector::rank( std::size_t pos) const
+{
+	if (pos >= m_size) return m_count;
+	std::size_t bi = pos / BlockBits;
+	uint64_t entry = m_blocks[ bi];
+	std::size_t rt = blockBase( entry);
+	unsigned int sbi = (pos % BlockBits) / SubBlockBits;
+	unsigned int si = 0;
+	for (; si < sbi; ++si)
+	{
+		rt += subBlockCount( entry, si);
+	}
+	std::size_t wi = bi * BlockWords + sbi * SubBlockWords;
+	std::size_t we = pos / 64;
+	rt += BitSetKernels::count( m_words.data() + wi, we - wi);
+	unsigned int ofs = pos % 64;
+	if (ofs)
+	{
+		rt += BitOperations::bitCount( (uint64_t)(m_words[ we] & (((uint64_t)1 << ofs) - 1)));
+	}
+	return rt;
+}
+
+DLL_PUBLIC int RankSelectBitVector::select( std::size_t idx) const
+{
+	if (idx >= m_count) return -1;
+	//... find the last block with at most idx bits set before it, between the blocks sampled for the ranks enclosing idx
+	std::size_t si = idx / SelectSampleRate;
+	std::size_t lo = m_samples[ si];
+	std::size_t hi = si + 1 < m_samples.size() ? m_samples[ si+1] + 1 : m_blocks.size();
+	while (hi - lo > 1)
+	{
+		std::size_t mid = (lo + hi) / 2;
+		if (blockBase( m_blocks[ mid]) <= idx)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	uint64_t entry = m_blocks[ lo];
+	std::size_t rest = idx - blockBase( entry);
+	unsigned int sbi = 0;
+	for (; sbi < NofSubBlocks-1; ++sbi)
+	{
+		unsigned int cnt = subBlockCount( entry, sbi);
+		if (rest < cnt) break;
+		rest -= cnt;
+	}
+	std::size_t wi = lo * BlockWords + sbi * SubBlockWords;
+	for (;; ++wi)
+	{
+		unsigned int cnt = BitOperations::bitCount( m_words[ wi]);
+		if (rest < cnt) break;
+		rest -= cnt;
+	}
+	return wi * 64 + selectInWord( m_words[ wi], rest);
+}
+
+DLL_PUBLIC std::size_t RankSelectBitVector::allocated() const
+{
+	return m_words.capacity() * sizeof(uint64_t) + m_blocks.capacity() * sizeof(uint64_t) + m_samples.capacity() * sizeof(uint32_t);
+}
+
@@ -7,13 +7,18 @@
  */
 #include "strus/base/symbolTable.hpp"
 #include "strus/base/dll_tags.hpp"
-#include "strus/base/unordered_map.hpp"
+#include "strus/base/bitOperations.hpp"
+#include "strus/base/fileio.hpp"
 #include "strus/errorBufferInterface.hpp"
 #include "private/internationalization.hpp"
+#include "symbolTableFile.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <algorithm>
+#if defined __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace strus {
 
@@ -40,6 +45,10 @@ public:
 	/// \return the immutable pointer to the key or 0, if the block does not have enough free space for the key to allocate
 	const char* allocKey( const char* key, std::size_t keylen);
 
+	/// \brief Allocate a string with its size stored as uint32_t in front of it
+	/// \return the immutable pointer to the key or 0, if the block does not have enough free space for the key to allocate
+	const char* allocKeyRecord( const char* key, std::size_t keylen);
+
 	void* blockPtr()
 	{
 		return m_blk;
@@ -66,6 +75,18 @@ public:
 	/// \return the immutable pointer to the key
 	const char* allocKey( const char* key, std::size_t keylen);
 
+	/// \brief Allocate a key with its size stored as uint32_t in front of it
+	/// \return the immutable pointer to the key
+	const char* allocKeyRecord( const char* key, std::size_t keylen);
+
+	/// \brief Get the size of a key allocated with allocKeyRecord
+	static std::size_t keyRecordSize( const char* key)
+	{
+		uint32_t rt;
+		std::memcpy( &rt, key - sizeof(uint32_t), sizeof(rt));
+		return rt;
+	}
+
 	/// \brief Free all keys allocated
 	void clear();
 
@@ -163,6 +184,19 @@ const char* StringMapKeyBlock::allocKey( const char* key, std::size_t keylen)
 	return rt;
 }
 
+const char* StringMapKeyBlock::allocKeyRecord( const char* key, std::size_t keylen)
+{
+	uint32_t keylen32 = keylen;
+	std::size_t recsize = sizeof(keylen32) + keylen;
+	if (recsize > m_blksize || recsize + m_blkpos + 1 > m_blksize) return 0;
+	std::memcpy( m_blk + m_blkpos, &keylen32, sizeof(keylen32));
+	const char* rt = m_blk + m_blkpos + sizeof(keylen32);
+	std::memcpy( m_blk + m_blkpos + sizeof(keylen32), key, keylen);
+	m_blk[ m_blkpos + recsize] = 0;
+	m_blkpos += recsize+1;
+	return rt;
+}
+
 void* StringMapKeyBlockList::allocBlock( std::size_t blksize_, std::size_t elemsize_)
 {
 	m_ar.push_front( StringMapKeyBlock( blksize_, elemsize_));
@@ -189,6 +223,28 @@ const char* StringMapKeyBlockList::allocKey( const char* key, std::size_t keylen
 	return rt;
 }
 
+const char* StringMapKeyBlockList::allocKeyRecord( const char* key, std::size_t keylen)
+{
+	if (keylen >= (std::size_t)std::numeric_limits<int32_t>::max()) throw std::bad_alloc();
+	const char* rt = m_ar.empty() ? 0 : m_ar.back().allocKeyRecord( key, keylen);
+	if (!rt)
+	{
+		std::size_t recsize = sizeof(uint32_t) + keylen;
+		if (recsize >= StringMapKeyBlock::DefaultSize)
+		{
+			m_ar.push_front( StringMapKeyBlock( recsize+1));
+			rt = m_ar.front().allocKeyRecord( key, keylen);
+		}
+		else
+		{
+			m_ar.push_back( StringMapKeyBlock());
+			rt = m_ar.back().allocKeyRecord( key, keylen);
+		}
+	}
+	if (!rt) throw std::bad_alloc();
+	return rt;
+}
+
 void StringMapKeyBlockList::clear()
 {
 	m_ar.clear();
@@ -201,14 +257,197 @@ DLL_PUBLIC void SymbolVector::swap( SymbolVector& o)
 }
 
 namespace strus {
+/// \brief Flat open addressing hash index of the symbol table, mapping keys to handles
+/// \note Organized in groups of 16 slots with one control byte per slot (as in Swiss tables):
+///	The control byte of a used slot holds 7 bits of the hash, so that all slots of a group can be
+///	probed at once and the key is only compared for slots with a matching control byte.
+///	A slot holds the hash and the handle of the key, the key itself is found with the handle in the inverse map.
 class InternalMap
-	:public strus::unordered_map<SymbolTable::Key,uint32_t,SymbolTable::HashFunc,SymbolTable::MapKeyEqual>
 {
 public:
-	InternalMap() :strus::unordered_map<SymbolTable::Key,uint32_t,SymbolTable::HashFunc,SymbolTable::MapKeyEqual>(){}
+	enum {GroupSize=16, InitNofGroups=1};
+	enum {CtrlEmpty=-128};
+
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t id;
+	};
+
+	InternalMap()
+		:m_ctrl(0),m_slots(0),m_groupMask(0),m_size(0),m_growthLeft(0)
+	{
+		allocate( InitNofGroups);
+	}
+	~InternalMap()
+	{
+		std::free( m_ctrl);
+		std::free( m_slots);
+	}
+
+	/// \brief Find a key
+	/// \return the handle of the key or 0 if not found
+	uint32_t find( const char* key, std::size_t keylen, uint32_t hash, const std::vector<const char*>& invmap) const
+	{
+		int8_t h2 = ctrlHash( hash);
+		std::size_t gi = hash & m_groupMask;
+		std::size_t step = 0;
+		for (;;)
+		{
+			const int8_t* ctrl = m_ctrl + gi * GroupSize;
+			uint32_t candidates = matchByte( ctrl, h2);
+			while (candidates)
+			{
+				int ci = BitOperations::bitScanForward( candidates) - 1;
+				const Slot& slot = m_slots[ gi * GroupSize + ci];
+				if (slot.hash == hash)
+				{
+					const char* keyptr = invmap[ slot.id-1];
+					if (StringMapKeyBlockList::keyRecordSize( keyptr) == keylen && std::memcmp( keyptr, key, keylen) == 0)
+					{
+						return slot.id;
+					}
+				}
+				candidates &= candidates - 1;
+			}
+			if (matchByte( ctrl, CtrlEmpty)) return 0;
+			gi = (gi + ++step) & m_groupMask;
+		}
+	}
+
+	/// \brief Insert a new key, that has not been inserted yet
+	void insert( uint32_t hash, uint32_t id)
+	{
+		if (!m_growthLeft) grow();
+		insertSlot( hash, id);
+		++m_size;
+		--m_growthLeft;
+	}
+
+	/// \brief Remove all keys, shrinking the table to its initial size
+	/// \note Never fails, the arrays allocated are kept and emptied if the allocation of the initial size fails
+	void clear()
+	{
+		int8_t* old_ctrl = m_ctrl;
+		Slot* old_slots = m_slots;
+		m_size = 0;
+		try
+		{
+			allocate( InitNofGroups);
+		}
+		catch (const std::bad_alloc&)
+		{
+			std::size_t capacity = (m_groupMask + 1) * GroupSize;
+			std::memset( m_ctrl, CtrlEmpty, capacity);
+			m_growthLeft = capacity - capacity / 8;
+			return;
+		}
+		std::free( old_ctrl);
+		std::free( old_slots);
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	static int8_t ctrlHash( uint32_t hash)
+	{
+		return (int8_t)(hash >> 25);
+	}
+
+	/// \brief Get the bitmask of control bytes of a group that are equal to a value
+	static uint32_t matchByte( const int8_t* ctrl, int8_t value)
+	{
+#if defined __SSE2__
+		__m128i grp = _mm_loadu_si128( (const __m128i*)(const void*)ctrl);
+		return _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( value), grp));
+#else
+		uint32_t rt = 0;
+		for (int ci=0; ci<GroupSize; ++ci)
+		{
+			if (ctrl[ ci] == value) rt |= (1U << ci);
+		}
+		return rt;
+#endif
+	}
+
+	void insertSlot( uint32_t hash, uint32_t id)
+	{
+		std::size_t gi = hash & m_groupMask;
+		std::size_t step = 0;
+		for (;;)
+		{
+			int8_t* ctrl = m_ctrl + gi * GroupSize;
+			uint32_t empty = matchByte( ctrl, CtrlEmpty);
+			if (empty)
+			{
+				int ci = BitOperations::bitScanForward( empty) - 1;
+				ctrl[ ci] = ctrlHash( hash);
+				Slot& slot = m_slots[ gi * GroupSize + ci];
+				slot.hash = hash;
+				slot.id = id;
+				return;
+			}
+			gi = (gi + ++step) & m_groupMask;
+		}
+	}
+
+	/// \brief Replace the arrays by new empty ones, the members are not changed if the allocation fails
+	void allocate( std::size_t nofGroups)
+	{
+		std::size_t capacity = nofGroups * GroupSize;
+		int8_t* ctrl = (int8_t*)std::malloc( capacity);
+		Slot* slots = (Slot*)std::malloc( capacity * sizeof(Slot));
+		if (!ctrl || !slots)
+		{
+			std::free( ctrl);
+			std::free( slots);
+			throw std::bad_alloc();
+		}
+		std::memset( ctrl, CtrlEmpty, capacity);
+		m_ctrl = ctrl;
+		m_slots = slots;
+		m_groupMask = nofGroups - 1;
+		m_growthLeft = capacity - capacity / 8 - m_size;	//... maximum load factor 7/8
+	}
+
+	void grow()
+	{
+		int8_t* old_ctrl = m_ctrl;
+		Slot* old_slots = m_slots;
+		std::size_t old_capacity = (m_groupMask + 1) * GroupSize;
+		allocate( (m_groupMask + 1) * 2);
+		for (std::size_t si=0; si<old_capacity; ++si)
+		{
+			if (old_ctrl[ si] != CtrlEmpty)
+			{
+				insertSlot( old_slots[ si].hash, old_slots[ si].id);
+			}
+		}
+		std::free( old_ctrl);
+		std::free( old_slots);
+	}
+
+private:
+	InternalMap( const InternalMap&){}	//... non copyable
+	void operator=( const InternalMap&){}	//... non copyable
+
+private:
+	int8_t* m_ctrl;
+	Slot* m_slots;
+	std::size_t m_groupMask;
+	std::size_t m_size;
+	std::size_t m_growthLeft;
 };
 }
 
+static uint32_t keyHash( const char* key, std::size_t keylen)
+{
+	return (uint32_t)StringHash::calc( key, keylen);
+}
+
 DLL_PUBLIC SymbolTable::~SymbolTable()
 {
 	delete m_map;
@@ -258,25 +497,29 @@ DLL_PUBLIC uint32_t SymbolTable::getOrCreate( const char* keystr, std::size_t ke
 {
 	try
 	{
-		Key newkey( keystr, keylen);
-		InternalMap::const_iterator itr = m_map->find( newkey);
-		m_isnew = (itr == m_map->end());
+		uint32_t hash = keyHash( keystr, keylen);
+		uint32_t rt = m_map->find( keystr, keylen, hash, m_invmap);
+		m_isnew = (rt == 0);
 		if (m_isnew)
 		{
 			if (m_invmap.size() >= (std::size_t)std::numeric_limits<int32_t>::max()-1)
 			{
 				throw std::bad_alloc();
 			}
-			const char* keystr_copy = m_keystring_blocks->allocKey( newkey.str, newkey.len);
+			const char* keystr_copy = m_keystring_blocks->allocKeyRecord( keystr, keylen);
 			m_invmap.push_back( keystr_copy);
-			Key kk( keystr_copy, newkey.len);
-			(*m_map)[ kk] = m_invmap.size();
-			return m_invmap.size();
-		}
-		else
-		{
-			return itr->second;
+			rt = m_invmap.size();
+			try
+			{
+				m_map->insert( hash, rt);
+			}
+			catch (const std::bad_alloc&)
+			{
+				m_invmap.pop_back();
+				throw std::bad_alloc();
+			}
 		}
+		return rt;
 	}
 	catch (const std::bad_alloc&)
 	{
@@ -297,13 +540,7 @@ DLL_PUBLIC uint32_t SymbolTable::get( const std::string& key_) const
 
 DLL_PUBLIC uint32_t SymbolTable::get( const char* keystr, std::size_t keylen) const
 {
-	Key keystruct( keystr, keylen);
-	InternalMap::const_iterator itr = m_map->find( keystruct);
-	if (itr != m_map->end())
-	{
-		return itr->second;
-	}
-	return 0;
+	return m_map->find( keystr, keylen, keyHash( keystr, keylen), m_invmap);
 }
 
 DLL_PUBLIC const char* SymbolTable::key( const uint32_t& value) const
@@ -312,6 +549,12 @@ DLL_PUBLIC const char* SymbolTable::key( const uint32_t& value) const
 	return m_invmap[ value-1];
 }
 
+DLL_PUBLIC std::size_t SymbolTable::keySize( const uint32_t& value) const
+{
+	if (!value || value > (uint32_t)m_invmap.size()) return 0;
+	return StringMapKeyBlockList::keyRecordSize( m_invmap[ value-1]);
+}
+
 DLL_PUBLIC void* SymbolTable::allocBlock( unsigned int blocksize, unsigned int elemsize)
 {
 	return m_keystring_blocks->allocBlock( blocksize, elemsize);
@@ -341,3 +584,80 @@ DLL_PUBLIC void SymbolTable::swap( SymbolTable& o)
 	std::swap( m_isnew, o.m_isnew);
 }
 
+DLL_PUBLIC bool SymbolTable::save( const std::string& filename) const
+{
+	try
+	{
+		typedef SymbolTableFile::Header Header;
+		typedef SymbolTableFile::Slot Slot;
+
+		// [1] Calculate the size of the keys:
+		uint32_t nofSymbols = m_invmap.size();
+		uint64_t stringsSize = 0;
+		std::vector<const char*>::const_iterator ki = m_invmap.begin(), ke = m_invmap.end();
+		for (; ki != ke; ++ki)
+		{
+			stringsSize += StringMapKeyBlockList::keyRecordSize( *ki) + 1;
+		}
+		// [2] Build the file content:
+		uint32_t hashTableSize = SymbolTableFile::hashTableSize( nofSymbols);
+		if (!hashTableSize) throw std::bad_alloc();
+		Header hdr;
+		std::memset( &hdr, 0, sizeof(hdr));
+		std::memcpy( hdr.magic, SymbolTableFile::magic(), sizeof(hdr.magic));
+		hdr.version = SymbolTableFile::Version;
+		hdr.byteOrderMark = SymbolTableFile::ByteOrderMark;
+		hdr.nofSymbols = nofSymbols;
+		hdr.hashTableSize = hashTableSize;
+		hdr.keyOffsetsPos = sizeof(Header);
+		hdr.hashTablePos = hdr.keyOffsetsPos + ((uint64_t)nofSymbols + 1) * sizeof(uint64_t);
+		hdr.stringsPos = hdr.hashTablePos + (uint64_t)hashTableSize * sizeof(Slot);
+		hdr.fileSize = hdr.stringsPos + stringsSize;
+		if (hdr.fileSize > (uint64_t)std::numeric_limits<std::size_t>::max()) throw std::bad_alloc();
+
+		std::string content( hdr.fileSize, '\0');
+		char* base = const_cast<char*>( content.c_str());
+		std::memcpy( base, &hdr, sizeof(hdr));
+		uint64_t* offsets = (uint64_t*)(void*)(base + hdr.keyOffsetsPos);
+		Slot* slots = (Slot*)(void*)(base + hdr.hashTablePos);
+		char* strings = base + hdr.stringsPos;
+		uint64_t strpos = 0;
+		uint32_t mask = hashTableSize - 1;
+
+		ki = m_invmap.begin();
+		for (uint32_t id=1; ki != ke; ++ki,++id)
+		{
+			std::size_t keylen = StringMapKeyBlockList::keyRecordSize( *ki);
+			offsets[ id-1] = strpos;
+			std::memcpy( strings + strpos, *ki, keylen);
+			strpos += keylen + 1;
+
+			uint32_t hash = SymbolTableFile::hash( *ki, keylen);
+			uint32_t pos = hash & mask;
+			while (slots[ pos].id) pos = (pos + 1) & mask;
+			slots[ pos].hash = hash;
+			slots[ pos].id = id;
+		}
+		offsets[ nofSymbols] = strpos;
+
+		// [3] Write the file:
+		int ec = strus::writeFile( filename, content);
+		if (ec)
+		{
+			if (m_errorhnd) m_errorhnd->report( ErrorCodeIOError, _TXT("error writing symbol table file '%s': %s"), filename.c_str(), ::strerror(ec));
+			return false;
+		}
+		return true;
+	}
+	catch (const std::bad_alloc&)
+	{
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeOutOfMem, _TXT("out of memory"));
+		return false;
+	}
+	catch (const std::exception& err)
+	{
+		if (m_errorhnd) m_errorhnd->report( ErrorCodeRuntimeError, "%s", err.what());
+		return false;
+	}
+}
+
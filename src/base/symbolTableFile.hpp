@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Layout of a symbol table snapshot file that can be mapped into memory
+///\note Written by SymbolTable::save and read by MappedSymbolTable
+///\remark Layout: [Header][key offsets: uint64_t x (nofSymbols+1)][hash table: Slot x hashTableSize][keys: 0-terminated strings]
+#ifndef _STRUS_BASE_SYMBOL_TABLE_FILE_HPP_INCLUDED
+#define _STRUS_BASE_SYMBOL_TABLE_FILE_HPP_INCLUDED
+#include "strus/base/crc32.hpp"
+#include "strus/base/stdint.h"
+#include <cstring>
+
+namespace strus {
+
+struct SymbolTableFile
+{
+	enum {Version=1, ByteOrderMark=0x01020304};
+
+	/// \brief Header of the file
+	struct Header
+	{
+		char magic[8];			///< "STRUSSYM" (not 0-terminated)
+		uint32_t version;		///< version of the file format
+		uint32_t byteOrderMark;		///< ByteOrderMark written in native byte order, file is rejected if it does not match
+		uint32_t nofSymbols;		///< number of symbols, handles are 1..nofSymbols
+		uint32_t hashTableSize;		///< number of slots in the hash table, a power of 2
+		uint64_t keyOffsetsPos;		///< file position of the key offset array, the offsets are relative to stringsPos
+		uint64_t hashTablePos;		///< file position of the hash table
+		uint64_t stringsPos;		///< file position of the key strings
+		uint64_t fileSize;		///< size of the whole file in bytes
+	};
+
+	/// \brief Element of the hash table (open addressing with linear probing)
+	struct Slot
+	{
+		uint32_t hash;			///< hash value of the key
+		uint32_t id;			///< handle of the key, 0 for an empty slot
+	};
+
+	static const char* magic()
+	{
+		return "STRUSSYM";
+	}
+
+	/// \brief Hash function used for the table in the file, must never change for a version of the file format
+	static uint32_t hash( const char* key, std::size_t keylen)
+	{
+		return utils::Crc32::calc( key, keylen);
+	}
+
+	/// \brief Get the size of the hash table for a number of symbols
+	/// \return the size or 0 if the number of symbols is too big
+	static uint32_t hashTableSize( uint32_t nofSymbols)
+	{
+		uint64_t rt = 16;
+		while (rt < (uint64_t)nofSymbols * 2) rt *= 2;
+		return rt > ((uint64_t)1 << 31) ? 0 : (uint32_t)rt;
+	}
+};
+
+}//namespace
+#endif
+
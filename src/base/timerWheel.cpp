@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Hierarchical timer wheel for many independent timeouts
+#include "strus/base/timerWheel.hpp"
+#include "strus/base/dll_tags.hpp"
+#include <limits>
+#include <cstring>
+#include <new>
+
+using namespace strus;
+
+#define MAX_DELTA ((uint64_t)1 << (TimerWheel::LevelBits * TimerWheel::NofLevels))
+
+DLL_PUBLIC TimerWheel::TimerWheel( uint64_t now_)
+	:m_now(now_),m_size(0),m_nodes(),m_freelist(0)
+{
+	std::memset( m_levelSize, 0, sizeof(m_levelSize));
+	std::memset( m_slots, 0, sizeof(m_slots));
+}
+
+DLL_PUBLIC void TimerWheel::link( uint32_t nodeidx)
+{
+	Node& node = m_nodes[ nodeidx];
+	uint64_t expiry = node.expiry < m_now ? m_now : node.expiry;
+	uint64_t delta = expiry - m_now;
+	if (delta >= MAX_DELTA)
+	{
+		//... out of the range of the wheel, put into the highest level and revisit when cascaded
+		delta = MAX_DELTA - 1;
+		expiry = m_now + delta;
+	}
+	int level = 0;
+	while (delta >= ((uint64_t)1 << (LevelBits * (level+1)))) ++level;
+	uint32_t slotidx = level * SlotsPerLevel + (uint32_t)((expiry >> (LevelBits * level)) & (SlotsPerLevel-1));
+
+	node.prev = 0;
+	node.next = m_slots[ slotidx];
+	if (node.next) m_nodes[ node.next-1].prev = nodeidx+1;
+	m_slots[ slotidx] = nodeidx+1;
+	node.slot = slotidx;
+	++m_levelSize[ level];
+}
+
+DLL_PUBLIC void TimerWheel::unlink( uint32_t nodeidx)
+{
+	Node& node = m_nodes[ nodeidx];
+	if (node.prev)
+	{
+		m_nodes[ node.prev-1].next = node.next;
+	}
+	else
+	{
+		m_slots[ node.slot] = node.next;
+	}
+	if (node.next)
+	{
+		m_nodes[ node.next-1].prev = node.prev;
+	}
+	--m_levelSize[ node.slot / SlotsPerLevel];
+	node.slot = NoSlot;
+	node.prev = 0;
+	node.next = 0;
+}
+
+DLL_PUBLIC void TimerWheel::freeNode( uint32_t nodeidx)
+{
+	Node& node = m_nodes[ nodeidx];
+	node.proc = 0;
+	node.context = 0;
+	node.deleter = 0;
+	node.next = m_freelist;
+	m_freelist = nodeidx+1;
+	--m_size;
+}
+
+DLL_PUBLIC TimerWheel::TimerId TimerWheel::schedule( uint64_t expiry, TimerProc proc, void* context, TimerDeleter deleter)
+{
+	uint32_t nodeidx;
+	if (m_freelist)
+	{
+		nodeidx = m_freelist-1;
+		m_freelist = m_nodes[ nodeidx].next;
+	}
+	else
+	{
+		if (m_nodes.size() >= (std::size_t)NoSlot - 1) throw std::bad_alloc();
+		m_nodes.push_back( Node());
+		nodeidx = m_nodes.size()-1;
+	}
+	Node& node = m_nodes[ nodeidx];
+	node.expiry = expiry <= m_now ? m_now+1 : expiry;
+	node.proc = proc;
+	node.context = context;
+	node.deleter = deleter;
+	++node.generation;
+	link( nodeidx);
+	++m_size;
+	return ((uint64_t)node.generation << 32) | (nodeidx+1);
+}
+
+DLL_PUBLIC bool TimerWheel::cancel( TimerId id, Timer& timer)
+{
+	uint32_t nodeidx = (uint32_t)(id & 0xffffFFFFU);
+	uint32_t generation = (uint32_t)(id >> 32);
+	if (!nodeidx || nodeidx > m_nodes.size()) return false;
+	--nodeidx;
+	Node& node = m_nodes[ nodeidx];
+	if (node.slot == NoSlot || node.generation != generation) return false;
+	timer = Timer( node.expiry, node.proc, node.context, node.deleter);
+	unlink( nodeidx);
+	freeNode( nodeidx);
+	return true;
+}
+
+DLL_PUBLIC void TimerWheel::cascade( int level)
+{
+	uint32_t idx = (uint32_t)((m_now >> (LevelBits * level)) & (SlotsPerLevel-1));
+	if (idx == 0 && level+1 < NofLevels)
+	{
+		cascade( level+1);
+	}
+	uint32_t slotidx = level * SlotsPerLevel + idx;
+	uint32_t ni = m_slots[ slotidx];
+	m_slots[ slotidx] = 0;
+	while (ni)
+	{
+		Node& node = m_nodes[ ni-1];
+		uint32_t next = node.next;
+		--m_levelSize[ level];
+		link( ni-1);
+		ni = next;
+	}
+}
+
+DLL_PUBLIC void TimerWheel::tick( std::vector<Timer>& expired)
+{
+	++m_now;
+	uint32_t idx = (uint32_t)(m_now & (SlotsPerLevel-1));
+	if (idx == 0)
+	{
+		cascade( 1);
+	}
+	uint32_t ni = m_slots[ idx];
+	while (ni)
+	{
+		Node& node = m_nodes[ ni-1];
+		uint32_t next = node.next;
+		if (node.expiry <= m_now)
+		{
+			expired.push_back( Timer( node.expiry, node.proc, node.context, node.deleter));
+			unlink( ni-1);
+			freeNode( ni-1);
+		}
+		else
+		{
+			unlink( ni-1);
+			link( ni-1);
+		}
+		ni = next;
+	}
+}
+
+DLL_PUBLIC void TimerWheel::advance( uint64_t now_, std::vector<Timer>& expired)
+{
+	while (m_now < now_)
+	{
+		uint64_t next = nextEventTime();
+		if (next > now_)
+		{
+			m_now = now_;
+			break;
+		}
+		//... skip the ticks without timers expiring or cascading
+		if (next > m_now + 1) m_now = next - 1;
+		tick( expired);
+	}
+}
+
+DLL_PUBLIC void TimerWheel::clear( std::vector<Timer>& removed)
+{
+	removed.reserve( removed.size() + m_size);
+	std::vector<Node>::const_iterator ni = m_nodes.begin(), ne = m_nodes.end();
+	for (; ni != ne; ++ni)
+	{
+		if (ni->slot != NoSlot) removed.push_back( Timer( ni->expiry, ni->proc, ni->context, ni->deleter));
+	}
+	//... the nodes are kept with their generation, so that handles of removed timers stay invalid
+	for (uint32_t nodeidx=0; nodeidx < m_nodes.size(); ++nodeidx)
+	{
+		if (m_nodes[ nodeidx].slot != NoSlot)
+		{
+			unlink( nodeidx);
+			freeNode( nodeidx);
+		}
+	}
+}
+
+DLL_PUBLIC uint64_t TimerWheel::nextEventTime() const
+{
+	uint64_t rt = std::numeric_limits<uint64_t>::max();
+	int level = 1;
+	for (; level < NofLevels; ++level)
+	{
+		if (m_levelSize[ level])
+		{
+			rt = ((m_now >> (LevelBits * level)) + 1) << (LevelBits * level);
+			break;
+		}
+	}
+	if (m_levelSize[ 0])
+	{
+		uint64_t tm = m_now + 1;
+		for (; tm < rt && tm < m_now + SlotsPerLevel; ++tm)
+		{
+			if (m_slots[ tm & (SlotsPerLevel-1)]) return tm;
+		}
+	}
+	return rt;
+}
+
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/arena.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <string>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+static void testAlignedAllocation()
+{
+	strus::Arena arena( 1024);
+	std::vector<std::pair<char*,std::size_t> > blocks;
+	for (int ii=0; ii<10000; ++ii)
+	{
+		std::size_t size = g_random.get( 0, ii % 100 == 0 ? 5000 : 100);
+		std::size_t alignment = (std::size_t)1 << g_random.get( 0, 7);
+		char* blk = (char*)arena.alloc( size, alignment);
+		if (((uintptr_t)blk & (alignment-1)) != 0) throw std::runtime_error( strus::string_format( "block %d not aligned to %d bytes", ii, (int)alignment));
+		std::memset( blk, ii & 0xff, size);
+		blocks.push_back( std::pair<char*,std::size_t>( blk, size));
+	}
+	// ... check that blocks do not overlap
+	for (std::size_t bi=0; bi<blocks.size(); ++bi)
+	{
+		for (std::size_t ci=0; ci<blocks[bi].second; ++ci)
+		{
+			if (blocks[bi].first[ci] != (char)(bi & 0xff)) throw std::runtime_error( strus::string_format( "block %d overwritten", (int)bi));
+		}
+	}
+	const char* str = arena.allocStringCopy( "hello world", 5);
+	if (0!=std::strcmp( str, "hello")) throw std::runtime_error( "string copy failed");
+}
+
+static void testMarkRewind()
+{
+	strus::Arena arena( 1024);
+	void* first = arena.alloc( 100);
+	strus::Arena::Mark mark = arena.mark();
+	void* second = arena.alloc( 100);
+	std::size_t nofChunks = arena.nofChunks();
+	{
+		strus::Arena::Scope scope( arena);
+		for (int ii=0; ii<200; ++ii) arena.alloc( 100);
+		if (arena.nofChunks() <= nofChunks) throw std::runtime_error( "expected chunks to be allocated");
+	}
+	if (arena.nofChunks() != nofChunks) throw std::runtime_error( "chunks not released by scope");
+	arena.rewind( mark);
+	if (arena.alloc( 100) != second) throw std::runtime_error( "memory not reused after rewind");
+	arena.clear();
+	if (arena.nofChunks() != 0) throw std::runtime_error( "chunks not released by clear");
+	if (arena.alloc( 100) != first) throw std::runtime_error( "chunk not reused after clear");
+}
+
+static void testOversizedAllocation()
+{
+	strus::Arena arena( 1024);
+	char* first = (char*)arena.alloc( 100);
+	strus::Arena::Mark mark = arena.mark();
+	char* big = (char*)arena.alloc( 5000);
+	std::memset( big, 1, 5000);
+	if (arena.nofChunks() != 2) throw std::runtime_error( "oversized block not allocated in a chunk of its own");
+	//... the allocation continues in the chunk used before the oversized block
+	char* second = (char*)arena.alloc( 100);
+	if (second != first + 112) throw std::runtime_error( "rest of chunk abandoned after allocation of an oversized block");
+	if (arena.nofChunks() != 2) throw std::runtime_error( "unexpected chunk allocated after an oversized block");
+	arena.rewind( mark);
+	if (arena.nofChunks() != 1) throw std::runtime_error( "chunk of oversized block not released by rewind");
+	if (arena.alloc( 100) != second) throw std::runtime_error( "memory not reused after rewind of an oversized block");
+
+	//... rewind to a mark taken after an oversized block
+	arena.alloc( 3000);
+	strus::Arena::Mark bigmark = arena.mark();
+	char* third = (char*)arena.alloc( 100);
+	for (int ii=0; ii<50; ++ii) arena.alloc( 100);
+	arena.rewind( bigmark);
+	if (arena.nofChunks() != 2 || arena.alloc( 100) != third) throw std::runtime_error( "rewind to a mark taken after an oversized block failed");
+	arena.clear();
+	if (arena.nofChunks() != 0) throw std::runtime_error( "chunks not released by clear");
+}
+
+static void testAllocatorAdaptor()
+{
+	strus::Arena arena;
+	strus::Arena::Scope scope( arena);
+	typedef std::basic_string<char,std::char_traits<char>,strus::ArenaAllocator<char> > ArenaString;
+	typedef std::map<int,ArenaString,std::less<int>,strus::ArenaAllocator<std::pair<const int,ArenaString> > > ArenaMap;
+	typedef std::vector<int,strus::ArenaAllocator<int> > ArenaVector;
+
+	ArenaVector vec( (strus::ArenaAllocator<int>( arena)));
+	std::less<int> cmp;
+	ArenaMap map( cmp, strus::ArenaAllocator<std::pair<const int,ArenaString> >( arena));
+	for (int ii=0; ii<10000; ++ii)
+	{
+		vec.push_back( ii);
+		std::string str = strus::string_format( "value %d of a string that is long enough to need an allocation", ii);
+		map.insert( ArenaMap::value_type( ii, ArenaString( str.c_str(), strus::ArenaAllocator<char>( arena))));
+	}
+	for (int ii=0; ii<10000; ++ii)
+	{
+		std::string str = strus::string_format( "value %d of a string that is long enough to need an allocation", ii);
+		if (vec[ ii] != ii) throw std::runtime_error( "unexpected value in vector allocated in arena");
+		ArenaMap::const_iterator mi = map.find( ii);
+		if (mi == map.end() || mi->second.c_str() != str) throw std::runtime_error( "unexpected value in map allocated in arena");
+	}
+}
+
+static void getLocalArena( strus::Arena** result)
+{
+	*result = &strus::Arena::local();
+	(*result)->alloc( 10);
+}
+
+static void testLocalArena()
+{
+	strus::Arena* arena1 = 0;
+	strus::Arena* arena2 = 0;
+	getLocalArena( &arena1);
+	strus::thread thread( &getLocalArena, &arena2);
+	thread.join();
+	if (arena1 != &strus::Arena::local() || arena1 == arena2) throw std::runtime_error( "arenas of different threads are not different");
+}
+
+int main( int, const char**)
+{
+	try
+	{
+		testAlignedAllocation();
+		testMarkRewind();
+		testOversizedAllocation();
+		testAllocatorAdaptor();
+		testLocalArena();
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/atomic_bitset.hpp"
+#include "strus/base/bitset.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+/// \brief Thread marking positions of a shared set, counting the positions it marked first
+template <class AtomicBitSet>
+class Marker
+{
+public:
+	Marker( AtomicBitSet* set_, const std::vector<int>& positions_)
+		:m_set(set_),m_positions(positions_),m_nofFirst(0){}
+
+	void run()
+	{
+		std::vector<int>::const_iterator pi = m_positions.begin(), pe = m_positions.end();
+		for (; pi != pe; ++pi)
+		{
+			if (!m_set->test_and_set( *pi)) ++m_nofFirst;
+		}
+	}
+
+	int nofFirst() const	{return m_nofFirst;}
+
+private:
+	AtomicBitSet* m_set;
+	std::vector<int> m_positions;
+	int m_nofFirst;
+};
+
+/// \brief Thread toggling the positions of a shared set assigned to it (position modulo number of threads), sharing the words with the other threads
+template <class AtomicBitSet>
+class Toggler
+{
+public:
+	Toggler( AtomicBitSet* set_, int threadIdx_, int nofThreads_, int dim_, int nofOperations_)
+		:m_set(set_),m_threadIdx(threadIdx_),m_nofThreads(nofThreads_),m_dim(dim_),m_nofOperations(nofOperations_),m_nofErrors(0),m_random(threadIdx_){}
+
+	void run()
+	{
+		int oi = 0;
+		for (; oi < m_nofOperations; ++oi)
+		{
+			int pos = m_random.get( 0, m_dim / m_nofThreads) * m_nofThreads + m_threadIdx;
+			if (pos >= m_dim) continue;
+			bool value = m_random.get( 0, 2) == 0;
+			bool prev = value ? m_set->test_and_set( pos) : m_set->test_and_reset( pos);
+			bool expected = m_expected.find( pos) != m_expected.end();
+			if (prev != expected) ++m_nofErrors;
+			if (value) m_expected.insert( pos); else m_expected.erase( pos);
+		}
+	}
+
+	int nofErrors() const			{return m_nofErrors;}
+	const std::set<int>& expected() const	{return m_expected;}
+
+private:
+	AtomicBitSet* m_set;
+	int m_threadIdx;
+	int m_nofThreads;
+	int m_dim;
+	int m_nofOperations;
+	int m_nofErrors;
+	strus::PseudoRandom m_random;
+	std::set<int> m_expected;
+};
+
+/// \brief Thread scanning a shared set with next while other threads are marking positions
+template <class AtomicBitSet>
+class Scanner
+{
+public:
+	Scanner( const AtomicBitSet* set_, const std::set<int>* allowed_, strus::AtomicFlag* terminate_)
+		:m_set(set_),m_allowed(allowed_),m_terminate(terminate_),m_nofErrors(0),m_nofScans(0){}
+
+	void run()
+	{
+		while (!m_terminate->test())
+		{
+			int prev = -1;
+			int pos = m_set->first();
+			for (; pos >= 0; prev = pos, pos = m_set->next( pos))
+			{
+				if (pos <= prev || m_allowed->find( pos) == m_allowed->end()) ++m_nofErrors;
+			}
+			++m_nofScans;
+		}
+	}
+
+	int nofErrors() const	{return m_nofErrors;}
+	int nofScans() const	{return m_nofScans;}
+
+private:
+	const AtomicBitSet* m_set;
+	const std::set<int>* m_allowed;
+	strus::AtomicFlag* m_terminate;
+	int m_nofErrors;
+	int m_nofScans;
+};
+
+template <class AtomicBitSet>
+static void checkElements( const AtomicBitSet& set, const std::set<int>& expected, const char* context)
+{
+	std::vector<int> elements = set.elements();
+	if (elements.size() != expected.size() || !std::equal( elements.begin(), elements.end(), expected.begin()))
+	{
+		throw std::runtime_error( strus::string_format( "%s: elements of the set do not match the expected (%d elements instead of %d)", context, (int)elements.size(), (int)expected.size()));
+	}
+	std::set<int>::const_iterator ei = expected.begin(), ee = expected.end();
+	for (; ei != ee; ++ei)
+	{
+		if (!set.test( *ei)) throw std::runtime_error( strus::string_format( "%s: test of position %d failed", context, *ei));
+	}
+}
+
+/// \brief Mark random positions by several threads with concurrent scans, every position must be marked first by exactly one thread
+template <class AtomicBitSet>
+static void testMarking( AtomicBitSet& set, int dim, int nofThreads, int nofPositions, const char* name)
+{
+	std::vector<std::vector<int> > positions( nofThreads);
+	std::set<int> allowed;
+	int ti = 0;
+	for (; ti < nofThreads; ++ti)
+	{
+		int pi = 0;
+		for (; pi < nofPositions; ++pi)
+		{
+			int pos = g_random.get( 0, dim);
+			positions[ ti].push_back( pos);
+			allowed.insert( pos);
+		}
+	}
+	std::vector<strus::shared_ptr<Marker<AtomicBitSet> > > markers;
+	std::vector<strus::shared_ptr<Scanner<AtomicBitSet> > > scanners;
+	std::vector<strus::shared_ptr<strus::thread> > markerThreads;
+	std::vector<strus::shared_ptr<strus::thread> > scannerThreads;
+	strus::AtomicFlag terminate;
+	for (ti = 0; ti < 2; ++ti)
+	{
+		scanners.push_back( strus::shared_ptr<Scanner<AtomicBitSet> >( new Scanner<AtomicBitSet>( &set, &allowed, &terminate)));
+		scannerThreads.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Scanner<AtomicBitSet>::run, scanners.back().get())));
+	}
+	for (ti = 0; ti < nofThreads; ++ti)
+	{
+		markers.push_back( strus::shared_ptr<Marker<AtomicBitSet> >( new Marker<AtomicBitSet>( &set, positions[ ti])));
+		markerThreads.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Marker<AtomicBitSet>::run, markers.back().get())));
+	}
+	std::vector<strus::shared_ptr<strus::thread> >::iterator gi = markerThreads.begin(), ge = markerThreads.end();
+	for (; gi != ge; ++gi) (*gi)->join();
+	terminate.set( true);
+	for (gi = scannerThreads.begin(), ge = scannerThreads.end(); gi != ge; ++gi) (*gi)->join();
+
+	int nofFirst = 0;
+	for (ti = 0; ti < nofThreads; ++ti) nofFirst += markers[ ti]->nofFirst();
+	int nofScanErrors = 0;
+	int nofScans = 0;
+	for (ti = 0; ti < (int)scanners.size(); ++ti)
+	{
+		nofScanErrors += scanners[ ti]->nofErrors();
+		nofScans += scanners[ ti]->nofScans();
+	}
+	std::cerr << name << ": marked " << allowed.size() << " positions by " << nofThreads << " threads during " << nofScans << " scans" << std::endl;
+	if (nofFirst != (int)allowed.size())
+	{
+		throw std::runtime_error( strus::string_format( "%s: %d positions marked first, expected %d", name, nofFirst, (int)allowed.size()));
+	}
+	if (nofScanErrors)
+	{
+		throw std::runtime_error( strus::string_format( "%s: %d positions not ascending or not marked found by scans", name, nofScanErrors));
+	}
+	checkElements( set, allowed, name);
+}
+
+/// \brief Set and clear positions by several threads sharing the same words, no update of another thread may be lost
+template <class AtomicBitSet>
+static void testToggling( AtomicBitSet& set, int dim, int nofThreads, int nofOperations, const char* name)
+{
+	set.reset();
+	std::vector<strus::shared_ptr<Toggler<AtomicBitSet> > > togglers;
+	std::vector<strus::shared_ptr<strus::thread> > threadGroup;
+	int ti = 0;
+	for (; ti < nofThreads; ++ti)
+	{
+		togglers.push_back( strus::shared_ptr<Toggler<AtomicBitSet> >( new Toggler<AtomicBitSet>( &set, ti, nofThreads, dim, nofOperations)));
+		threadGroup.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Toggler<AtomicBitSet>::run, togglers.back().get())));
+	}
+	std::vector<strus::shared_ptr<strus::thread> >::iterator gi = threadGroup.begin(), ge = threadGroup.end();
+	for (; gi != ge; ++gi) (*gi)->join();
+
+	std::set<int> expected;
+	int nofErrors = 0;
+	for (ti = 0; ti < nofThreads; ++ti)
+	{
+		nofErrors += togglers[ ti]->nofErrors();
+		expected.insert( togglers[ ti]->expected().begin(), togglers[ ti]->expected().end());
+	}
+	std::cerr << name << ": toggled " << nofOperations << " positions by each of " << nofThreads << " threads, " << expected.size() << " set" << std::endl;
+	if (nofErrors)
+	{
+		throw std::runtime_error( strus::string_format( "%s: %d operations returned an unexpected previous value", name, nofErrors));
+	}
+	checkElements( set, expected, name);
+}
+
+/// \brief Single threaded check of the interface shared with bitset
+static void testInterface()
+{
+	strus::atomic_bitset<300> set;
+	strus::bitset<300> other;
+	if (!set.empty() || set.first() != -1) throw std::runtime_error( "atomic bitset not empty after construction");
+	if (!set.set( 5, true) || set.set( 5, true) || !set.test_and_set( 5) || set.test_and_set( 299)) throw std::runtime_error( "atomic bitset set returns wrong value");
+	if (set.test_and_set( 300) || set.test( 300) || set.set( -1, true)) throw std::runtime_error( "atomic bitset accepts position out of range");
+	other.set( 5, true);
+	if (set.join( other)) throw std::runtime_error( "atomic bitset join of a subset reports a change");
+	other.set( 64, true);
+	other.set( 200, true);
+	if (!set.join( other)) throw std::runtime_error( "atomic bitset join does not report a change");
+	if (set.size() != 4 || set.next( 5) != 64 || set.next( 200) != 299 || set.next( 299) != -1) throw std::runtime_error( "atomic bitset contents wrong after join");
+	if (!set.test_and_reset( 64) || set.test_and_reset( 64) || !set.set( 200, false) || set.size() != 2) throw std::runtime_error( "atomic bitset reset returns wrong value");
+
+	strus::atomic_dynamic_bitset dynset( 1000);
+	if (dynset.size() != 1000 || dynset.count() != 0) throw std::runtime_error( "atomic dynamic bitset not empty after construction");
+	if (!dynset.set( 999) || dynset.test_and_set( 0) || dynset.set( 1000) || dynset.count() != 2 || dynset.first() != 0 || dynset.next( 0) != 999) throw std::runtime_error( "atomic dynamic bitset contents wrong");
+	dynset.reset();
+	if (dynset.count() != 0 || dynset.first() != -1) throw std::runtime_error( "atomic dynamic bitset not empty after reset");
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofThreads = 8;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testAtomicBitSet [<nofthreads>]" << std::endl;
+			std::cout << "       <nofthreads> :Number of threads marking positions concurrently (default 8)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofThreads = parseNumber( argv[1]);
+		if (argc > 2) throw std::runtime_error( "too many arguments");
+		if (nofThreads <= 0) throw std::runtime_error( "number of threads must be positive");
+
+		testInterface();
+		{
+			strus::atomic_bitset<4096> set;
+			testMarking( set, 4096, nofThreads, 2000, "atomic_bitset<4096>");
+			testToggling( set, 4096, nofThreads, 20000, "atomic_bitset<4096>");
+		}
+		{
+			strus::atomic_dynamic_bitset set( 1000000);
+			testMarking( set, 1000000, nofThreads, 50000, "atomic_dynamic_bitset");
+			testToggling( set, 1000000, nofThreads, 50000, "atomic_dynamic_bitset");
+		}
+		{
+			strus::atomic_dynamic_bitset set( 200);
+			testToggling( set, 200, nofThreads, 100000, "atomic_dynamic_bitset small");
+		}
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
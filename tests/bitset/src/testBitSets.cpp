@@ -7,6 +7,8 @@
  */
 #include "strus/base/bitset.hpp"
 #include "strus/base/dynamic_bitset.hpp"
+#include "strus/base/compressed_bitset.hpp"
+#include "strus/base/bitSetKernels.hpp"
 #include "strus/base/string_format.hpp"
 #include "strus/base/pseudoRandom.hpp"
 #include <stdexcept>
@@ -16,6 +18,9 @@
 #include <limits>
 #include <cstdlib>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
@@ -106,6 +111,329 @@ static void testDynamicBitSet( int times, int maximum, int nofElements)
 	std::cerr << "executed testDynamicBitSet( " << times << ", " << maximum << ", " << nofElements << ")" << std::endl;
 }
 
+static std::set<int> randomDynamicBitSet( strus::dynamic_bitset& testset, int maximum, int nofElements)
+{
+	std::set<int> rt;
+	//... elements clustered in a part of the range, so that some blocks are allocated in one of the operands only
+	int start = g_random.get( 0, maximum / 2);
+	int end = g_random.get( start + 1, maximum + 1);
+	for (int ei=0; ei<nofElements; ++ei)
+	{
+		int elem = g_random.get( start, end);
+		rt.insert( elem);
+		testset.set( elem, true);
+	}
+	return rt;
+}
+
+static void checkDynamicBitSet( const strus::dynamic_bitset& testset, const std::set<int>& eset, const char* operation)
+{
+	std::vector<int> elements;
+	for (int pi = testset.first(); pi >= 0; pi = testset.next( pi)) elements.push_back( pi);
+	std::vector<int> iterated( testset.begin(), testset.end());
+	if (elements.size() != eset.size() || !std::equal( elements.begin(), elements.end(), eset.begin()) || elements != iterated || testset.count() != eset.size())
+	{
+		std::cerr << "elements of dynamic bitset after " << operation << " differ from expected: size " << elements.size() << " count " << testset.count() << " expected " << eset.size() << std::endl;
+		if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "dynamic bitset operation test failed");
+	}
+}
+
+static void testDynamicBitSetOperations( int times, int maximum, int nofElements)
+{
+	for (int ti=0; ti<times; ++ti)
+	{
+		strus::dynamic_bitset set1( maximum);
+		strus::dynamic_bitset set2( maximum);
+		std::set<int> eset1 = randomDynamicBitSet( set1, maximum, nofElements);
+		std::set<int> eset2 = randomDynamicBitSet( set2, maximum, g_random.get( 0, nofElements + 1));
+		checkDynamicBitSet( set1, eset1, "set");
+		checkDynamicBitSet( set2, eset2, "set");
+
+		std::set<int> expected;
+		std::set_intersection( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		strus::dynamic_bitset result( set1);
+		result &= set2;
+		checkDynamicBitSet( result, expected, "intersection");
+
+		expected.clear();
+		std::set_union( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result |= set2;
+		checkDynamicBitSet( result, expected, "union");
+
+		expected.clear();
+		std::set_symmetric_difference( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result ^= set2;
+		checkDynamicBitSet( result, expected, "symmetric difference");
+
+		expected.clear();
+		std::set_difference( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result -= set2;
+		checkDynamicBitSet( result, expected, "difference");
+
+		result = set1;
+		result ^= result;
+		checkDynamicBitSet( result, std::set<int>(), "symmetric difference with itself");
+		result = set1;
+		result -= result;
+		checkDynamicBitSet( result, std::set<int>(), "difference with itself");
+	}
+	std::cerr << "executed testDynamicBitSetOperations( " << times << ", " << maximum << ", " << nofElements << ")" << std::endl;
+}
+
+enum CompressedSetPattern {SparsePattern,DensePattern,RunPattern};
+static const char* compressedSetPatternName( CompressedSetPattern pattern)
+{
+	static const char* ar[] = {"sparse","dense","runs"};
+	return ar[ pattern];
+}
+
+/// \brief Fill a compressed bitset with random elements of a pattern that makes it use array, bitmap or run containers
+static void fillCompressedBitSet( strus::compressed_bitset& testset, std::set<int>& eset, int maximum, CompressedSetPattern pattern)
+{
+	switch (pattern)
+	{
+		case SparsePattern:
+			for (int ei=0, ee=maximum/1000+1; ei<ee; ++ei)
+			{
+				int elem = g_random.get( 0, maximum);
+				eset.insert( elem);
+				testset.set( elem, true);
+			}
+			break;
+		case DensePattern:
+			for (int ei=0, ee=maximum/3; ei<ee; ++ei)
+			{
+				int elem = g_random.get( 0, maximum);
+				eset.insert( elem);
+				testset.set( elem, true);
+			}
+			break;
+		case RunPattern:
+			for (int ei=0, ee=maximum/5000+1; ei<ee; ++ei)
+			{
+				int start = g_random.get( 0, maximum);
+				int end = std::min( maximum, start + g_random.get( 1, 3000));
+				for (int pos = start; pos < end; ++pos)
+				{
+					eset.insert( pos);
+					testset.set( pos, true);
+				}
+			}
+			break;
+	}
+	//... punch some holes
+	for (int ei=0, ee=maximum/2000+1; ei<ee; ++ei)
+	{
+		int elem = g_random.get( 0, maximum);
+		eset.erase( elem);
+		testset.set( elem, false);
+	}
+}
+
+static void checkCompressedBitSet( const strus::compressed_bitset& testset, const std::set<int>& eset, const char* operation)
+{
+	std::vector<int> elements = testset.elements();
+	if (elements.size() != eset.size() || !std::equal( elements.begin(), elements.end(), eset.begin()) || testset.count() != eset.size())
+	{
+		std::cerr << "elements of compressed bitset after " << operation << " differ from expected: size " << elements.size() << " count " << testset.count() << " expected " << eset.size() << std::endl;
+		if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "compressed bitset test failed");
+	}
+	std::set<int>::const_iterator si = eset.begin(), se = eset.end();
+	for (; si != se; ++si)
+	{
+		if (!testset.test( *si))
+		{
+			std::cerr << "element " << *si << " not found in compressed bitset after " << operation << std::endl;
+			if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "compressed bitset test failed");
+		}
+	}
+}
+
+static void testCompressedBitSet( int times, int maximum)
+{
+	for (int ti=0; ti<times; ++ti)
+	{
+		CompressedSetPattern pattern1 = (CompressedSetPattern)g_random.get( 0, 3);
+		CompressedSetPattern pattern2 = (CompressedSetPattern)g_random.get( 0, 3);
+		strus::compressed_bitset set1( maximum);
+		strus::compressed_bitset set2( maximum);
+		std::set<int> eset1;
+		std::set<int> eset2;
+		fillCompressedBitSet( set1, eset1, maximum, pattern1);
+		fillCompressedBitSet( set2, eset2, maximum, pattern2);
+		if (ti % 2 == 0)
+		{
+			set1.optimize();
+			set2.optimize();
+		}
+		checkCompressedBitSet( set1, eset1, compressedSetPatternName( pattern1));
+		checkCompressedBitSet( set2, eset2, compressedSetPatternName( pattern2));
+		if (set1.test( maximum) || set1.set( maximum, true)) throw std::runtime_error( "compressed bitset accepts element out of range");
+
+		std::set<int> expected;
+		std::set_intersection( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		if (set1.count_and( set2) != expected.size())
+		{
+			std::cerr << "count of intersection of compressed bitsets " << set1.count_and( set2) << " differs from expected " << expected.size() << std::endl;
+			if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "compressed bitset test failed");
+		}
+		strus::compressed_bitset result( set1);
+		result &= set2;
+		checkCompressedBitSet( result, expected, "intersection");
+
+		expected.clear();
+		std::set_union( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result |= set2;
+		checkCompressedBitSet( result, expected, "union");
+
+		expected.clear();
+		std::set_symmetric_difference( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result ^= set2;
+		checkCompressedBitSet( result, expected, "symmetric difference");
+
+		expected.clear();
+		std::set_difference( eset1.begin(), eset1.end(), eset2.begin(), eset2.end(), std::inserter( expected, expected.end()));
+		result = set1;
+		result -= set2;
+		checkCompressedBitSet( result, expected, "difference");
+
+		// Operations with the set itself as operand:
+		result = set1;
+		result |= result;
+		checkCompressedBitSet( result, eset1, "union with itself");
+		result &= result;
+		checkCompressedBitSet( result, eset1, "intersection with itself");
+		result ^= result;
+		checkCompressedBitSet( result, std::set<int>(), "symmetric difference with itself");
+		result = set1;
+		result -= result;
+		checkCompressedBitSet( result, std::set<int>(), "difference with itself");
+
+		// Equality is independent of the representation of the containers:
+		result = set1;
+		result.optimize();
+		if (!(result == set1) || (eset1 != eset2 && set1 == set2))
+		{
+			std::cerr << "comparison of compressed bitsets returns unexpected result" << std::endl;
+			if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "compressed bitset test failed");
+		}
+	}
+	std::cerr << "executed testCompressedBitSet( " << times << ", " << maximum << ")" << std::endl;
+}
+
+static void testCompressedBitSetMemory( int maximum)
+{
+	strus::dynamic_bitset dynset( maximum);
+	strus::compressed_bitset sparseset( maximum);
+	strus::compressed_bitset runset( maximum);
+	for (int pos = 0; pos < maximum; pos += 1000)
+	{
+		dynset.set( pos, true);
+		sparseset.set( pos, true);
+	}
+	int runLength = maximum / 25;
+	for (int pos = maximum / 4; pos < maximum / 4 + runLength; ++pos)
+	{
+		runset.set( pos, true);
+	}
+	runset.optimize();
+	std::size_t dynsize = (maximum + 255) / 256 * sizeof(int32_t) + (maximum / 1000) * 32;
+	std::cerr << "memory used for " << maximum << " positions: sparse " << sparseset.allocated() << " bytes, run " << runset.allocated() << " bytes, dynamic_bitset sparse at least " << dynsize << " bytes" << std::endl;
+	if (sparseset.allocated() * 4 > dynsize) throw std::runtime_error( "compressed bitset does not compress sparse sets");
+	if (runset.allocated() * 100 > (std::size_t)runLength / 8) throw std::runtime_error( "compressed bitset does not compress runs");
+}
+
+static uint64_t randomWord( int density)
+{
+	uint64_t rt = 0;
+	int bi = 0;
+	for (; bi < 64; ++bi)
+	{
+		if (g_random.get( 0, 64) < density) rt |= (uint64_t)1 << bi;
+	}
+	return rt;
+}
+
+static std::size_t wordsBitCount( const std::vector<uint64_t>& ar)
+{
+	std::size_t rt = 0;
+	std::vector<uint64_t>::const_iterator ai = ar.begin(), ae = ar.end();
+	for (; ai != ae; ++ai)
+	{
+		uint64_t ww = *ai;
+		for (; ww; ww &= ww - 1) ++rt;
+	}
+	return rt;
+}
+
+static void checkKernelResult( const std::vector<uint64_t>& result, const std::vector<uint64_t>& expected, bool returnValueCorrect, const char* operation, strus::BitSetKernels::Isa isa)
+{
+	if (result != expected || !returnValueCorrect)
+	{
+		throw std::runtime_error( strus::string_format( "bitset kernel %s (%s) failed for %d words", operation, strus::BitSetKernels::isaName( isa), (int)expected.size()));
+	}
+}
+
+static void testBitSetKernels( int times)
+{
+	strus::BitSetKernels::Isa best = strus::BitSetKernels::isa();
+	int ii = 0;
+	for (; ii <= (int)strus::BitSetKernels::IsaAVX512; ++ii)
+	{
+		strus::BitSetKernels::Isa isa = (strus::BitSetKernels::Isa)ii;
+		if (!strus::BitSetKernels::supported( isa)) continue;
+		if (!strus::BitSetKernels::select( isa)) throw std::runtime_error( "failed to select supported bitset kernel implementation");
+		int tt = 0;
+		for (; tt < times; ++tt)
+		{
+			std::size_t nofWords = g_random.get( 0, 140);
+			int density = g_random.get( 0, 65);
+			std::vector<uint64_t> aa, bb;
+			std::size_t wi = 0;
+			for (; wi < nofWords; ++wi)
+			{
+				aa.push_back( randomWord( density));
+				bb.push_back( g_random.get( 0, 4) == 0 ? aa.back() : randomWord( density));
+			}
+			std::vector<uint64_t> joinExp( aa), intersectExp( aa), subtractExp( aa), toggleExp( aa);
+			for (wi = 0; wi < nofWords; ++wi)
+			{
+				joinExp[ wi] |= bb[ wi];
+				intersectExp[ wi] &= bb[ wi];
+				subtractExp[ wi] &= ~bb[ wi];
+				toggleExp[ wi] ^= bb[ wi];
+			}
+			std::size_t mismatchExp = 0;
+			for (; mismatchExp < nofWords && aa[ mismatchExp] == bb[ mismatchExp]; ++mismatchExp){}
+
+			std::vector<uint64_t> res( aa);
+			bool changed = strus::BitSetKernels::join( res.data(), bb.data(), nofWords);
+			checkKernelResult( res, joinExp, changed == (joinExp != aa), "join", isa);
+			res = aa;
+			std::size_t nofChanges = strus::BitSetKernels::join_count( res.data(), bb.data(), nofWords);
+			checkKernelResult( res, joinExp, nofChanges == wordsBitCount( joinExp) - wordsBitCount( aa), "join_count", isa);
+			res = aa;
+			changed = strus::BitSetKernels::intersect( res.data(), bb.data(), nofWords);
+			checkKernelResult( res, intersectExp, changed == (intersectExp != aa), "intersect", isa);
+			res = aa;
+			changed = strus::BitSetKernels::subtract( res.data(), bb.data(), nofWords);
+			checkKernelResult( res, subtractExp, changed == (subtractExp != aa), "subtract", isa);
+			res = aa;
+			changed = strus::BitSetKernels::toggle( res.data(), bb.data(), nofWords);
+			checkKernelResult( res, toggleExp, changed == (toggleExp != aa), "toggle", isa);
+			checkKernelResult( aa, aa, strus::BitSetKernels::count( aa.data(), nofWords) == wordsBitCount( aa), "count", isa);
+			checkKernelResult( aa, aa, strus::BitSetKernels::mismatch( aa.data(), bb.data(), nofWords) == mismatchExp, "mismatch", isa);
+		}
+		std::cerr << "tested bitset kernels " << strus::BitSetKernels::isaName( isa) << std::endl;
+	}
+	strus::BitSetKernels::select( best);
+}
+
 template<int NN>
 static void checkElements( const strus::bitset<NN>& testset, const std::set<int>& eset)
 {
@@ -231,6 +559,33 @@ static void testBitSetJoin( int times, int nofElements)
 				if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "join bitset test failed");
 			}
 		}
+		{
+			std::pair<strus::bitset<NN>,std::set<int> > set1 = randomSet<NN>( nofElements);
+			std::pair<strus::bitset<NN>,std::set<int> > set2 = randomSet<NN>( nofElements);
+			std::set<int> expected;
+
+			strus::bitset<NN> result( set1.first);
+			result.intersect( set2.first);
+			std::set_intersection( set1.second.begin(), set1.second.end(), set2.second.begin(), set2.second.end(), std::inserter( expected, expected.end()));
+			checkElements( result, expected);
+
+			result = set1.first;
+			result.subtract( set2.first);
+			expected.clear();
+			std::set_difference( set1.second.begin(), set1.second.end(), set2.second.begin(), set2.second.end(), std::inserter( expected, expected.end()));
+			checkElements( result, expected);
+
+			result = set1.first;
+			result.toggle( set2.first);
+			expected.clear();
+			std::set_symmetric_difference( set1.second.begin(), set1.second.end(), set2.second.begin(), set2.second.end(), std::inserter( expected, expected.end()));
+			checkElements( result, expected);
+			if (result.size() != expected.size())
+			{
+				std::cerr << "bitset size differs from expected: " << result.size() << "!=" << expected.size() << std::endl;
+				if (++g_nof_errors >= g_max_nof_errors) throw std::runtime_error( "join bitset test failed");
+			}
+		}
 	}
 }
 
@@ -309,6 +664,8 @@ int main( int, const char**)
 {
 	try
 	{
+		testBitSetKernels( 2000);
+
 		testBitSet<8>( 20, 1);
 		testBitSet<16>( 20, 1);
 		testBitSet<32>( 30, 1);
@@ -373,6 +730,15 @@ int main( int, const char**)
 		testDynamicBitSet( 2, 1000000, 500000);
 		testDynamicBitSet( 2, 1000000, 500);
 
+		testDynamicBitSetOperations( 30, 100, 10);
+		testDynamicBitSetOperations( 30, 10000, 100);
+		testDynamicBitSetOperations( 10, 1000000, 5000);
+
+		testCompressedBitSet( 30, 1000);
+		testCompressedBitSet( 20, 70000);
+		testCompressedBitSet( 5, 200000);
+		testCompressedBitSetMemory( 100000000);
+
 		if (g_nof_errors > 0)
 		{
 			std::cerr << "ERROR test failed with " << g_nof_errors << " errors" << std::endl;
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/concurrentSymbolTable.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <set>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+typedef std::map<std::string,uint32_t> KeyMap;
+
+static std::string keyString( int idx)
+{
+	char keybuf[ 32];
+	std::snprintf( keybuf, sizeof(keybuf), "K%d", idx);
+	return std::string( keybuf);
+}
+
+class Inserter
+{
+public:
+	Inserter( strus::ConcurrentSymbolTable* symtab_, int seed_, int nofElements_)
+		:m_symtab(symtab_),m_random(seed_),m_nofElements(nofElements_),m_keymap(),m_nofNew(0){}
+
+	void run()
+	{
+		int ni = 0, ne = m_nofElements;
+		for (; ni != ne; ++ni)
+		{
+			std::string key = keyString( m_random.get( 0, m_nofElements));
+			bool isNew = false;
+			uint32_t id = m_symtab->getOrCreate( key.c_str(), key.size(), isNew);
+			if (!id) throw std::runtime_error( "getOrCreate failed");
+			if (isNew) ++m_nofNew;
+			KeyMap::const_iterator ki = m_keymap.find( key);
+			if (ki == m_keymap.end())
+			{
+				m_keymap[ key] = id;
+			}
+			else if (ki->second != id)
+			{
+				throw std::runtime_error( strus::string_format( "handle of key '%s' changed from %u to %u", key.c_str(), ki->second, id));
+			}
+		}
+	}
+
+	const KeyMap& keymap() const	{return m_keymap;}
+	int nofNew() const		{return m_nofNew;}
+
+private:
+	strus::ConcurrentSymbolTable* m_symtab;
+	strus::PseudoRandom m_random;
+	int m_nofElements;
+	KeyMap m_keymap;
+	int m_nofNew;
+};
+
+class Reader
+{
+public:
+	Reader( const strus::ConcurrentSymbolTable* symtab_, strus::AtomicFlag* terminate_, int nofElements_)
+		:m_symtab(symtab_),m_terminate(terminate_),m_random(),m_nofElements(nofElements_),m_nofErrors(0){}
+
+	void run()
+	{
+		while (!m_terminate->test())
+		{
+			std::string key = keyString( m_random.get( 0, m_nofElements));
+			uint32_t id = m_symtab->get( key);
+			if (id)
+			{
+				const char* keystr = m_symtab->key( id);
+				if (!keystr || key != keystr)
+				{
+					std::cerr << "inverse lookup of concurrently read key '" << key << "' failed" << std::endl;
+					++m_nofErrors;
+				}
+			}
+		}
+	}
+
+	int nofErrors() const	{return m_nofErrors;}
+
+private:
+	const strus::ConcurrentSymbolTable* m_symtab;
+	strus::AtomicFlag* m_terminate;
+	strus::PseudoRandom m_random;
+	int m_nofElements;
+	int m_nofErrors;
+};
+
+static void checkResult( const strus::ConcurrentSymbolTable& symtab, const std::vector<strus::shared_ptr<Inserter> >& inserters)
+{
+	KeyMap keymap;
+	int nofNew = 0;
+	std::vector<strus::shared_ptr<Inserter> >::const_iterator ii = inserters.begin(), ie = inserters.end();
+	for (; ii != ie; ++ii)
+	{
+		nofNew += (*ii)->nofNew();
+		KeyMap::const_iterator ki = (*ii)->keymap().begin(), ke = (*ii)->keymap().end();
+		for (; ki != ke; ++ki)
+		{
+			KeyMap::const_iterator mi = keymap.find( ki->first);
+			if (mi == keymap.end())
+			{
+				keymap[ ki->first] = ki->second;
+			}
+			else if (mi->second != ki->second)
+			{
+				throw std::runtime_error( strus::string_format( "different handles %u != %u for key '%s' in different threads", mi->second, ki->second, ki->first.c_str()));
+			}
+		}
+	}
+	if (keymap.size() != symtab.size() || (std::size_t)nofNew != symtab.size())
+	{
+		throw std::runtime_error( strus::string_format( "number of keys %d or number of new keys %d does not match size of table %d", (int)keymap.size(), nofNew, (int)symtab.size()));
+	}
+	std::set<uint32_t> handles;
+	KeyMap::const_iterator ki = keymap.begin(), ke = keymap.end();
+	for (; ki != ke; ++ki)
+	{
+		if (ki->second == 0 || ki->second > symtab.size())
+		{
+			throw std::runtime_error( strus::string_format( "handle %u of key '%s' out of range", ki->second, ki->first.c_str()));
+		}
+		if (!handles.insert( ki->second).second)
+		{
+			throw std::runtime_error( strus::string_format( "handle %u assigned twice", ki->second));
+		}
+		if (symtab.get( ki->first) != ki->second)
+		{
+			throw std::runtime_error( strus::string_format( "lookup of key '%s' failed", ki->first.c_str()));
+		}
+		const char* keystr = symtab.key( ki->second);
+		if (!keystr || ki->first != keystr)
+		{
+			throw std::runtime_error( strus::string_format( "inverse lookup of handle %u failed", ki->second));
+		}
+	}
+	if (symtab.get( "notakey") != 0)
+	{
+		throw std::runtime_error( "lookup of undefined key returned a handle");
+	}
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofThreads = 8;
+		int nofElements = 10000;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testConcurrentSymbolTable [<nofthreads>] [<nofelems>]" << std::endl;
+			std::cout << "       <nofthreads> :Number of writer threads (default 8)" << std::endl;
+			std::cout << "       <nofelems> :Number of elements inserted per thread (default 10000)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofThreads = parseNumber( argv[1]);
+		if (argc > 2) nofElements = parseNumber( argv[2]);
+		if (argc > 3) throw std::runtime_error( "too many arguments");
+
+		strus::ConcurrentSymbolTable symtab( 0/*errorhnd*/);
+		strus::AtomicFlag terminate;
+		std::vector<strus::shared_ptr<Inserter> > inserters;
+		std::vector<strus::shared_ptr<Reader> > readers;
+		std::vector<strus::shared_ptr<strus::thread> > threadGroup;
+
+		for (int ti=0; ti < nofThreads; ++ti)
+		{
+			inserters.push_back( strus::shared_ptr<Inserter>( new Inserter( &symtab, ti+1, nofElements)));
+			readers.push_back( strus::shared_ptr<Reader>( new Reader( &symtab, &terminate, nofElements)));
+		}
+		std::vector<strus::shared_ptr<Reader> >::const_iterator ri = readers.begin(), re = readers.end();
+		for (; ri != re; ++ri)
+		{
+			threadGroup.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Reader::run, ri->get())));
+		}
+		std::vector<strus::shared_ptr<Inserter> >::const_iterator ii = inserters.begin(), ie = inserters.end();
+		for (; ii != ie; ++ii)
+		{
+			threadGroup.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Inserter::run, ii->get())));
+		}
+		std::vector<strus::shared_ptr<strus::thread> >::iterator gi = threadGroup.begin() + readers.size(), ge = threadGroup.end();
+		for (; gi != ge; ++gi) (*gi)->join();
+		terminate.set( true);
+		gi = threadGroup.begin(), ge = threadGroup.begin() + readers.size();
+		for (; gi != ge; ++gi) (*gi)->join();
+
+		int nofReadErrors = 0;
+		for (ri = readers.begin(); ri != re; ++ri) nofReadErrors += (*ri)->nofErrors();
+		if (nofReadErrors) throw std::runtime_error( strus::string_format( "%d errors in concurrent reads", nofReadErrors));
+
+		checkResult( symtab, inserters);
+		std::cerr << "inserted " << symtab.size() << " keys with " << nofThreads << " threads" << std::endl;
+
+		symtab.clear();
+		if (!symtab.empty() || symtab.get( keyString( 1)) != 0) throw std::runtime_error( "table not empty after clear");
+		if (symtab.getOrCreate( keyString( 1)) != 1) throw std::runtime_error( "unexpected handle after clear");
+
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
@@ -6,48 +6,52 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 #include "strus/base/crc32.hpp"
+#include "strus/base/stringHash.hpp"
 #include "strus/base/stdint.h"
 #include "private/internationalization.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
+#include <string>
+#include <set>
 
 using namespace strus;
 
+static const char* g_keys[] = {
+	"",
+	"a",
+	"ab",
+	"abc",
+	"abcd",
+	"abcde",
+	"abcdef",
+	"abcdefg",
+	"abcdefgh",
+	"abcdefghi",
+	"abcdefghij",
+	"abcdefghijk",
+	"abcdefghijkl",
+	"abcdefghijklm",
+	"abcdefghijklmn",
+	"abcdefghijklmno",
+	"abcdefghijklmnop",
+	"abcdefghijklmnopq",
+	"abcdefghijklmnopqr",
+	"abcdefghijklmnopqrs",
+	"abcdefghijklmnopqrst",
+	"abcdefghijklmnopqrstu",
+	"abcdefghijklmnopqrstuv",
+	"abcdefghijklmnopqrstuvw",
+	"abcdefghijklmnopqrstuvwx",
+	"abcdefghijklmnopqrstuvwxy",
+	"abcdefghijklmnopqrstuvwxyz",
+	"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+	"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz",
+	0
+};
+
 static void crc32Test()
 {
-	static const char* keys[] = {
-		"",
-		"a",
-		"ab",
-		"abc",
-		"abcd",
-		"abcde",
-		"abcdef",
-		"abcdefg",
-		"abcdefgh",
-		"abcdefghi",
-		"abcdefghij",
-		"abcdefghijk",
-		"abcdefghijkl",
-		"abcdefghijklm",
-		"abcdefghijklmn",
-		"abcdefghijklmno",
-		"abcdefghijklmnop",
-		"abcdefghijklmnopq",
-		"abcdefghijklmnopqr",
-		"abcdefghijklmnopqrs",
-		"abcdefghijklmnopqrst",
-		"abcdefghijklmnopqrstu",
-		"abcdefghijklmnopqrstuv",
-		"abcdefghijklmnopqrstuvw",
-		"abcdefghijklmnopqrstuvwx",
-		"abcdefghijklmnopqrstuvwxy",
-		"abcdefghijklmnopqrstuvwxyz",
-		"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
-		"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz",
-		0
-	};
 	static uint32_t expected[] =
 	{
 		0U,
@@ -80,7 +84,7 @@ static void crc32Test()
 		2317279385U,
 		3692677129U,
 	};
-	char const** ki = keys;
+	char const** ki = g_keys;
 	for (unsigned int kidx=0; *ki; ++ki,++kidx)
 	{
 		uint32_t val1 = utils::Crc32::calc( *ki, std::strlen(*ki));
@@ -90,12 +94,113 @@ static void crc32Test()
 	}
 }
 
+static void crc32cTest()
+{
+	static uint32_t expected[] =
+	{
+		0U,
+		3251651376U,
+		3802278198U,
+		910901175U,
+		2462583345U,
+		3293632151U,
+		1404891121U,
+		3861378113U,
+		177480119U,
+		769432060U,
+		3864630327U,
+		1325211590U,
+		2610574288U,
+		1608251256U,
+		1692248097U,
+		3206163554U,
+		2745695973U,
+		132947879U,
+		3025685113U,
+		959128355U,
+		3618358858U,
+		1012567298U,
+		3829648078U,
+		2554247582U,
+		2540970522U,
+		545015781U,
+		2665934629U,
+		1888578973U,
+		383517330U,
+	};
+	char const** ki = g_keys;
+	for (unsigned int kidx=0; *ki; ++ki,++kidx)
+	{
+		uint32_t val1 = utils::Crc32c::calc( *ki, std::strlen(*ki));
+		uint32_t val2 = utils::Crc32c::calc( *ki);
+		if (val1 != val2) throw strus::runtime_error("crc32c calculation different with and without length parameter in test %u (%u != %u)", kidx, val1, val2);
+		if (val1 != expected[kidx]) throw strus::runtime_error( "crc32c calculation not as expected in test %u (%u != %u)", kidx, val1, expected[kidx]);
+	}
+	uint32_t check = utils::Crc32c::calc( "123456789");
+	if (check != 3808858755U) throw strus::runtime_error( "crc32c check value not as expected (%u != %u)", check, 3808858755U);
+	// ... blocks of all sizes and alignments processed in 8 byte chunks by the CPU instruction give the same result as byte by byte
+	std::string blk;
+	for (unsigned int bi=0; bi<300; ++bi) blk.push_back( (char)(bi * 7 + 3));
+	for (unsigned int ofs=0; ofs<8; ++ofs)
+	{
+		for (unsigned int len=0; ofs+len<=blk.size(); len+=13)
+		{
+			uint32_t val = utils::Crc32c::calc( blk.c_str()+ofs, len);
+			uint32_t exp = ~(uint32_t)0;
+			for (unsigned int li=0; li<len; ++li)
+			{
+				exp ^= (unsigned char)blk[ ofs+li];
+				for (int kk=0; kk<8; ++kk) exp = (exp >> 1) ^ (0x82F63B78U & (0U - (exp & 1)));
+			}
+			exp = ~exp;
+			if (val != exp) throw strus::runtime_error( "crc32c calculation of %u bytes at offset %u not as expected (%u != %u)", len, ofs, val, exp);
+		}
+	}
+}
+
+static void stringHashTest()
+{
+	std::set<uint64_t> hashset;
+	char const** ki = g_keys;
+	for (unsigned int kidx=0; *ki; ++ki,++kidx)
+	{
+		std::size_t len = std::strlen(*ki);
+		uint64_t val1 = StringHash::calc( *ki, len);
+		uint64_t val2 = StringHash::calc( *ki);
+		if (val1 != val2) throw strus::runtime_error("string hash different with and without length parameter in test %u", kidx);
+		// ... result must not depend on the alignment of the key
+		std::string buf = std::string( "_") + *ki;
+		uint64_t val3 = StringHash::calc( buf.c_str()+1, len);
+		if (val1 != val3) throw strus::runtime_error("string hash depends on the alignment of the key in test %u", kidx);
+		if (!hashset.insert( val1).second) throw strus::runtime_error("string hash collision in test %u", kidx);
+		if (Crc32cStringHash::calc( *ki, len) != utils::Crc32c::calc( *ki, len)) throw strus::runtime_error("CRC32C hash policy not equal to CRC32C in test %u", kidx);
+	}
+}
+
 int main( int, const char**)
 {
 	try
 	{
 		std::cerr << "executing CRC32 test" << std::endl;
 		crc32Test();
+		bool hardware = utils::Crc32c::hardwareSupported();
+		std::cerr << "executing CRC32C test (hardware support " << (hardware ? "yes":"no") << ")" << std::endl;
+		// ... both implementations are checked, independent of the one selected for this machine
+		if (!utils::Crc32c::selectHardware( false)) throw std::runtime_error( "failed to select table driven crc32c implementation");
+		std::cerr << "executing CRC32C test of the table driven implementation" << std::endl;
+		crc32cTest();
+		if (utils::Crc32c::selectHardware( true))
+		{
+			std::cerr << "executing CRC32C test of the implementation with the CPU instruction" << std::endl;
+			crc32cTest();
+		}
+		else if (hardware)
+		{
+			throw std::runtime_error( "failed to select crc32c implementation with the CPU instruction");
+		}
+		utils::Crc32c::selectHardware( hardware);
+		std::cerr << "executing string hash test" << std::endl;
+		stringHashTest();
 		std::cerr << "OK" << std::endl;
 		return 0;
 	}
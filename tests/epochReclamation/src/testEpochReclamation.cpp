@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/epochReclamation.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/shared_ptr.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+/// \brief Object shared with readers, freeing it only marks it as dead, so that an access after free can be detected
+struct Object
+{
+	strus::AtomicFlag alive;
+	int value;
+
+	explicit Object( int value_)
+		:alive(true),value(value_){}
+};
+
+static strus::AtomicCounter<int> g_nofFreed;
+
+static void markDead( void* ptr)
+{
+	((Object*)ptr)->alive.set( false);
+	g_nofFreed.increment();
+}
+
+class Writer
+{
+public:
+	Writer( strus::EpochReclamation* reclamation_, strus::atomic<Object*>* current_, std::vector<Object*>* objects_)
+		:m_reclamation(reclamation_),m_current(current_),m_objects(objects_){}
+
+	void run()
+	{
+		std::vector<Object*>::const_iterator oi = m_objects->begin(), oe = m_objects->end();
+		for (; oi != oe; ++oi)
+		{
+			Object* prev = m_current->exchange( *oi);
+			m_reclamation->retire( prev, &markDead);
+		}
+	}
+
+private:
+	strus::EpochReclamation* m_reclamation;
+	strus::atomic<Object*>* m_current;
+	std::vector<Object*>* m_objects;
+};
+
+class Reader
+{
+public:
+	Reader( const strus::EpochReclamation* reclamation_, const strus::atomic<Object*>* current_, strus::AtomicFlag* terminate_)
+		:m_reclamation(reclamation_),m_current(current_),m_terminate(terminate_),m_nofErrors(0),m_nofReads(0){}
+
+	void run()
+	{
+		while (!m_terminate->test())
+		{
+			strus::EpochReclamation::Guard guard( *m_reclamation);
+			const Object* obj = m_current->load();
+			int value = obj->value;
+			for (int ii=0; ii<10; ++ii)
+			{
+				if (!obj->alive.test() || obj->value != value)
+				{
+					++m_nofErrors;
+					break;
+				}
+			}
+			++m_nofReads;
+		}
+	}
+
+	int nofErrors() const	{return m_nofErrors;}
+	int nofReads() const	{return m_nofReads;}
+
+private:
+	const strus::EpochReclamation* m_reclamation;
+	const strus::atomic<Object*>* m_current;
+	strus::AtomicFlag* m_terminate;
+	int m_nofErrors;
+	int m_nofReads;
+};
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofThreads = 8;
+		int nofObjects = 10000;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testEpochReclamation [<nofthreads>] [<nofobjects>]" << std::endl;
+			std::cout << "       <nofthreads> :Number of reader threads (default 8)" << std::endl;
+			std::cout << "       <nofobjects> :Number of objects replaced by the writer (default 10000)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofThreads = parseNumber( argv[1]);
+		if (argc > 2) nofObjects = parseNumber( argv[2]);
+		if (argc > 3) throw std::runtime_error( "too many arguments");
+
+		std::vector<Object*> objects;
+		for (int oi=0; oi <= nofObjects; ++oi)
+		{
+			objects.push_back( new Object( oi));
+		}
+		strus::atomic<Object*> current( objects[0]);
+		std::vector<Object*> replacements( objects.begin()+1, objects.end());
+		strus::AtomicFlag terminate;
+		int nofErrors = 0;
+		int nofReads = 0;
+		{
+			strus::EpochReclamation reclamation;
+			std::vector<strus::shared_ptr<Reader> > readers;
+			std::vector<strus::shared_ptr<strus::thread> > threadGroup;
+			for (int ti=0; ti < nofThreads; ++ti)
+			{
+				readers.push_back( strus::shared_ptr<Reader>( new Reader( &reclamation, &current, &terminate)));
+				threadGroup.push_back( strus::shared_ptr<strus::thread>( new strus::thread( &Reader::run, readers.back().get())));
+			}
+			Writer writer( &reclamation, &current, &replacements);
+			writer.run();
+			terminate.set( true);
+
+			std::vector<strus::shared_ptr<strus::thread> >::iterator gi = threadGroup.begin(), ge = threadGroup.end();
+			for (; gi != ge; ++gi) (*gi)->join();
+			std::vector<strus::shared_ptr<Reader> >::const_iterator ri = readers.begin(), re = readers.end();
+			for (; ri != re; ++ri)
+			{
+				nofErrors += (*ri)->nofErrors();
+				nofReads += (*ri)->nofReads();
+			}
+			std::cerr << "freed " << g_nofFreed.value() << " of " << nofObjects << " objects while " << nofReads << " reads happened" << std::endl;
+
+			// ... without readers all retired objects have to be freed by collect:
+			reclamation.collect();
+			if (reclamation.nofRetired() != 0 || g_nofFreed.value() != nofObjects)
+			{
+				throw std::runtime_error( strus::string_format( "%d objects not freed after readers left", (int)reclamation.nofRetired()));
+			}
+		}
+		if (nofErrors) throw std::runtime_error( strus::string_format( "%d objects accessed by readers after they have been freed", nofErrors));
+		if (!current.load()->alive.test()) throw std::runtime_error( "current object freed");
+
+		std::vector<Object*>::const_iterator oi = objects.begin(), oe = objects.end();
+		for (; oi != oe; ++oi) delete *oi;
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
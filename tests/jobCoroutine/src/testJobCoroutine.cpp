@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/jobCoroutine.hpp"
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/jobFuture.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/stdint.h"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+#ifdef STRUS_HAVE_COROUTINES
+
+/// \brief Read bytes from a pipe till the expected number is reached, suspended while there is nothing to read
+static strus::JobTask<int> readBytes( int fd, int nofBytes)
+{
+	int sum = 0;
+	int cnt = 0;
+	while (cnt < nofBytes)
+	{
+		co_await strus::readable( fd);
+		char buf[ 64];
+		ssize_t nn;
+		while (cnt < nofBytes && (nn = ::read( fd, buf, sizeof(buf))) > 0)
+		{
+			for (ssize_t bi=0; bi < nn; ++bi) sum += (unsigned char)buf[ bi];
+			cnt += nn;
+		}
+	}
+	co_return sum;
+}
+
+/// \brief Write bytes to a pipe with a pause before each of them
+static strus::JobTask<int> writeBytes( int fd, int nofBytes, int milliseconds)
+{
+	int sum = 0;
+	for (int bi=0; bi < nofBytes; ++bi)
+	{
+		co_await strus::sleep_for( milliseconds);
+		char chr = (char)('a' + bi % 26);
+		if (::write( fd, &chr, 1) != 1) throw std::runtime_error( "failed to write to pipe");
+		sum += (unsigned char)chr;
+	}
+	co_return sum;
+}
+
+struct RangeSum
+{
+	int64_t start;
+	int64_t end;
+
+	RangeSum( int64_t start_, int64_t end_)
+		:start(start_),end(end_){}
+
+	int64_t operator()() const
+	{
+		int64_t rt = 0;
+		for (int64_t ii=start; ii < end; ++ii) rt += ii;
+		return rt;
+	}
+};
+
+/// \brief Sum of a range computed by jobs, awaiting their futures
+static strus::JobTask<int64_t> sumOfJobs( strus::JobQueueWorker* worker, int64_t size, int nofParts)
+{
+	std::vector<strus::JobFuture<int64_t> > futures;
+	for (int pi=0; pi < nofParts; ++pi)
+	{
+		futures.push_back( strus::submitJob<int64_t>( *worker, RangeSum( size * pi / nofParts, size * (pi+1) / nofParts)));
+	}
+	int64_t rt = 0;
+	for (std::size_t fi=0; fi < futures.size(); ++fi)
+	{
+		rt += co_await futures[ fi];
+	}
+	co_return rt;
+}
+
+static strus::JobTask<int> depth( int level)
+{
+	if (level == 0) co_return 0;
+	int rt = co_await depth( level-1);
+	co_return rt + 1;
+}
+
+static strus::JobTask<bool> failing()
+{
+	co_await strus::sleep_for( 1);
+	throw std::runtime_error( "task failed");
+	co_return true;
+}
+
+static strus::JobTask<bool> awaitFailing()
+{
+	try
+	{
+		co_await failing();
+	}
+	catch (const std::runtime_error& err)
+	{
+		co_return 0==std::strcmp( err.what(), "task failed");
+	}
+	co_return false;
+}
+
+static strus::JobTask<bool> sleeping( int milliseconds)
+{
+	co_await strus::sleep_for( milliseconds);
+	co_return true;
+}
+
+static void testCoroutines( int nofPipes)
+{
+	strus::JobQueueWorker worker( 60, true);
+	if (!worker.start()) throw std::runtime_error( "failed to start worker");
+
+	std::vector<int> pipes;
+	try
+	{
+		// [1] Start readers and writers on pipes:
+		std::vector<strus::JobFuture<int> > readers;
+		std::vector<strus::JobFuture<int> > writers;
+		for (int pi=0; pi < nofPipes; ++pi)
+		{
+			int pipfd[2];
+			if (::pipe( pipfd) == -1) throw std::runtime_error( "failed to create pipe");
+			pipes.push_back( pipfd[0]);
+			pipes.push_back( pipfd[1]);
+			if (::fcntl( pipfd[0], F_SETFL, O_NONBLOCK) == -1) throw std::runtime_error( "failed to set pipe non blocking");
+			int nofBytes = 1 + pi % 7;
+			readers.push_back( readBytes( pipfd[0], nofBytes).spawn( worker));
+			writers.push_back( writeBytes( pipfd[1], nofBytes, 1 + pi % 5).spawn( worker));
+		}
+		// [2] Start tasks awaiting jobs and other tasks:
+		strus::JobFuture<int64_t> jobsResult = sumOfJobs( &worker, 100000, 8).spawn( worker);
+		strus::JobFuture<int> depthResult = depth( 50).spawn( worker);
+		strus::JobFuture<bool> failResult = failing().spawn( worker);
+		strus::JobFuture<bool> awaitFailResult = awaitFailing().spawn( worker);
+		{
+			//... a task never started is destroyed with its handle
+			strus::JobTask<bool> unused = sleeping( 1);
+		}
+		// [3] Check the results:
+		for (int pi=0; pi < nofPipes; ++pi)
+		{
+			if (writers[ pi].failed()) throw std::runtime_error( strus::string_format( "writer task failed: %s", writers[ pi].error().c_str()));
+			if (readers[ pi].failed()) throw std::runtime_error( strus::string_format( "reader task failed: %s", readers[ pi].error().c_str()));
+			if (readers[ pi].get() != writers[ pi].get()) throw std::runtime_error( "bytes read differ from bytes written");
+		}
+		if (jobsResult.get() != (int64_t)100000 * 99999 / 2) throw std::runtime_error( "wrong result of task awaiting jobs");
+		if (depthResult.get() != 50) throw std::runtime_error( "wrong result of nested tasks");
+		if (!failResult.failed() || failResult.error() != "task failed") throw std::runtime_error( "exception of task not propagated to its future");
+		if (!awaitFailResult.get()) throw std::runtime_error( "exception of awaited task not propagated to the awaiting task");
+
+		worker.stop();
+
+		// [4] Tasks suspended when their worker is destroyed are destroyed and their futures fail:
+		strus::JobFuture<bool> pending;
+		{
+			strus::JobQueueWorker sleeper( 60, true);
+			if (!sleeper.start()) throw std::runtime_error( "failed to start worker");
+			pending = sleeping( 100000).spawn( sleeper);
+			strus::JobFuture<bool> waiting = sleeping( 10).spawn( sleeper);
+			if (!waiting.get()) throw std::runtime_error( "wrong result of sleeping task");
+		}
+		if (!pending.failed()) throw std::runtime_error( "task pending at destruction of its worker did not fail");
+	}
+	catch (...)
+	{
+		std::vector<int>::const_iterator fi = pipes.begin(), fe = pipes.end();
+		for (; fi != fe; ++fi) ::close( *fi);
+		throw;
+	}
+	std::vector<int>::const_iterator fi = pipes.begin(), fe = pipes.end();
+	for (; fi != fe; ++fi) ::close( *fi);
+	std::cerr << "executed " << (2 * nofPipes + 4) << " tasks" << std::endl;
+}
+#endif
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofPipes = 20;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testJobCoroutine [<nofpipes>]" << std::endl;
+			std::cout << "       <nofpipes> :Number of pipes with a reader and a writer task (default 20)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofPipes = parseNumber( argv[1]);
+		if (argc > 2) throw std::runtime_error( "too many arguments");
+
+#ifdef STRUS_HAVE_COROUTINES
+		testCoroutines( nofPipes);
+#else
+		(void)nofPipes;
+		std::cerr << "coroutines not supported by the compiler, build with CPP_LANGUAGE_VERSION=20" << std::endl;
+#endif
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
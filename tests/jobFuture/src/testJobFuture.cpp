@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/jobFuture.hpp"
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/sleep.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/stdint.h"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+/// \brief Sum of the numbers in a range, standing for the query of a shard
+struct ShardQuery
+{
+	int64_t start;
+	int64_t end;
+
+	ShardQuery( int64_t start_, int64_t end_)
+		:start(start_),end(end_){}
+
+	int64_t operator()() const
+	{
+		int64_t rt = 0;
+		for (int64_t ii=start; ii < end; ++ii) rt += ii;
+		return rt;
+	}
+};
+
+struct MergeResults
+{
+	int64_t operator()( const std::vector<int64_t>& results) const
+	{
+		int64_t rt = 0;
+		std::vector<int64_t>::const_iterator ri = results.begin(), re = results.end();
+		for (; ri != re; ++ri) rt += *ri;
+		return rt;
+	}
+};
+
+struct Multiply
+{
+	int64_t factor;
+
+	explicit Multiply( int64_t factor_) :factor(factor_){}
+
+	int64_t operator()( const int64_t& value) const
+	{
+		return value * factor;
+	}
+};
+
+struct FormatResult
+{
+	std::string operator()( const int64_t& value) const
+	{
+		return strus::string_format( "%d", (int)value);
+	}
+};
+
+struct FailingQuery
+{
+	int64_t operator()() const
+	{
+		throw std::runtime_error( "shard not available");
+	}
+};
+
+struct SlowQuery
+{
+	int operator()() const
+	{
+		strus::usleep( 20000);
+		return 1;
+	}
+};
+
+static int64_t expectedSum( int64_t end)
+{
+	return end * (end - 1) / 2;
+}
+
+static void testSubmit( strus::JobQueueWorker& worker)
+{
+	strus::JobFuture<int64_t> future = strus::submitJob<int64_t>( worker, ShardQuery( 0, 1000));
+	if (future.get() != expectedSum( 1000)) throw std::runtime_error( "unexpected result of job");
+	if (!future.ready() || future.failed()) throw std::runtime_error( "unexpected state of future");
+}
+
+static void testFanOutFanIn( strus::JobQueueWorker& worker, int nofShards)
+{
+	enum {ShardSize=100000};
+	std::vector<strus::JobFuture<int64_t> > shards;
+	for (int si=0; si < nofShards; ++si)
+	{
+		shards.push_back( strus::submitJob<int64_t>( worker, ShardQuery( (int64_t)si * ShardSize, (int64_t)(si+1) * ShardSize)));
+	}
+	strus::JobFuture<std::string> result
+		= strus::whenAll( shards)
+			.then<int64_t>( worker, MergeResults())
+			.then<int64_t>( worker, Multiply( 2))
+			.then<std::string>( worker, FormatResult());
+	std::string expected = strus::string_format( "%d", (int)(expectedSum( (int64_t)nofShards * ShardSize) * 2));
+	if (result.get() != expected)
+	{
+		throw std::runtime_error( strus::string_format( "unexpected result of fan out: %s, expected %s", result.get().c_str(), expected.c_str()));
+	}
+	std::vector<strus::JobFuture<int64_t> > none;
+	if (!strus::whenAll( none).get().empty()) throw std::runtime_error( "unexpected result of join of nothing");
+}
+
+static void testErrors( strus::JobQueueWorker& worker, int nofShards)
+{
+	std::vector<strus::JobFuture<int64_t> > shards;
+	for (int si=0; si < nofShards; ++si)
+	{
+		if (si == nofShards / 2)
+		{
+			shards.push_back( strus::submitJob<int64_t>( worker, FailingQuery()));
+		}
+		else
+		{
+			shards.push_back( strus::submitJob<int64_t>( worker, ShardQuery( 0, 100)));
+		}
+	}
+	strus::JobFuture<int64_t> result = strus::whenAll( shards).then<int64_t>( worker, MergeResults());
+	if (!result.failed() || result.error() != "shard not available") throw std::runtime_error( "error of job not propagated");
+	try
+	{
+		(void)result.get();
+		throw std::logic_error( "get of failed future returned");
+	}
+	catch (const std::runtime_error& err)
+	{
+		if (std::string( err.what()) != "shard not available") throw std::runtime_error( "unexpected error of get");
+	}
+}
+
+static void testDropped( int nofJobs)
+{
+	strus::JobQueueWorker worker( 1, false);
+	if (!worker.start()) throw std::runtime_error( "failed to start worker");
+	std::vector<strus::JobFuture<int> > futures;
+	for (int ji=0; ji < nofJobs; ++ji)
+	{
+		futures.push_back( strus::submitJob<int>( worker, SlowQuery()));
+	}
+	worker.stop();
+	strus::JobFuture<std::vector<int> > all = strus::whenAll( futures);
+	if (!all.ready() || !all.failed()) throw std::runtime_error( "futures of dropped jobs not failed");
+	int nofDropped = 0;
+	std::vector<strus::JobFuture<int> >::const_iterator fi = futures.begin(), fe = futures.end();
+	for (; fi != fe; ++fi) if (fi->failed()) ++nofDropped;
+	std::cerr << "dropped " << nofDropped << " of " << nofJobs << " jobs at stop" << std::endl;
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofWorkers = 4;
+		int nofShards = 64;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testJobFuture [<nofworkers>] [<nofshards>]" << std::endl;
+			std::cout << "       <nofworkers> :Number of threads of the pool, 0 for a worker without pool (default 4)" << std::endl;
+			std::cout << "       <nofshards>  :Number of jobs joined (default 64)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofWorkers = parseNumber( argv[1]);
+		if (argc > 2) nofShards = parseNumber( argv[2]);
+		if (argc > 3) throw std::runtime_error( "too many arguments");
+		if (nofShards == 0) throw std::runtime_error( "number of shards must be positive");
+		strus::JobQueueWorker* worker = nofWorkers
+			? new strus::JobQueueWorker( 1, false, nofWorkers)
+			: new strus::JobQueueWorker( 1, false);
+		try
+		{
+			if (!worker->start()) throw std::runtime_error( "failed to start worker");
+			testSubmit( *worker);
+			testFanOutFanIn( *worker, nofShards);
+			testErrors( *worker, nofShards);
+		}
+		catch (...)
+		{
+			delete worker;
+			throw;
+		}
+		delete worker;
+		//... more jobs than the event thread executes in one batch (64) before it looks for termination, so that some are dropped even if it started executing them before the stop
+		testDropped( 200);
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
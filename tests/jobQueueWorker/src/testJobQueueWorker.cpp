@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/jobQueueWorker.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/sleep.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+#include <limits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+enum {FanOutDepth=2, JobsPerRoot=7};
+
+static strus::JobQueueWorker* g_worker = 0;
+static strus::AtomicCounter<int> g_nofExecuted;
+static strus::AtomicCounter<int> g_nofDeleted;
+static strus::AtomicCounter<int> g_nofErrors;
+static strus::mutex g_threadsMutex;
+static std::set<strus::ThreadId::Type> g_threads;
+
+struct JobContext
+{
+	int depth;
+	int work;
+
+	JobContext( int depth_, int work_)
+		:depth(depth_),work(work_){}
+};
+
+static void deleteJob( void* context)
+{
+	delete (JobContext*)context;
+	g_nofDeleted.increment();
+}
+
+static void runJob( void* context)
+{
+	JobContext* job = (JobContext*)context;
+	{
+		strus::unique_lock lock( g_threadsMutex);
+		g_threads.insert( strus::ThreadId::get());
+	}
+	if (job->depth > 0)
+	{
+		//... fan out, the children are queued in the queue of the thread executing this job
+		for (int ci=0; ci < 2; ++ci)
+		{
+			if (!g_worker->pushJob( &runJob, new JobContext( job->depth-1, job->work), &deleteJob))
+			{
+				g_nofErrors.increment();
+			}
+		}
+	}
+	if (job->work)
+	{
+		strus::usleep( job->work);
+	}
+	else
+	{
+		volatile unsigned int hash = 0;
+		for (int ii=0; ii < 1000; ++ii) hash = hash * 31 + ii;
+	}
+	delete job;
+	g_nofExecuted.increment();
+}
+
+static void waitForJobs( int nofJobs)
+{
+	int nofRounds = 0;
+	while (g_nofExecuted.value() < nofJobs)
+	{
+		if (++nofRounds > 60000) throw std::runtime_error( strus::string_format( "timeout, %d of %d jobs executed", g_nofExecuted.value(), nofJobs));
+		strus::usleep( 1000);
+	}
+}
+
+static void testExecuteJobs( strus::JobQueueWorker& worker, int nofJobs)
+{
+	g_nofExecuted.set( 0);
+	g_threads.clear();
+	int nofRoots = nofJobs / JobsPerRoot + 1;
+	for (int ri=0; ri < nofRoots; ++ri)
+	{
+		if (!worker.pushJob( &runJob, new JobContext( FanOutDepth, 0), &deleteJob)) throw std::runtime_error( "failed to push job");
+	}
+	waitForJobs( nofRoots * JobsPerRoot);
+	if (g_nofExecuted.value() != nofRoots * JobsPerRoot)
+	{
+		throw std::runtime_error( strus::string_format( "%d jobs executed, expected %d", g_nofExecuted.value(), nofRoots * JobsPerRoot));
+	}
+	int nofThreads;
+	{
+		strus::unique_lock lock( g_threadsMutex);
+		nofThreads = g_threads.size();
+	}
+	std::cerr << "executed " << g_nofExecuted.value() << " jobs in " << nofThreads << " threads" << std::endl;
+	if (nofThreads > worker.nofWorkers()) throw std::runtime_error( "jobs executed in more threads than workers");
+}
+
+class Producer
+{
+public:
+	Producer( strus::JobQueueWorker* worker_, int nofJobs_)
+		:m_worker(worker_),m_nofJobs(nofJobs_){}
+
+	void run()
+	{
+		for (int ji=0; ji < m_nofJobs; ++ji)
+		{
+			if (!m_worker->pushJob( &runJob, new JobContext( 0, 0), &deleteJob)) g_nofErrors.increment();
+		}
+	}
+
+private:
+	strus::JobQueueWorker* m_worker;
+	int m_nofJobs;
+};
+
+static void testConcurrentProducers( strus::JobQueueWorker& worker, int nofProducers, int nofJobs)
+{
+	g_nofExecuted.set( 0);
+	int nofJobsPerProducer = nofJobs / nofProducers + 1;
+	std::vector<Producer> producers( nofProducers, Producer( &worker, nofJobsPerProducer));
+	std::vector<strus::thread*> threadGroup;
+	for (int pi=0; pi < nofProducers; ++pi)
+	{
+		threadGroup.push_back( new strus::thread( &Producer::run, &producers[ pi]));
+	}
+	std::vector<strus::thread*>::iterator ti = threadGroup.begin(), te = threadGroup.end();
+	for (; ti != te; ++ti)
+	{
+		(*ti)->join();
+		delete *ti;
+	}
+	waitForJobs( nofProducers * nofJobsPerProducer);
+	if (g_nofExecuted.value() != nofProducers * nofJobsPerProducer)
+	{
+		throw std::runtime_error( strus::string_format( "%d jobs executed, expected %d", g_nofExecuted.value(), nofProducers * nofJobsPerProducer));
+	}
+	std::cerr << "executed " << g_nofExecuted.value() << " jobs pushed by " << nofProducers << " threads" << std::endl;
+}
+
+static void testStopWithJobsQueued( strus::JobQueueWorker& worker, int nofJobs)
+{
+	g_nofExecuted.set( 0);
+	g_nofDeleted.set( 0);
+	for (int ji=0; ji < nofJobs; ++ji)
+	{
+		if (!worker.pushJob( &runJob, new JobContext( 0, 100), &deleteJob)) throw std::runtime_error( "failed to push job");
+	}
+	worker.stop();
+	std::cerr << "stopped with " << g_nofExecuted.value() << " jobs executed and " << g_nofDeleted.value() << " deleted" << std::endl;
+	if (g_nofExecuted.value() + g_nofDeleted.value() != nofJobs)
+	{
+		throw std::runtime_error( strus::string_format( "%d jobs lost at stop", nofJobs - g_nofExecuted.value() - g_nofDeleted.value()));
+	}
+}
+
+static strus::JobQueueWorker* createWorker( int nofWorkers)
+{
+	return nofWorkers
+		? new strus::JobQueueWorker( 1, false, nofWorkers)
+		: new strus::JobQueueWorker( 1, false);
+}
+
+static void checkStatistics( const strus::JobQueueWorker::QueueStatistics& stats, std::size_t depth, uint64_t nofEnqueued, uint64_t nofDequeued, uint64_t nofRejected, uint64_t nofDropped)
+{
+	if (stats.depth != depth || stats.nofEnqueued != nofEnqueued || stats.nofDequeued != nofDequeued
+		|| stats.nofRejected != nofRejected || stats.nofDropped != nofDropped)
+	{
+		throw std::runtime_error( strus::string_format(
+			"unexpected queue statistics: depth %d, enqueued %d, dequeued %d, rejected %d, dropped %d",
+			(int)stats.depth, (int)stats.nofEnqueued, (int)stats.nofDequeued, (int)stats.nofRejected, (int)stats.nofDropped));
+	}
+}
+
+static void testOverflowReject( int nofWorkers, int capacity)
+{
+	g_nofExecuted.set( 0);
+	strus::JobQueueWorker* worker = createWorker( nofWorkers);
+	try
+	{
+		if (!worker->setQueueCapacity( capacity, strus::JobQueueWorker::OverflowReject)) throw std::runtime_error( "failed to set queue capacity");
+		for (int ji=0; ji < capacity; ++ji)
+		{
+			if (!worker->pushJob( &runJob, new JobContext( 0, 0), &deleteJob)) throw std::runtime_error( "failed to push job");
+		}
+		JobContext* rejected = new JobContext( 0, 0);
+		if (worker->pushJob( &runJob, rejected, &deleteJob)) throw std::runtime_error( "job pushed to a full queue not rejected");
+		delete rejected;
+		checkStatistics( worker->queueStatistics(), capacity, capacity, 0, 1, 0);
+
+		if (!worker->start()) throw std::runtime_error( "failed to start worker");
+		if (worker->setQueueCapacity( 0, strus::JobQueueWorker::OverflowReject)) throw std::runtime_error( "queue capacity changed while running");
+		waitForJobs( capacity);
+		checkStatistics( worker->queueStatistics(), 0, capacity, capacity, 1, 0);
+	}
+	catch (...)
+	{
+		delete worker;
+		throw;
+	}
+	delete worker;
+}
+
+static void testOverflowDropOldest( int nofWorkers, int capacity, int nofJobs)
+{
+	g_nofExecuted.set( 0);
+	g_nofDeleted.set( 0);
+	strus::JobQueueWorker* worker = createWorker( nofWorkers);
+	try
+	{
+		if (!worker->setQueueCapacity( capacity, strus::JobQueueWorker::OverflowDropOldest)) throw std::runtime_error( "failed to set queue capacity");
+		for (int ji=0; ji < nofJobs; ++ji)
+		{
+			if (!worker->pushJob( &runJob, new JobContext( 0, 0), &deleteJob)) throw std::runtime_error( "failed to push job");
+		}
+		if (g_nofDeleted.value() != nofJobs - capacity) throw std::runtime_error( strus::string_format( "%d jobs dropped, expected %d", g_nofDeleted.value(), nofJobs - capacity));
+		checkStatistics( worker->queueStatistics(), capacity, nofJobs, 0, 0, nofJobs - capacity);
+
+		if (!worker->start()) throw std::runtime_error( "failed to start worker");
+		waitForJobs( capacity);
+		worker->stop();
+		if (g_nofExecuted.value() != capacity) throw std::runtime_error( strus::string_format( "%d jobs executed after dropping, expected %d", g_nofExecuted.value(), capacity));
+		checkStatistics( worker->queueStatistics(), 0, nofJobs, capacity, 0, nofJobs - capacity);
+	}
+	catch (...)
+	{
+		delete worker;
+		throw;
+	}
+	delete worker;
+}
+
+static void testOverflowBlock( int nofWorkers, int capacity, int nofProducers, int nofJobs)
+{
+	g_nofExecuted.set( 0);
+	strus::JobQueueWorker* worker = createWorker( nofWorkers);
+	g_worker = worker;
+	try
+	{
+		if (!worker->setQueueCapacity( capacity, strus::JobQueueWorker::OverflowBlock)) throw std::runtime_error( "failed to set queue capacity");
+		if (!worker->start()) throw std::runtime_error( "failed to start worker");
+
+		// [1] Producers waiting for space:
+		int nofJobsPerProducer = nofJobs / nofProducers + 1;
+		std::vector<Producer> producers( nofProducers, Producer( worker, nofJobsPerProducer));
+		std::vector<strus::thread*> threadGroup;
+		for (int pi=0; pi < nofProducers; ++pi)
+		{
+			threadGroup.push_back( new strus::thread( &Producer::run, &producers[ pi]));
+		}
+		std::vector<strus::thread*>::iterator ti = threadGroup.begin(), te = threadGroup.end();
+		for (; ti != te; ++ti)
+		{
+			(*ti)->join();
+			delete *ti;
+		}
+		waitForJobs( nofProducers * nofJobsPerProducer);
+		strus::JobQueueWorker::QueueStatistics stats = worker->queueStatistics();
+		if (stats.maxDepth > (std::size_t)capacity) throw std::runtime_error( strus::string_format( "queue depth %d exceeded capacity %d", (int)stats.maxDepth, capacity));
+		std::cerr << strus::string_format( "executed %d jobs with queue capacity %d, %d pushes blocked, enqueue rate %.0f/s, average wait time %.3f ms, maximum %.3f ms",
+				g_nofExecuted.value(), capacity, (int)stats.nofBlocked, stats.enqueueRate, stats.avgWaitTime, stats.maxWaitTime) << std::endl;
+
+		// [2] Jobs pushing jobs to a full queue must not wait for themselves:
+		g_nofExecuted.set( 0);
+		int nofRoots = capacity * 4;
+		for (int ri=0; ri < nofRoots; ++ri)
+		{
+			if (!worker->pushJob( &runJob, new JobContext( FanOutDepth, 0), &deleteJob)) throw std::runtime_error( "failed to push job");
+		}
+		waitForJobs( nofRoots * JobsPerRoot);
+		checkStatistics( worker->queueStatistics(), 0, stats.nofEnqueued + nofRoots * JobsPerRoot, stats.nofEnqueued + nofRoots * JobsPerRoot, 0, 0);
+	}
+	catch (...)
+	{
+		delete worker;
+		throw;
+	}
+	delete worker;
+}
+
+static strus::AtomicCounter<int> g_executionSequence;
+
+struct PriorityJobContext
+{
+	int priority;
+	int* sequence;	///< where to write the order of execution
+
+	PriorityJobContext( int priority_, int* sequence_)
+		:priority(priority_),sequence(sequence_){}
+};
+
+static void runPriorityJob( void* context)
+{
+	PriorityJobContext* job = (PriorityJobContext*)context;
+	*job->sequence = g_executionSequence.allocIncrement();
+	delete job;
+	g_nofExecuted.increment();
+}
+
+static void deletePriorityJob( void* context)
+{
+	delete (PriorityJobContext*)context;
+	g_nofDeleted.increment();
+}
+
+static void testPriorities( int nofWorkers, int nofJobsPerClass)
+{
+	enum {NofClasses=strus::JobQueueWorker::NofJobPriorities};
+	g_nofExecuted.set( 0);
+	g_executionSequence.set( 0);
+	std::vector<int> sequence( NofClasses * nofJobsPerClass, -1);
+	strus::JobQueueWorker* worker = createWorker( nofWorkers);
+	try
+	{
+		//... the jobs are queued before start, lowest priority first, so that every job has to overtake the ones pushed before
+		for (int pi=NofClasses-1; pi >= 0; --pi)
+		{
+			for (int ji=0; ji < nofJobsPerClass; ++ji)
+			{
+				int* seq = &sequence[ pi * nofJobsPerClass + ji];
+				PriorityJobContext* context = new PriorityJobContext( pi, seq);
+				if (!worker->pushJob( &runPriorityJob, context, &deletePriorityJob, (strus::JobQueueWorker::JobPriority)pi))
+				{
+					delete context;
+					throw std::runtime_error( "failed to push job");
+				}
+			}
+		}
+		if (!worker->start()) throw std::runtime_error( "failed to start worker");
+		waitForJobs( NofClasses * nofJobsPerClass);
+		worker->stop();
+
+		strus::JobQueueWorker::QueueStatistics stats = worker->queueStatistics();
+		double avgSequence[ NofClasses];
+		for (int pi=0; pi < NofClasses; ++pi)
+		{
+			int minSeq = std::numeric_limits<int>::max();
+			int maxSeq = -1;
+			double sum = 0.0;
+			for (int ji=0; ji < nofJobsPerClass; ++ji)
+			{
+				int seq = sequence[ pi * nofJobsPerClass + ji];
+				if (seq < minSeq) minSeq = seq;
+				if (seq > maxSeq) maxSeq = seq;
+				sum += seq;
+			}
+			avgSequence[ pi] = sum / nofJobsPerClass;
+			if (nofWorkers == 0 && (minSeq != pi * nofJobsPerClass || maxSeq != (pi+1) * nofJobsPerClass - 1))
+			{
+				//... a single thread executes the classes strictly in the order of their priority
+				throw std::runtime_error( strus::string_format( "jobs of priority %d executed as %d to %d", pi, minSeq, maxSeq));
+			}
+			if (pi > 0 && avgSequence[ pi] <= avgSequence[ pi-1])
+			{
+				throw std::runtime_error( strus::string_format( "jobs of priority %d not executed before the jobs of priority %d", pi-1, pi));
+			}
+			const strus::JobQueueWorker::PriorityStatistics& pst = stats.priority[ pi];
+			if (pst.nofEnqueued != (uint64_t)nofJobsPerClass || pst.nofDequeued != (uint64_t)nofJobsPerClass || pst.depth != 0)
+			{
+				throw std::runtime_error( strus::string_format( "unexpected statistics of priority %d: enqueued %d, dequeued %d, depth %d",
+						pi, (int)pst.nofEnqueued, (int)pst.nofDequeued, (int)pst.depth));
+			}
+			std::cerr << strus::string_format( "jobs of priority %d waited %.3f ms on average, %.3f ms at most", pi, pst.avgWaitTime, pst.maxWaitTime) << std::endl;
+		}
+		if (stats.priority[ 0].maxWaitTime > stats.priority[ NofClasses-1].maxWaitTime)
+		{
+			throw std::runtime_error( "jobs of the highest priority waited longer than bulk jobs");
+		}
+	}
+	catch (...)
+	{
+		delete worker;
+		throw;
+	}
+	delete worker;
+}
+
+static int64_t timeNowMicroSeconds()
+{
+	struct timespec ts;
+	::clock_gettime( CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct TimerContext
+{
+	int64_t deadline;	///< earliest time in microseconds the timer may expire
+
+	explicit TimerContext( int64_t deadline_)
+		:deadline(deadline_){}
+};
+
+static strus::AtomicCounter<int> g_nofTimersExpired;
+static strus::AtomicCounter<int> g_nofTimersDeleted;
+static strus::AtomicCounter<int> g_nofTimersEarly;
+
+static void timerExpired( void* context)
+{
+	TimerContext* timer = (TimerContext*)context;
+	if (timeNowMicroSeconds() < timer->deadline) g_nofTimersEarly.increment();
+	delete timer;
+	g_nofTimersExpired.increment();
+}
+
+static void deleteTimer( void* context)
+{
+	delete (TimerContext*)context;
+	g_nofTimersDeleted.increment();
+}
+
+static void testTimers( strus::JobQueueWorker& worker, int nofTimers)
+{
+	g_nofTimersExpired.set( 0);
+	g_nofTimersDeleted.set( 0);
+	g_nofTimersEarly.set( 0);
+	std::vector<strus::JobQueueWorker::TimerId> timers;
+	for (int ti=0; ti < nofTimers; ++ti)
+	{
+		int milliseconds = 1 + (ti * 7919) % 300;
+		//... the clock of the worker has a resolution of one millisecond
+		TimerContext* context = new TimerContext( timeNowMicroSeconds() + milliseconds * 1000 - 1000);
+		strus::JobQueueWorker::TimerId id = worker.scheduleTimer( milliseconds, &timerExpired, context, &deleteTimer);
+		if (!id)
+		{
+			delete context;
+			throw std::runtime_error( "failed to schedule timer");
+		}
+		timers.push_back( id);
+	}
+	int nofCancelled = 0;
+	for (int ti=0; ti < nofTimers; ti += 3)
+	{
+		if (worker.cancelTimer( timers[ ti])) ++nofCancelled;
+	}
+	int nofRounds = 0;
+	while (g_nofTimersExpired.value() + nofCancelled < nofTimers)
+	{
+		if (++nofRounds > 60000) throw std::runtime_error( strus::string_format( "timeout, %d of %d timers expired", g_nofTimersExpired.value(), nofTimers - nofCancelled));
+		strus::usleep( 1000);
+	}
+	if (g_nofTimersDeleted.value() != nofCancelled || g_nofTimersExpired.value() + nofCancelled != nofTimers)
+	{
+		throw std::runtime_error( strus::string_format( "%d timers expired and %d deleted, %d cancelled of %d", g_nofTimersExpired.value(), g_nofTimersDeleted.value(), nofCancelled, nofTimers));
+	}
+	if (g_nofTimersEarly.value()) throw std::runtime_error( strus::string_format( "%d timers expired too early", g_nofTimersEarly.value()));
+	for (int ti=0; ti < nofTimers; ti += 3)
+	{
+		if (worker.cancelTimer( timers[ ti])) throw std::runtime_error( "timer cancelled twice");
+	}
+	std::cerr << "expired " << g_nofTimersExpired.value() << " timers, " << nofCancelled << " cancelled" << std::endl;
+}
+
+struct ListenerContext
+{
+	int fd;
+
+	explicit ListenerContext( int fd_)
+		:fd(fd_){}
+};
+
+static strus::AtomicCounter<int> g_nofEventsHandled;
+static strus::AtomicCounter<int> g_nofListenersDeleted;
+
+static void readListener( void* context)
+{
+	ListenerContext* listener = (ListenerContext*)context;
+	char ch;
+	if (::read( listener->fd, &ch, 1) == 1) g_nofEventsHandled.increment();
+}
+
+static void deleteListener( void* context)
+{
+	delete (ListenerContext*)context;
+	g_nofListenersDeleted.increment();
+}
+
+static void testListeners( int nofPipes)
+{
+	strus::JobQueueWorker worker( 1, true);
+	if (!worker.start()) throw std::runtime_error( "failed to start worker");
+	testTimers( worker, nofPipes);
+	std::vector<int> pipes;
+	try
+	{
+		for (int pi=0; pi < nofPipes; ++pi)
+		{
+			int pipfd[2];
+			if (::pipe( pipfd) == -1) throw std::runtime_error( "failed to create pipe");
+			pipes.push_back( pipfd[0]);
+			pipes.push_back( pipfd[1]);
+			::fcntl( pipfd[0], F_SETFL, ::fcntl( pipfd[0], F_GETFL) | O_NONBLOCK);
+			if (!worker.pushListener( &readListener, new ListenerContext( pipfd[0]), &deleteListener, pipfd[0], strus::JobQueueWorker::FdRead))
+			{
+				throw std::runtime_error( "failed to push listener");
+			}
+		}
+		strus::usleep( 10000);
+		for (int pi=0; pi < nofPipes; ++pi)
+		{
+			if (::write( pipes[ pi*2+1], "x", 1) != 1) throw std::runtime_error( "failed to write to pipe");
+		}
+		int nofRounds = 0;
+		while (g_nofEventsHandled.value() < nofPipes)
+		{
+			if (++nofRounds > 60000) throw std::runtime_error( strus::string_format( "timeout, %d of %d events handled", g_nofEventsHandled.value(), nofPipes));
+			strus::usleep( 1000);
+		}
+		for (int pi=0; pi < nofPipes; ++pi)
+		{
+			if (!worker.pushListener( 0, 0, 0, pipes[ pi*2], 0)) throw std::runtime_error( "failed to remove listener");
+		}
+		nofRounds = 0;
+		while (g_nofListenersDeleted.value() < nofPipes)
+		{
+			if (++nofRounds > 60000) throw std::runtime_error( strus::string_format( "timeout, %d of %d listeners deleted", g_nofListenersDeleted.value(), nofPipes));
+			strus::usleep( 1000);
+		}
+		worker.stop();
+	}
+	catch (...)
+	{
+		worker.stop();
+		std::vector<int>::const_iterator fi = pipes.begin(), fe = pipes.end();
+		for (; fi != fe; ++fi) ::close( *fi);
+		throw;
+	}
+	std::vector<int>::const_iterator fi = pipes.begin(), fe = pipes.end();
+	for (; fi != fe; ++fi) ::close( *fi);
+	std::cerr << "handled " << g_nofEventsHandled.value() << " events of " << nofPipes << " listeners" << std::endl;
+	if (g_nofEventsHandled.value() != nofPipes) throw std::runtime_error( "unexpected number of events handled");
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofWorkers = 4;
+		int nofJobs = 10000;
+		int nofPipes = 300;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testJobQueueWorker [<nofworkers>] [<nofjobs>] [<nofpipes>]" << std::endl;
+			std::cout << "       <nofworkers> :Number of threads of the pool, 0 for a worker without pool (default 4)" << std::endl;
+			std::cout << "       <nofjobs>    :Number of jobs to execute (default 10000)" << std::endl;
+			std::cout << "       <nofpipes>   :Number of pipes with listeners (default 300)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofWorkers = parseNumber( argv[1]);
+		if (argc > 2) nofJobs = parseNumber( argv[2]);
+		if (argc > 3) nofPipes = parseNumber( argv[3]);
+		if (argc > 4) throw std::runtime_error( "too many arguments");
+
+		strus::JobQueueWorker* worker = createWorker( nofWorkers);
+		g_worker = worker;
+		try
+		{
+			if (!worker->start()) throw std::runtime_error( "failed to start worker");
+			testExecuteJobs( *worker, nofJobs);
+			testConcurrentProducers( *worker, 8, nofJobs);
+			testTimers( *worker, nofJobs / 10 + 1);
+			testStopWithJobsQueued( *worker, nofJobs / 10 + 1);
+			if (g_nofErrors.value()) throw std::runtime_error( "failed to push jobs from jobs");
+		}
+		catch (...)
+		{
+			delete worker;
+			throw;
+		}
+		delete worker;
+		testOverflowReject( nofWorkers, 10);
+		testOverflowDropOldest( nofWorkers, 10, 25);
+		testOverflowBlock( nofWorkers, 4, 4, nofJobs / 10 + 1);
+		testPriorities( nofWorkers, nofJobs / 10 + 1);
+		if (g_nofErrors.value()) throw std::runtime_error( "failed to push jobs from jobs");
+		testListeners( nofPipes);
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
@@ -6,6 +6,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 #include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
 #include "strus/base/lockfreeStringMap.hpp"
 #include "strus/base/pseudoRandom.hpp"
 #include "strus/base/string_format.hpp"
@@ -16,6 +17,7 @@
 #include <cstdlib>
 #include <map>
 #include <set>
+#include <vector>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
@@ -117,6 +119,243 @@ static void checkResultExpected( const TestMap& testMap, const ExpectedMap& expe
 	if (nofErrors) throw std::runtime_error( strus::string_format( "%d of differences found comparing %d test keys with %d expected", nofErrors, nofTestKeys, nofExpectedKeys));
 }
 
+/// \brief Lookup of the expected keys as slices of one string, single and batched with some keys not in the map
+static void checkLengthDelimitedKeys( const TestMap& testMap, const ExpectedMap& expectedMap)
+{
+	std::string buffer;
+	std::vector<std::size_t> keypos;
+	std::vector<std::size_t> keylens;
+	std::vector<int> expectedValues;
+	ExpectedMap::const_iterator ei = expectedMap.begin(), ee = expectedMap.end();
+	for (int eidx=0; ei != ee; ++ei,++eidx)
+	{
+		keypos.push_back( buffer.size());
+		// ... every third key is a prefix of an existing key that might not be in the map
+		std::size_t keylen = (eidx % 3 == 0) ? (ei->first.size()-1) : ei->first.size();
+		ExpectedMap::const_iterator xi = expectedMap.find( ei->first.substr( 0, keylen));
+		keylens.push_back( keylen);
+		expectedValues.push_back( xi == expectedMap.end() ? -1 : xi->second);
+		buffer.append( ei->first);
+	}
+	std::vector<const char*> keys;
+	std::vector<std::size_t>::const_iterator pi = keypos.begin(), pe = keypos.end();
+	for (; pi != pe; ++pi) keys.push_back( buffer.c_str() + *pi);
+
+	std::vector<int> values( keys.size(), -1);
+	bool* found = new bool[ keys.size()];
+	std::size_t nofFound = testMap.getMany( keys.size(), keys.data(), keylens.data(), values.data(), found);
+	std::size_t nofExpectedFound = 0;
+	for (std::size_t ki=0; ki < keys.size(); ++ki)
+	{
+		int value = -1;
+		bool singleFound = testMap.get( keys[ ki], keylens[ ki], value);
+		bool expectedFound = expectedValues[ ki] >= 0;
+		if (expectedFound) ++nofExpectedFound;
+		if (singleFound != expectedFound || found[ ki] != expectedFound)
+		{
+			delete [] found;
+			throw std::runtime_error( strus::string_format( "lookup of length delimited key %d not as expected", (int)ki));
+		}
+		if (expectedFound && (value != expectedValues[ ki] || values[ ki] != expectedValues[ ki]))
+		{
+			delete [] found;
+			throw std::runtime_error( strus::string_format( "value of length delimited key %d not as expected", (int)ki));
+		}
+	}
+	delete [] found;
+	if (nofFound != nofExpectedFound) throw std::runtime_error( "number of keys found in batch lookup not as expected");
+}
+
+/// \brief Thread inserting its own set of keys with the key index as value
+class ConcurrentWriter
+{
+public:
+	ConcurrentWriter( TestMap* testMap_, int threadidx_, int nofElements_)
+		:m_testMap(testMap_),m_threadidx(threadidx_),m_nofElements(nofElements_){}
+
+	void operator()()
+	{
+		for (int ei=0; ei<m_nofElements; ++ei)
+		{
+			char keybuf[ 32];
+			std::snprintf( keybuf, sizeof(keybuf), "T%d_%d", m_threadidx, ei);
+			m_testMap->set( keybuf, ei, MapIncrement());
+		}
+	}
+
+private:
+	TestMap* m_testMap;
+	int m_threadidx;
+	int m_nofElements;
+};
+
+/// \brief Thread reading keys of the writers while they are inserted, a key found must have the expected value
+class ConcurrentReader
+{
+public:
+	ConcurrentReader( const TestMap* testMap_, int nofThreads_, int nofElements_, strus::AtomicCounter<int>* nofErrors_)
+		:m_testMap(testMap_),m_nofThreads(nofThreads_),m_nofElements(nofElements_),m_nofErrors(nofErrors_){}
+
+	void operator()()
+	{
+		for (int ei=0; ei<m_nofElements; ++ei)
+		{
+			char keybuf[ 32];
+			std::snprintf( keybuf, sizeof(keybuf), "T%d_%d", ei % m_nofThreads, ei);
+			int value;
+			if (m_testMap->get( keybuf, value) && value != ei)
+			{
+				m_nofErrors->increment();
+			}
+		}
+	}
+
+private:
+	const TestMap* m_testMap;
+	int m_nofThreads;
+	int m_nofElements;
+	strus::AtomicCounter<int>* m_nofErrors;
+};
+
+static void testConcurrentAccess( int nofBlocks, int nofThreads, int nofElements)
+{
+	TestMap testMap( nofBlocks);
+	strus::AtomicCounter<int> nofErrors;
+	std::vector<strus::thread*> threads;
+	for (int ti=0; ti<nofThreads; ++ti)
+	{
+		threads.push_back( new strus::thread( ConcurrentWriter( &testMap, ti, nofElements)));
+		threads.push_back( new strus::thread( ConcurrentReader( &testMap, nofThreads, nofElements, &nofErrors)));
+	}
+	std::vector<strus::thread*>::iterator hi = threads.begin(), he = threads.end();
+	for (; hi != he; ++hi)
+	{
+		(*hi)->join();
+		delete *hi;
+	}
+	if (nofErrors.value()) throw std::runtime_error( strus::string_format( "%d values read by concurrent readers not as expected", nofErrors.value()));
+
+	int nofKeys = 0;
+	TestMap::const_iterator ti = testMap.begin(), te = testMap.end();
+	for (; ti != te; ++ti) ++nofKeys;
+	if (nofKeys != nofThreads * nofElements) throw std::runtime_error( strus::string_format( "number of keys %d inserted by concurrent writers not as expected %d", nofKeys, nofThreads * nofElements));
+	for (int thidx=0; thidx<nofThreads; ++thidx)
+	{
+		for (int ei=0; ei<nofElements; ++ei)
+		{
+			char keybuf[ 32];
+			std::snprintf( keybuf, sizeof(keybuf), "T%d_%d", thidx, ei);
+			int value;
+			if (!testMap.get( keybuf, value) || value != ei)
+			{
+				throw std::runtime_error( strus::string_format( "key '%s' inserted by concurrent writer not found or with unexpected value", keybuf));
+			}
+		}
+	}
+}
+
+/// \brief Thread inserting keys in ascending order, publishing the number of keys inserted after every insert
+class GrowthWriter
+{
+public:
+	GrowthWriter( TestMap* testMap_, int nofElements_, strus::AtomicCounter<int>* nofInserted_)
+		:m_testMap(testMap_),m_nofElements(nofElements_),m_nofInserted(nofInserted_){}
+
+	void operator()()
+	{
+		for (int ei=0; ei<m_nofElements; ++ei)
+		{
+			char keybuf[ 32];
+			std::snprintf( keybuf, sizeof(keybuf), "G%d", ei);
+			m_testMap->set( keybuf, ei, MapIncrement());
+			m_nofInserted->set( ei+1);
+		}
+	}
+
+private:
+	TestMap* m_testMap;
+	int m_nofElements;
+	strus::AtomicCounter<int>* m_nofInserted;
+};
+
+/// \brief Thread looking up only keys inserted completely before the lookup started, while the writer grows the tables, every key must be found
+/// \note Readers with an odd index also iterate on the map, every key inserted before the iteration started must be visited
+class GrowthReader
+{
+public:
+	GrowthReader( const TestMap* testMap_, int readeridx_, int nofElements_, const strus::AtomicCounter<int>* nofInserted_, strus::AtomicCounter<int>* nofMisses_)
+		:m_testMap(testMap_),m_readeridx(readeridx_),m_nofElements(nofElements_),m_nofInserted(nofInserted_),m_nofMisses(nofMisses_){}
+
+	void operator()()
+	{
+		unsigned int rnd = m_readeridx + 1;
+		int nofLookups = 0;
+		int nofInserted;
+		while ((nofInserted = m_nofInserted->value()) < m_nofElements)
+		{
+			if (nofInserted == 0) continue;
+			if (m_readeridx % 2 == 1 && ++nofLookups % 4096 == 0)
+			{
+				checkIteration( nofInserted);
+				continue;
+			}
+			rnd = rnd * 1103515245 + 12345;
+			//... prefer the keys inserted last, they are the ones under migration
+			int ei = (rnd & 1) ? (nofInserted - 1 - (int)((rnd >> 8) % 1024) ) : (int)((rnd >> 8) % nofInserted);
+			if (ei < 0) ei = 0;
+			char keybuf[ 32];
+			std::snprintf( keybuf, sizeof(keybuf), "G%d", ei);
+			int value;
+			if (!m_testMap->get( keybuf, value) || value != ei)
+			{
+				m_nofMisses->increment();
+			}
+		}
+	}
+
+private:
+	void checkIteration( int nofInserted)
+	{
+		int nofVisited = 0;
+		TestMap::const_iterator ti = m_testMap->begin(), te = m_testMap->end();
+		for (; ti != te; ++ti)
+		{
+			if (ti->first[0] == 'G' && ::atoi( ti->first+1) < nofInserted) ++nofVisited;
+		}
+		if (nofVisited < nofInserted)
+		{
+			m_nofMisses->increment( nofInserted - nofVisited);
+		}
+	}
+
+private:
+	const TestMap* m_testMap;
+	int m_readeridx;
+	int m_nofElements;
+	const strus::AtomicCounter<int>* m_nofInserted;
+	strus::AtomicCounter<int>* m_nofMisses;
+};
+
+static void testConcurrentGrowth( int nofBlocks, int nofThreads, int nofElements)
+{
+	TestMap testMap( nofBlocks);
+	strus::AtomicCounter<int> nofInserted;
+	strus::AtomicCounter<int> nofMisses;
+	std::vector<strus::thread*> threads;
+	threads.push_back( new strus::thread( GrowthWriter( &testMap, nofElements, &nofInserted)));
+	for (int ti=0; ti<nofThreads; ++ti)
+	{
+		threads.push_back( new strus::thread( GrowthReader( &testMap, ti, nofElements, &nofInserted, &nofMisses)));
+	}
+	std::vector<strus::thread*>::iterator hi = threads.begin(), he = threads.end();
+	for (; hi != he; ++hi)
+	{
+		(*hi)->join();
+		delete *hi;
+	}
+	if (nofMisses.value()) throw std::runtime_error( strus::string_format( "%d keys inserted before a lookup or iteration started not found during concurrent growth", nofMisses.value()));
+}
+
 static int parseNumber( const char* arg)
 {
 	char const* ai = arg;
@@ -132,6 +371,7 @@ int main( int argc, const char** argv)
 		int argi = 1;
 		int nofBlocks = 128;
 		int nofElements = 10000;
+		int nofThreads = 4;
 		for (; argc > argi && argv[argi][0] == '-'; ++argi)
 		{
 			if (0==std::strcmp( argv[argi], "--"))
@@ -145,11 +385,12 @@ int main( int argc, const char** argv)
 			}
 			else if (0==std::strcmp( argv[1], "-h"))
 			{
-				std::cout << "Usage: testLockfreeStringMap [-V,-h] [<nofblocks>] [<nofelems>]" << std::endl;
+				std::cout << "Usage: testLockfreeStringMap [-V,-h] [<nofblocks>] [<nofelems>] [<nofthreads>]" << std::endl;
 				std::cout << "       Option -V: Verbose output" << std::endl;
 				std::cout << "              -h: Print this usage" << std::endl;
 				std::cout << "       <nofblocks> :Number of blocks in map (default 128)" << std::endl;
-				std::cout << "       <nofblocks> :Number of elements in map (default 10000)" << std::endl;
+				std::cout << "       <nofelems> :Number of elements in map (default 10000)" << std::endl;
+				std::cout << "       <nofthreads> :Number of concurrent writers and readers (default 4)" << std::endl;
 			}
 			else
 			{
@@ -164,6 +405,10 @@ int main( int argc, const char** argv)
 		{
 			nofElements = parseNumber( argv[argi++]);
 		}
+		if (argi < argc)
+		{
+			nofThreads = parseNumber( argv[argi++]);
+		}
 		if (argi < argc) throw std::runtime_error( "too many arguments");
 
 		TestMap testMap( nofBlocks);
@@ -181,6 +426,9 @@ int main( int argc, const char** argv)
 			std::cerr << "number of keys inserted: " << expectedMap.size() << std::endl;
 		}
 		checkResultExpected( testMap, expectedMap);
+		checkLengthDelimitedKeys( testMap, expectedMap);
+		testConcurrentAccess( nofBlocks, nofThreads, nofElements);
+		testConcurrentGrowth( nofBlocks, nofThreads, nofElements * 10);
 
 		std::cerr << "OK" << std::endl;
 		return 0;
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/parallel.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/stdint.h"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+struct SquareBody
+{
+	std::vector<int64_t>& ar;
+
+	explicit SquareBody( std::vector<int64_t>& ar_) :ar(ar_){}
+
+	void operator()( std::size_t start, std::size_t end) const
+	{
+		for (std::size_t ii=start; ii < end; ++ii) ar[ ii] = (int64_t)ii * (int64_t)ii;
+	}
+};
+
+struct SumBody
+{
+	const std::vector<int64_t>& ar;
+
+	explicit SumBody( const std::vector<int64_t>& ar_) :ar(ar_){}
+
+	int64_t operator()( std::size_t start, std::size_t end, const int64_t& init) const
+	{
+		int64_t rt = init;
+		for (std::size_t ii=start; ii < end; ++ii) rt += ar[ ii];
+		return rt;
+	}
+};
+
+struct Plus
+{
+	int64_t operator()( const int64_t& aa, const int64_t& bb) const
+	{
+		return aa + bb;
+	}
+};
+
+/// \brief Reduction that is associative but not commutative, to check the order of the joins
+struct DigitsBody
+{
+	std::string operator()( std::size_t start, std::size_t end, const std::string& init) const
+	{
+		std::string rt = init;
+		for (std::size_t ii=start; ii < end; ++ii) rt.push_back( '0' + ii % 10);
+		return rt;
+	}
+};
+
+struct Concat
+{
+	std::string operator()( const std::string& aa, const std::string& bb) const
+	{
+		return aa + bb;
+	}
+};
+
+/// \brief Nested parallel loops, the inner loops are executed by the threads of the outer loop
+struct NestedBody
+{
+	std::vector<int64_t>& ar;
+	std::size_t rowSize;
+
+	NestedBody( std::vector<int64_t>& ar_, std::size_t rowSize_) :ar(ar_),rowSize(rowSize_){}
+
+	void operator()( std::size_t start, std::size_t end) const
+	{
+		for (std::size_t row=start; row < end; ++row)
+		{
+			std::vector<int64_t> rowar( rowSize);
+			strus::parallel_for( 0, rowSize, SquareBody( rowar), 64);
+			int64_t sum = strus::parallel_reduce( 0, rowSize, (int64_t)0, SumBody( rowar), Plus(), 64);
+			ar[ row] = sum + row;
+		}
+	}
+};
+
+struct FailingBody
+{
+	void operator()( std::size_t start, std::size_t end) const
+	{
+		if (start <= 777 && end > 777) throw std::runtime_error( "element 777 failed");
+	}
+};
+
+static int64_t sumOfSquares( int64_t nn)
+{
+	//... divide before multiplying the last factor to avoid an overflow for sizes up to several millions
+	return (nn - 1) * nn / 2 * (2 * nn - 1) / 3;
+}
+
+static void testFor( std::size_t size)
+{
+	std::vector<int64_t> ar( size, -1);
+	strus::parallel_for( 0, size, SquareBody( ar), 1000);
+	for (std::size_t ii=0; ii < size; ++ii)
+	{
+		if (ar[ ii] != (int64_t)ii * (int64_t)ii) throw std::runtime_error( strus::string_format( "element %d not processed by parallel_for", (int)ii));
+	}
+	int64_t sum = strus::parallel_reduce( 0, size, (int64_t)0, SumBody( ar), Plus(), 1000);
+	if (sum != sumOfSquares( size)) throw std::runtime_error( "unexpected result of parallel_reduce");
+}
+
+static void testReduceOrder( std::size_t size)
+{
+	std::string expected = DigitsBody()( 0, size, std::string());
+	std::string result = strus::parallel_reduce( 0, size, std::string(), DigitsBody(), Concat(), 10);
+	if (result != expected) throw std::runtime_error( "order of joins of parallel_reduce not respected");
+}
+
+static void testNested( std::size_t nofRows, std::size_t rowSize)
+{
+	std::vector<int64_t> ar( nofRows, -1);
+	strus::parallel_for( 0, nofRows, NestedBody( ar, rowSize), 1);
+	for (std::size_t row=0; row < nofRows; ++row)
+	{
+		if (ar[ row] != sumOfSquares( rowSize) + (int64_t)row) throw std::runtime_error( "unexpected result of nested parallel loops");
+	}
+}
+
+static void testSort( std::size_t size)
+{
+	std::vector<int> ar;
+	ar.reserve( size);
+	for (std::size_t ii=0; ii < size; ++ii) ar.push_back( g_random.get( 0, 1000000));
+	std::vector<int> expected( ar);
+	std::sort( expected.begin(), expected.end());
+	strus::parallel_sort( ar.begin(), ar.end());
+	if (ar != expected) throw std::runtime_error( "parallel_sort failed");
+
+	std::vector<int> small( ar.begin(), ar.begin() + std::min( size, (std::size_t)100));
+	std::vector<int> smallExpected( small);
+	std::sort( smallExpected.begin(), smallExpected.end(), std::greater<int>());
+	strus::parallel_sort( small.begin(), small.end(), std::greater<int>());
+	if (small != smallExpected) throw std::runtime_error( "parallel_sort of small range failed");
+}
+
+static void testError()
+{
+	try
+	{
+		strus::parallel_for( 0, 100000, FailingBody(), 10);
+	}
+	catch (const std::runtime_error& err)
+	{
+		if (std::string( err.what()) != "element 777 failed") throw std::runtime_error( "unexpected error of parallel_for");
+		return;
+	}
+	throw std::runtime_error( "error of parallel_for not reported");
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofThreads = 0;
+		int size = 1000000;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testParallel [<threads>] [<size>]" << std::endl;
+			std::cout << "       <threads> :Number of threads including the caller (0 for the number of cores)" << std::endl;
+			std::cout << "       <size>    :Number of elements processed (default 1000000)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofThreads = parseNumber( argv[1]);
+		if (argc > 2) size = parseNumber( argv[2]);
+		if (argc > 3) throw std::runtime_error( "too many arguments");
+
+		if (!strus::parallel::setConcurrency( nofThreads)) throw std::runtime_error( "failed to set number of threads");
+		std::cerr << "running with " << strus::parallel::concurrency() << " threads" << std::endl;
+		testFor( size);
+		testReduceOrder( 10000);
+		testNested( 100, 1000);
+		testSort( size);
+		testError();
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
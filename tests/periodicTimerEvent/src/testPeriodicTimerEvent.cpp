@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/periodicTimerEvent.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/base/atomic.hpp"
+#include "strus/base/sleep.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+enum {RunTimeMilliseconds=600};
+
+static strus::mutex g_threadsMutex;
+static std::set<strus::ThreadId::Type> g_threads;
+
+class CountingTimerEvent
+	:public strus::PeriodicTimerEvent
+{
+public:
+	CountingTimerEvent( int milliseconds_, int maxTicks_)
+		:strus::PeriodicTimerEvent( milliseconds_, strus::PeriodicTimerEvent::Milliseconds)
+		,m_milliseconds(milliseconds_),m_maxTicks(maxTicks_),m_nofTicks(0){}
+	virtual ~CountingTimerEvent()
+	{
+		stop();
+	}
+
+	virtual void tick()
+	{
+		{
+			strus::unique_lock lock( g_threadsMutex);
+			g_threads.insert( strus::ThreadId::get());
+		}
+		m_nofTicks.increment();
+		//... stop called by the tick itself must not wait for the tick to finish
+		if (m_maxTicks && m_nofTicks.value() >= m_maxTicks) stop();
+	}
+
+	int milliseconds() const
+	{
+		return m_milliseconds;
+	}
+
+	int nofTicks() const
+	{
+		return m_nofTicks.value();
+	}
+
+private:
+	int m_milliseconds;
+	int m_maxTicks;
+	strus::AtomicCounter<int> m_nofTicks;
+};
+
+static void testTimerEvents( int nofEvents)
+{
+	std::vector<CountingTimerEvent*> events;
+	try
+	{
+		for (int ei=0; ei < nofEvents; ++ei)
+		{
+			//... periods of 20 to 200 milliseconds, every 10th event stops itself after 2 ticks
+			int maxTicks = (ei % 10 == 9) ? 2 : 0;
+			events.push_back( new CountingTimerEvent( 20 + (ei * 37) % 181, maxTicks));
+			if (!events.back()->start()) throw std::runtime_error( "failed to start timer event");
+		}
+		strus::usleep( RunTimeMilliseconds * 1000);
+		std::vector<int> ticksInRunTime;
+		for (int ei=0; ei < nofEvents; ++ei)
+		{
+			ticksInRunTime.push_back( events[ ei]->nofTicks());
+		}
+
+		// [1] Stop half of the events and check that they do not tick anymore:
+		std::vector<int> ticksAtStop;
+		for (int ei=0; ei < nofEvents; ei += 2)
+		{
+			events[ ei]->stop();
+			ticksAtStop.push_back( events[ ei]->nofTicks());
+		}
+		strus::usleep( 100 * 1000);
+		for (int ei=0; ei < nofEvents; ei += 2)
+		{
+			if (events[ ei]->nofTicks() != ticksAtStop[ ei / 2]) throw std::runtime_error( "timer event ticked after stop");
+		}
+		// [2] Check the number of ticks:
+		for (int ei=0; ei < nofEvents; ++ei)
+		{
+			int expected = RunTimeMilliseconds / events[ ei]->milliseconds();
+			int nofTicks = ticksInRunTime[ ei];
+			if (ei % 10 == 9)
+			{
+				if (nofTicks != 2) throw std::runtime_error( strus::string_format( "timer event stopped by its tick ticked %d times", nofTicks));
+			}
+			else if (nofTicks > expected + 1 || nofTicks < expected / 2)
+			{
+				throw std::runtime_error( strus::string_format( "timer event with a period of %d ms ticked %d times in %d ms", events[ ei]->milliseconds(), nofTicks, (int)RunTimeMilliseconds));
+			}
+		}
+		// [3] Restart an event stopped:
+		int ticksBefore = events[ 0]->nofTicks();
+		if (!events[ 0]->start()) throw std::runtime_error( "failed to restart timer event");
+		strus::usleep( (events[ 0]->milliseconds() * 2 + 50) * 1000);
+		if (events[ 0]->nofTicks() <= ticksBefore) throw std::runtime_error( "restarted timer event does not tick");
+	}
+	catch (...)
+	{
+		std::vector<CountingTimerEvent*>::const_iterator ei = events.begin(), ee = events.end();
+		for (; ei != ee; ++ei) delete *ei;
+		throw;
+	}
+	std::vector<CountingTimerEvent*>::const_iterator ei = events.begin(), ee = events.end();
+	for (; ei != ee; ++ei) delete *ei;
+
+	std::size_t nofThreads;
+	{
+		strus::unique_lock lock( g_threadsMutex);
+		nofThreads = g_threads.size();
+	}
+	std::cerr << "served " << nofEvents << " timer events with " << nofThreads << " threads" << std::endl;
+	if (nofThreads != 1) throw std::runtime_error( "timer events not served by one thread");
+}
+
+/// \brief Stop of the only event running by its own tick, the timer service must not destroy the worker of the thread calling it
+static void testLastEventStopsItself()
+{
+	CountingTimerEvent event( 20, 2);
+	if (!event.start()) throw std::runtime_error( "failed to start timer event");
+	strus::usleep( 200 * 1000);
+	if (event.nofTicks() != 2) throw std::runtime_error( strus::string_format( "last timer event stopped by its tick ticked %d times", event.nofTicks()));
+
+	//... the timer service is still usable after the last event stopped itself
+	CountingTimerEvent next( 20, 2);
+	if (!next.start()) throw std::runtime_error( "failed to start timer event after the last one stopped itself");
+	strus::usleep( 200 * 1000);
+	if (next.nofTicks() != 2) throw std::runtime_error( strus::string_format( "timer event started after the last one stopped itself ticked %d times", next.nofTicks()));
+	std::cerr << "executed testLastEventStopsItself()" << std::endl;
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofEvents = 50;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testPeriodicTimerEvent [<nofevents>]" << std::endl;
+			std::cout << "       <nofevents> :Number of timer events running concurrently (default 50)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofEvents = parseNumber( argv[1]);
+		if (argc > 2) throw std::runtime_error( "too many arguments");
+
+		testLastEventStopsItself();
+		testTimerEvents( nofEvents);
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/rankSelectBitVector.hpp"
+#include "strus/base/bitset.hpp"
+#include "strus/base/dynamic_bitset.hpp"
+#include "strus/base/compressed_bitset.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/stdint.h"
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+/// \brief Create a random array of words with a density of bits set of about density/1000
+static std::vector<uint64_t> randomWords( std::size_t size, int density)
+{
+	std::vector<uint64_t> rt( (size + 63) / 64, 0);
+	std::size_t pos = 0;
+	for (; pos < size; ++pos)
+	{
+		if (g_random.get( 0, 1000) < density) rt[ pos / 64] |= (uint64_t)1 << (pos % 64);
+	}
+	if (size % 64 != 0 && g_random.get( 0, 2) == 0)
+	{
+		//... bits beyond the dimension have to be ignored
+		rt.back() |= ~(uint64_t)0 << (size % 64);
+	}
+	return rt;
+}
+
+/// \brief Check rank and select of every position and every bit set against a linear scan of the positions
+static void checkRankSelect( const strus::RankSelectBitVector& bv, const std::vector<bool>& expected, const char* context)
+{
+	if (bv.size() != expected.size())
+	{
+		throw std::runtime_error( strus::string_format( "%s: dimension %d does not match expected %d", context, (int)bv.size(), (int)expected.size()));
+	}
+	std::size_t cnt = 0;
+	std::size_t pos = 0;
+	for (; pos < expected.size(); ++pos)
+	{
+		if (bv.rank( pos) != cnt)
+		{
+			throw std::runtime_error( strus::string_format( "%s: rank of position %d is %d, expected %d", context, (int)pos, (int)bv.rank( pos), (int)cnt));
+		}
+		if (bv.test( pos) != expected[ pos])
+		{
+			throw std::runtime_error( strus::string_format( "%s: test of position %d failed", context, (int)pos));
+		}
+		if (expected[ pos])
+		{
+			if (bv.select( cnt) != (int)pos)
+			{
+				throw std::runtime_error( strus::string_format( "%s: select of rank %d is %d, expected %d", context, (int)cnt, bv.select( cnt), (int)pos));
+			}
+			++cnt;
+		}
+	}
+	if (bv.count() != cnt || bv.rank( expected.size()) != cnt || bv.rank( expected.size() + 100) != cnt)
+	{
+		throw std::runtime_error( strus::string_format( "%s: number of bits set %d does not match expected %d", context, (int)bv.count(), (int)cnt));
+	}
+	if (bv.select( cnt) != -1 || bv.select( cnt + 1000) != -1)
+	{
+		throw std::runtime_error( strus::string_format( "%s: select of rank out of range returns a position", context));
+	}
+}
+
+static std::vector<bool> expectedBits( const std::vector<uint64_t>& words, std::size_t size)
+{
+	std::vector<bool> rt( size, false);
+	std::size_t pos = 0;
+	for (; pos < size; ++pos)
+	{
+		rt[ pos] = (words[ pos / 64] & ((uint64_t)1 << (pos % 64))) != 0;
+	}
+	return rt;
+}
+
+static void testWords( std::size_t size, int density)
+{
+	std::vector<uint64_t> words = randomWords( size, density);
+	strus::RankSelectBitVector bv( words.data(), size);
+	std::string context = strus::string_format( "words size %d density %d", (int)size, density);
+	checkRankSelect( bv, expectedBits( words, size), context.c_str());
+#ifdef STRUS_LOWLEVEL_DEBUG
+	std::cerr << "checked " << context << " with " << bv.count() << " bits set" << std::endl;
+#endif
+}
+
+template <int SIZE>
+static void testBitSet( int density)
+{
+	strus::bitset<SIZE> set;
+	std::vector<bool> expected( SIZE, false);
+	int pos = 0;
+	for (; pos < SIZE; ++pos)
+	{
+		if (g_random.get( 0, 1000) < density)
+		{
+			set.set( pos, true);
+			expected[ pos] = true;
+		}
+	}
+	strus::RankSelectBitVector bv( set);
+	checkRankSelect( bv, expected, strus::string_format( "bitset<%d> density %d", SIZE, density).c_str());
+}
+
+template <class BitSet>
+static void testSparseSet( const char* name, std::size_t size, int nofElements)
+{
+	BitSet set( size);
+	std::vector<bool> expected( size, false);
+	int ei = 0;
+	for (; ei < nofElements; ++ei)
+	{
+		int pos = g_random.get( 0, size);
+		set.set( pos, true);
+		expected[ pos] = true;
+	}
+	//... a run of consecutive positions
+	std::size_t start = g_random.get( 0, size);
+	std::size_t end = start + g_random.get( 0, 5000);
+	for (; start < end && start < size; ++start)
+	{
+		set.set( start, true);
+		expected[ start] = true;
+	}
+	strus::RankSelectBitVector bv( set);
+	checkRankSelect( bv, expected, strus::string_format( "%s size %d elements %d", name, (int)size, nofElements).c_str());
+}
+
+static void testSpaceOverhead( std::size_t size)
+{
+	std::vector<uint64_t> words = randomWords( size, 500);
+	strus::RankSelectBitVector bv( words.data(), size);
+	std::size_t rawsize = (size + 7) / 8;
+	std::size_t overhead = bv.allocated() - rawsize;
+	std::cerr << "memory used for " << size << " bits: " << bv.allocated() << " bytes, index " << overhead << " bytes (" << (overhead * 1000 / rawsize) / 10.0 << "%)" << std::endl;
+	if (overhead * 100 >= rawsize * 5) throw std::runtime_error( "space overhead of rank select index exceeds 5%");
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testRankSelectBitVector" << std::endl;
+			return 0;
+		}
+		if (argc > 1) throw std::runtime_error( "too many arguments");
+
+		checkRankSelect( strus::RankSelectBitVector(), std::vector<bool>(), "empty");
+		static const std::size_t sizes[] = {0,1,63,64,65,511,512,513,2047,2048,2049,6000,100000,1000000};
+		static const int densities[] = {0,1,50,500,990,1000};
+		std::size_t si = 0;
+		for (; si < sizeof(sizes)/sizeof(sizes[0]); ++si)
+		{
+			std::size_t di = 0;
+			for (; di < sizeof(densities)/sizeof(densities[0]); ++di)
+			{
+				testWords( sizes[ si], densities[ di]);
+			}
+		}
+		testBitSet<64>( 300);
+		testBitSet<100>( 500);
+		testBitSet<512>( 100);
+		testBitSet<4096>( 700);
+		testSparseSet<strus::dynamic_bitset>( "dynamic_bitset", 10000, 100);
+		testSparseSet<strus::dynamic_bitset>( "dynamic_bitset", 1000000, 20000);
+		testSparseSet<strus::compressed_bitset>( "compressed_bitset", 10000, 100);
+		testSparseSet<strus::compressed_bitset>( "compressed_bitset", 1000000, 20000);
+		testSpaceOverhead( 10000000);
+
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
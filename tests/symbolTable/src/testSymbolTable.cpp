@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/symbolTable.hpp"
+#include "strus/base/mappedSymbolTable.hpp"
+#include "strus/base/frozenSymbolTable.hpp"
+#include "strus/base/fileio.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/string_format.hpp"
+#include "strus/base/unordered_map.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <string>
+#include <set>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+static std::string randomKey( int maxlen)
+{
+	std::string rt;
+	int len = g_random.get( 0, maxlen+1);
+	for (int li=0; li<len; ++li)
+	{
+		rt.push_back( (char)g_random.get( 0, 256));
+	}
+	return rt;
+}
+
+/// \brief Fill a symbol table with random keys and return the keys ordered by handle
+static std::vector<std::string> fillSymbolTable( strus::SymbolTable& symtab, int nofKeys)
+{
+	std::vector<std::string> rt;
+	for (int ki=0; ki<nofKeys; ++ki)
+	{
+		std::string key = randomKey( ki % 3 ? 8 : 40);
+		uint32_t id = symtab.getOrCreate( key);
+		if (!id) throw std::runtime_error( "getOrCreate failed");
+		if (symtab.isNew())
+		{
+			if (id != rt.size()+1) throw std::runtime_error( strus::string_format( "handle %u of new key not as expected %u", id, (unsigned int)rt.size()+1));
+			rt.push_back( key);
+		}
+		else if (rt.at( id-1) != key)
+		{
+			throw std::runtime_error( strus::string_format( "handle %u of existing key does not match", id));
+		}
+	}
+	return rt;
+}
+
+template <class SymbolTableType>
+static void checkSymbolTable( const char* name, const SymbolTableType& symtab, const std::vector<std::string>& keys)
+{
+	if (symtab.size() != keys.size())
+	{
+		throw std::runtime_error( strus::string_format( "size of %s %d does not match expected %d", name, (int)symtab.size(), (int)keys.size()));
+	}
+	std::vector<std::string>::const_iterator ki = keys.begin(), ke = keys.end();
+	for (uint32_t id=1; ki != ke; ++ki,++id)
+	{
+		uint32_t res = symtab.get( ki->c_str(), ki->size());
+		if (res != id)
+		{
+			throw std::runtime_error( strus::string_format( "lookup of key with handle %u in %s returned %u", id, name, res));
+		}
+		const char* keystr = symtab.key( id);
+		if (!keystr || 0!=std::memcmp( keystr, ki->c_str(), ki->size()+1))
+		{
+			throw std::runtime_error( strus::string_format( "inverse lookup of handle %u in %s failed", id, name));
+		}
+	}
+	std::set<std::string> keyset( keys.begin(), keys.end());
+	int nofMisses = 0;
+	for (int mi=0; mi<(int)keys.size(); ++mi)
+	{
+		std::string key = randomKey( 40);
+		if (keyset.find( key) != keyset.end()) continue;
+		if (symtab.get( key) != 0) throw std::runtime_error( strus::string_format( "lookup of undefined key in %s returned a handle", name));
+		++nofMisses;
+	}
+	if (symtab.key( 0) != 0 || symtab.key( keys.size()+1) != 0)
+	{
+		throw std::runtime_error( strus::string_format( "inverse lookup of undefined handle in %s returned a key", name));
+	}
+	std::cerr << "checked " << keys.size() << " keys and " << nofMisses << " misses in " << name << std::endl;
+}
+
+/// \brief Write a symbol table snapshot with a value overwritten
+template <typename ValueType>
+static void writeCorruptSnapshot( const char* filename, const std::string& content, uint64_t pos, ValueType value)
+{
+	std::string corrupt( content);
+	std::memcpy( const_cast<char*>( corrupt.c_str()) + pos, &value, sizeof(value));
+	if (0!=strus::writeFile( filename, corrupt)) throw std::runtime_error( "failed to write corrupt symbol table snapshot");
+}
+
+/// \brief Write a symbol table snapshot with a value of the header or the section bounds overwritten and check that loading it is rejected
+template <typename ValueType>
+static void testCorruptSnapshot( const char* filename, const std::string& content, uint64_t pos, ValueType value, const char* what)
+{
+	writeCorruptSnapshot( filename, content, pos, value);
+	strus::MappedSymbolTable mapped( 0/*errorhnd*/);
+	if (mapped.load( filename)) throw std::runtime_error( strus::string_format( "corrupt symbol table snapshot (%s) not rejected", what));
+}
+
+/// \brief Write a symbol table snapshot with a value inside a section overwritten, not checked by load, and check that accessing it never returns a wrong result
+template <typename ValueType>
+static void testCorruptContent( const char* filename, const std::string& content, uint64_t pos, ValueType value, const std::vector<std::string>& keys, const char* what)
+{
+	writeCorruptSnapshot( filename, content, pos, value);
+	strus::MappedSymbolTable mapped( 0/*errorhnd*/);
+	if (!mapped.load( filename)) throw std::runtime_error( strus::string_format( "symbol table snapshot with corrupt content (%s) not loaded", what));
+	std::vector<std::string>::const_iterator ki = keys.begin(), ke = keys.end();
+	for (uint32_t id=1; ki != ke; ++ki,++id)
+	{
+		uint32_t res = mapped.get( ki->c_str(), ki->size());
+		if (res && res != id) throw std::runtime_error( strus::string_format( "lookup in symbol table snapshot with corrupt content (%s) returned wrong handle", what));
+		const char* keystr = mapped.key( id);
+		if (keystr && std::strlen( keystr) > content.size()) throw std::runtime_error( strus::string_format( "inverse lookup in symbol table snapshot with corrupt content (%s) returned key out of range", what));
+	}
+}
+
+static void testSnapshot( const strus::SymbolTable& symtab, const std::vector<std::string>& keys)
+{
+	const char* filename = "symtab.snapshot";
+	if (!symtab.save( filename)) throw std::runtime_error( "failed to save symbol table snapshot");
+	{
+		strus::MappedSymbolTable mapped( 0/*errorhnd*/);
+		if (!mapped.load( filename)) throw std::runtime_error( "failed to load symbol table snapshot");
+		checkSymbolTable( "mapped symbol table", mapped, keys);
+	}
+	std::string content;
+	if (0!=strus::readFile( filename, content)) throw std::runtime_error( "failed to read symbol table snapshot");
+	//... header layout: magic[8], version, byteOrderMark, nofSymbols, hashTableSize (uint32_t), keyOffsetsPos, hashTablePos, stringsPos, fileSize (uint64_t)
+	uint32_t nofSymbols;
+	uint64_t keyOffsetsPos;
+	uint64_t hashTablePos;
+	std::memcpy( &nofSymbols, content.c_str() + 16, sizeof(nofSymbols));
+	std::memcpy( &keyOffsetsPos, content.c_str() + 24, sizeof(keyOffsetsPos));
+	std::memcpy( &hashTablePos, content.c_str() + 32, sizeof(hashTablePos));
+	uint64_t slotpos = hashTablePos;
+	for (; nofSymbols > 0; slotpos += 8)
+	{
+		uint32_t slotid;
+		std::memcpy( &slotid, content.c_str() + slotpos + 4, sizeof(slotid));
+		if (slotid) break;
+	}
+
+	testCorruptSnapshot( filename, content, 0, (uint8_t)'X', "magic");
+	testCorruptSnapshot( filename, content, 20, (uint32_t)3, "hash table size not a power of 2");
+	testCorruptSnapshot( filename, content, 20, (uint32_t)1 << 31, "hash table size not matching the section positions");
+	testCorruptSnapshot( filename, content, keyOffsetsPos, (uint64_t)1, "first key offset");
+	testCorruptSnapshot( filename, content, keyOffsetsPos + nofSymbols * 8, (uint64_t)1 << 40, "last key offset");
+	if (nofSymbols > 0)
+	{
+		testCorruptSnapshot( filename, content, content.size() - 1, (uint8_t)'X', "string area not terminated");
+	}
+	if (nofSymbols >= 2)
+	{
+		testCorruptContent( filename, content, keyOffsetsPos + 8, (uint64_t)1 << 40, keys, "key offset out of range");
+		testCorruptContent( filename, content, keyOffsetsPos + 8, (uint64_t)0, keys, "key offsets not increasing");
+	}
+	testCorruptContent( filename, content, slotpos + 4, nofSymbols + 1, keys, "handle in hash table out of range");
+	(void)strus::removeFile( filename);
+}
+
+static void testFrozen( const strus::SymbolTable& symtab, const std::vector<std::string>& keys)
+{
+	strus::FrozenSymbolTable frozen( 0/*errorhnd*/);
+	if (!frozen.build( symtab)) throw std::runtime_error( "failed to build frozen symbol table");
+	checkSymbolTable( "frozen symbol table", frozen, keys);
+	for (uint32_t id=1; id <= keys.size(); ++id)
+	{
+		if (frozen.keySize( id) != keys[ id-1].size()) throw std::runtime_error( strus::string_format( "size of key with handle %u in frozen symbol table does not match", id));
+	}
+	std::size_t keyBytes = 0;
+	std::vector<std::string>::const_iterator ki = keys.begin(), ke = keys.end();
+	for (; ki != ke; ++ki) keyBytes += ki->size() + 1;
+	std::size_t overhead = frozen.memoryUsage() - keyBytes;
+	std::cerr << "frozen symbol table uses " << frozen.memoryUsage() << " bytes for " << keys.size() << " keys, " << overhead << " bytes besides the keys" << std::endl;
+	//... documented overhead: 8 bits hash function, 32 bits slot to handle, 32 bits handle to key per key
+	if (overhead > keys.size() * 9 + 64) throw std::runtime_error( "memory used by frozen symbol table besides the keys exceeds 9 bytes per key");
+}
+
+static void testClear( strus::SymbolTable& symtab, const std::vector<std::string>& keys)
+{
+	symtab.clear();
+	if (!symtab.empty() || (!keys.empty() && symtab.get( keys[0]) != 0)) throw std::runtime_error( "symbol table not empty after clear");
+	std::vector<std::string> refilled = fillSymbolTable( symtab, 1000);
+	checkSymbolTable( "symbol table refilled after clear", symtab, refilled);
+}
+
+static double secondsSince( std::clock_t start)
+{
+	return (std::clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+/// \brief Compare the times of inserts, lookups and misses of the symbol table with a node based hash map of strings
+static void benchmarkSymbolTable( int nofKeys)
+{
+	std::vector<std::string> keys;
+	std::vector<std::string> misses;
+	for (int ki=0; ki<nofKeys; ++ki)
+	{
+		keys.push_back( strus::string_format( "key_%d_%d", ki, g_random.get( 0, 1000000)));
+		misses.push_back( strus::string_format( "miss_%d_%d", ki, g_random.get( 0, 1000000)));
+	}
+	strus::SymbolTable symtab( 0/*errorhnd*/);
+	strus::unordered_map<std::string,uint32_t> map;
+	uint32_t checksum = 0;
+
+	std::clock_t start = std::clock();
+	std::vector<std::string>::const_iterator ki = keys.begin(), ke = keys.end();
+	for (; ki != ke; ++ki) checksum += symtab.getOrCreate( *ki);
+	double symtabInsert = secondsSince( start);
+	start = std::clock();
+	for (ki = keys.begin(); ki != ke; ++ki) checksum += map.insert( strus::unordered_map<std::string,uint32_t>::value_type( *ki, map.size()+1)).first->second;
+	double mapInsert = secondsSince( start);
+
+	start = std::clock();
+	for (ki = keys.begin(); ki != ke; ++ki) checksum += symtab.get( *ki);
+	double symtabFind = secondsSince( start);
+	start = std::clock();
+	for (ki = keys.begin(); ki != ke; ++ki) checksum += map.find( *ki)->second;
+	double mapFind = secondsSince( start);
+
+	std::vector<std::string>::const_iterator mi = misses.begin(), me = misses.end();
+	start = std::clock();
+	for (; mi != me; ++mi) checksum += symtab.get( *mi);
+	double symtabMiss = secondsSince( start);
+	start = std::clock();
+	for (mi = misses.begin(); mi != me; ++mi) checksum += (map.find( *mi) != map.end());
+	double mapMiss = secondsSince( start);
+
+	if (checksum != (uint32_t)((uint64_t)nofKeys * (nofKeys + 1) * 2)) throw std::runtime_error( "results of symbol table benchmark not as expected");
+	std::cerr << strus::string_format( "%d keys, seconds for symbol table / node based hash map: insert %.3f / %.3f, find %.3f / %.3f, miss %.3f / %.3f",
+			nofKeys, symtabInsert, mapInsert, symtabFind, mapFind, symtabMiss, mapMiss) << std::endl;
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofKeys = 10000;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testSymbolTable [<nofkeys>]" << std::endl;
+			std::cout << "       <nofkeys> :Number of keys inserted (default 10000)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofKeys = parseNumber( argv[1]);
+		if (argc > 2) throw std::runtime_error( "too many arguments");
+
+		strus::SymbolTable symtab( 0/*errorhnd*/);
+		std::vector<std::string> keys = fillSymbolTable( symtab, nofKeys);
+		checkSymbolTable( "symbol table", symtab, keys);
+		testSnapshot( symtab, keys);
+		testFrozen( symtab, keys);
+		testClear( symtab, keys);
+		benchmarkSymbolTable( nofKeys * 50);
+
+		strus::SymbolTable emptytab( 0/*errorhnd*/);
+		testSnapshot( emptytab, std::vector<std::string>());
+		testFrozen( emptytab, std::vector<std::string>());
+
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2019 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+#include "strus/base/timerWheel.hpp"
+#include "strus/base/pseudoRandom.hpp"
+#include "strus/base/string_format.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <limits>
+
+#undef STRUS_LOWLEVEL_DEBUG
+
+static strus::PseudoRandom g_random;
+
+struct TimerRecord
+{
+	uint64_t expiry;
+	uint64_t firedAt;
+	strus::TimerWheel::TimerId id;
+	bool cancelled;
+
+	TimerRecord()
+		:expiry(0),firedAt(0),id(0),cancelled(false){}
+};
+
+static std::vector<TimerRecord> g_records;
+static int g_nofDeleted = 0;
+
+static void timerProc( void*)
+{}
+
+static void timerDeleter( void*)
+{
+	++g_nofDeleted;
+}
+
+static uint64_t randomDelta()
+{
+	switch (g_random.get( 0, 100) / 25)
+	{
+		case 0: return g_random.get( 0, 300);
+		case 1: return g_random.get( 0, 1<<16);
+		case 2: return g_random.get( 0, 1<<24);
+		default:
+			if (g_random.get( 0, 10) == 0)
+			{
+				//... out of the range of the wheel
+				return ((uint64_t)g_random.get( 0, 1<<3) << 31) + g_random.get( 0, 1<<30);
+			}
+			return ((uint64_t)g_random.get( 0, 1<<2) << 30) + g_random.get( 0, 1<<30);
+	}
+}
+
+static uint64_t randomStep()
+{
+	switch (g_random.get( 0, 3))
+	{
+		case 0: return g_random.get( 1, 300);
+		case 1: return g_random.get( 1, 70000);
+		default: return g_random.get( 1, 1<<26);
+	}
+}
+
+static void scheduleTimer( strus::TimerWheel& wheel)
+{
+	TimerRecord rec;
+	rec.expiry = wheel.now() + randomDelta();
+	if (rec.expiry <= wheel.now()) rec.expiry = wheel.now() + 1;
+	rec.id = wheel.schedule( rec.expiry, &timerProc, (void*)(uintptr_t)g_records.size(), &timerDeleter);
+	g_records.push_back( rec);
+}
+
+static void checkExpired( const std::vector<strus::TimerWheel::Timer>& expired, uint64_t prevNow, uint64_t now)
+{
+	std::vector<strus::TimerWheel::Timer>::const_iterator ei = expired.begin(), ee = expired.end();
+	for (; ei != ee; ++ei)
+	{
+		std::size_t recidx = (std::size_t)(uintptr_t)ei->context;
+		TimerRecord& rec = g_records[ recidx];
+		if (rec.cancelled) throw std::runtime_error( strus::string_format( "cancelled timer %d expired", (int)recidx));
+		if (rec.firedAt) throw std::runtime_error( strus::string_format( "timer %d expired twice", (int)recidx));
+		if (rec.expiry <= prevNow || rec.expiry > now)
+		{
+			throw std::runtime_error( strus::string_format( "timer %d with expiry %lu expired between %lu and %lu", (int)recidx, (unsigned long)rec.expiry, (unsigned long)prevNow, (unsigned long)now));
+		}
+		rec.firedAt = now;
+	}
+}
+
+static int parseNumber( const char* arg)
+{
+	char const* ai = arg;
+	for (; *ai >= '0' && *ai <= '9'; ++ai){}
+	if (*ai) throw std::runtime_error("non negative number expected as argument");
+	return ::atoi(arg);
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		int nofTimers = 100000;
+		if (argc > 1 && (0==std::strcmp( argv[1], "-h") || 0==std::strcmp( argv[1], "--help")))
+		{
+			std::cout << "Usage: testTimerWheel [<noftimers>]" << std::endl;
+			std::cout << "       <noftimers> :Number of timers scheduled (default 100000)" << std::endl;
+			return 0;
+		}
+		if (argc > 1) nofTimers = parseNumber( argv[1]);
+		if (argc > 2) throw std::runtime_error( "too many arguments");
+
+		//... start close to a wrap around of the highest level
+		strus::TimerWheel wheel( ((uint64_t)1 << 32) - 1000);
+		g_records.reserve( nofTimers);
+
+		// [1] Schedule the first half of the timers and cancel some of them:
+		for (int ti=0; ti < nofTimers / 2; ++ti)
+		{
+			scheduleTimer( wheel);
+		}
+		int nofCancelled = 0;
+		for (int ci=0; ci < nofTimers / 20; ++ci)
+		{
+			TimerRecord& rec = g_records[ g_random.get( 0, g_records.size())];
+			strus::TimerWheel::Timer timer;
+			bool success = wheel.cancel( rec.id, timer);
+			if (success == rec.cancelled) throw std::runtime_error( "unexpected result of cancel");
+			if (success)
+			{
+				if (timer.expiry != rec.expiry || timer.deleter != &timerDeleter) throw std::runtime_error( "unexpected timer cancelled");
+				timer.deleter( timer.context);
+				rec.cancelled = true;
+				++nofCancelled;
+			}
+		}
+		// [2] Advance the clock and schedule the other timers meanwhile:
+		std::vector<strus::TimerWheel::Timer> expired;
+		std::size_t nofExpired = 0;
+		int nofAdvance = 0;
+		while (wheel.size() || (int)g_records.size() < nofTimers)
+		{
+			uint64_t prevNow = wheel.now();
+			uint64_t now = prevNow + randomStep();
+			expired.clear();
+			wheel.advance( now, expired);
+			if (wheel.now() != now) throw std::runtime_error( "clock not advanced");
+			checkExpired( expired, prevNow, now);
+			nofExpired += expired.size();
+			++nofAdvance;
+
+			int nofSchedule = nofTimers - g_records.size();
+			if (nofSchedule > 1000) nofSchedule = g_random.get( 0, 1000);
+			for (int ti=0; ti < nofSchedule; ++ti)
+			{
+				scheduleTimer( wheel);
+			}
+			if (!expired.empty())
+			{
+				//... handles of expired timers must not be accepted anymore
+				strus::TimerWheel::Timer timer;
+				std::size_t recidx = (std::size_t)(uintptr_t)expired.back().context;
+				if (wheel.cancel( g_records[ recidx].id, timer)) throw std::runtime_error( "expired timer cancelled");
+			}
+		}
+		if ((int)nofExpired + nofCancelled != nofTimers || g_nofDeleted != nofCancelled)
+		{
+			throw std::runtime_error( strus::string_format( "%d timers expired and %d cancelled of %d", (int)nofExpired, nofCancelled, nofTimers));
+		}
+		if (wheel.nextEventTime() != std::numeric_limits<uint64_t>::max()) throw std::runtime_error( "events of empty timer wheel");
+		std::cerr << "expired " << nofExpired << " timers in " << nofAdvance << " steps, " << nofCancelled << " cancelled" << std::endl;
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::bad_alloc& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "ERROR " << err.what() << std::endl;
+	}
+	return -1;
+}
+